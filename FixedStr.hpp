@@ -6,8 +6,40 @@
 #include <cstdarg>
 #include <cstring>
 #include <wchar.h>
+#include <wctype.h>
 #include <stdexcept>
 #include <limits.h>
+#include <functional>
+#include <type_traits>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<string_view>)
+#include <string_view>
+#define FIXED_STR_HAS_STRING_VIEW 1
+#endif
+#endif
+#if defined(__cpp_impl_three_way_comparison) && __cpp_impl_three_way_comparison >= 201907L
+#include <compare>
+#define FIXED_STR_HAS_SPACESHIP 1
+#endif
+#include "FixedStrAlloc.hpp"
+#include "FixedStrSimd.hpp"
+#include "FixedStrNum.hpp"
+#include "FixedStrHash.hpp"
+#include "FixedStrParse.hpp"
+// POSIX 2008 wide memory streams; counts long wide formats without
+// converting them to multibyte.
+#if !defined(_MSC_VER) && (defined(__GLIBC__) || defined(__APPLE__) || defined(__linux__) || \
+                           defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__))
+#define FIXED_STR_HAS_WMEMSTREAM 1
+#endif
+#ifdef FIXED_STR_STATS
+#include "FixedStrStats.hpp"
+#define FIXED_STR_STATS_RECORD(kind, alloc, charSize, newLen, wasOverflow, isOverflow, bytes) \
+    FixedStrStats::record (FixedStrStats::kind, alloc, charSize, newLen, wasOverflow, isOverflow, bytes)
+#else
+// compiled out.
+#define FIXED_STR_STATS_RECORD(kind, alloc, charSize, newLen, wasOverflow, isOverflow, bytes)
+#endif
 
 /*
  *  FixedStr
@@ -15,6 +47,18 @@
  *  cases where the max reasonable size is known at compile time.
  */
 
+template<size_t _AllocSizeT, typename _CharT>
+class BaseStr;
+
+template<typename _CharT>
+class BaseStrView;
+
+template<typename _CharT, size_t _PiecesT>
+class BaseStrBuilder;
+
+template<typename _CharT, typename _LhsT, typename _RhsT>
+class BaseStrConcat;
+
 namespace {
     
 ////////////////////////
@@ -23,7 +67,7 @@ namespace {
 // FixedStr<10> and FixedStr<11> to each have their own impls of all the code!
 ////////////////////////
 
-    inline void my_va_copy(va_list& newVa, va_list& origVa) {
+    inline void my_va_copy(va_list& newVa, va_list origVa) {
 #ifndef _MSC_VER
         // C99 macro, but widely available.
         va_copy(newVa, origVa);
@@ -34,6 +78,98 @@ namespace {
 #endif
     }
 
+    // A length of -1 (the overflow is used), as the unsigned it's stored in.
+    const unsigned int USING_OVERFLOW = static_cast<unsigned int> (-1);
+
+    // Overflow blocks have a small header in front recording where they
+    // came from, so they can be given back to the right resource.
+    struct OverflowHeader {
+        FixedStrResource*   resource;
+        size_t              bytes;
+    };
+
+    // Rounds up to what a typical malloc would hand out anyway:  16 byte
+    // steps to 128, then four steps per doubling.
+    inline size_t sizeClass (size_t bytes) {
+        if (bytes <= 128) {
+            return (bytes + 15) & ~static_cast<size_t> (15);
+        }
+        size_t pow = 128;
+        while (pow < bytes / 2) {
+            pow *= 2;
+        }
+        const size_t step = pow / 4;
+        return (bytes + step - 1) / step * step;
+    }
+
+    // Block size for 'alloc' chars plus terminator, per the growth policy.
+    template<typename _CharT>
+    inline size_t overflowBytes (size_t alloc) {
+        size_t bytes = sizeof (OverflowHeader) + (alloc + 1) * sizeof (_CharT);
+        return FixedStrGrowth::current().roundToSizeClass ? sizeClass (bytes) : bytes;
+    }
+
+    // Chars a block of 'bytes' holds, not counting the terminator.
+    template<typename _CharT>
+    inline unsigned int capacityOfBytes (size_t bytes) {
+        size_t chars = (bytes - sizeof (OverflowHeader)) / sizeof (_CharT) - 1;
+        return chars < UINT_MAX ? static_cast<unsigned int> (chars) : UINT_MAX - 1;
+    }
+
+    // What to allocate when growing to 'needed' chars.
+    inline size_t growTo (size_t needed) {
+        unsigned long long percent = FixedStrGrowth::current().growPercent;
+        unsigned long long sz = needed * (percent < 100 ? 100 : percent) / 100;
+        if (sz >= UINT_MAX) sz = UINT_MAX - 1;
+        return sz < needed ? needed : static_cast<size_t> (sz);
+    }
+
+    // Whether a spilled string now 'len' long goes back to its array
+    // ('alloc' chars; len <= alloc).
+    inline bool backInline (size_t len, size_t alloc) {
+        unsigned long long percent = FixedStrGrowth::current().inlinePercent;
+        return percent >= 100 ||
+               (percent > 0 && static_cast<unsigned long long> (len) * 100 <= alloc * percent);
+    }
+
+    // Whether an overflow of 'capacity' is too big for 'len'.
+    inline bool shrinkOverflow (size_t len, size_t capacity) {
+        unsigned long long percent = FixedStrGrowth::current().shrinkPercent;
+        return static_cast<unsigned long long> (len) * 100 < capacity * percent;
+    }
+
+    // Returns space for 'alloc' chars plus terminator (maybe more, per the
+    // growth policy; see overflowCapacity()).
+    // 'resource' NULL means the current thread's default.
+    template<typename _CharT>
+    inline _CharT* overflowNew (size_t alloc, FixedStrResource* resource) {
+        if (!resource) resource = FixedStrResource::getDefault();
+        size_t bytes = overflowBytes<_CharT> (alloc);
+        OverflowHeader* header = static_cast<OverflowHeader*> (resource->allocate (bytes));
+        header->resource = resource;
+        header->bytes =    bytes;
+        return reinterpret_cast<_CharT*> (header + 1);
+    }
+
+    // Which resource an existing overflow came from.
+    inline FixedStrResource* overflowResource (const void* overflow) {
+        return (static_cast<const OverflowHeader*> (overflow) - 1)->resource;
+    }
+
+    // How many chars an existing overflow holds (not counting the terminator).
+    template<typename _CharT>
+    inline unsigned int overflowCapacity (const _CharT* overflow) {
+        const OverflowHeader* header = reinterpret_cast<const OverflowHeader*> (overflow) - 1;
+        return capacityOfBytes<_CharT> (header->bytes);
+    }
+
+    // Null is ok.
+    inline void overflowDelete (void* overflow) {
+        if (!overflow) return;
+        OverflowHeader* header = static_cast<OverflowHeader*> (overflow) - 1;
+        header->resource->deallocate (header, header->bytes);
+    }
+
     // Moved outside to avoid template bloat.
     // returns new overflowAlloc.    
     template<typename _CharT>
@@ -66,32 +202,48 @@ namespace {
                     unsigned int    overflowLenIn,
                     unsigned int*   overflowlenOut) {
 
-        if (newStrLen == 0) {
-            if (*len == -1) delete[] overflowIn;
-            *len = 0;
-            // not dereferencing 'newStr' -- allows a null pointer passed in.
-            array[0] = '\0';
-            return;
-        }
-        if (newStrLen <= alloc) {
+        const bool wasOverflow = *len == USING_OVERFLOW;
+        // A spilled string may keep its overflow (see FixedStrGrowth).
+        const bool shrink = wasOverflow && shrinkOverflow (newStrLen, overflowAllocIn);
+        if (newStrLen <= alloc && (!wasOverflow || shrink || backInline (newStrLen, alloc))) {
             // fits in the static array.
-            // get rid of existing heap if needed.
-            if (*len == -1) delete[] overflowIn;
-            memcpy (array, newStr, newStrLen * sizeof (_CharT));
+            FIXED_STR_STATS_RECORD (ASSIGN, alloc, sizeof (_CharT), newStrLen, wasOverflow, false, 0);
+            // 'newStr' may be part of this string (a view of it), so move
+            // rather than copy, and only then get rid of existing heap.
+            // Not dereferencing 'newStr' if 0 -- allows a null pointer passed in.
+            if (newStrLen > 0) {
+                memmove (array, newStr, newStrLen * sizeof (_CharT));
+            }
             array[newStrLen] = '\0';
+            if (wasOverflow) overflowDelete (overflowIn);
             *len = newStrLen;
             return;
         } // fits
         else {
-            // too big for static array.
-            if (*len != -1 || newStrLen > overflowAllocIn) {
-                // existing alloc too small.
-                if (*len == -1) delete[] overflowIn;
-                // +1:  allow for terminator.
-                *overflowOut = new _CharT[newStrLen + 1];
-                *overflowAllocOut = newStrLen;
-            }                        
-            memcpy (*overflowOut, newStr, newStrLen * sizeof (_CharT));
+            // too big for static array (or the overflow's being kept).
+            if (!wasOverflow || newStrLen > overflowAllocIn || shrink) {
+                // existing alloc too small (or too big).  Only a shrink
+                // leaves room to grow.
+                _CharT* newOverflow = overflowNew<_CharT> (shrink ? growTo (newStrLen) : newStrLen,
+                        wasOverflow ? overflowResource (overflowIn) : NULL);
+                FIXED_STR_STATS_RECORD (ASSIGN, alloc, sizeof (_CharT), newStrLen, wasOverflow, true,
+                                        (overflowCapacity (newOverflow) + 1) * sizeof (_CharT));
+                // Copied before the old block goes; 'newStr' may be part of it.
+                memcpy (newOverflow, newStr, newStrLen * sizeof (_CharT));
+                // A string that's already spilled sticks with its resource.
+                if (wasOverflow) overflowDelete (overflowIn);
+                *overflowOut = newOverflow;
+                *overflowAllocOut = overflowCapacity (newOverflow);
+            }
+            else {
+                // fits in existing overflow.
+                FIXED_STR_STATS_RECORD (ASSIGN, alloc, sizeof (_CharT), newStrLen, true, true, 0);
+                *overflowOut = overflowIn;
+                *overflowAllocOut = overflowAllocIn;
+                if (newStrLen > 0) {
+                    memmove (*overflowOut, newStr, newStrLen * sizeof (_CharT));
+                }
+            }
             (*overflowOut)[newStrLen] = '\0';
              *overflowlenOut = newStrLen;
              // The -1 indicates that the overflow is used.
@@ -125,42 +277,59 @@ namespace {
         size_t sizeNeeded = realLen + newStrLen;
         _CharT* target = NULL;
         bool newOverflow = false;
+#ifdef FIXED_STR_STATS
+        bool wasOverflow = *len == USING_OVERFLOW;
+        size_t statsBytes = 0;
+#endif
         
         // not a loop; break out idiom.
         do {
-            if (sizeNeeded <= alloc) {
-                // fits in array
-                target = array;
-                break;
-            }
-            if (*len == -1 && sizeNeeded <= overflowAllocIn) {
-                // fits in existing heap alloc
+            if (*len == USING_OVERFLOW && sizeNeeded <= overflowAllocIn) {
+                // fits in existing heap alloc (even if it would fit the
+                // array:  that's been reserved or kept on purpose).
                 *overflowAllocOut = overflowAllocIn;
                 target = overflowIn;
                 newOverflow = true;
                 break;
             }
-            unsigned int expandSz = sizeNeeded*2;
+            if (sizeNeeded <= alloc) {
+                // fits in array
+                target = array;
+                if (*len == USING_OVERFLOW) {
+                    // Overflow smaller than the array; shouldn't happen but
+                    // bring the content back.
+                    memcpy (array, overflowIn, realLen * sizeof (_CharT));
+                }
+                break;
+            }
+            size_t expandSz = growTo (sizeNeeded);
             if (*len != -1) {
                 // existing array but out of space.  Need to use overflow.
                 // We need to copy the existing content to the new space.
                 // (but the appended portion occurs below)
-                // +1:  allow for terminator.
-                target = new _CharT[expandSz+1];
+                target = overflowNew<_CharT> (expandSz, NULL);
                 // original terminator isn't copied, because after doing this
                 // it's expected we'll append to the string.
                 memcpy (target, array, realLen * sizeof (_CharT));
-                *overflowAllocOut = expandSz;
+                *overflowAllocOut = overflowCapacity (target);
                 newOverflow = true;
+#ifdef FIXED_STR_STATS
+                statsBytes = (*overflowAllocOut + 1) * sizeof (_CharT);
+#endif
                 break;
             }
             // existing overflow but out of space.
-            target  = new _CharT[expandSz+1];
+            target  = overflowNew<_CharT> (expandSz, overflowResource (overflowIn));
             memcpy (target, overflowIn, realLen * sizeof (_CharT));
-            delete [] overflowIn;
-            *overflowAllocOut = expandSz;
+            // the old block goes below; 'newStr' may be part of it.
+            *overflowAllocOut = overflowCapacity (target);
             newOverflow = true;
+#ifdef FIXED_STR_STATS
+            statsBytes = (*overflowAllocOut + 1) * sizeof (_CharT);
+#endif
         } while (false);
+        FIXED_STR_STATS_RECORD (APPEND, alloc, sizeof (_CharT), sizeNeeded,
+                                wasOverflow, newOverflow, statsBytes);
         
         // if 'newStrLen' 0 not dereferencing 'newStr' -- allows a null pointer passed in.          
         if (newStrLen > 0) {
@@ -168,7 +337,7 @@ namespace {
             realLen += newStrLen;
             target[realLen] = '\0';
         }
-        if (*len == -1 && !newOverflow) delete[] overflowIn;
+        if (*len == USING_OVERFLOW && target != overflowIn) overflowDelete (overflowIn);
         if (newOverflow) {
             *len = -1;
             *overflowlenOut = realLen;
@@ -179,6 +348,66 @@ namespace {
         }
     }
 
+    // Finishes a format that went into the space we already had ('buff' is
+    // 'array' or 'overflowIn').  If it went into the overflow but would fit
+    // in the array it's moved back there, so the overflow doesn't stick
+    // (unless the growth policy keeps it).
+    template<typename _CharT>
+    inline void formatPlaced (
+                    const _CharT*   buff,
+                    size_t          resultLen,
+                    size_t          alloc,
+                    unsigned int*   len,
+                    _CharT*         array,
+                    _CharT*         overflowIn,
+                    _CharT**        overflowOut,
+                    unsigned int    overflowAllocIn,
+                    unsigned int*   overflowAllocOut,
+                    unsigned int*   overflowlenOut) {
+
+        if (*len != USING_OVERFLOW) {
+            // went into existing array.
+            *len = static_cast<unsigned int> (resultLen);
+        }
+        else if (resultLen <= alloc && (backInline (resultLen, alloc) ||
+                                        shrinkOverflow (resultLen, overflowAllocIn))) {
+            // went into existing overflow but fits in the array.
+            memcpy (array, buff, (resultLen + 1) * sizeof (_CharT));
+            overflowDelete (overflowIn);
+            *len = static_cast<unsigned int> (resultLen);
+        }
+        else if (shrinkOverflow (resultLen, overflowAllocIn)) {
+            // fits in a smaller overflow.
+            _CharT* smaller = overflowNew<_CharT> (growTo (resultLen), overflowResource (overflowIn));
+            memcpy (smaller, buff, (resultLen + 1) * sizeof (_CharT));
+            overflowDelete (overflowIn);
+            *len = -1;
+            *overflowOut = smaller;
+            *overflowAllocOut = overflowCapacity (smaller);
+            *overflowlenOut = static_cast<unsigned int> (resultLen);
+        }
+        else {
+            // stays in existing overflow.
+            *len = -1;
+            *overflowOut = overflowIn;
+            *overflowAllocOut = overflowAllocIn;
+            *overflowlenOut = static_cast<unsigned int> (resultLen);
+        }
+    }
+
+    // After a failed format the buffer may hold partial output, so the
+    // string is left empty rather than half-written.
+    template<typename _CharT>
+    inline void formatFailed (
+                    unsigned int*   len,
+                    _CharT*         array,
+                    _CharT*         overflowIn) {
+
+        if (*len == USING_OVERFLOW) overflowDelete (overflowIn);
+        *len = 0;
+        array[0] = '\0';
+    }
+
     inline bool formatImpl (
                     const char*     formatStr, 
                     va_list         *args,
@@ -216,45 +445,183 @@ namespace {
         if (required < 0) {
             // error
             va_end (argsHold);
+            formatFailed (len, array, overflowIn);
             return false;
         }
         if (required <= buffAlloc) {
             // it fit ok.
-            if (*len != -1) {
-                // went into existing array.
-                *len = required;
-            }
-            else {
-                // went into exising overflow.
-                // This will occur even if the new string will fit in the array.
-                // (might consider fixing)
-                *len = -1;
-                *overflowOut = overflowIn;
-                *overflowAllocOut = overflowAllocIn;
-                *overflowlenOut = required;
-            }
+            FIXED_STR_STATS_RECORD (FORMAT, alloc, sizeof (char), required,
+                                    *len == USING_OVERFLOW, *len == USING_OVERFLOW && required > alloc, 0);
+            formatPlaced (buff, required, alloc, len, array, overflowIn, overflowOut,
+                          overflowAllocIn, overflowAllocOut, overflowlenOut);
         }
         else {
             // It didn't fit.
             // This shouldn't be a common use case.
             // don't use asprintf() -- not standard.
-            char* overflowNew = new char[required+1];
-            int res = vsnprintf (overflowNew, required+1, formatStr, argsHold);
+            char* overflowNewBuff = overflowNew<char> (required,
+                        *len == USING_OVERFLOW ? overflowResource (overflowIn) : NULL);
+            int res = vsnprintf (overflowNewBuff, required+1, formatStr, argsHold);
             if (res < 0) {
                 va_end (argsHold);
-                delete [] overflowNew;
+                overflowDelete (overflowNewBuff);
+                formatFailed (len, array, overflowIn);
                 return false;
             }
-            if (*len == -1) delete [] overflowIn;
+            FIXED_STR_STATS_RECORD (FORMAT, alloc, sizeof (char), required,
+                                    *len == USING_OVERFLOW, true, required + 1);
+            if (*len == USING_OVERFLOW) overflowDelete (overflowIn);
             *len = -1;
-            *overflowOut = overflowNew;
-            *overflowAllocOut = required;
+            *overflowOut = overflowNewBuff;
+            *overflowAllocOut = overflowCapacity (overflowNewBuff);
             *overflowlenOut = required;
         }
         va_end (argsHold);
         return true;
     }
 
+#if !defined(_MSC_VER)
+    // A wide stream that's only written to for the length vfwprintf()
+    // returns.  One per thread, opened on first use and rewound each time,
+    // so after the first few formats it costs no allocation.  A wide
+    // memory stream where there is one (no conversion to multibyte, no
+    // system calls), else the null device.
+    struct WideCountingSink {
+        // The memory stream keeps a buffer as big as the longest output;
+        // past this many wchar_ts it's closed (freeing that) and reopened
+        // by the next count.
+        enum { KEEP = 1024 };
+
+        FILE*       file;
+        wchar_t*    buff;
+        size_t      len;
+        bool        inMemory;
+
+        WideCountingSink()
+            :
+            file    (NULL),
+            buff    (NULL),
+            len     (0),
+            inMemory(false)
+        {
+        }
+
+        ~WideCountingSink() {
+            close();
+        }
+
+        bool open() {
+            if (file) {
+                return true;
+            }
+#if defined(FIXED_STR_HAS_WMEMSTREAM)
+            file = open_wmemstream (&buff, &len);
+            inMemory = file != NULL;
+#endif
+            if (!file) {
+                file = fopen ("/dev/null", "w");
+            }
+            if (file) {
+                fwide (file, 1);
+            }
+            return file != NULL;
+        }
+
+        void close() {
+            if (file) {
+                fclose (file);
+                file = NULL;
+            }
+            free (buff);
+            buff =     NULL;
+            len =      0;
+            inMemory = false;
+        }
+
+        // What vswprintf() would need for 'formatStr', or -1.
+        int count (const wchar_t* formatStr, va_list* args) {
+            clearerr (file);
+            rewind (file);
+            va_list argsHere;
+            my_va_copy (argsHere, *args);
+            int required = vfwprintf (file, formatStr, argsHere);
+            va_end (argsHere);
+            if (required < 0 || (inMemory && required > KEEP)) {
+                close();
+            }
+            return required;
+        }
+    };
+
+    // This thread's sink, or NULL if neither stream could be opened.
+    inline WideCountingSink* wideCountingSink() {
+        static thread_local WideCountingSink sink;
+        return sink.open() ? &sink : NULL;
+    }
+#endif
+
+    // Formats into a new overflow, from 'resource', when the result didn't
+    // fit in the space we had.  The length is counted first (_vscwprintf()
+    // or printing to a counting stream), then vswprintf() writes straight
+    // into an overflow of exactly that size.
+    // Only fails if vswprintf() itself does (e.g. a bad conversion) or the
+    // result won't fit in an unsigned int.
+    inline bool wideFormatNew (
+                    const wchar_t*      formatStr,
+                    va_list*            args,
+                    // what didn't fit; only the last resort below uses it.
+                    size_t              tried,
+                    FixedStrResource*   resource,
+                    wchar_t**           out,
+                    size_t*             outLen) {
+
+        int required = -1;
+#if defined(_MSC_VER)
+        (void) tried;
+        va_list argsHere;
+        my_va_copy (argsHere, *args);
+        required = _vscwprintf (formatStr, argsHere);
+        va_end (argsHere);
+#else
+        WideCountingSink* sink = wideCountingSink();
+        if (sink) {
+            required = sink->count (formatStr, args);
+        }
+        else {
+            // Nothing tells us the length; keep trying a bigger buffer.  Bad
+            // conversions look the same as not fitting so this is the last
+            // resort.
+            size_t buffAlloc = tried < 64 ? 64 : tried;
+            while (buffAlloc < UINT_MAX / 2) {
+                buffAlloc *= 2;
+                wchar_t* buff = overflowNew<wchar_t> (buffAlloc, resource);
+                va_list argsHere;
+                my_va_copy (argsHere, *args);
+                int result = vswprintf (buff, buffAlloc+1, formatStr, argsHere);
+                va_end (argsHere);
+                if (result >= 0) {
+                    *out =    buff;
+                    *outLen = result;
+                    return true;
+                }
+                overflowDelete (buff);
+            }
+            return false;
+        }
+#endif
+        if (required < 0) {
+            return false;
+        }
+        wchar_t* buff = overflowNew<wchar_t> (required, resource);
+        if (vswprintf (buff, required + 1, formatStr, *args) < 0) {
+            overflowDelete (buff);
+            return false;
+        }
+        *out =    buff;
+        *outLen = required;
+        return true;
+    }
+
     inline bool wideFormatImpl (
                     const wchar_t*     formatStr,
                     va_list         *args,
@@ -288,57 +655,44 @@ namespace {
         
         // alloc+1:  we already have space for the null terminator.
         // Unlike vsnprintf() this returns -1 if it doesn't fit in
-        // the buffer (not the count needed).              
+        // the buffer (not the count needed).
         int result = vswprintf (buff, buffAlloc+1, formatStr, *args);
         if (result >= 0) {
-            if (*len != -1) {
-                // went into existing array.
-                *len = result;
-            }
-            else {
-                // went into exising overflow.
-                // This will occur even if the new string will fit in the array.
-                // (might consider fixing)
-                *len = -1;
-                *overflowOut = overflowIn;
-                *overflowAllocOut = overflowAllocIn;
-                *overflowlenOut = result;
-            }
+            va_end (argsHold);
+            FIXED_STR_STATS_RECORD (FORMAT, alloc, sizeof (wchar_t), result,
+                                    *len == USING_OVERFLOW, *len == USING_OVERFLOW && result > alloc, 0);
+            formatPlaced (buff, result, alloc, len, array, overflowIn, overflowOut,
+                          overflowAllocIn, overflowAllocOut, overflowlenOut);
             return true;
         }
         
-        // TODO:  If something like _vscwprintf is available, take advantage of it.
-        size_t maxIters = 8;
-        wchar_t* overflowNew = NULL;
-        for (size_t i = 0; i < maxIters; ++i) {
-            // Keep trying a bigger buffer until it fits.
-            // Inelegant but this is really abusing the purpose of this class.
-            buffAlloc *= 2;
-            delete [] overflowNew;
-            overflowNew = new wchar_t[buffAlloc+1];
-            
-            va_list argsHere;
-            my_va_copy (argsHere, argsHold);            
-            int result = vswprintf (overflowNew, buffAlloc+1, formatStr, argsHere);
-            if (result >= 0) {
-                if (*len == -1) delete[] overflowIn;
-                *len = -1;
-                *overflowOut = overflowNew;
-                *overflowAllocOut = buffAlloc;
-                *overflowlenOut = result;
-                va_end (argsHere);
-                return true;
-            }                            
-            va_end (argsHere);
-        }
-        // Punt; return; false; don't throw an exception.
-        // The trouble is callers may not be prepared to deal with exceptions
-        // vswprintf() and friends return bad status codes.
+        // Didn't fit (or a real error; wideFormatNew() finds out).
+        // A string that's already spilled sticks with its resource.
+        wchar_t* newBuff = NULL;
+        size_t   newLen =  0;
+        bool ok = wideFormatNew (formatStr, &argsHold, buffAlloc,
+                                 *len == USING_OVERFLOW ? overflowResource (overflowIn) : NULL,
+                                 &newBuff, &newLen);
         va_end (argsHold);
-        return false;
+        if (!ok) {
+            // return false; don't throw an exception.
+            // The trouble is callers may not be prepared to deal with exceptions
+            // vswprintf() and friends return bad status codes.
+            formatFailed (len, array, overflowIn);
+            return false;
+        }
+        FIXED_STR_STATS_RECORD (FORMAT, alloc, sizeof (wchar_t), newLen,
+                                *len == USING_OVERFLOW, true, (newLen + 1) * sizeof (wchar_t));
+        if (*len == USING_OVERFLOW) overflowDelete (overflowIn);
+        *len = -1;
+        *overflowOut = newBuff;
+        *overflowAllocOut = overflowCapacity (newBuff);
+        *overflowlenOut = static_cast<unsigned int> (newLen);
+        return true;
     }
         
-    // generic strlen()-type function.
+    // generic strlen()-type function.  strlen() and wcslen() are
+    // vectorized by the C library, so those are used where they fit.
     template<typename _CharT>
     inline size_t countLen (
                     const _CharT* str) {
@@ -353,7 +707,21 @@ namespace {
        return len;                      
     } 
 
+    template<>
+    inline size_t countLen (
+                    const char* str) {
+       return str ? strlen (str) : 0;
+    }
+
+    template<>
+    inline size_t countLen (
+                    const wchar_t* str) {
+       return str ? wcslen (str) : 0;
+    }
+
     // generic equality comparison.
+    // Equality doesn't care about signedness so it's just a byte compare;
+    // see FixedStrSimd.hpp.
     template<typename _CharT>
     inline bool isEqualImpl (
                     const _CharT*   lhs, 
@@ -364,191 +732,1216 @@ namespace {
         if (lhsLen != rhsLen) {
             return false;
         } 
-        
-        for (size_t i=0; i<lhsLen; ++i) {
-            if (*lhs != *rhs) {
-                return false;
-            }
-            ++lhs;
-            ++rhs;
-        }
-        return true;                           
+        return bytesEqual (lhs, rhs, lhsLen * sizeof (_CharT));
     }
 
-#if UINT_MAX == 4294967295 && CHAR_BIT == 8
-
-    // optimized equality check for char strings.
-    // Note the assumptions it makes for these sizes.
-    inline bool isEqualImpl_char (
-                    const char*   lhs, 
-                    size_t        lhsLen, 
-                    const char*   rhs, 
-                    size_t        rhsLen) {
-
-        if (lhsLen != rhsLen) {
-            return false;
-        } 
-        
-        const int* lhsRaw = reinterpret_cast<const int*> (lhs);
-        const int* rhsRaw = reinterpret_cast<const int*> (rhs);
+    // What characters get compared as for ordering.  Plain char is
+    // compared as unsigned to match strcmp() (by default gcc assumes plain
+    // char as signed).
+    template<typename _CharT>
+    struct CompareAs {
+        typedef _CharT type;
+    };
 
-        size_t big_loop = lhsLen / 4;
+    template<>
+    struct CompareAs<char> {
+        typedef unsigned char type;
+    };
 
-        // Comparing 4 bytes at a time.
-        // This is usually at least twice as fast but could be slower
-        // for comparing short strings due to the extra logic needed.
-        for (size_t i=0; i<big_loop; ++i) {
-            if (*lhsRaw != *rhsRaw) {
-                return false;
-            }
-            ++lhsRaw;
-            ++rhsRaw;
-        }
-        
-        size_t offset = big_loop * 4;
-        size_t remain = lhsLen - offset;
-        lhs += offset;
-        rhs += offset;
-        // assumes an int is 4 chars...
-        switch (remain) {
-            case 3:
-               if (*lhs != *rhs) {
-                  return false;
-               }
-               ++lhs;
-               ++rhs;
-            // intentional case fall-through.
-            case 2:
-               if (*lhs != *rhs) {
-                  return false;
-               }
-               ++lhs;
-               ++rhs;            
-            case 1:
-               if (*lhs != *rhs) {
-                  return false;
-               }
-        }
-        return true;        
-    }
-#endif
-        
+    // Finishes a three-way compare given the position of the first
+    // differing character (or the shorter length if there's none).
     template<typename _CharT, typename _UnsignedCharT>
-    inline bool isLessImpl (
+    inline int compareAt (
                     const _CharT*   lhs, 
                     size_t          lhsLen, 
                     const _CharT*   rhs, 
-                    size_t          rhsLen) {
-                    
-        for (size_t i=0; i<lhsLen; ++i) {
-            if (i >= rhsLen) {
-                // left hand side longer
-                return false;
-            }        
-            // ensure characters are compared as unsigned.
-            // This matches strcmp() behavior.
-            // (by default gcc assumes plain char as signed).
-            _UnsignedCharT lhsCh = static_cast<_UnsignedCharT> (*lhs);
-            _UnsignedCharT rhsCh = static_cast<_UnsignedCharT> (*rhs);
-            int diff = lhsCh - rhsCh;
-            if (diff != 0) {
-                return diff < 0 ? true : false;
-            }
-            ++lhs;
-            ++rhs;
-        } // each char.
-    
+                    size_t          rhsLen,
+                    size_t          pos) {
+
+        if (pos < lhsLen && pos < rhsLen) {
+            _UnsignedCharT lhsCh = static_cast<_UnsignedCharT> (lhs[pos]);
+            _UnsignedCharT rhsCh = static_cast<_UnsignedCharT> (rhs[pos]);
+            return lhsCh < rhsCh ? -1 : 1;
+        }
+        // one is a prefix of the other (could both be length 0)
         if (lhsLen == rhsLen) {
-            // same length; same chars (could both be length 0)
-            return false;
+            return 0;
         }
-    
-        // If we make it here, the left hand side is shorter.
-        return true;                                                
+        return lhsLen < rhsLen ? -1 : 1;
     }
-                        
- } // blank namespace
-
-///////////////
-// main class template.
-///////////////
 
-template<size_t _AllocSizeT, typename _CharT>
-class BaseStr {
-public:   
+    // Three-way comparison:  <0, 0, >0 like strcmp() but length aware.
+    // The first differing position is found a vector at a time; see
+    // FixedStrSimd.hpp.
+    template<typename _CharT, typename _UnsignedCharT>
+    inline int compareImpl (
+                    const _CharT*   lhs, 
+                    size_t          lhsLen, 
+                    const _CharT*   rhs, 
+                    size_t          rhsLen) {
 
-    /////////////////////////
-    // ctor, dtor,...
-    /////////////////////////
-    BaseStr () 
-        :
-        m_len(0) {
-        m_array[0] = '\0';
+        size_t common = lhsLen < rhsLen ? lhsLen : rhsLen;
+        size_t pos = bytesMismatch (lhs, rhs, common * sizeof (_CharT)) / sizeof (_CharT);
+        return compareAt<_CharT, _UnsignedCharT> (lhs, lhsLen, rhs, rhsLen, pos);
     }
 
-    // Copy ctor; works on  with different
-    // allocations.
-    template<size_t newAllocT>
-    BaseStr (const BaseStr<newAllocT, _CharT>& newStr)
-        :
-        m_len(0) {
-        assign (newStr.c_str(), newStr.length());
+    // Position of 'ch' at or after 'pos', or -1.
+    template<typename _CharT>
+    inline size_t findChar (const _CharT* str, size_t len, _CharT ch, size_t pos) {
+        if (pos >= len) {
+            return -1;
+        }
+        const size_t found = findElem (str + pos, len - pos, ch);
+        return found == len - pos ? -1 : pos + found;
     }
 
-    explicit BaseStr (const _CharT* newStr)
-        :
-        m_len(0) {
-        assign (newStr);
+    // Position of the last 'ch' at or before 'pos', or -1.
+    template<typename _CharT>
+    inline size_t rfindChar (const _CharT* str, size_t len, _CharT ch, size_t pos) {
+        const size_t n = pos < len ? pos + 1 : len;
+        const size_t found = rfindElem (str, n, ch);
+        return found == n ? -1 : found;
     }
 
-    ~BaseStr() {
-        if (m_len == -1) delete [] m_overflow;
-    }
+    // Position of 'needle' at or after 'pos', or -1.  Candidates are where
+    // the first and last chars of the needle both match, a vector at a
+    // time; see findSeq() in FixedStrSimd.hpp.
+    template<typename _CharT>
+    inline size_t findImpl (
+                    const _CharT*   str,
+                    size_t          len,
+                    const _CharT*   needle,
+                    size_t          needleLen,
+                    size_t          pos) {
 
-    // assigning same-alloc strings; also detects self-assignment
-    BaseStr<_AllocSizeT, _CharT>& operator=(const BaseStr<_AllocSizeT, _CharT>& rhs) {
-        if (this == &rhs) {
-            return *this;
+        if (pos > len || needleLen > len - pos) {
+            return -1;
         }
-        assign (rhs.c_str(), rhs.length());
-        return *this;
+        if (needleLen == 0) {
+            return pos;
+        }
+        const size_t found = findSeq (str + pos, len - pos, needle, needleLen);
+        return found == len - pos ? -1 : pos + found;
     }
 
-    // assigns different-alloc strings.
-    template<size_t newAllocT>
-    BaseStr<_AllocSizeT, _CharT>& operator=(const BaseStr<newAllocT, _CharT>& rhs) {
-        // self-assignment can't occur.
-        assign (rhs.c_str(), rhs.length());
-        return *this;
-    }
+    // Position of the last 'needle' starting at or before 'pos', or -1.
+    template<typename _CharT>
+    inline size_t rfindImpl (
+                    const _CharT*   str,
+                    size_t          len,
+                    const _CharT*   needle,
+                    size_t          needleLen,
+                    size_t          pos) {
 
-    // assign from a C string.
-    BaseStr<_AllocSizeT, _CharT>& operator=(const _CharT* rhs) { 
-        assign (rhs);
-        return *this;
-    }
-    
-    /////////////////////////////////
-    // accessors
-    /////////////////////////////////
-    const  _CharT* c_str() const {
-        return  m_len != -1 ? m_array : m_overflow;
+        if (needleLen > len) {
+            return -1;
+        }
+        const size_t start = pos < len - needleLen ? pos : len - needleLen;
+        if (needleLen == 0) {
+            return start;
+        }
+        const size_t n = start + needleLen;
+        const size_t found = rfindSeq (str, n, needle, needleLen);
+        return found == n ? -1 : found;
     }
 
-    size_t length() const {
-        return m_len != -1 ? m_len : m_overflowLen;
-    }
+    // Position of the first of set[0..setLen) at or after 'pos', or -1.
+    template<typename _CharT>
+    inline size_t findFirstOfImpl (
+                    const _CharT*   str,
+                    size_t          len,
+                    const _CharT*   set,
+                    size_t          setLen,
+                    size_t          pos) {
 
-    bool empty() const {
-        return m_len == 0;
+        if (pos >= len || setLen == 0) {
+            return -1;
+        }
+        const size_t found = setLen == 1 ? findElem (str + pos, len - pos, set[0])
+                                         : findAnyOf (str + pos, len - pos, set, setLen);
+        return found == len - pos ? -1 : pos + found;
     }
 
-    bool isUsingOverflow() const {
-        return m_len == -1;
+    ////////////////////
+    // Case-insensitive compares, hash and conversion.  char is ASCII
+    // only, a vector at a time (see FixedStrSimd.hpp); wchar_t goes a char
+    // at a time through towlower()/towupper().
+    ////////////////////
+
+    inline bool iequalsImpl (const char* lhs, size_t lhsLen, const char* rhs, size_t rhsLen) {
+        return lhsLen == rhsLen &&
+               asciiCaseMismatch (reinterpret_cast<const unsigned char*> (lhs),
+                                  reinterpret_cast<const unsigned char*> (rhs), lhsLen) == lhsLen;
+    }
+
+    inline bool iequalsImpl (const wchar_t* lhs, size_t lhsLen, const wchar_t* rhs, size_t rhsLen) {
+        if (lhsLen != rhsLen) {
+            return false;
+        }
+        for (size_t i = 0; i < lhsLen; ++i) {
+            if (lhs[i] != rhs[i] && towlower (lhs[i]) != towlower (rhs[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // As compareImpl(), on lower-cased chars.
+    inline int icompareImpl (const char* lhs, size_t lhsLen, const char* rhs, size_t rhsLen) {
+        const size_t common = lhsLen < rhsLen ? lhsLen : rhsLen;
+        const size_t pos = asciiCaseMismatch (reinterpret_cast<const unsigned char*> (lhs),
+                                              reinterpret_cast<const unsigned char*> (rhs), common);
+        if (pos < common) {
+            return asciiLower (static_cast<unsigned char> (lhs[pos])) <
+                   asciiLower (static_cast<unsigned char> (rhs[pos])) ? -1 : 1;
+        }
+        return compareAt<char, unsigned char> (lhs, lhsLen, rhs, rhsLen, common);
+    }
+
+    inline int icompareImpl (const wchar_t* lhs, size_t lhsLen, const wchar_t* rhs, size_t rhsLen) {
+        const size_t common = lhsLen < rhsLen ? lhsLen : rhsLen;
+        for (size_t i = 0; i < common; ++i) {
+            const wchar_t l = static_cast<wchar_t> (towlower (lhs[i]));
+            const wchar_t r = static_cast<wchar_t> (towlower (rhs[i]));
+            if (l != r) {
+                return l < r ? -1 : 1;
+            }
+        }
+        return compareAt<wchar_t, wchar_t> (lhs, lhsLen, rhs, rhsLen, common);
+    }
+
+    // Same as hashing a lower-cased copy, without making one.
+    inline size_t ihashImpl (const char* str, size_t len) {
+        return hashBytesAsciiLower (str, len);
+    }
+
+    inline size_t ihashImpl (const wchar_t* str, size_t len) {
+        return hashWideLower (str, len);
+    }
+
+    inline void convertCase (char* str, size_t len, bool upper) {
+        asciiConvert (reinterpret_cast<unsigned char*> (str), len, upper);
+    }
+
+    inline void convertCase (wchar_t* str, size_t len, bool upper) {
+        for (size_t i = 0; i < len; ++i) {
+            str[i] = static_cast<wchar_t> (upper ? towupper (str[i]) : towlower (str[i]));
+        }
+    }
+
+    ////////////////////
+    // fmt() support.
+    ////////////////////
+
+    // One fmt() argument, converted before anything is written so the
+    // exact length is known up front.  Numbers go in 'buff'.
+    template<typename _CharT>
+    struct FmtArg {
+        const _CharT*   str;
+        size_t          len;
+        _CharT          buff[NUMBER_CHARS_MAX];
+    };
+
+    // The types fmt() accepts.  Anything else doesn't compile.
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, const _CharT* value) {
+        arg.str = value;
+        arg.len = countLen (value);
+    }
+
+    template<size_t _AllocSizeT, typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, const BaseStr<_AllocSizeT, _CharT>& value) {
+        arg.str = value.c_str();
+        arg.len = value.length();
+    }
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, const BaseStrView<_CharT>& value) {
+        arg.str = value.data();
+        arg.len = value.length();
+    }
+
+#ifdef FIXED_STR_HAS_STRING_VIEW
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, std::basic_string_view<_CharT> value) {
+        arg.str = value.data();
+        arg.len = value.length();
+    }
+#endif
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, _CharT value) {
+        arg.buff[0] = value;
+        arg.str = arg.buff;
+        arg.len = 1;
+    }
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, int value) {
+        arg.str = arg.buff;
+        arg.len = writeSigned (arg.buff, value);
+    }
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, long value) {
+        arg.str = arg.buff;
+        arg.len = writeSigned (arg.buff, value);
+    }
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, long long value) {
+        arg.str = arg.buff;
+        arg.len = writeSigned (arg.buff, value);
+    }
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, unsigned int value) {
+        arg.str = arg.buff;
+        arg.len = writeUnsigned (arg.buff, value);
+    }
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, unsigned long value) {
+        arg.str = arg.buff;
+        arg.len = writeUnsigned (arg.buff, value);
+    }
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, unsigned long long value) {
+        arg.str = arg.buff;
+        arg.len = writeUnsigned (arg.buff, value);
+    }
+
+    template<typename _CharT>
+    inline void toFmtArg (FmtArg<_CharT>& arg, double value) {
+        arg.str = arg.buff;
+        arg.len = writeDouble (arg.buff, value);
+    }
+
+    template<typename _CharT>
+    inline void fillFmtArgs (FmtArg<_CharT>*) {
+    }
+
+    template<typename _CharT, typename _FirstT, typename... _RestT>
+    inline void fillFmtArgs (FmtArg<_CharT>* out, const _FirstT& first, const _RestT&... rest) {
+        toFmtArg (*out, first);
+        fillFmtArgs (out + 1, rest...);
+    }
+
+    // Length of the formatted result, or -1 if the format string is bad
+    // ('{' or '}' not part of "{}", "{{" or "}}") or doesn't use exactly
+    // 'argCount' args.
+    template<typename _CharT>
+    inline size_t fmtLength (
+                    const _CharT*           formatStr,
+                    const FmtArg<_CharT>*   args,
+                    size_t                  argCount) {
+
+        size_t total = 0;
+        size_t used = 0;
+        for (const _CharT* p = formatStr; *p != '\0'; ++p) {
+            if (*p == '{') {
+                if (p[1] == '{') {
+                    ++p;
+                }
+                else if (p[1] == '}' && used < argCount) {
+                    total += args[used++].len;
+                    ++p;
+                    continue;
+                }
+                else {
+                    return -1;
+                }
+            }
+            else if (*p == '}') {
+                if (p[1] != '}') {
+                    return -1;
+                }
+                ++p;
+            }
+            ++total;
+        }
+        return used == argCount ? total : -1;
+    }
+
+    // Writes the result; the format string has been checked by fmtLength().
+    template<typename _CharT>
+    inline void fmtWrite (
+                    _CharT*                 out,
+                    const _CharT*           formatStr,
+                    const FmtArg<_CharT>*   args) {
+
+        const _CharT* run = formatStr;
+        const _CharT* p =   formatStr;
+        for (; *p != '\0'; ++p) {
+            if (*p != '{' && *p != '}') {
+                continue;
+            }
+            memcpy (out, run, (p - run) * sizeof (_CharT));
+            out += p - run;
+            if (p[0] == '{' && p[1] == '}') {
+                memcpy (out, args->str, args->len * sizeof (_CharT));
+                out += args->len;
+                ++args;
+            }
+            else {
+                // "{{" or "}}"
+                *out++ = *p;
+            }
+            ++p;
+            run = p + 1;
+        }
+        memcpy (out, run, (p - run) * sizeof (_CharT));
+        out[p - run] = '\0';
+    }
+
+    inline bool pointsInto (const void* p, const void* buff, size_t bytes) {
+        size_t offset = reinterpret_cast<size_t> (p) - reinterpret_cast<size_t> (buff);
+        return offset < bytes;
+    }
+
+    // Puts a result whose length is known up front into the array, the
+    // existing overflow or one new allocation.  The first 'keep' chars of
+    // the current content stay (0 to assign, the length to append);
+    // 'write' is given where the rest goes and writes total - keep chars.
+    // If 'aliased' (what's written comes from this string) it's always
+    // written to new space first.  Returns the bytes allocated, if any.
+    template<typename _CharT, typename _WriteT>
+    inline size_t placeImpl (
+                    size_t          keep,
+                    size_t          total,
+                    bool            aliased,
+                    const _WriteT&  write,
+                    size_t          alloc,
+
+                    unsigned int*   len,
+
+                    _CharT*         array,
+
+                    _CharT*         overflowIn,
+                    _CharT**        overflowOut,
+
+                    unsigned int    overflowAllocIn,
+                    unsigned int*   overflowAllocOut,
+
+                    unsigned int*   overflowlenOut) {
+
+        bool wasOverflow = *len == USING_OVERFLOW;
+        // A spilled string may keep its overflow (see FixedStrGrowth).
+        const bool shrink =   wasOverflow && shrinkOverflow (total, overflowAllocIn);
+        const bool toArray =  total <= alloc && (!wasOverflow || shrink || backInline (total, alloc));
+        _CharT* target;
+        bool newOverflow = false;
+        if (!aliased && toArray) {
+            target = array;
+            if (wasOverflow) {
+                memcpy (array, overflowIn, keep * sizeof (_CharT));
+            }
+        }
+        else if (!aliased && wasOverflow && total <= overflowAllocIn && !shrink) {
+            target = overflowIn;
+        }
+        else {
+            // A string that's already spilled sticks with its resource.
+            target = overflowNew<_CharT> (total, wasOverflow ? overflowResource (overflowIn) : NULL);
+            memcpy (target, wasOverflow ? overflowIn : array, keep * sizeof (_CharT));
+            newOverflow = true;
+        }
+        write (target + keep);
+        target[total] = '\0';
+
+        if (newOverflow && toArray) {
+            // only because of aliasing; it goes back in the array.
+            memcpy (array, target, (total + 1) * sizeof (_CharT));
+            overflowDelete (target);
+            target = array;
+            newOverflow = false;
+        }
+        if (target == array) {
+            if (wasOverflow) overflowDelete (overflowIn);
+            *len = static_cast<unsigned int> (total);
+            return 0;
+        }
+        if (newOverflow) {
+            if (wasOverflow) overflowDelete (overflowIn);
+            *overflowAllocOut = overflowCapacity (target);
+        }
+        else {
+            *overflowAllocOut = overflowAllocIn;
+        }
+        *len = -1;
+        *overflowOut = target;
+        *overflowlenOut = static_cast<unsigned int> (total);
+        return newOverflow ? (*overflowAllocOut + 1) * sizeof (_CharT) : 0;
+    }
+
+    // Assigns the formatted result.  The length is worked out first so the
+    // result goes straight into the array, the existing overflow or one new
+    // allocation.  Args that point into this string itself are fine.
+    // Returns false (leaving the string alone) if the format string is bad.
+    template<typename _CharT>
+    inline bool fmtImpl (
+                    const _CharT*           formatStr,
+                    const FmtArg<_CharT>*   args,
+                    size_t                  argCount,
+                    size_t                  alloc,
+
+                    unsigned int*           len,
+
+                    _CharT*                 array,
+
+                    _CharT*                 overflowIn,
+                    _CharT**                overflowOut,
+
+                    unsigned int            overflowAllocIn,
+                    unsigned int*           overflowAllocOut,
+
+                    unsigned int            /* overflowLenIn */,
+                    unsigned int*           overflowlenOut) {
+
+        size_t total = fmtLength (formatStr, args, argCount);
+        if (total >= UINT_MAX) {
+            // bad format (or too big for m_len).
+            return false;
+        }
+        bool wasOverflow = *len == USING_OVERFLOW;
+        bool aliased = false;
+        for (size_t i = 0; i < argCount; ++i) {
+            const size_t bytes = args[i].len * sizeof (_CharT);
+            if (bytes && (pointsInto (args[i].str, array, (alloc + 1) * sizeof (_CharT)) ||
+                    (wasOverflow && pointsInto (args[i].str, overflowIn,
+                                                (overflowAllocIn + 1) * sizeof (_CharT))))) {
+                aliased = true;
+            }
+        }
+
+        size_t bytes = placeImpl (
+                        0,
+                        total,
+                        aliased,
+                        [&] (_CharT* out) { fmtWrite (out, formatStr, args); },
+                        alloc,
+                        len,
+                        array,
+                        overflowIn,
+                        overflowOut,
+                        overflowAllocIn,
+                        overflowAllocOut,
+                        overflowlenOut);
+        FIXED_STR_STATS_RECORD (FORMAT, alloc, sizeof (_CharT), total, wasOverflow, *len == USING_OVERFLOW, bytes);
+        (void) bytes;
+        return true;
+    }
+
+ } // blank namespace
+
+///////////////
+// Non-owning view of someone else's chars:  just a pointer and a length.
+// Every BaseStr converts to one implicitly, so functions taking a view
+// accept FixedStrs of any size, C strings and (C++17) std::string_views.
+// Slicing with substr() doesn't copy anything; turn it into a FixedStr
+// (assign, ctor) only when it needs to be kept.
+//
+// Like std::string_view it doesn't own the chars, so it mustn't outlive
+// them, and the chars aren't necessarily null terminated.
+///////////////
+
+template<typename _CharT>
+class BaseStrView {
+public:
+    static const size_t npos = -1;
+
+    BaseStrView()
+        :
+        m_str (emptyStr()),
+        m_len (0) {
+    }
+
+    // NULL is treated as empty.
+    BaseStrView (const _CharT* str)
+        :
+        m_str (str ? str : emptyStr()),
+        m_len (countLen (str)) {
+    }
+
+    BaseStrView (const _CharT* str, size_t len)
+        :
+        m_str (str ? str : emptyStr()),
+        m_len (str ? len : 0) {
+    }
+
+#ifdef FIXED_STR_HAS_STRING_VIEW
+    BaseStrView (std::basic_string_view<_CharT> str)
+        :
+        m_str (str.data() ? str.data() : emptyStr()),
+        m_len (str.length()) {
+    }
+
+    operator std::basic_string_view<_CharT>() const {
+        return std::basic_string_view<_CharT> (m_str, m_len);
+    }
+#endif
+
+    /////////////////////////////////
+    // accessors
+    /////////////////////////////////
+    const _CharT* data() const {
+        return m_str;
+    }
+
+    size_t length() const {
+        return m_len;
+    }
+
+    size_t size() const {
+        return m_len;
+    }
+
+    bool empty() const {
+        return m_len == 0;
+    }
+
+    _CharT operator[] (size_t pos) const {
+        return m_str[pos];
+    }
+
+    const _CharT* begin() const {
+        return m_str;
+    }
+
+    const _CharT* end() const {
+        return m_str + m_len;
+    }
+
+    // Up to 'count' chars starting at 'pos'.  Throws std::out_of_range if
+    // 'pos' is past the end, same as substring().
+    BaseStrView<_CharT> substr (size_t pos, size_t count = npos) const {
+        if (pos > m_len) {
+            throw std::out_of_range("FixedStrView.substr() start out of range");
+        }
+        if (count > m_len - pos) {
+            count = m_len - pos;
+        }
+        return BaseStrView<_CharT> (m_str + pos, count);
+    }
+
+    void remove_prefix (size_t count) {
+        m_str += count;
+        m_len -= count;
+    }
+
+    void remove_suffix (size_t count) {
+        m_len -= count;
+    }
+
+    // npos if not found.
+    size_t find (BaseStrView<_CharT> needle, size_t pos = 0) const {
+        return findImpl (m_str, m_len, needle.m_str, needle.m_len, pos);
+    }
+
+    size_t find (_CharT ch, size_t pos = 0) const {
+        return findChar (m_str, m_len, ch, pos);
+    }
+
+    // Last match starting at or before 'pos'.  npos if not found.
+    size_t rfind (BaseStrView<_CharT> needle, size_t pos = npos) const {
+        return rfindImpl (m_str, m_len, needle.m_str, needle.m_len, pos);
+    }
+
+    size_t rfind (_CharT ch, size_t pos = npos) const {
+        return rfindChar (m_str, m_len, ch, pos);
+    }
+
+    // First of any of the chars in 'set'.  npos if not found.
+    size_t find_first_of (BaseStrView<_CharT> set, size_t pos = 0) const {
+        return findFirstOfImpl (m_str, m_len, set.m_str, set.m_len, pos);
+    }
+
+    bool contains (BaseStrView<_CharT> needle) const {
+        return find (needle) != npos;
+    }
+
+    bool contains (_CharT ch) const {
+        return find (ch) != npos;
+    }
+
+    // Ignoring case:  ASCII letters only for char, towlower() for
+    // wchar_t.  ihash() agrees with iequals(), so it can key a
+    // case-insensitive hash table (see FixedStrIHash).
+    bool iequals (BaseStrView<_CharT> rhs) const {
+        return iequalsImpl (m_str, m_len, rhs.m_str, rhs.m_len);
+    }
+
+    int icompare (BaseStrView<_CharT> rhs) const {
+        return icompareImpl (m_str, m_len, rhs.m_str, rhs.m_len);
+    }
+
+    size_t ihash() const {
+        return ihashImpl (m_str, m_len);
+    }
+
+    // The number at the start:  any integer type, float or double.  See
+    // FixedStrParse.hpp.
+    template<typename _NumT>
+    FixedStrParsed<_NumT> parse() const {
+        return parseNumber<_NumT> (m_str, m_len);
+    }
+
+    // The whole string as a number.  False, leaving 'value' alone, if
+    // it's anything else or doesn't fit.
+    template<typename _NumT>
+    bool parse (_NumT& value) const {
+        const FixedStrParsed<_NumT> parsed = parse<_NumT>();
+        if (!parsed.ok() || parsed.length != m_len) {
+            return false;
+        }
+        value = parsed.value;
+        return true;
+    }
+
+    bool starts_with (BaseStrView<_CharT> prefix) const {
+        return prefix.m_len <= m_len &&
+               bytesEqual (m_str, prefix.m_str, prefix.m_len * sizeof (_CharT));
+    }
+
+    bool starts_with (_CharT ch) const {
+        return m_len > 0 && m_str[0] == ch;
+    }
+
+    bool ends_with (BaseStrView<_CharT> suffix) const {
+        return suffix.m_len <= m_len &&
+               bytesEqual (m_str + m_len - suffix.m_len, suffix.m_str, suffix.m_len * sizeof (_CharT));
+    }
+
+    // Same ordering as BaseStr::compare().
+    int compare (BaseStrView<_CharT> rhs) const {
+        return compareImpl<_CharT, typename CompareAs<_CharT>::type> (
+                    m_str, m_len, rhs.m_str, rhs.m_len);
+    }
+
+    bool equals (BaseStrView<_CharT> rhs) const {
+        return isEqualImpl (m_str, m_len, rhs.m_str, rhs.m_len);
+    }
+
+    // Same for equal content wherever it lives (view, FixedStr of any size).
+    size_t hash() const {
+        return hashBytes (m_str, m_len * sizeof (_CharT));
+    }
+
+private:
+    static const _CharT* emptyStr() {
+        static const _CharT empty[1] = { 0 };
+        return empty;
+    }
+
+    const _CharT*   m_str;
+    size_t          m_len;
+};
+
+template<typename _CharT>
+const size_t BaseStrView<_CharT>::npos;
+
+typedef BaseStrView<char>       FixedStrView;
+typedef BaseStrView<wchar_t>    WFixedStrView;
+
+namespace std {
+    template<typename _CharT>
+    struct hash<BaseStrView<_CharT> > {
+        size_t operator() (const BaseStrView<_CharT>& str) const {
+            return str.hash();
+        }
+    };
+}
+
+///////////////
+// Storage layouts.
+//
+// BaseStr only gets at its state through the few functions below, so the
+// layout can depend on the size.
+//
+// Full layout (any size):  an unsigned int length, -1 meaning the overflow
+// is in use, then the array unioned with the overflow's pointer, alloc and
+// length.
+//
+// Compact layout (small sizes, up to 127 chars or so):  no separate length.
+// The last element of the storage is a tag holding the remaining capacity,
+// as in fbstring and libc++.  When the string is completely full that's 0,
+// so it doubles as the terminator.  The 0x80 bit set means the overflow is
+// in use; the pointer and length then sit at the front of the storage.
+// The overflow's alloc isn't stored; it's in the block's header.  The
+// storage is rounded up to a multiple of the pointer size, so FixedStr<15>
+// is 16 bytes and FixedStr<23> is 24.
+//
+// Define FIXED_STR_NO_COMPACT to always use the full layout.
+///////////////
+
+template<size_t _AllocSizeT, typename _CharT>
+struct BaseStrLayout {
+    // smallest storage that can hold the overflow pointer and length and
+    // still have a separate tag.
+    static const size_t minElems =
+        (sizeof (void*) + sizeof (unsigned int) + 2 * sizeof (_CharT) - 1) / sizeof (_CharT);
+    static const size_t wanted = _AllocSizeT + 1 > minElems ? _AllocSizeT + 1 : minElems;
+    static const size_t elems =
+        (wanted * sizeof (_CharT) + sizeof (void*) - 1) / sizeof (void*) * sizeof (void*) / sizeof (_CharT);
+#ifdef FIXED_STR_NO_COMPACT
+    static const bool compact = false;
+#else
+    // the remaining capacity has to fit below the 0x80 flag.
+    static const bool compact = elems <= 0x80;
+#endif
+};
+
+template<size_t _AllocSizeT, typename _CharT,
+         bool _Compact = BaseStrLayout<_AllocSizeT, _CharT>::compact>
+class BaseStrStorage {
+protected:
+    // starts empty.
+    BaseStrStorage()
+        :
+        m_len(0) {
+        m_array[0] = '\0';
+    }
+
+    bool isOverflow() const {
+        return m_len == USING_OVERFLOW;
+    }
+
+    // Only when !isOverflow().
+    unsigned int arrayLen() const {
+        return m_len;
+    }
+
+    _CharT* array() {
+        return m_array;
+    }
+
+    const _CharT* array() const {
+        return m_array;
+    }
+
+    // Only when isOverflow().
+    _CharT* overflow() const {
+        return m_overflow;
+    }
+
+    unsigned int overflowAlloc() const {
+        return m_overflowAlloc;
+    }
+
+    unsigned int overflowLen() const {
+        return m_overflowLen;
+    }
+
+    // Content (and terminator) is already in array().
+    void setArrayLen (unsigned int len) {
+        m_len = len;
+    }
+
+    void setOverflow (_CharT* overflow, unsigned int alloc, unsigned int len) {
+        m_len =           -1;
+        m_overflow =      overflow;
+        m_overflowAlloc = alloc;
+        m_overflowLen =   len;
+    }
+
+private:
+    // 16 -> 17 bumps sizeof 24 -> 32
+    // Doesn't include terminator.
+    // If -1 the overflow is used; otherwise the m_array is used.
+    unsigned int  m_len;
+    
+    // Below we use a union because if we have to use an overflow
+    // then m_array is unusable so we can use its space for something else.
+    union {
+        // size is fixed; based on int template.
+        // +1 to include terminator.
+         _CharT          m_array [_AllocSizeT+1];
+        struct {
+        
+            // If heap was needed it goes here...
+            _CharT*         m_overflow;
+        
+            // If heap was needed; alloc size.  Real alloc size +1 to account for terminator.
+            unsigned int    m_overflowAlloc;
+            
+            // Needed becaause m_len would be -1.
+            unsigned int    m_overflowLen;
+        };
+    };
+};
+
+template<size_t _AllocSizeT, typename _CharT>
+class BaseStrStorage<_AllocSizeT, _CharT, true> {
+protected:
+    BaseStrStorage() {
+        m_array[0] = '\0';
+        setArrayLen (0);
+    }
+
+    bool isOverflow() const {
+        return (tag() & OVERFLOW_FLAG) != 0;
+    }
+
+    unsigned int arrayLen() const {
+        return TAG - tag();
+    }
+
+    _CharT* array() {
+        return m_array;
+    }
+
+    const _CharT* array() const {
+        return m_array;
+    }
+
+    _CharT* overflow() const {
+        return m_overflow;
+    }
+
+    unsigned int overflowAlloc() const {
+        return overflowCapacity (m_overflow);
+    }
+
+    unsigned int overflowLen() const {
+        return m_overflowLen;
+    }
+
+    void setArrayLen (unsigned int len) {
+        // 0 when full, which is also the terminator.
+        m_array[TAG] = static_cast<_CharT> (TAG - len);
+    }
+
+    // The alloc is in the block's header already.
+    void setOverflow (_CharT* overflow, unsigned int /* alloc */, unsigned int len) {
+        m_overflow =    overflow;
+        m_overflowLen = len;
+        m_array[TAG] =  static_cast<_CharT> (OVERFLOW_FLAG);
+    }
+
+private:
+    enum {
+        ELEMS = BaseStrLayout<_AllocSizeT, _CharT>::elems,
+        // where the tag goes.
+        TAG = ELEMS - 1,
+        OVERFLOW_FLAG = 0x80
+    };
+
+    unsigned int tag() const {
+        return static_cast<typename CompareAs<_CharT>::type> (m_array[TAG]);
+    }
+
+    union {
+        // Holds up to _AllocSizeT chars plus terminator; the tag is
+        // the last element.
+        _CharT          m_array [ELEMS];
+        struct {
+            _CharT*         m_overflow;
+            unsigned int    m_overflowLen;
+        };
+    };
+};
+
+///////////////
+// main class template.
+///////////////
+
+template<size_t _AllocSizeT, typename _CharT>
+class BaseStr : protected BaseStrStorage<_AllocSizeT, _CharT> {
+public:   
+
+    /////////////////////////
+    // ctor, dtor,...
+    /////////////////////////
+    BaseStr () {
+    }
+
+    // Copy ctor for the same allocation.  The template below doesn't count
+    // as a copy ctor so without this the compiler would generate one that
+    // copies the overflow pointer (and it would get deleted twice).
+    BaseStr (const BaseStr<_AllocSizeT, _CharT>& newStr) {
+        assign (newStr.c_str(), newStr.length());
+    }
+
+    // Copy ctor; works on  with different
+    // allocations.
+    template<size_t newAllocT>
+    BaseStr (const BaseStr<newAllocT, _CharT>& newStr) {
+        assign (newStr.c_str(), newStr.length());
+    }
+
+    // Move ctors.  These hand over the overflow instead of copying it
+    // when possible; see moveFrom().  The same-alloc ones never allocate
+    // (content either fits in the array or is handed over) so they're
+    // noexcept, which lets std::vector move instead of copy when growing.
+    BaseStr (BaseStr<_AllocSizeT, _CharT>&& newStr) noexcept {
+        moveFrom (newStr);
+    }
+
+    template<size_t newAllocT>
+    BaseStr (BaseStr<newAllocT, _CharT>&& newStr) {
+        moveFrom (newStr);
+    }
+
+    explicit BaseStr (const _CharT* newStr) {
+        assign (newStr);
+    }
+
+    explicit BaseStr (BaseStrView<_CharT> newStr) {
+        assign (newStr);
+    }
+
+    // From a chain of operator+;  see BaseStrConcat.
+    template<typename _LhsT, typename _RhsT>
+    BaseStr (const BaseStrConcat<_CharT, _LhsT, _RhsT>& expr) {
+        assign (expr);
+    }
+
+    ~BaseStr() {
+        if (isOverflow()) overflowDelete (overflow());
+    }
+
+    // assigning same-alloc strings; also detects self-assignment
+    BaseStr<_AllocSizeT, _CharT>& operator=(const BaseStr<_AllocSizeT, _CharT>& rhs) {
+        if (this == &rhs) {
+            return *this;
+        }
+        assign (rhs.c_str(), rhs.length());
+        return *this;
+    }
+
+    // assigns different-alloc strings.
+    template<size_t newAllocT>
+    BaseStr<_AllocSizeT, _CharT>& operator=(const BaseStr<newAllocT, _CharT>& rhs) {
+        // self-assignment can't occur.
+        assign (rhs.c_str(), rhs.length());
+        return *this;
+    }
+
+    // move-assigning same-alloc strings; also detects self-assignment
+    BaseStr<_AllocSizeT, _CharT>& operator=(BaseStr<_AllocSizeT, _CharT>&& rhs) noexcept {
+        if (this == &rhs) {
+            return *this;
+        }
+        moveAssign (rhs);
+        return *this;
+    }
+
+    // move-assigns different-alloc strings.
+    template<size_t newAllocT>
+    BaseStr<_AllocSizeT, _CharT>& operator=(BaseStr<newAllocT, _CharT>&& rhs) {
+        moveFrom (rhs);
+        return *this;
+    }
+
+    // assign from a C string.
+    BaseStr<_AllocSizeT, _CharT>& operator=(const _CharT* rhs) { 
+        assign (rhs);
+        return *this;
+    }
+
+    BaseStr<_AllocSizeT, _CharT>& operator=(BaseStrView<_CharT> rhs) { 
+        assign (rhs);
+        return *this;
+    }
+
+    template<typename _LhsT, typename _RhsT>
+    BaseStr<_AllocSizeT, _CharT>& operator=(const BaseStrConcat<_CharT, _LhsT, _RhsT>& rhs) { 
+        assign (rhs);
+        return *this;
+    }
+    
+    /////////////////////////////////
+    // accessors
+    /////////////////////////////////
+    const  _CharT* c_str() const {
+        return  !isOverflow() ? array() : overflow();
+    }
+
+    size_t length() const {
+        return !isOverflow() ? arrayLen() : overflowLen();
+    }
+
+    bool empty() const {
+        return length() == 0;
+    }
+
+    bool isUsingOverflow() const {
+        return isOverflow();
+    }
+
+    // Chars it holds without allocating (not counting the terminator).
+    size_t capacity() const {
+        return isOverflow() ? overflowAlloc() : _AllocSizeT;
+    }
+
+    // Makes room for at least 'n' chars, so appends up to that length don't
+    // allocate.  Never shrinks.  Note an assign() that fits the array goes
+    // back there unless the growth policy says otherwise (FixedStrGrowth).
+    void reserve (size_t n) {
+        if (n <= capacity()) {
+            return;
+        }
+        if (n >= UINT_MAX) {
+            throw std::length_error ("FixedStr.reserve() too long");
+        }
+        const size_t len = length();
+        // A string that's already spilled sticks with its resource.
+        _CharT* block = overflowNew<_CharT> (n, isOverflow() ? overflowResource (overflow()) : NULL);
+        memcpy (block, c_str(), (len + 1) * sizeof (_CharT));
+        if (isOverflow()) overflowDelete (overflow());
+        setOverflow (block, overflowCapacity (block), static_cast<unsigned int> (len));
+    }
+
+    // Gives back overflow that isn't needed:  back to the array if the
+    // content fits, otherwise an overflow only as big as it has to be.
+    // Ignores the growth policy's hysteresis; this is asked for.
+    void shrink_to_fit() {
+        if (!isOverflow()) {
+            return;
+        }
+        const unsigned int len = overflowLen();
+        _CharT* old = overflow();
+        if (len <= _AllocSizeT) {
+            // (the array overlaps where the overflow pointer was)
+            memcpy (array(), old, (len + 1) * sizeof (_CharT));
+            overflowDelete (old);
+            setArrayLen (len);
+            return;
+        }
+        if (capacityOfBytes<_CharT> (overflowBytes<_CharT> (len)) >= overflowAlloc()) {
+            return;
+        }
+        _CharT* block = overflowNew<_CharT> (len, overflowResource (old));
+        memcpy (block, old, (len + 1) * sizeof (_CharT));
+        overflowDelete (old);
+        setOverflow (block, overflowCapacity (block), len);
+    }
+
+    // Views of the content; valid until the string is next changed.
+    BaseStrView<_CharT> view() const {
+        return BaseStrView<_CharT> (c_str(), length());
+    }
+
+    operator BaseStrView<_CharT>() const {
+        return view();
+    }
+
+    // Depends only on the content:  equal to the hash of any other
+    // FixedStr, or view, with the same chars.
+    size_t hash() const {
+        return hashBytes (c_str(), length() * sizeof (_CharT));
+    }
+
+    // Zero-copy substring; see BaseStrView::substr().
+    BaseStrView<_CharT> substr (size_t pos, size_t count = BaseStrView<_CharT>::npos) const {
+        return view().substr (pos, count);
+    }
+
+    size_t find (BaseStrView<_CharT> needle, size_t pos = 0) const {
+        return view().find (needle, pos);
+    }
+
+    size_t find (_CharT ch, size_t pos = 0) const {
+        return view().find (ch, pos);
+    }
+
+    size_t rfind (BaseStrView<_CharT> needle, size_t pos = BaseStrView<_CharT>::npos) const {
+        return view().rfind (needle, pos);
+    }
+
+    size_t rfind (_CharT ch, size_t pos = BaseStrView<_CharT>::npos) const {
+        return view().rfind (ch, pos);
+    }
+
+    size_t find_first_of (BaseStrView<_CharT> set, size_t pos = 0) const {
+        return view().find_first_of (set, pos);
+    }
+
+    bool contains (BaseStrView<_CharT> needle) const {
+        return view().contains (needle);
+    }
+
+    bool contains (_CharT ch) const {
+        return view().contains (ch);
+    }
+
+    // Ignoring case; see BaseStrView::iequals().
+    bool iequals (BaseStrView<_CharT> rhs) const {
+        return view().iequals (rhs);
+    }
+
+    int icompare (BaseStrView<_CharT> rhs) const {
+        return view().icompare (rhs);
+    }
+
+    size_t ihash() const {
+        return view().ihash();
+    }
+
+    // See BaseStrView::parse().
+    template<typename _NumT>
+    FixedStrParsed<_NumT> parse() const {
+        return view().template parse<_NumT>();
+    }
+
+    template<typename _NumT>
+    bool parse (_NumT& value) const {
+        return view().parse (value);
+    }
+
+    // In place.  For char only ASCII letters change, so UTF-8 stays
+    // valid.
+    BaseStr<_AllocSizeT, _CharT>& to_lower() {
+        convertCase (isOverflow() ? overflow() : array(), length(), false);
+        return *this;
+    }
+
+    BaseStr<_AllocSizeT, _CharT>& to_upper() {
+        convertCase (isOverflow() ? overflow() : array(), length(), true);
+        return *this;
+    }
+
+    bool starts_with (BaseStrView<_CharT> prefix) const {
+        return view().starts_with (prefix);
+    }
+
+    bool ends_with (BaseStrView<_CharT> suffix) const {
+        return view().ends_with (suffix);
+    }
+
+    // Three-way comparison; <0, 0 or >0 like strcmp() (plain char compared
+    // as unsigned) except that embedded zeros are fine.
+    template<size_t origAlloc>
+    int compare (const BaseStr<origAlloc, _CharT>& rhs) const {
+        size_t lhsLen = length();
+        size_t rhsLen = rhs.length();
+        size_t common = lhsLen < rhsLen ? lhsLen : rhsLen;
+        size_t pos;
+        if (!isOverflow() && !rhs.isOverflow()) {
+            // Both in arrays; see operator==.
+            const size_t buffBytes = 
+                ((_AllocSizeT < origAlloc ? _AllocSizeT : origAlloc) + 1) * sizeof (_CharT);
+            pos = bufferBytesMismatch<buffBytes> (array(), rhs.array(), common * sizeof (_CharT));
+        }
+        else {
+            pos = bytesMismatch (c_str(), rhs.c_str(), common * sizeof (_CharT));
+        }
+        return compareAt<_CharT, typename CompareAs<_CharT>::type> (
+                    c_str(), lhsLen, rhs.c_str(), rhsLen, pos / sizeof (_CharT));
+    }
+
+    int compare (const _CharT* rhs) const {
+        return compareImpl<_CharT, typename CompareAs<_CharT>::type> (
+                    c_str(), length(), rhs, countLen (rhs));
+    }
+
+    int compare (BaseStrView<_CharT> rhs) const {
+        return view().compare (rhs);
     }
 
     size_t getAlloc() const {
-        return m_len != -1 ?  _AllocSizeT : m_overflowAlloc;
+        return !isOverflow() ?  _AllocSizeT : overflowAlloc();
     }
   
     // Returned value is passed into 'target' (ref parameter) instead of 
@@ -579,68 +1972,74 @@ public:
     /////////////////////////////////
     
     void clear() {
-        if (m_len == -1) {
-            delete [] m_overflow;
+        if (isOverflow()) {
+            if (!backInline (0, _AllocSizeT) && !shrinkOverflow (0, overflowAlloc())) {
+                // the growth policy keeps it.
+                overflow()[0] = '\0';
+                setOverflow (overflow(), overflowAlloc(), 0);
+                return;
+            }
+            overflowDelete (overflow());
         }
-        m_len = 0;
-        m_array[0] = '\0';
+        array()[0] = '\0';
+        setArrayLen (0);
     }
     
     void assign (const _CharT* newStr, size_t newStrLen) {
         
-        _CharT*         overflowOut      = NULL;
-        unsigned int    overflowAllocOut = 0;
-        unsigned int    overflowLenOut   = 0;
-        
-        // note how we avoid dereferencing m_overflowX in the union.
+        HelperState st (*this);
         assignImpl (
                         newStr, 
                         newStrLen,
                         _AllocSizeT,
-                        &m_len,
-                        m_array,
-                        m_overflow,
-                        &overflowOut,
-                        m_overflowAlloc,
-                        &overflowAllocOut,
-                        m_overflowLen,
-                        &overflowLenOut);
-
-        if (m_len == -1) {
-            m_overflow =      overflowOut;
-            m_overflowAlloc = overflowAllocOut;
-            m_overflowLen =   overflowLenOut;
-        }
+                        &st.len,
+                        array(),
+                        st.overflow,
+                        &st.overflow,
+                        st.overflowAlloc,
+                        &st.overflowAlloc,
+                        st.overflowLen,
+                        &st.overflowLen);
+        setState (st);
     }
     
     void assign (const _CharT* newStr) {
         assign (newStr, countLen(newStr));
     }
+
+    void assign (BaseStrView<_CharT> newStr) {
+        assign (newStr.data(), newStr.length());
+    }
+
+    // The whole length is known first, so the pieces are copied straight
+    // into the array or one overflow allocation of exactly that size.
+    template<typename _LhsT, typename _RhsT>
+    void assign (const BaseStrConcat<_CharT, _LhsT, _RhsT>& expr) {
+#ifdef FIXED_STR_STATS
+        const bool wasOverflow = isOverflow();
+#endif
+        size_t bytes = place (0, expr.length(), expr.overlaps (*this), expr);
+        FIXED_STR_STATS_RECORD (ASSIGN, _AllocSizeT, sizeof (_CharT), expr.length(),
+                                wasOverflow, isOverflow(), bytes);
+        (void) bytes;
+    }
       
     BaseStr<_AllocSizeT, _CharT>&  append(const _CharT* newStr, size_t newStrLen) {
     
-        _CharT*         overflowOut      = NULL;
-        unsigned int    overflowAllocOut = 0;
-        unsigned int    overflowLenOut   = 0;
-
+        HelperState st (*this);
         appendImpl (
                         newStr, 
                         newStrLen,
                         _AllocSizeT,
-                        &m_len,
-                        m_array,
-                        m_overflow,
-                        &overflowOut,
-                        m_overflowAlloc,
-                        &overflowAllocOut,
-                        m_overflowLen,
-                        &overflowLenOut);
-
-        if (m_len == -1) {
-            m_overflow =      overflowOut;
-            m_overflowAlloc = overflowAllocOut;
-            m_overflowLen =   overflowLenOut;
-        }
+                        &st.len,
+                        array(),
+                        st.overflow,
+                        &st.overflow,
+                        st.overflowAlloc,
+                        &st.overflowAlloc,
+                        st.overflowLen,
+                        &st.overflowLen);
+        setState (st);
         return *this;
     }
 
@@ -648,6 +2047,23 @@ public:
         return append (newStr, countLen(newStr));
     } 
 
+    BaseStr<_AllocSizeT, _CharT>& append (BaseStrView<_CharT> newStr) {
+        return append (newStr.data(), newStr.length());
+    } 
+
+    template<typename _LhsT, typename _RhsT>
+    BaseStr<_AllocSizeT, _CharT>& append (const BaseStrConcat<_CharT, _LhsT, _RhsT>& expr) {
+#ifdef FIXED_STR_STATS
+        const bool wasOverflow = isOverflow();
+#endif
+        const size_t keep = length();
+        size_t bytes = place (keep, keep + expr.length(), expr.overlaps (*this), expr);
+        FIXED_STR_STATS_RECORD (APPEND, _AllocSizeT, sizeof (_CharT), keep + expr.length(),
+                                wasOverflow, isOverflow(), bytes);
+        (void) bytes;
+        return *this;
+    } 
+
     template<size_t origAlloc>
     BaseStr<_AllocSizeT, _CharT>& append(const BaseStr<origAlloc, _CharT>& newStr) {
         append(newStr.c_str(), newStr.length());
@@ -655,12 +2071,99 @@ public:
     }
     
     BaseStr<_AllocSizeT, _CharT>& append(_CharT ch) {  
+        // The usual case is room for it where the content already is.
+        if (!isOverflow()) {
+            const unsigned int len = arrayLen();
+            if (len < _AllocSizeT) {
+                FIXED_STR_STATS_RECORD (APPEND, _AllocSizeT, sizeof (_CharT), len + 1, false, false, 0);
+                array()[len] = ch;
+                array()[len + 1] = '\0';
+                setArrayLen (len + 1);
+                return *this;
+            }
+        }
+        else if (overflowLen() < overflowAlloc()) {
+            const unsigned int len = overflowLen();
+            FIXED_STR_STATS_RECORD (APPEND, _AllocSizeT, sizeof (_CharT), len + 1, true, true, 0);
+            overflow()[len] = ch;
+            overflow()[len + 1] = '\0';
+            setOverflow (overflow(), overflowAlloc(), len + 1);
+            return *this;
+        }
         _CharT arr[1];
         arr[0] = ch;
         append(arr, 1);        
         return *this;
     }
     
+    // Numbers are written directly (no printf); the length is known
+    // first so there's at most one allocation.  Doubles use the shortest
+    // form that reads back exactly.
+    BaseStr<_AllocSizeT, _CharT>& append (int value) {
+        return append (static_cast<long long> (value));
+    }
+
+    BaseStr<_AllocSizeT, _CharT>& append (long value) {
+        return append (static_cast<long long> (value));
+    }
+
+    BaseStr<_AllocSizeT, _CharT>& append (long long value) {
+        _CharT buff[NUMBER_CHARS_MAX];
+        return append (buff, writeSigned (buff, value));
+    }
+
+    BaseStr<_AllocSizeT, _CharT>& append (unsigned int value) {
+        return append (static_cast<unsigned long long> (value));
+    }
+
+    BaseStr<_AllocSizeT, _CharT>& append (unsigned long value) {
+        return append (static_cast<unsigned long long> (value));
+    }
+
+    BaseStr<_AllocSizeT, _CharT>& append (unsigned long long value) {
+        _CharT buff[NUMBER_CHARS_MAX];
+        return append (buff, writeUnsigned (buff, value));
+    }
+
+    BaseStr<_AllocSizeT, _CharT>& append (double value) {
+        _CharT buff[NUMBER_CHARS_MAX];
+        return append (buff, writeDouble (buff, value));
+    }
+
+    // Type-safe formatting:  each "{}" is replaced by the next arg, "{{"
+    // and "}}" give literal braces.  Args can be C strings, other FixedStrs
+    // of the same char type, a char, integers and doubles.  Everything is
+    // converted and measured before anything is written, so unlike format()
+    // the result goes straight to the array or a single allocation.
+    // Returns false (leaving the string alone) if the braces don't match
+    // up with the args.
+    //
+    //      key.fmt ("{}:{}:{}", name, id, seq);
+    //
+    template<typename... _ArgsT>
+    bool fmt (const _CharT* formatStr, const _ArgsT&... args) {
+        // +1 so there's no zero size array when there are no args.
+        FmtArg<_CharT> converted[sizeof...(_ArgsT) + 1];
+        fillFmtArgs (converted, args...);
+
+        HelperState st (*this);
+        bool ok = fmtImpl (
+                        formatStr,
+                        converted,
+                        sizeof...(_ArgsT),
+                        _AllocSizeT,
+                        &st.len,
+                        array(),
+                        st.overflow,
+                        &st.overflow,
+                        st.overflowAlloc,
+                        &st.overflowAlloc,
+                        st.overflowLen,
+                        &st.overflowLen);
+        setState (st);
+        return ok;
+    }
+
     BaseStr<_AllocSizeT, _CharT>& operator+=(const _CharT* newStr) {
         return append(newStr);
     }
@@ -673,31 +2176,138 @@ public:
     BaseStr<_AllocSizeT, _CharT>& operator+=(_CharT ch) {
         return append(ch);
     }
-                
+
+    BaseStr<_AllocSizeT, _CharT>& operator+=(BaseStrView<_CharT> newStr) {
+        return append(newStr);
+    }
+
+    template<typename _LhsT, typename _RhsT>
+    BaseStr<_AllocSizeT, _CharT>& operator+=(const BaseStrConcat<_CharT, _LhsT, _RhsT>& expr) {
+        return append(expr);
+    }
+
+    // Whether 'bytes' at 'p' are (partly) in this string's array or overflow.
+    bool overlaps (const void* p, size_t bytes) const {
+        if (bytes == 0) {
+            return false;
+        }
+        // Both ends, so a range that starts before us and runs in counts too.
+        const _CharT* buff = isOverflow() ? overflow() : array();
+        const size_t  buffBytes = ((isOverflow() ? overflowAlloc() : _AllocSizeT) + 1) * sizeof (_CharT);
+        const unsigned char* start = static_cast<const unsigned char*> (p);
+        return pointsInto (start, buff, buffBytes) ||
+               pointsInto (start + bytes - 1, buff, buffBytes) ||
+               pointsInto (buff, start, bytes);
+    }
+
 protected:
-    // 16 -> 17 bumps sizeof 24 -> 32
-    // Doesn't include terminator.
-    // If -1 the overflow is used; otherwise the m_array is used.
-    unsigned int  m_len;
-    
-    // Below we use a union because if we have to use an overflow
-    // then m_array is unusable so we can use its space for something else.
-    union {
-        // size is fixed; based on int template.
-        // +1 to include terminator.
-         _CharT          m_array [_AllocSizeT+1];
-        struct {
-        
-            // If heap was needed it goes here...
-            _CharT*         m_overflow;
-        
-            // If heap was needed; alloc size.  Real alloc size +1 to account for terminator.
-            unsigned int    m_overflowAlloc;
-            
-            // Needed becaause m_len would be -1.
-            unsigned int    m_overflowLen;
-        };
+    typedef BaseStrStorage<_AllocSizeT, _CharT> Storage;
+    using Storage::isOverflow;
+    using Storage::arrayLen;
+    using Storage::array;
+    using Storage::overflow;
+    using Storage::overflowAlloc;
+    using Storage::overflowLen;
+    using Storage::setArrayLen;
+    using Storage::setOverflow;
+
+    // Other allocations need to get at the overflow when moving.
+    template<size_t, typename> friend class BaseStr;
+
+    // Writes its pieces straight into the array or overflow.
+    template<typename, size_t> friend class BaseStrBuilder;
+
+    // So does transcoding to and from UTF-8.
+    friend class FixedStrUtf8;
+
+    // The state the way the helpers above want it:  a length that's -1
+    // when the overflow is used, plus the overflow's fields.  They write
+    // content straight into array(); setState() then records the result.
+    struct HelperState {
+        explicit HelperState (const BaseStr<_AllocSizeT, _CharT>& str)
+            :
+            len             (str.isOverflow() ? -1 : str.arrayLen()),
+            overflow        (str.isOverflow() ? str.overflow() : NULL),
+            overflowAlloc   (str.isOverflow() ? str.overflowAlloc() : 0),
+            overflowLen     (str.isOverflow() ? str.overflowLen() : 0) {
+        }
+
+        unsigned int    len;
+        _CharT*         overflow;
+        unsigned int    overflowAlloc;
+        unsigned int    overflowLen;
     };
+
+    void setState (const HelperState& st) {
+        if (st.len == USING_OVERFLOW) {
+            setOverflow (st.overflow, st.overflowAlloc, st.overflowLen);
+        }
+        else {
+            setArrayLen (st.len);
+        }
+    }
+
+    // Makes this 'total' long, keeping the first 'keep' chars, and has
+    // 'writer.write (_CharT* out)' fill in the rest (total - keep chars, no
+    // terminator).  See placeImpl().  Returns the bytes allocated, if any.
+    template<typename _WriterT>
+    size_t place (size_t keep, size_t total, bool aliased, const _WriterT& writer) {
+        if (total >= UINT_MAX) {
+            throw std::length_error ("FixedStr too long");
+        }
+        HelperState st (*this);
+        size_t bytes = placeImpl (
+                        keep,
+                        total,
+                        aliased,
+                        [&] (_CharT* out) { writer.write (out); },
+                        _AllocSizeT,
+                        &st.len,
+                        array(),
+                        st.overflow,
+                        &st.overflow,
+                        st.overflowAlloc,
+                        &st.overflowAlloc,
+                        &st.overflowLen);
+        setState (st);
+        return bytes;
+    }
+
+    // Takes the content of 'rhs', leaving it empty if its overflow was taken.
+    // If rhs has spilled and the content wouldn't fit in our array anyway,
+    // the overflow is handed over as-is:  no allocation and no copy.
+    // Otherwise it's just a copy, which needs no heap unless we're
+    // the smaller one.
+    template<size_t rhsAllocT>
+    void moveFrom (BaseStr<rhsAllocT, _CharT>& rhs) {
+        if (!rhs.isOverflow() || rhs.overflowLen() <= _AllocSizeT) {
+            assign (rhs.c_str(), rhs.length());
+            return;
+        }
+        if (isOverflow()) overflowDelete (overflow());
+        setOverflow (rhs.overflow(), rhs.overflowAlloc(), rhs.overflowLen());
+
+        rhs.array()[0] = '\0';
+        rhs.setArrayLen (0);
+    }
+
+    // moveFrom() for the noexcept same-alloc move assignment, which mustn't
+    // allocate whatever the growth policy or resources.  Rather than go
+    // through assign(), content that fits our array is copied there and
+    // any overflow of ours is just freed.
+    void moveAssign (BaseStr<_AllocSizeT, _CharT>& rhs) {
+        if (rhs.isOverflow() && rhs.overflowLen() > _AllocSizeT) {
+            moveFrom (rhs);
+            return;
+        }
+        // the array shares space with the overflow pointer.
+        _CharT* old = isOverflow() ? overflow() : NULL;
+        const unsigned int len = static_cast<unsigned int> (rhs.length());
+        memcpy (array(), rhs.c_str(), len * sizeof (_CharT));
+        array()[len] = '\0';
+        setArrayLen (len);
+        overflowDelete (old);
+    }
     
 }; // end class.
 
@@ -718,26 +2328,94 @@ public:
     {
     }
 
+    FixedStr (const FixedStr<_AllocSizeT>& newStr)
+        :
+        BaseStr<_AllocSizeT, char> (newStr)
+    {
+    }
+
+    template<size_t newAllocT>
+    FixedStr (const FixedStr<newAllocT>& newStr)
+        :
+        BaseStr<_AllocSizeT, char> (newStr)
+    {
+    }
+
+    FixedStr (FixedStr<_AllocSizeT>&& newStr) noexcept
+        :
+        BaseStr<_AllocSizeT, char> (static_cast<BaseStr<_AllocSizeT, char>&&> (newStr))
+    {
+    }
+
+    template<size_t newAllocT>
+    FixedStr (FixedStr<newAllocT>&& newStr)
+        :
+        BaseStr<_AllocSizeT, char> (static_cast<BaseStr<newAllocT, char>&&> (newStr))
+    {
+    }
+
+    // ok
+    explicit FixedStr (const char* newStr)
+        :
+        BaseStr<_AllocSizeT, char> (newStr)
+    {
+    }
+
+    explicit FixedStr (FixedStrView newStr)
+        :
+        BaseStr<_AllocSizeT, char> (newStr)
+    {
+    }
+
+    // FixedStr<32> key = a + ":" + b;
+    template<typename _LhsT, typename _RhsT>
+    FixedStr (const BaseStrConcat<char, _LhsT, _RhsT>& expr)
+        :
+        BaseStr<_AllocSizeT, char> (expr)
+    {
+    }
+
+    // We need this because operator= doesn't inherit.
+    // The copy assignment operator (where rhs is the same type as 'this')
+    // is compiler generated and calls the base version.  However we need 
+    // our own impl here for other types. 
+    FixedStr<_AllocSizeT>& operator=(const char* rhs) { 
+        BaseStr<_AllocSizeT, char>::operator=(rhs);
+        return *this;
+    }
+
+    FixedStr<_AllocSizeT>& operator=(FixedStrView rhs) { 
+        BaseStr<_AllocSizeT, char>::operator=(rhs);
+        return *this;
+    }
+
+    template<typename _LhsT, typename _RhsT>
+    FixedStr<_AllocSizeT>& operator=(const BaseStrConcat<char, _LhsT, _RhsT>& rhs) { 
+        BaseStr<_AllocSizeT, char>::operator=(rhs);
+        return *this;
+    }
+
+    // Declaring the move ops means the copy ops have to be spelled out too.
+    FixedStr<_AllocSizeT>& operator=(const FixedStr<_AllocSizeT>& rhs) {
+        BaseStr<_AllocSizeT, char>::operator=(rhs);
+        return *this;
+    }
+
+    // Without these a different-alloc rhs would go through a temporary.
     template<size_t newAllocT>
-    FixedStr (const FixedStr<newAllocT>& newStr)
-        :
-        BaseStr<_AllocSizeT, char> (newStr)
-    {
+    FixedStr<_AllocSizeT>& operator=(const FixedStr<newAllocT>& rhs) {
+        BaseStr<_AllocSizeT, char>::operator=(rhs);
+        return *this;
     }
 
-    // ok
-    explicit FixedStr (const char* newStr)
-        :
-        BaseStr<_AllocSizeT, char> (newStr)
-    {
+    FixedStr<_AllocSizeT>& operator=(FixedStr<_AllocSizeT>&& rhs) noexcept {
+        BaseStr<_AllocSizeT, char>::operator=(static_cast<BaseStr<_AllocSizeT, char>&&> (rhs));
+        return *this;
     }
 
-    // We need this because operator= doesn't inherit.
-    // The copy assignment operator (where rhs is the same type as 'this')
-    // is compiler generated and calls the base version.  However we need 
-    // our own impl here for other types. 
-    FixedStr<_AllocSizeT>& operator=(const char* rhs) { 
-        BaseStr<_AllocSizeT, char>::operator=(rhs);
+    template<size_t newAllocT>
+    FixedStr<_AllocSizeT>& operator=(FixedStr<newAllocT>&& rhs) {
+        BaseStr<_AllocSizeT, char>::operator=(static_cast<BaseStr<newAllocT, char>&&> (rhs));
         return *this;
     }
         
@@ -745,29 +2423,30 @@ public:
     bool format (const char* formatStr, ...) {
         va_list args;
         va_start(args, formatStr);    
-        char*           overflowOut      = NULL;
-        unsigned int    overflowAllocOut = 0;
-        unsigned int    overflowLenOut   = 0;
+        bool ok = vformat (formatStr, args);
+        va_end (args);
+        return ok;
+    }
 
+    // For wrappers with their own '...'.
+    bool vformat (const char* formatStr, va_list args) {
+        va_list argsHere;
+        my_va_copy (argsHere, args);
+        typename BaseStr<_AllocSizeT, char>::HelperState st (*this);
         bool ok = formatImpl (
                         formatStr,
-                        &args,
+                        &argsHere,
                         _AllocSizeT,
-                        &(this->m_len),
-                        this->m_array,
-                        this->m_overflow,
-                        &overflowOut,
-                        this->m_overflowAlloc,
-                        &overflowAllocOut,
-                        this->m_overflowLen,
-                        &overflowLenOut);
-
-        if (ok && this->m_len == -1) {
-            this->m_overflow =      overflowOut;
-            this->m_overflowAlloc = overflowAllocOut;
-            this->m_overflowLen =   overflowLenOut;
-        }
-        va_end (args);
+                        &st.len,
+                        this->array(),
+                        st.overflow,
+                        &st.overflow,
+                        st.overflowAlloc,
+                        &st.overflowAlloc,
+                        st.overflowLen,
+                        &st.overflowLen);
+        this->setState (st);
+        va_end (argsHere);
         return ok;
     }
                         
@@ -782,6 +2461,12 @@ public:
     {
     }
 
+    WFixedStr (const WFixedStr<_AllocSizeT>& newStr)
+        :
+        BaseStr<_AllocSizeT, wchar_t> (newStr)
+    {
+    }
+
     template<size_t newAllocT>
     WFixedStr (const WFixedStr<newAllocT>& newStr)
         :
@@ -789,44 +2474,105 @@ public:
     {
     }
 
+    WFixedStr (WFixedStr<_AllocSizeT>&& newStr) noexcept
+        :
+        BaseStr<_AllocSizeT, wchar_t> (static_cast<BaseStr<_AllocSizeT, wchar_t>&&> (newStr))
+    {
+    }
+
+    template<size_t newAllocT>
+    WFixedStr (WFixedStr<newAllocT>&& newStr)
+        :
+        BaseStr<_AllocSizeT, wchar_t> (static_cast<BaseStr<newAllocT, wchar_t>&&> (newStr))
+    {
+    }
+
     // ok
     explicit WFixedStr (const wchar_t* newStr)
         :
         BaseStr<_AllocSizeT, wchar_t> (newStr)
     {
     }
+
+    explicit WFixedStr (WFixedStrView newStr)
+        :
+        BaseStr<_AllocSizeT, wchar_t> (newStr)
+    {
+    }
+
+    // FixedStr<32> key = a + ":" + b;
+    template<typename _LhsT, typename _RhsT>
+    WFixedStr (const BaseStrConcat<wchar_t, _LhsT, _RhsT>& expr)
+        :
+        BaseStr<_AllocSizeT, wchar_t> (expr)
+    {
+    }
     
     WFixedStr<_AllocSizeT>& operator=(const wchar_t* rhs) { 
         BaseStr<_AllocSizeT, wchar_t>::operator=(rhs);
         return *this;
     }
+
+    WFixedStr<_AllocSizeT>& operator=(WFixedStrView rhs) { 
+        BaseStr<_AllocSizeT, wchar_t>::operator=(rhs);
+        return *this;
+    }
+
+    template<typename _LhsT, typename _RhsT>
+    WFixedStr<_AllocSizeT>& operator=(const BaseStrConcat<wchar_t, _LhsT, _RhsT>& rhs) { 
+        BaseStr<_AllocSizeT, wchar_t>::operator=(rhs);
+        return *this;
+    }
+
+    WFixedStr<_AllocSizeT>& operator=(const WFixedStr<_AllocSizeT>& rhs) {
+        BaseStr<_AllocSizeT, wchar_t>::operator=(rhs);
+        return *this;
+    }
+
+    template<size_t newAllocT>
+    WFixedStr<_AllocSizeT>& operator=(const WFixedStr<newAllocT>& rhs) {
+        BaseStr<_AllocSizeT, wchar_t>::operator=(rhs);
+        return *this;
+    }
+
+    WFixedStr<_AllocSizeT>& operator=(WFixedStr<_AllocSizeT>&& rhs) noexcept {
+        BaseStr<_AllocSizeT, wchar_t>::operator=(static_cast<BaseStr<_AllocSizeT, wchar_t>&&> (rhs));
+        return *this;
+    }
+
+    template<size_t newAllocT>
+    WFixedStr<_AllocSizeT>& operator=(WFixedStr<newAllocT>&& rhs) {
+        BaseStr<_AllocSizeT, wchar_t>::operator=(static_cast<BaseStr<newAllocT, wchar_t>&&> (rhs));
+        return *this;
+    }
     
     bool format (const wchar_t* formatStr, ...) {
         va_list args;
         va_start(args, formatStr);    
-        wchar_t*        overflowOut      = NULL;
-        unsigned int    overflowAllocOut = 0;
-        unsigned int    overflowLenOut   = 0;
+        bool ok = vformat (formatStr, args);
+        va_end (args);
+        return ok;
+    }
 
+    // For wrappers with their own '...'.
+    bool vformat (const wchar_t* formatStr, va_list args) {
+        va_list argsHere;
+        my_va_copy (argsHere, args);
+        typename BaseStr<_AllocSizeT, wchar_t>::HelperState st (*this);
         bool ok = wideFormatImpl (
                         formatStr,
-                        &args,
+                        &argsHere,
                         _AllocSizeT,
-                        &(this->m_len),
-                        this->m_array,
-                        this->m_overflow,
-                        &overflowOut,
-                        this->m_overflowAlloc,
-                        &overflowAllocOut,
-                        this->m_overflowLen,
-                        &overflowLenOut);
-
-        if (ok && this->m_len == -1) {
-            this->m_overflow =      overflowOut;
-            this->m_overflowAlloc = overflowAllocOut;
-            this->m_overflowLen =   overflowLenOut;
-        }
-        va_end (args);
+                        &st.len,
+                        this->array(),
+                        st.overflow,
+                        &st.overflow,
+                        st.overflowAlloc,
+                        &st.overflowAlloc,
+                        st.overflowLen,
+                        &st.overflowLen);
+        this->setState (st);
+        va_end (argsHere);
         return ok;
     }
 };  
@@ -839,49 +2585,497 @@ template<size_t origAlloc1, size_t origAlloc2, typename _CharT>
 bool operator==(const BaseStr<origAlloc1, _CharT> &lhs,
                 const BaseStr<origAlloc2, _CharT> &rhs)
 {
-    return isEqualImpl (
-                lhs.c_str(), lhs.length(),
-                rhs.c_str(), rhs.length()); 
+    size_t len = lhs.length();
+    if (len != rhs.length()) {
+        return false;
+    }
+    if (!lhs.isUsingOverflow() && !rhs.isUsingOverflow()) {
+        // Both in their arrays, so the smaller array size is a compile time
+        // bound.  Short strings get compared with a single vector load.
+        const size_t buffBytes = 
+            ((origAlloc1 < origAlloc2 ? origAlloc1 : origAlloc2) + 1) * sizeof (_CharT);
+        return bufferBytesEqual<buffBytes> (lhs.c_str(), rhs.c_str(), len * sizeof (_CharT));
+    }
+    return bytesEqual (lhs.c_str(), rhs.c_str(), len * sizeof (_CharT));
 }
 
 
-#if UINT_MAX == 4294967295 && CHAR_BIT == 8
-template<size_t origAlloc1, size_t origAlloc2>
-bool operator==(const FixedStr<origAlloc1> &lhs,
-                const FixedStr<origAlloc2> &rhs)
+template<size_t origAlloc1, size_t origAlloc2, typename _CharT>
+bool operator!=(const BaseStr<origAlloc1, _CharT> &lhs,
+                const BaseStr<origAlloc2, _CharT> &rhs)
 {
-    return isEqualImpl_char (
-                lhs.c_str(), lhs.length(),
-                rhs.c_str(), rhs.length()); 
+    return !(lhs==rhs);
 }
-#endif
 
+// Ordering is all built on compare().
 
 template<size_t origAlloc1, size_t origAlloc2, typename _CharT>
-bool operator!=(const BaseStr<origAlloc1, _CharT> &lhs,
+bool operator<( const BaseStr<origAlloc1, _CharT> &lhs,
                 const BaseStr<origAlloc2, _CharT> &rhs)
 {
-    return !(lhs==rhs);
+    return lhs.compare (rhs) < 0;
+}
+
+template<size_t origAlloc1, size_t origAlloc2, typename _CharT>
+bool operator<=(const BaseStr<origAlloc1, _CharT> &lhs,
+                const BaseStr<origAlloc2, _CharT> &rhs)
+{
+    return lhs.compare (rhs) <= 0;
+}
+
+template<size_t origAlloc1, size_t origAlloc2, typename _CharT>
+bool operator>( const BaseStr<origAlloc1, _CharT> &lhs,
+                const BaseStr<origAlloc2, _CharT> &rhs)
+{
+    return lhs.compare (rhs) > 0;
+}
+
+template<size_t origAlloc1, size_t origAlloc2, typename _CharT>
+bool operator>=(const BaseStr<origAlloc1, _CharT> &lhs,
+                const BaseStr<origAlloc2, _CharT> &rhs)
+{
+    return lhs.compare (rhs) >= 0;
+}
+
+//////////////////////////
+// Views.  FixedStrs of any size compare with views (and so anything that
+// converts to one), and views with C strings.
+//////////////////////////
+
+template<typename _CharT>
+bool operator==(BaseStrView<_CharT> lhs, BaseStrView<_CharT> rhs)
+{
+    return lhs.equals (rhs);
+}
+
+template<typename _CharT>
+bool operator!=(BaseStrView<_CharT> lhs, BaseStrView<_CharT> rhs)
+{
+    return !lhs.equals (rhs);
+}
+
+template<typename _CharT>
+bool operator<( BaseStrView<_CharT> lhs, BaseStrView<_CharT> rhs)
+{
+    return lhs.compare (rhs) < 0;
+}
+
+template<typename _CharT>
+bool operator<=(BaseStrView<_CharT> lhs, BaseStrView<_CharT> rhs)
+{
+    return lhs.compare (rhs) <= 0;
+}
+
+template<typename _CharT>
+bool operator>( BaseStrView<_CharT> lhs, BaseStrView<_CharT> rhs)
+{
+    return lhs.compare (rhs) > 0;
+}
+
+template<typename _CharT>
+bool operator>=(BaseStrView<_CharT> lhs, BaseStrView<_CharT> rhs)
+{
+    return lhs.compare (rhs) >= 0;
+}
+
+template<size_t origAlloc, typename _CharT>
+bool operator==(const BaseStr<origAlloc, _CharT>& lhs, BaseStrView<_CharT> rhs)
+{
+    return lhs.view().equals (rhs);
 }
 
-template<size_t origAlloc1, size_t origAlloc2>
-bool operator<( const BaseStr<origAlloc1, char> &lhs,
-                const BaseStr<origAlloc2, char> &rhs)
+template<size_t origAlloc, typename _CharT>
+bool operator==(BaseStrView<_CharT> lhs, const BaseStr<origAlloc, _CharT>& rhs)
 {
-    // Compiler won't be able to figure out template params.
-    return isLessImpl<char, unsigned char> (
-                lhs.c_str(), lhs.length(),
-                rhs.c_str(), rhs.length());       
+    return lhs.equals (rhs.view());
 }
 
-template<size_t origAlloc1, size_t origAlloc2>
-bool operator<( const BaseStr<origAlloc1, wchar_t> &lhs,
-                const BaseStr<origAlloc2, wchar_t> &rhs)
+template<size_t origAlloc, typename _CharT>
+bool operator!=(const BaseStr<origAlloc, _CharT>& lhs, BaseStrView<_CharT> rhs)
 {
-    return isLessImpl<wchar_t, wchar_t> (
-                lhs.c_str(), lhs.length(),
-                rhs.c_str(), rhs.length());       
+    return !lhs.view().equals (rhs);
 }
 
+template<size_t origAlloc, typename _CharT>
+bool operator!=(BaseStrView<_CharT> lhs, const BaseStr<origAlloc, _CharT>& rhs)
+{
+    return !lhs.equals (rhs.view());
+}
+
+template<size_t origAlloc, typename _CharT>
+bool operator<( const BaseStr<origAlloc, _CharT>& lhs, BaseStrView<_CharT> rhs)
+{
+    return lhs.view().compare (rhs) < 0;
+}
+
+template<size_t origAlloc, typename _CharT>
+bool operator<( BaseStrView<_CharT> lhs, const BaseStr<origAlloc, _CharT>& rhs)
+{
+    return lhs.compare (rhs.view()) < 0;
+}
+
+template<typename _CharT>
+bool operator==(BaseStrView<_CharT> lhs, const _CharT* rhs)
+{
+    return lhs.equals (rhs);
+}
+
+template<typename _CharT>
+bool operator==(const _CharT* lhs, BaseStrView<_CharT> rhs)
+{
+    return rhs.equals (lhs);
+}
+
+template<typename _CharT>
+bool operator!=(BaseStrView<_CharT> lhs, const _CharT* rhs)
+{
+    return !lhs.equals (rhs);
+}
+
+template<typename _CharT>
+bool operator!=(const _CharT* lhs, BaseStrView<_CharT> rhs)
+{
+    return !rhs.equals (lhs);
+}
+
+#ifdef FIXED_STR_HAS_SPACESHIP
+template<size_t origAlloc1, size_t origAlloc2, typename _CharT>
+std::strong_ordering operator<=>(const BaseStr<origAlloc1, _CharT> &lhs,
+                                 const BaseStr<origAlloc2, _CharT> &rhs)
+{
+    int res = lhs.compare (rhs);
+    if (res < 0) return std::strong_ordering::less;
+    if (res > 0) return std::strong_ordering::greater;
+    return std::strong_ordering::equal;
+}
+#endif
+
+//////////////////////////
+// Hashing.  Only the content counts, so a FixedStr<16>, a FixedStr<64>
+// and a view with the same chars all hash the same.  To look up with
+// something other than the key type (C++20 unordered containers), use
+// FixedStrHash / WFixedStrHash with std::equal_to<>:
+//
+//      std::unordered_map<FixedStr<16>, int, FixedStrHash, std::equal_to<> > ids;
+//      ids.find (line.substr (0, 8));      // no FixedStr made
+//////////////////////////
+
+template<typename _CharT>
+struct BaseStrHash {
+    typedef void is_transparent;
+
+    size_t operator() (BaseStrView<_CharT> str) const {
+        return str.hash();
+    }
+
+    // Anything with its own hash() (FixedStrs, HashedFixedStr's cached one).
+    template<typename _StrT>
+    auto operator() (const _StrT& str) const -> decltype (str.hash()) {
+        return str.hash();
+    }
+};
+
+typedef BaseStrHash<char>       FixedStrHash;
+typedef BaseStrHash<wchar_t>    WFixedStrHash;
+
+// Case-insensitive hash and equality, for keys like header and host
+// names; lookups need no lower-cased copy:
+//
+//      std::unordered_map<FixedStr<32>, int, FixedStrIHash, FixedStrIEqual> headers;
+//      headers.find ("Content-Length");    // C++20; finds "content-length"
+template<typename _CharT>
+struct BaseStrIHash {
+    typedef void is_transparent;
+
+    size_t operator() (BaseStrView<_CharT> str) const {
+        return str.ihash();
+    }
+};
+
+template<typename _CharT>
+struct BaseStrIEqual {
+    typedef void is_transparent;
+
+    bool operator() (BaseStrView<_CharT> lhs, BaseStrView<_CharT> rhs) const {
+        return lhs.iequals (rhs);
+    }
+};
+
+typedef BaseStrIHash<char>      FixedStrIHash;
+typedef BaseStrIHash<wchar_t>   WFixedStrIHash;
+typedef BaseStrIEqual<char>     FixedStrIEqual;
+typedef BaseStrIEqual<wchar_t>  WFixedStrIEqual;
+
+namespace std {
+    template<size_t _AllocSizeT, typename _CharT>
+    struct hash<BaseStr<_AllocSizeT, _CharT> > {
+        size_t operator() (const BaseStr<_AllocSizeT, _CharT>& str) const {
+            return str.hash();
+        }
+    };
+
+    template<size_t _AllocSizeT>
+    struct hash<FixedStr<_AllocSizeT> > {
+        size_t operator() (const FixedStr<_AllocSizeT>& str) const {
+            return str.hash();
+        }
+    };
+
+    template<size_t _AllocSizeT>
+    struct hash<WFixedStr<_AllocSizeT> > {
+        size_t operator() (const WFixedStr<_AllocSizeT>& str) const {
+            return str.hash();
+        }
+    };
+}
+
+//////////////////////////
+// Concatenation.  operator+ doesn't build a string; it returns a small
+// node that just remembers its operands (pointer and length, or a char).
+// Assigning or appending the finished chain to a FixedStr adds up the
+// length first and then copies each piece once, straight into the array
+// or one overflow allocation of exactly the right size:
+//
+//      FixedStr<32> key = name + ':' + id + ":" + seq;
+//
+// Operands are FixedStrs (any size), views, std::basic_string_views, C
+// strings and chars; at least one side of each + must be a FixedStr, a
+// view or another node.  Like a view, a node only points at its operands,
+// so 'auto e = a + b;' must not outlive 'a' and 'b'.
+//////////////////////////
+
+template<typename _CharT>
+class ConcatText {
+public:
+    ConcatText (const _CharT* str, size_t len)
+        :
+        m_str (str),
+        m_len (len)
+    {
+    }
+
+    size_t length() const {
+        return m_len;
+    }
+
+    _CharT* write (_CharT* out) const {
+        copyBytes (out, m_str, m_len * sizeof (_CharT));
+        return out + m_len;
+    }
+
+    template<size_t _AllocSizeT>
+    bool overlaps (const BaseStr<_AllocSizeT, _CharT>& str) const {
+        return str.overlaps (m_str, m_len * sizeof (_CharT));
+    }
+
+private:
+    const _CharT*   m_str;
+    size_t          m_len;
+};
+
+template<typename _CharT>
+class ConcatChar {
+public:
+    explicit ConcatChar (_CharT ch)
+        :
+        m_ch (ch)
+    {
+    }
+
+    size_t length() const {
+        return 1;
+    }
+
+    _CharT* write (_CharT* out) const {
+        *out = m_ch;
+        return out + 1;
+    }
+
+    template<size_t _AllocSizeT>
+    bool overlaps (const BaseStr<_AllocSizeT, _CharT>&) const {
+        return false;
+    }
+
+private:
+    _CharT          m_ch;
+};
+
+template<typename _CharT, typename _LhsT, typename _RhsT>
+class BaseStrConcat {
+public:
+    BaseStrConcat (const _LhsT& lhs, const _RhsT& rhs)
+        :
+        m_lhs (lhs),
+        m_rhs (rhs),
+        m_len (lhs.length() + rhs.length())
+    {
+    }
+
+    size_t length() const {
+        return m_len;
+    }
+
+    // Writes the pieces at 'out' (no terminator); returns the end.
+    _CharT* write (_CharT* out) const {
+        return m_rhs.write (m_lhs.write (out));
+    }
+
+    // Whether any piece is part of 'str'.
+    template<size_t _AllocSizeT>
+    bool overlaps (const BaseStr<_AllocSizeT, _CharT>& str) const {
+        return m_lhs.overlaps (str) || m_rhs.overlaps (str);
+    }
+
+private:
+    _LhsT   m_lhs;
+    _RhsT   m_rhs;
+    size_t  m_len;
+};
+
+// What can be on either side of a +:  gives its char type and the node
+// it becomes.
+template<typename _T>
+struct ConcatOperand {
+    enum { IS = 0 };
+};
+
+template<size_t _AllocSizeT, typename _CharT>
+struct ConcatOperand<BaseStr<_AllocSizeT, _CharT> > {
+    enum { IS = 1 };
+    typedef _CharT              CharT;
+    typedef ConcatText<_CharT>  Node;
+    static Node node (const BaseStr<_AllocSizeT, _CharT>& str) {
+        return Node (str.c_str(), str.length());
+    }
+};
+
+template<size_t _AllocSizeT>
+struct ConcatOperand<FixedStr<_AllocSizeT> > : ConcatOperand<BaseStr<_AllocSizeT, char> > {
+};
+
+template<size_t _AllocSizeT>
+struct ConcatOperand<WFixedStr<_AllocSizeT> > : ConcatOperand<BaseStr<_AllocSizeT, wchar_t> > {
+};
+
+template<typename _CharT>
+struct ConcatOperand<BaseStrView<_CharT> > {
+    enum { IS = 1 };
+    typedef _CharT              CharT;
+    typedef ConcatText<_CharT>  Node;
+    static Node node (BaseStrView<_CharT> str) {
+        return Node (str.data(), str.length());
+    }
+};
+
+template<typename _CharT, typename _LhsT, typename _RhsT>
+struct ConcatOperand<BaseStrConcat<_CharT, _LhsT, _RhsT> > {
+    enum { IS = 1 };
+    typedef _CharT                                  CharT;
+    typedef BaseStrConcat<_CharT, _LhsT, _RhsT>     Node;
+    static const Node& node (const Node& expr) {
+        return expr;
+    }
+};
+
+// What can only be on one side, with one of the above on the other:
+// C strings, chars and std::basic_string_views of the same char type.
+template<typename _T, typename _CharT>
+struct ConcatOther {
+    enum { IS = 0 };
+};
+
+template<typename _CharT>
+struct ConcatOther<const _CharT*, _CharT> {
+    enum { IS = 1 };
+    typedef ConcatText<_CharT>  Node;
+    static Node node (const _CharT* str) {
+        return Node (str, countLen (str));
+    }
+};
+
+template<typename _CharT>
+struct ConcatOther<_CharT*, _CharT> : ConcatOther<const _CharT*, _CharT> {
+};
+
+// String literals and char arrays.  Up to the terminator, not the size.
+template<typename _CharT, size_t _SizeT>
+struct ConcatOther<_CharT[_SizeT], _CharT> : ConcatOther<const _CharT*, _CharT> {
+};
+
+template<typename _CharT, size_t _SizeT>
+struct ConcatOther<const _CharT[_SizeT], _CharT> : ConcatOther<const _CharT*, _CharT> {
+};
+
+template<typename _CharT>
+struct ConcatOther<_CharT, _CharT> {
+    enum { IS = 1 };
+    typedef ConcatChar<_CharT>  Node;
+    static Node node (_CharT ch) {
+        return Node (ch);
+    }
+};
+
+#ifdef FIXED_STR_HAS_STRING_VIEW
+template<typename _CharT>
+struct ConcatOther<std::basic_string_view<_CharT>, _CharT> {
+    enum { IS = 1 };
+    typedef ConcatText<_CharT>  Node;
+    static Node node (std::basic_string_view<_CharT> str) {
+        return Node (str.data(), str.length());
+    }
+};
+#endif
+
+// The node for lhs + rhs, given how each side becomes a node.
+template<typename _CharT, typename _LhsT, typename _RhsT, typename _LhsOpT, typename _RhsOpT>
+struct ConcatMake {
+    typedef BaseStrConcat<_CharT, typename _LhsOpT::Node, typename _RhsOpT::Node> type;
+    static type make (const _LhsT& lhs, const _RhsT& rhs) {
+        return type (_LhsOpT::node (lhs), _RhsOpT::node (rhs));
+    }
+};
+
+// Has no 'type' (so operator+ drops out) unless lhs + rhs is one of ours.
+struct ConcatNone {
+};
+
+template<typename _LhsT, typename _RhsT,
+         bool _LhsIsT = ConcatOperand<_LhsT>::IS,
+         bool _RhsIsT = ConcatOperand<_RhsT>::IS>
+struct ConcatResult : ConcatNone {
+};
+
+template<typename _LhsT, typename _RhsT>
+struct ConcatResult<_LhsT, _RhsT, true, true>
+    : std::conditional<
+        std::is_same<typename ConcatOperand<_LhsT>::CharT, typename ConcatOperand<_RhsT>::CharT>::value,
+        ConcatMake<typename ConcatOperand<_LhsT>::CharT, _LhsT, _RhsT,
+                   ConcatOperand<_LhsT>, ConcatOperand<_RhsT> >,
+        ConcatNone>::type {
+};
+
+template<typename _LhsT, typename _RhsT>
+struct ConcatResult<_LhsT, _RhsT, true, false>
+    : std::conditional<
+        ConcatOther<_RhsT, typename ConcatOperand<_LhsT>::CharT>::IS,
+        ConcatMake<typename ConcatOperand<_LhsT>::CharT, _LhsT, _RhsT,
+                   ConcatOperand<_LhsT>, ConcatOther<_RhsT, typename ConcatOperand<_LhsT>::CharT> >,
+        ConcatNone>::type {
+};
+
+template<typename _LhsT, typename _RhsT>
+struct ConcatResult<_LhsT, _RhsT, false, true>
+    : std::conditional<
+        ConcatOther<_LhsT, typename ConcatOperand<_RhsT>::CharT>::IS,
+        ConcatMake<typename ConcatOperand<_RhsT>::CharT, _LhsT, _RhsT,
+                   ConcatOther<_LhsT, typename ConcatOperand<_RhsT>::CharT>, ConcatOperand<_RhsT> >,
+        ConcatNone>::type {
+};
+
+template<typename _LhsT, typename _RhsT>
+typename ConcatResult<_LhsT, _RhsT>::type operator+(const _LhsT& lhs, const _RhsT& rhs)
+{
+    return ConcatResult<_LhsT, _RhsT>::make (lhs, rhs);
+}
 
 #endif
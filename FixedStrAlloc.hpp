@@ -0,0 +1,343 @@
+#ifndef FIXED_STR_ALLOC_H
+#define FIXED_STR_ALLOC_H
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <stdint.h>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define FIXED_STR_HAS_PMR 1
+#endif
+#endif
+
+/*
+ *  FixedStrAlloc
+ *  Where FixedStr gets its overflow (heap) storage from.
+ *
+ *  By default overflow comes from the global heap, same as always.
+ *  To use something else (e.g. a per-request arena) install a resource for
+ *  the current thread with FixedStrResourceScope.  Any string spilling on
+ *  that thread while the scope is alive gets its overflow from there:
+ *
+ *      FixedStrArena arena;
+ *      FixedStrResourceScope scope (&arena);
+ *      ... FixedStr<16> stuff; anything spilling comes from 'arena' ...
+ *
+ *  The resource a block came from is remembered in a small header in front
+ *  of the block itself, so it costs nothing inside the string object and
+ *  the string can be destroyed or grown on any thread.  It does mean the
+ *  resource has to outlive every string that got a block from it.
+ */
+
+class FixedStrResource {
+public:
+    virtual ~FixedStrResource() {
+    }
+
+    // 'bytes' is never 0.  Must return memory aligned for a pointer at least,
+    // or throw std::bad_alloc.
+    virtual void* allocate (size_t bytes) = 0;
+
+    // 'bytes' is what was passed to allocate().
+    virtual void  deallocate (void* p, size_t bytes) = 0;
+
+    // The global heap.  Always available.
+    static FixedStrResource* heap();
+
+    // Resource used for new overflow on this thread.  heap() unless a
+    // FixedStrResourceScope says otherwise.
+    static FixedStrResource* getDefault() {
+        FixedStrResource* res = threadDefault();
+        return res ? res : heap();
+    }
+
+    // Returns the previous setting.  NULL means heap().
+    static FixedStrResource* setDefault (FixedStrResource* res) {
+        FixedStrResource* prev = threadDefault();
+        threadDefault() = res;
+        return prev;
+    }
+
+private:
+    // Inline function statics are shared across translation units, unlike
+    // anything in FixedStr.hpp's blank namespace.
+    static FixedStrResource*& threadDefault() {
+        static thread_local FixedStrResource* res = NULL;
+        return res;
+    }
+};
+
+class FixedStrHeapResource : public FixedStrResource {
+public:
+    void* allocate (size_t bytes) {
+        return ::operator new (bytes);
+    }
+
+    void deallocate (void* p, size_t) {
+        ::operator delete (p);
+    }
+};
+
+inline FixedStrResource* FixedStrResource::heap() {
+    static FixedStrHeapResource res;
+    return &res;
+}
+
+////////////////////
+// Sets the default resource for the current thread until it goes
+// out of scope.  These can nest.
+////////////////////
+class FixedStrResourceScope {
+public:
+    explicit FixedStrResourceScope (FixedStrResource* res)
+        :
+        m_prev (FixedStrResource::setDefault (res)) {
+    }
+
+    ~FixedStrResourceScope() {
+        FixedStrResource::setDefault (m_prev);
+    }
+
+private:
+    FixedStrResource* m_prev;
+
+    // disable these...
+    FixedStrResourceScope(const FixedStrResourceScope& other);
+    FixedStrResourceScope& operator=(const FixedStrResourceScope& other);
+};
+
+////////////////////
+// How overflow is sized, and when it's given up.  Like the resource this is
+// per thread:  install one with FixedStrGrowthScope for a stretch of code
+// (e.g. around per-message building, or the setup of long-lived objects).
+// The defaults are the original behavior.
+////////////////////
+struct FixedStrGrowth {
+    FixedStrGrowth()
+        :
+        growPercent     (200),
+        roundToSizeClass(false),
+        inlinePercent   (100),
+        shrinkPercent   (0) {
+    }
+
+    // An append that outgrows the space allocates this percent of the
+    // length needed.  200 doubles; 100 is exact.
+    unsigned int    growPercent;
+
+    // Round overflow blocks up to the sizes a typical malloc hands out
+    // anyway, so the slack is usable capacity instead of waste.
+    bool            roundToSizeClass;
+
+    // When a spilled string's content would fit the array again it goes
+    // back there (freeing the overflow) only if it's at most this percent
+    // of the array.  100 goes back as soon as it fits; 0 never does.
+    // Something in between leaves a band where the overflow is kept, so a
+    // length going back and forth across the array size doesn't allocate
+    // and free each time.
+    unsigned int    inlinePercent;
+
+    // When what's assigned uses less than this percent of the overflow,
+    // the overflow is swapped for a smaller one (sized as if growing, so
+    // it isn't right back at the limit).  0 keeps it however big it is.
+    unsigned int    shrinkPercent;
+
+    // The policy for this thread.
+    static const FixedStrGrowth& current() {
+        const FixedStrGrowth* growth = threadCurrent();
+        return growth ? *growth : defaults();
+    }
+
+    // Returns the previous setting.  NULL means the defaults.
+    static const FixedStrGrowth* setCurrent (const FixedStrGrowth* growth) {
+        const FixedStrGrowth* prev = threadCurrent();
+        threadCurrent() = growth;
+        return prev;
+    }
+
+private:
+    static const FixedStrGrowth& defaults() {
+        static const FixedStrGrowth growth;
+        return growth;
+    }
+
+    static const FixedStrGrowth*& threadCurrent() {
+        static thread_local const FixedStrGrowth* growth = NULL;
+        return growth;
+    }
+};
+
+////////////////////
+// Uses 'growth' on the current thread until it goes out of scope.
+// These can nest.
+////////////////////
+class FixedStrGrowthScope {
+public:
+    explicit FixedStrGrowthScope (const FixedStrGrowth& growth)
+        :
+        m_growth (growth),
+        m_prev   (FixedStrGrowth::setCurrent (&m_growth)) {
+    }
+
+    ~FixedStrGrowthScope() {
+        FixedStrGrowth::setCurrent (m_prev);
+    }
+
+private:
+    FixedStrGrowth          m_growth;
+    const FixedStrGrowth*   m_prev;
+
+    // disable these...
+    FixedStrGrowthScope(const FixedStrGrowthScope& other);
+    FixedStrGrowthScope& operator=(const FixedStrGrowthScope& other);
+};
+
+////////////////////
+// Monotonic (bump) arena.  deallocate() is a no-op; everything is given
+// back at once by release() or the dtor.  Intended to be owned by one
+// request/thread so there's no locking.
+////////////////////
+class FixedStrArena : public FixedStrResource {
+public:
+    explicit FixedStrArena (size_t chunkSize = 64 * 1024,
+                            FixedStrResource* upstream = FixedStrResource::heap())
+        :
+        m_upstream  (upstream),
+        m_chunks    (NULL),
+        m_chunkSize (chunkSize),
+        m_pos       (NULL),
+        m_end       (NULL),
+        m_initial   (NULL),
+        m_initialEnd(NULL),
+        m_used      (0) {
+    }
+
+    // Starts with caller-provided storage (e.g. on the stack) and only
+    // goes upstream once that runs out.
+    FixedStrArena (void* buffer, size_t bufferSize, size_t chunkSize = 64 * 1024,
+                   FixedStrResource* upstream = FixedStrResource::heap())
+        :
+        m_upstream  (upstream),
+        m_chunks    (NULL),
+        m_chunkSize (chunkSize),
+        m_pos       (alignStart (buffer, bufferSize)),
+        m_end       (static_cast<char*> (buffer) + bufferSize),
+        m_initial   (m_pos),
+        m_initialEnd(m_end),
+        m_used      (0) {
+    }
+
+    ~FixedStrArena() {
+        release();
+    }
+
+    void* allocate (size_t bytes) {
+        bytes = roundUp (bytes);
+        if (static_cast<size_t> (m_end - m_pos) < bytes) {
+            newChunk (bytes);
+        }
+        void* toRet = m_pos;
+        m_pos += bytes;
+        m_used += bytes;
+        return toRet;
+    }
+
+    void deallocate (void*, size_t) {
+        // monotonic; reclaimed by release().
+    }
+
+    // Frees everything allocated so far.  Any strings still using
+    // this arena's memory are left dangling.
+    void release() {
+        while (m_chunks) {
+            Chunk* next = m_chunks->next;
+            m_upstream->deallocate (m_chunks, m_chunks->size);
+            m_chunks = next;
+        }
+        m_pos =  m_initial;
+        m_end =  m_initialEnd;
+        m_used = 0;
+    }
+
+    // Total handed out since the last release().
+    size_t bytesUsed() const {
+        return m_used;
+    }
+
+private:
+    struct Chunk {
+        Chunk*  next;
+        size_t  size;
+    };
+
+    enum { ALIGN = 16 };
+
+    static size_t roundUp (size_t bytes) {
+        return (bytes + ALIGN - 1) & ~static_cast<size_t> (ALIGN - 1);
+    }
+
+    // A caller's buffer (a char[] can start anywhere) rounded up to ALIGN,
+    // so what's handed out from it is aligned like the rest.
+    static char* alignStart (void* buffer, size_t bufferSize) {
+        char* p = static_cast<char*> (buffer);
+        const size_t pad = (ALIGN - reinterpret_cast<uintptr_t> (p) % ALIGN) % ALIGN;
+        return p + (pad < bufferSize ? pad : bufferSize);
+    }
+
+    void newChunk (size_t bytes) {
+        size_t headerSz = roundUp (sizeof (Chunk));
+        size_t sz = headerSz + bytes;
+        if (sz < m_chunkSize) {
+            sz = m_chunkSize;
+        }
+        Chunk* chunk = static_cast<Chunk*> (m_upstream->allocate (sz));
+        chunk->next = m_chunks;
+        chunk->size = sz;
+        m_chunks = chunk;
+        m_pos = reinterpret_cast<char*> (chunk) + headerSz;
+        m_end = reinterpret_cast<char*> (chunk) + sz;
+    }
+
+    FixedStrResource*   m_upstream;
+    Chunk*              m_chunks;
+    size_t              m_chunkSize;
+    char*               m_pos;
+    char*               m_end;
+    char*               m_initial;
+    char*               m_initialEnd;
+    size_t              m_used;
+
+    // disable these...
+    FixedStrArena(const FixedStrArena& other);
+    FixedStrArena& operator=(const FixedStrArena& other);
+};
+
+#ifdef FIXED_STR_HAS_PMR
+////////////////////
+// Adapts a std::pmr::memory_resource (monotonic_buffer_resource,
+// synchronized_pool_resource,...) so FixedStr can use it.
+////////////////////
+class FixedStrPmrResource : public FixedStrResource {
+public:
+    explicit FixedStrPmrResource (std::pmr::memory_resource* upstream)
+        :
+        m_upstream (upstream) {
+    }
+
+    void* allocate (size_t bytes) {
+        return m_upstream->allocate (bytes, alignof (std::max_align_t));
+    }
+
+    void deallocate (void* p, size_t bytes) {
+        m_upstream->deallocate (p, bytes, alignof (std::max_align_t));
+    }
+
+private:
+    std::pmr::memory_resource* m_upstream;
+};
+#endif
+
+#endif
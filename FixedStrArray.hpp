@@ -0,0 +1,464 @@
+#ifndef FIXED_STR_ARRAY_H
+#define FIXED_STR_ARRAY_H
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrArray
+ *  A column of strings that are nearly always up to N chars, stored the
+ *  way a column store would:  all the lengths together in one array, all
+ *  the characters in another at a stride of N + 1, and the few that are
+ *  longer than N in a shared side arena.  A std::vector<FixedStr<N> > has
+ *  each length in with its chars (plus padding), and spilled strings off
+ *  in their own heap blocks.
+ *
+ *      FixedStrArray<32> hosts;
+ *      hosts.reserve (rows);
+ *      hosts.push_back (fields[3]);
+ *      ...
+ *      std::vector<size_t> hits;
+ *      hosts.find_all ("db-7.example.com", std::back_inserter (hits));
+ *      hosts.starts_with ("db-", std::back_inserter (hits));
+ *
+ *  The bulk scans (find, find_all, count, starts_with, length_between) go
+ *  through the length array first, 16 at a time (SSE2), and only look at
+ *  the characters of the strings whose lengths can match; comparing those
+ *  is one masked 16-byte load for short strings.  A scan that's mostly
+ *  rejected by length never touches the characters.
+ *
+ *  a[i] gives a view (const) or a Ref (non-const):  a proxy with the
+ *  read-only side of the FixedStr API plus assign/append/+=/clear.  Views
+ *  are invalidated by anything that adds or changes strings, as with a
+ *  std::vector.
+ *
+ *  A string longer than N keeps its first N chars in its row (so prefix
+ *  scans don't have to go to the arena) and the whole string in the
+ *  arena.  Arena space given up when a long string is replaced is
+ *  reclaimed once it's over half the arena.  Strings are limited to 4G
+ *  characters.
+ */
+
+template<size_t _AllocSizeT, typename _CharT>
+class BaseStrArray {
+public:
+    typedef BaseStrView<_CharT> View;
+
+    static const size_t npos = -1;
+
+    // What a[i] gives on a non-const array.  Only valid while the array is
+    // there; assigning through it changes the string in the array.
+    class Ref {
+    public:
+        Ref& operator= (View str) {
+            m_array->set (m_index, str);
+            return *this;
+        }
+
+        // a[i] = a[j] copies the string, not the reference.
+        Ref& operator= (const Ref& other) {
+            m_array->set (m_index, other.view());
+            return *this;
+        }
+
+        View view() const {
+            return m_array->view (m_index);
+        }
+
+        operator View() const {
+            return view();
+        }
+
+        const _CharT* c_str() const {
+            return view().data();
+        }
+
+        size_t length() const {
+            return m_array->length (m_index);
+        }
+
+        size_t size() const {
+            return length();
+        }
+
+        bool empty() const {
+            return length() == 0;
+        }
+
+        int compare (View rhs) const {
+            return view().compare (rhs);
+        }
+
+        bool equals (View rhs) const {
+            return view().equals (rhs);
+        }
+
+        bool operator== (View rhs) const {
+            return equals (rhs);
+        }
+
+        bool operator!= (View rhs) const {
+            return !equals (rhs);
+        }
+
+        bool starts_with (View prefix) const {
+            return view().starts_with (prefix);
+        }
+
+        bool ends_with (View suffix) const {
+            return view().ends_with (suffix);
+        }
+
+        size_t find (View needle, size_t pos = 0) const {
+            return view().find (needle, pos);
+        }
+
+        size_t find (_CharT ch, size_t pos = 0) const {
+            return view().find (ch, pos);
+        }
+
+        size_t hash() const {
+            return view().hash();
+        }
+
+        void assign (View str) {
+            m_array->set (m_index, str);
+        }
+
+        Ref& append (View str) {
+            m_array->append (m_index, str);
+            return *this;
+        }
+
+        Ref& operator+= (View str) {
+            return append (str);
+        }
+
+        void clear() {
+            m_array->set (m_index, View());
+        }
+
+    private:
+        friend class BaseStrArray<_AllocSizeT, _CharT>;
+
+        Ref (BaseStrArray<_AllocSizeT, _CharT>* array, size_t index)
+            :
+            m_array (array),
+            m_index (index)
+        {
+        }
+
+        BaseStrArray<_AllocSizeT, _CharT>*  m_array;
+        size_t                              m_index;
+    };
+
+    BaseStrArray()
+        :
+        m_arenaDead (0)
+    {
+    }
+
+    size_t size() const {
+        return m_lens.size();
+    }
+
+    bool empty() const {
+        return m_lens.empty();
+    }
+
+    // Room for 'n' strings without reallocating (not counting the arena).
+    void reserve (size_t n) {
+        m_lens.reserve (n);
+        m_chars.reserve (n * ROW);
+    }
+
+    void clear() {
+        m_lens.clear();
+        m_chars.clear();
+        m_spills.clear();
+        m_arena.clear();
+        m_arenaDead = 0;
+    }
+
+    void push_back (View str) {
+        checkLength (str.length());
+        m_lens.push_back (0);
+        m_chars.resize (m_chars.size() + ROW);
+        set (m_lens.size() - 1, str);
+    }
+
+    void pop_back() {
+        if (m_lens.back() > _AllocSizeT) {
+            dropSpill (m_lens.size() - 1);
+        }
+        m_lens.pop_back();
+        m_chars.resize (m_chars.size() - ROW);
+    }
+
+    View operator[] (size_t i) const {
+        return view (i);
+    }
+
+    Ref operator[] (size_t i) {
+        return Ref (this, i);
+    }
+
+    // Throws std::out_of_range if 'i' is past the end.
+    View at (size_t i) const {
+        if (i >= size()) {
+            throw std::out_of_range ("FixedStrArray::at");
+        }
+        return view (i);
+    }
+
+    View view (size_t i) const {
+        const uint32_t len = m_lens[i];
+        if (len <= _AllocSizeT) {
+            return View (row (i), len);
+        }
+        return View (&m_arena[m_spills.find (i)->second], len);
+    }
+
+    size_t length (size_t i) const {
+        return m_lens[i];
+    }
+
+    // 'str' may be (part of) a string in this array.
+    void set (size_t i, View str) {
+        const size_t len = str.length();
+        checkLength (len);
+        if (len > 0 && (inside (str.data(), m_chars) || inside (str.data(), m_arena))) {
+            std::basic_string<_CharT> copy (str.data(), len);
+            set (i, View (copy.data(), len));
+            return;
+        }
+        if (m_lens[i] > _AllocSizeT) {
+            dropSpill (i);
+        }
+        const size_t inRow = len <= _AllocSizeT ? len : _AllocSizeT;
+        _CharT* r = &m_chars[i * ROW];
+        memcpy (r, str.data(), inRow * sizeof (_CharT));
+        r[inRow] = 0;
+        if (len > _AllocSizeT) {
+            addSpill (i, str);
+        }
+        m_lens[i] = static_cast<uint32_t> (len);
+    }
+
+    void append (size_t i, View str) {
+        const size_t len = m_lens[i];
+        if (len + str.length() <= _AllocSizeT && !inside (str.data(), m_chars)) {
+            // fits where it is.
+            _CharT* r = &m_chars[i * ROW];
+            memcpy (r + len, str.data(), str.length() * sizeof (_CharT));
+            r[len + str.length()] = 0;
+            m_lens[i] = static_cast<uint32_t> (len + str.length());
+            return;
+        }
+        View current = view (i);
+        std::basic_string<_CharT> joined (current.data(), current.length());
+        joined.append (str.data(), str.length());
+        set (i, View (joined.data(), joined.length()));
+    }
+
+    ////////////////
+    // Bulk scans over the whole column.
+    ////////////////
+
+    // Index of the first string from 'from' on equal to 'str', or npos.
+    size_t find (View str, size_t from = 0) const {
+        Needle needle (str);
+        size_t found = npos;
+        forEqual (needle, from, [&] (size_t i) {
+            found = i;
+            return false;
+        });
+        return found;
+    }
+
+    // Indexes of all the strings equal to 'str', in order, to 'out'.
+    template<typename _OutIterT>
+    _OutIterT find_all (View str, _OutIterT out) const {
+        Needle needle (str);
+        forEqual (needle, 0, [&] (size_t i) {
+            *out++ = i;
+            return true;
+        });
+        return out;
+    }
+
+    size_t count (View str) const {
+        Needle needle (str);
+        size_t found = 0;
+        forEqual (needle, 0, [&] (size_t) {
+            ++found;
+            return true;
+        });
+        return found;
+    }
+
+    // Indexes of all the strings starting with 'prefix', in order.
+    template<typename _OutIterT>
+    _OutIterT starts_with (View prefix, _OutIterT out) const {
+        Needle needle (prefix);
+        const size_t len = prefix.length();
+        forLengths (len, 0xffffffffu, 0, [&] (size_t i) {
+            // the row has the first N chars even of a spilled string.
+            if (len <= _AllocSizeT ? rowStartsWith (i, needle) : view (i).starts_with (prefix)) {
+                *out++ = i;
+            }
+            return true;
+        });
+        return out;
+    }
+
+    // Indexes of all the strings 'minLen' to 'maxLen' chars long, in
+    // order.  Doesn't look at the characters at all.
+    template<typename _OutIterT>
+    _OutIterT length_between (size_t minLen, size_t maxLen, _OutIterT out) const {
+        forLengths (minLen, maxLen, 0, [&] (size_t i) {
+            *out++ = i;
+            return true;
+        });
+        return out;
+    }
+
+private:
+    enum {
+        ROW =       _AllocSizeT + 1,            // chars per row, with the terminator
+        ROW_BYTES = ROW * sizeof (_CharT)
+    };
+
+    // A string being searched for, copied to a buffer the size of a row
+    // so it can be compared with bufferBytesEqual().
+    struct Needle {
+        explicit Needle (View str)
+            :
+            str     (str),
+            padded  (ROW, 0)
+        {
+            if (str.length() <= _AllocSizeT) {
+                memcpy (&padded[0], str.data(), str.length() * sizeof (_CharT));
+            }
+        }
+
+        View                str;
+        std::vector<_CharT> padded;
+    };
+
+    const _CharT* row (size_t i) const {
+        return &m_chars[i * ROW];
+    }
+
+    bool rowStartsWith (size_t i, const Needle& needle) const {
+        return bufferBytesEqual<ROW_BYTES> (row (i), &needle.padded[0],
+                                            needle.str.length() * sizeof (_CharT));
+    }
+
+    // fn (i) for each string from 'from' on that equals the needle, until
+    // it returns false.
+    template<typename _FnT>
+    void forEqual (const Needle& needle, size_t from, const _FnT& fn) const {
+        const size_t len = needle.str.length();
+        forLengths (len, len, from, [&] (size_t i) {
+            if (len <= _AllocSizeT ? rowStartsWith (i, needle) : view (i).equals (needle.str)) {
+                return fn (i);
+            }
+            return true;
+        });
+    }
+
+    // fn (i) for each string from 'from' on 'minLen' to 'maxLen' long,
+    // until it returns false.  The lengths are looked at 16 at a time, so
+    // only the strings that pass are touched.
+    template<typename _FnT>
+    void forLengths (size_t minLen, size_t maxLen, size_t from, const _FnT& fn) const {
+        if (maxLen > 0xffffffffu) {
+            maxLen = 0xffffffffu;
+        }
+        if (minLen > maxLen) {
+            return;
+        }
+        const uint32_t lo = static_cast<uint32_t> (minLen);
+        const uint32_t hi = static_cast<uint32_t> (maxLen);
+        const size_t n = size();
+        size_t i = from;
+        for (; i + 16 <= n; i += 16) {
+            uint32_t hits = blockInRange32 (&m_lens[i], lo, hi);
+            while (hits) {
+                if (!fn (i + lowestBit (hits))) {
+                    return;
+                }
+                hits &= hits - 1;
+            }
+        }
+        for (; i < n; ++i) {
+            if (m_lens[i] - lo <= hi - lo && !fn (i)) {
+                return;
+            }
+        }
+    }
+
+    static void checkLength (size_t len) {
+        if (len > 0xffffffffu) {
+            throw std::length_error ("FixedStrArray string too long");
+        }
+    }
+
+    static bool inside (const _CharT* p, const std::vector<_CharT>& buffer) {
+        std::less<const _CharT*> before;
+        return !buffer.empty() && !before (p, &buffer[0]) && before (p, &buffer[0] + buffer.size());
+    }
+
+    void addSpill (size_t i, View str) {
+        if (m_arenaDead > 4096 && m_arenaDead * 2 > m_arena.size()) {
+            compactArena();
+        }
+        m_spills[i] = m_arena.size();
+        m_arena.insert (m_arena.end(), str.data(), str.data() + str.length());
+        m_arena.push_back (0);
+    }
+
+    void dropSpill (size_t i) {
+        m_arenaDead += m_lens[i] + 1;
+        m_spills.erase (i);
+    }
+
+    void compactArena() {
+        std::vector<_CharT> arena;
+        arena.reserve (m_arena.size() - m_arenaDead);
+        for (typename std::unordered_map<size_t, size_t>::iterator it = m_spills.begin(); it != m_spills.end(); ++it) {
+            const size_t at = arena.size();
+            const _CharT* str = &m_arena[it->second];
+            arena.insert (arena.end(), str, str + m_lens[it->first] + 1);
+            it->second = at;
+        }
+        m_arena.swap (arena);
+        m_arenaDead = 0;
+    }
+
+    std::vector<uint32_t>               m_lens;
+    std::vector<_CharT>                 m_chars;
+    std::unordered_map<size_t, size_t>  m_spills;       // index -> arena offset
+    std::vector<_CharT>                 m_arena;
+    size_t                              m_arenaDead;
+};
+
+template<size_t _AllocSizeT, typename _CharT>
+const size_t BaseStrArray<_AllocSizeT, _CharT>::npos;
+
+template<size_t _AllocSizeT, typename _CharT = char>
+using FixedStrArray = BaseStrArray<_AllocSizeT, _CharT>;
+
+template<size_t _AllocSizeT>
+using WFixedStrArray = BaseStrArray<_AllocSizeT, wchar_t>;
+
+#endif
@@ -0,0 +1,1605 @@
+
+/*
+ *  FixedStrBench.cpp
+ *  FixedStr
+ *
+ */
+
+#include "FixedStrBench.h"
+#include "FixedStr.hpp"
+#include "FixedStrBuilder.hpp"
+#include "HashedFixedStr.hpp"
+#include "FixedStrMap.hpp"
+#include "FixedStrIntern.hpp"
+#include "FixedStrSort.hpp"
+#include "FixedStrArray.hpp"
+#include "FixedStrTable.hpp"
+#include "FixedStrReader.hpp"
+#include "FixedStrMatcher.hpp"
+#include "FixedStrUtf8.hpp"
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <clocale>
+#include <locale>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Strings of assorted lengths; most spill out of a FixedStr<16>.
+    const char* s_churnSrc[] = {
+        "GET /index.html",
+        "Host: www.example.com:8080",
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64)",
+        "Accept: text/html,application/xhtml+xml",
+        "X-Request-Id: 7f3e9a1c-55b2-4c1e-9a7d-2b8e0c6f1d44",
+        "Cookie: session=abcdef0123456789abcdef0123456789",
+        "ok",
+        "Content-Type: application/json; charset=utf-8",
+    };
+    const size_t s_churnSrcCount = sizeof s_churnSrc / sizeof s_churnSrc[0];
+
+    // One simulated request:  build and throw away a handful of strings.
+    // Returns something derived from the results so it can't be optimized out.
+    size_t churnRequest() {
+        size_t toRet = 0;
+        FixedStr<16> fields[s_churnSrcCount];
+        for (size_t i = 0; i < s_churnSrcCount; ++i) {
+            fields[i].assign (s_churnSrc[i]);
+            fields[i] += "; ";
+            fields[i] += s_churnSrc[(i + 1) % s_churnSrcCount];
+            toRet += fields[i].length();
+        }
+        return toRet;
+    }
+
+    void churnThread (size_t requests, bool useArena, size_t* result) {
+        size_t total = 0;
+        FixedStrArena arena;
+        for (size_t r = 0; r < requests; ++r) {
+            if (useArena) {
+                FixedStrResourceScope scope (&arena);
+                total += churnRequest();
+                arena.release();
+            }
+            else {
+                total += churnRequest();
+            }
+        }
+        *result = total;
+    }
+}
+
+void FixedStrBench::benchResourceChurn() {
+    if (!groupSelected ("churn")) {
+        return;
+    }
+
+    const size_t requests = 200000;
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads < 4) maxThreads = 4;
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        for (int arena = 0; arena < 2; ++arena) {
+            std::vector<std::thread> workers;
+            std::vector<size_t> results (threads);
+            double start = nowNs();
+            for (size_t t = 0; t < threads; ++t) {
+                workers.push_back (std::thread (churnThread, requests, arena != 0, &results[t]));
+            }
+            for (size_t t = 0; t < threads; ++t) {
+                workers[t].join();
+            }
+            double elapsed = nowNs() - start;
+
+            char name[80];
+            snprintf (name, sizeof name, "%s, %u threads",
+                      arena ? "arena" : "heap", static_cast<unsigned> (threads));
+            // wall time per request on each thread.
+            report ("churn", name, requests, elapsed);
+        }
+    }
+}
+
+namespace {
+    // The character at a time ordering operator< used before compare().
+    template<typename _CharT, typename _UnsignedCharT>
+    bool legacyIsLess (const _CharT* lhs, size_t lhsLen, const _CharT* rhs, size_t rhsLen) {
+        for (size_t i=0; i<lhsLen; ++i) {
+            if (i >= rhsLen) {
+                return false;
+            }
+            _UnsignedCharT lhsCh = static_cast<_UnsignedCharT> (*lhs);
+            _UnsignedCharT rhsCh = static_cast<_UnsignedCharT> (*rhs);
+            int diff = lhsCh - rhsCh;
+            if (diff != 0) {
+                return diff < 0 ? true : false;
+            }
+            ++lhs;
+            ++rhs;
+        }
+        if (lhsLen == rhsLen) {
+            return false;
+        }
+        return true;
+    }
+
+    struct LegacyLess {
+        template<size_t _AllocSizeT>
+        bool operator() (const FixedStr<_AllocSizeT>& lhs, const FixedStr<_AllocSizeT>& rhs) const {
+            return legacyIsLess<char, unsigned char> (lhs.c_str(), lhs.length(), rhs.c_str(), rhs.length());
+        }
+    };
+
+    // Symbol-table like keys:  shared prefixes, mostly under 16 chars.
+    void makeSymbolKeys (std::vector<std::string>& keys, size_t count) {
+        static const char* prefixes[] = { "NYSE.", "NASDAQ.", "LSE.", "cpu.load.", "net.if.eth0.", "" };
+        unsigned int seed = 42;
+        keys.clear();
+        keys.reserve (count);
+        for (size_t i = 0; i < count; ++i) {
+            seed = seed * 1103515245 + 12345;
+            char buff[64];
+            snprintf (buff, sizeof buff, "%s%X", prefixes[(seed >> 16) % 6], seed % 0xfffff);
+            keys.push_back (buff);
+        }
+    }
+}
+
+void FixedStrBench::benchSort() {
+    if (!groupSelected ("sort")) {
+        return;
+    }
+    const size_t count = 1000000;
+    std::vector<std::string> strKeys;
+    makeSymbolKeys (strKeys, count);
+
+    std::vector<FixedStr<16> > fixedKeys;
+    fixedKeys.reserve (count);
+    for (size_t i = 0; i < count; ++i) {
+        fixedKeys.push_back (FixedStr<16> (strKeys[i].c_str()));
+    }
+
+    {
+        std::vector<FixedStr<16> > work (fixedKeys);
+        double start = nowNs();
+        std::sort (work.begin(), work.end(), LegacyLess());
+        report ("sort", "FixedStr<16> 1M, char at a time", count, nowNs() - start);
+    }
+    {
+        std::vector<FixedStr<16> > work (fixedKeys);
+        double start = nowNs();
+        std::sort (work.begin(), work.end());
+        report ("sort", "FixedStr<16> 1M, compare()", count, nowNs() - start);
+    }
+    {
+        std::vector<std::string> work (strKeys);
+        double start = nowNs();
+        std::sort (work.begin(), work.end());
+        report ("sort", "std::string 1M", count, nowNs() - start);
+    }
+
+    const size_t cores = std::max (1u, std::thread::hardware_concurrency());
+    const size_t threadCounts[] = { 1, 4, cores };
+    for (size_t t = 0; t < sizeof threadCounts / sizeof threadCounts[0]; ++t) {
+        if (t == 2 && (cores == 1 || cores == 4)) {
+            break;
+        }
+        char name [64];
+        snprintf (name, sizeof name, "FixedStr<16> 1M, sort_strings %zu thread(s)", threadCounts[t]);
+        std::vector<FixedStr<16> > work (fixedKeys);
+        double start = nowNs();
+        sort_strings (work.begin(), work.end(), threadCounts[t]);
+        report ("sort", name, count, nowNs() - start);
+    }
+    {
+        std::vector<FixedStr<16> > work (fixedKeys);
+        double start = nowNs();
+        std::sort (work.begin(), work.end());
+        work.erase (std::unique (work.begin(), work.end()), work.end());
+        report ("sort", "FixedStr<16> 1M, std::sort + std::unique", count, nowNs() - start);
+    }
+    {
+        std::vector<FixedStr<16> > work (fixedKeys);
+        double start = nowNs();
+        work.erase (unique_strings (work.begin(), work.end()), work.end());
+        report ("sort", "FixedStr<16> 1M, unique_strings", count, nowNs() - start);
+    }
+    {
+        // long shared prefixes, half of them spilled.
+        std::vector<FixedStr<16> > longKeys;
+        longKeys.reserve (count);
+        for (size_t i = 0; i < count; ++i) {
+            char buff[64];
+            snprintf (buff, sizeof buff, "metrics.host%03zu.%s", i % 997, strKeys[i].c_str());
+            longKeys.push_back (FixedStr<16> (buff));
+        }
+        std::vector<FixedStr<16> > work (longKeys);
+        double start = nowNs();
+        std::sort (work.begin(), work.end());
+        report ("sort", "FixedStr<16> 1M spilled, std::sort", count, nowNs() - start);
+        work = longKeys;
+        start = nowNs();
+        sort_strings (work.begin(), work.end(), 1);
+        report ("sort", "FixedStr<16> 1M spilled, sort_strings 1 thread", count, nowNs() - start);
+    }
+}
+
+// printf-style format() against the type-safe fmt() and append(number),
+// building the kind of keys hot paths use.  The "spilled" ones are too big
+// for the array, which costs format() a second vsnprintf().
+void FixedStrBench::benchFmt() {
+    if (!groupSelected ("fmt")) {
+        return;
+    }
+    const char* name = "orders";
+    const char* longName = "orders-archive-eu-west-1-replica";
+    int         id =   48213;
+    unsigned    seq =  3000000017u;
+    double      price = 1234.5625;
+
+    FixedStr<32> key;
+    run ("fmt", "key inline format(\"%s:%d:%u\")", [&] {
+        doNotOptimize (name);
+        key.format ("%s:%d:%u", name, id, seq);
+        doNotOptimize (key);
+    });
+    run ("fmt", "key inline fmt(\"{}:{}:{}\")", [&] {
+        doNotOptimize (name);
+        key.fmt ("{}:{}:{}", name, id, seq);
+        doNotOptimize (key);
+    });
+    run ("fmt", "key inline std::string", [&] {
+        doNotOptimize (name);
+        std::string str (name);
+        str += ':';
+        str += std::to_string (id);
+        str += ':';
+        str += std::to_string (seq);
+        doNotOptimize (str);
+    });
+
+    run ("fmt", "key spilled format(\"%s:%d:%u\")", [&] {
+        doNotOptimize (longName);
+        FixedStr<32> spilled;
+        spilled.format ("%s:%d:%u", longName, id, seq);
+        doNotOptimize (spilled);
+    });
+    run ("fmt", "key spilled fmt(\"{}:{}:{}\")", [&] {
+        doNotOptimize (longName);
+        FixedStr<32> spilled;
+        spilled.fmt ("{}:{}:{}", longName, id, seq);
+        doNotOptimize (spilled);
+    });
+
+    run ("fmt", "int format(\"%d\")", [&] {
+        doNotOptimize (id);
+        key.format ("%d", id);
+        doNotOptimize (key);
+    });
+    run ("fmt", "int clear()+append(int)", [&] {
+        doNotOptimize (id);
+        key.clear();
+        key.append (id);
+        doNotOptimize (key);
+    });
+    run ("fmt", "double format(\"%.17g\")", [&] {
+        doNotOptimize (price);
+        key.format ("%.17g", price);
+        doNotOptimize (key);
+    });
+    run ("fmt", "double clear()+append(double)", [&] {
+        doNotOptimize (price);
+        key.clear();
+        key.append (price);
+        doNotOptimize (key);
+    });
+}
+
+// Wide format() when the result is much bigger than the array.  vswprintf()
+// can't say how long the result will be, so the old code kept doubling the
+// buffer and reformatting; now it's measured once and written into an
+// overflow of that size.  std::wstring doing the same doubling is there for
+// comparison.
+// A ~2KB payload from 200 fragments, and a line joined from 50 fields.
+void FixedStrBench::benchBuilder() {
+    if (!groupSelected ("builder")) {
+        return;
+    }
+    const size_t fragments = 200;
+    std::vector<FixedStr<16> > parts;
+    for (size_t i = 0; i < fragments; ++i) {
+        parts.push_back (FixedStr<16> (s_churnSrc[i % s_churnSrcCount]));
+    }
+
+    run ("builder", "200 pieces chained append", [&] {
+        FixedStr<64> payload;
+        for (size_t i = 0; i < fragments; ++i) {
+            payload += parts[i];
+            payload += ',';
+        }
+        doNotOptimize (payload);
+    });
+    run ("builder", "200 pieces FixedStrBuilder", [&] {
+        FixedStrBuilder b;
+        for (size_t i = 0; i < fragments; ++i) {
+            b.append (parts[i]).append (',');
+        }
+        FixedStr<64> payload;
+        b.build (payload);
+        doNotOptimize (payload);
+    });
+    run ("builder", "200 pieces std::string", [&] {
+        std::string payload;
+        for (size_t i = 0; i < fragments; ++i) {
+            payload.append (parts[i].c_str(), parts[i].length());
+            payload += ',';
+        }
+        doNotOptimize (payload);
+    });
+
+    // Fewer, bigger pieces:  here it's mostly the copying that counts.
+    std::string big (120, 'x');
+    const size_t bigPieces = 40;
+    run ("builder", "40 x 120 chained append", [&] {
+        FixedStr<64> payload;
+        for (size_t i = 0; i < bigPieces; ++i) {
+            payload.append (big.c_str(), big.length());
+        }
+        doNotOptimize (payload);
+    });
+    run ("builder", "40 x 120 FixedStrBuilder", [&] {
+        FixedStrBuilder b;
+        for (size_t i = 0; i < bigPieces; ++i) {
+            b.append (big.c_str(), big.length());
+        }
+        FixedStr<64> payload;
+        b.build (payload);
+        doNotOptimize (payload);
+    });
+    run ("builder", "40 x 120 std::string", [&] {
+        std::string payload;
+        for (size_t i = 0; i < bigPieces; ++i) {
+            payload.append (big);
+        }
+        doNotOptimize (payload);
+    });
+
+    const char* host = "example.com";
+    int         port = 8080;
+    run ("builder", "key chained append", [&] {
+        doNotOptimize (host);
+        FixedStr<32> key (host);
+        key += ':';
+        key.append (port);
+        key += "/items";
+        doNotOptimize (key);
+    });
+    run ("builder", "key FixedStrBuilder", [&] {
+        doNotOptimize (host);
+        FixedStrBuilder b;
+        b.append (host).append (':').append (port).append ("/items");
+        FixedStr<32> key;
+        b.build (key);
+        doNotOptimize (key);
+    });
+
+    std::vector<FixedStr<16> > fields (parts.begin(), parts.begin() + 50);
+    run ("builder", "join 50 chained append", [&] {
+        FixedStr<64> line;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i > 0) {
+                line += ", ";
+            }
+            line += fields[i];
+        }
+        doNotOptimize (line);
+    });
+    run ("builder", "join 50 join()", [&] {
+        FixedStr<64> line;
+        join (line, fields, ", ");
+        doNotOptimize (line);
+    });
+}
+
+// 3, 5 and 10 short pieces put together with operator+.
+void FixedStrBench::benchConcat() {
+    if (!groupSelected ("concat")) {
+        return;
+    }
+    FixedStr<16> a ("orders"), b ("eu-west-1"), c ("48213");
+    std::string  sa ("orders"), sb ("eu-west-1"), sc ("48213");
+
+    run ("concat", "3-way FixedStr<32>", [&] {
+        doNotOptimize (a);
+        FixedStr<32> key = a + b + c;
+        doNotOptimize (key);
+    });
+    run ("concat", "3-way std::string", [&] {
+        doNotOptimize (sa);
+        std::string key = sa + sb + sc;
+        doNotOptimize (key);
+    });
+    run ("concat", "5-way FixedStr<32>", [&] {
+        doNotOptimize (a);
+        FixedStr<32> key = a + ':' + b + ':' + c;
+        doNotOptimize (key);
+    });
+    run ("concat", "5-way std::string", [&] {
+        doNotOptimize (sa);
+        std::string key = sa + ':' + sb + ':' + sc;
+        doNotOptimize (key);
+    });
+    run ("concat", "10-way FixedStr<32> (spills)", [&] {
+        doNotOptimize (a);
+        FixedStr<32> key = a + ':' + b + ':' + c + '/' + a + ':' + b + ':' + c;
+        doNotOptimize (key);
+    });
+    run ("concat", "10-way FixedStr<64>", [&] {
+        doNotOptimize (a);
+        FixedStr<64> key = a + ':' + b + ':' + c + '/' + a + ':' + b + ':' + c;
+        doNotOptimize (key);
+    });
+    run ("concat", "10-way std::string", [&] {
+        doNotOptimize (sa);
+        std::string key = sa + ':' + sb + ':' + sc + '/' + sa + ':' + sb + ':' + sc;
+        doNotOptimize (key);
+    });
+    run ("concat", "10-way FixedStr<64> appends", [&] {
+        doNotOptimize (a);
+        FixedStr<64> key (a);
+        key += ':';
+        key += b;
+        key += ':';
+        key += c;
+        key += '/';
+        key += a;
+        key += ':';
+        key += b;
+        key += ':';
+        key += c;
+        doNotOptimize (key);
+    });
+}
+
+// Building a message with and without reserve(), and a long-lived string
+// whose length goes back and forth across its array size.
+void FixedStrBench::benchGrowth() {
+    if (!groupSelected ("growth")) {
+        return;
+    }
+    run ("growth", "message 64 appends", [&] {
+        FixedStr<32> msg;
+        for (size_t i = 0; i < 64; ++i) {
+            msg += s_churnSrc[i % s_churnSrcCount];
+        }
+        doNotOptimize (msg);
+    });
+    run ("growth", "message 64 appends reserve(2400)", [&] {
+        FixedStr<32> msg;
+        msg.reserve (2400);
+        for (size_t i = 0; i < 64; ++i) {
+            msg += s_churnSrc[i % s_churnSrcCount];
+        }
+        doNotOptimize (msg);
+    });
+
+    const char* longer =  "0123456789012345678901234";
+    const char* shorter = "0123456789012";
+    FixedStr<16> bouncing;
+    run ("growth", "bouncing default", [&] {
+        bouncing.assign (longer);
+        bouncing.assign (shorter);
+        doNotOptimize (bouncing);
+    });
+    FixedStrGrowth growth;
+    growth.inlinePercent = 50;
+    FixedStrGrowthScope scope (growth);
+    run ("growth", "bouncing inlinePercent=50", [&] {
+        bouncing.assign (longer);
+        bouncing.assign (shorter);
+        doNotOptimize (bouncing);
+    });
+}
+
+void FixedStrBench::benchHash() {
+    if (!groupSelected ("hash")) {
+        return;
+    }
+    const size_t lengths[] = { 8, 32, 256 };
+    for (size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i) {
+        std::string text (lengths[i], 'k');
+        FixedStr<16> str (text.c_str());
+        char name [64];
+        snprintf (name, sizeof name, "FixedStr hash() %zu", lengths[i]);
+        run ("hash", name, [&] {
+            doNotOptimize (str.hash());
+        });
+        snprintf (name, sizeof name, "std::hash<std::string> %zu", lengths[i]);
+        run ("hash", name, [&] {
+            doNotOptimize (std::hash<std::string>() (text));
+        });
+    }
+
+    // 64 lookups of keys already made, in a set of 1000.
+    const size_t count = 1000;
+    const size_t probes = 64;
+    std::unordered_set<std::string>         stdSet;
+    std::unordered_set<FixedStr<24> >       fixedSet;
+    std::unordered_set<HashedFixedStr<24> > hashedSet;
+    std::vector<std::string>                stdProbes;
+    std::vector<FixedStr<24> >              fixedProbes;
+    std::vector<HashedFixedStr<24> >        hashedProbes;
+    for (size_t i = 0; i < count; ++i) {
+        FixedStr<24> key;
+        key.fmt ("session-{}-{}", i * 7919, i);
+        stdSet.insert (key.c_str());
+        fixedSet.insert (key);
+        hashedSet.insert (HashedFixedStr<24> (key));
+        if (i % (count / probes) == 0 && stdProbes.size() < probes) {
+            stdProbes.push_back (key.c_str());
+            fixedProbes.push_back (key);
+            hashedProbes.push_back (HashedFixedStr<24> (key));
+        }
+    }
+    run ("hash", "std::string set 64 lookups", [&] {
+        size_t found = 0;
+        for (size_t i = 0; i < stdProbes.size(); ++i) {
+            found += stdSet.count (stdProbes[i]);
+        }
+        doNotOptimize (found);
+    });
+    run ("hash", "FixedStr set 64 lookups", [&] {
+        size_t found = 0;
+        for (size_t i = 0; i < fixedProbes.size(); ++i) {
+            found += fixedSet.count (fixedProbes[i]);
+        }
+        doNotOptimize (found);
+    });
+    run ("hash", "HashedFixedStr set 64 lookups", [&] {
+        size_t found = 0;
+        for (size_t i = 0; i < hashedProbes.size(); ++i) {
+            found += hashedSet.count (hashedProbes[i]);
+        }
+        doNotOptimize (found);
+    });
+}
+
+namespace {
+    // Distinct 21 char keys ("sess:" and 16 hex digits), 'miss' gives a
+    // different set of the same shape.
+    void makeSessionKey (char* buff, size_t i, bool miss) {
+        snprintf (buff, 32, "%s%016llX", miss ? "sesx:" : "sess:",
+                  static_cast<unsigned long long> (i) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    template<typename _MapT, typename _KeyT>
+    void timeMap (FixedStrBench& bench, const char* what, size_t count,
+                  const std::vector<_KeyT>& keys, const std::vector<_KeyT>& misses) {
+        char name [128];
+        _MapT table;
+        double start = SimpleBench::nowNs();
+        for (size_t i = 0; i < count; ++i) {
+            table[keys[i]] = i;
+        }
+        snprintf (name, sizeof name, "%s %zuM insert", what, count / 1000000);
+        bench.report ("map", name, count, SimpleBench::nowNs() - start);
+
+        // hits in a scattered order, so each one is a cache miss.
+        size_t found = 0;
+        start = SimpleBench::nowNs();
+        for (size_t i = 0, j = 0; i < count; ++i, j = (j + 7919) % count) {
+            found += table.find (keys[j]) != table.end();
+        }
+        snprintf (name, sizeof name, "%s %zuM find hit", what, count / 1000000);
+        bench.report ("map", name, count, SimpleBench::nowNs() - start);
+
+        start = SimpleBench::nowNs();
+        for (size_t i = 0; i < misses.size(); ++i) {
+            found += table.find (misses[i]) != table.end();
+        }
+        snprintf (name, sizeof name, "%s %zuM find miss", what, count / 1000000);
+        bench.report ("map", name, misses.size(), SimpleBench::nowNs() - start);
+        SimpleBench::doNotOptimize (found);
+    }
+}
+
+// 50M entries needs around 10 GB between the two; add it to 'counts' on a
+// machine that has it.
+void FixedStrBench::benchMap() {
+    if (!groupSelected ("map")) {
+        return;
+    }
+    const size_t counts[] = { 1000000, 10000000 };
+    const size_t missCount = 1000000;
+    for (size_t c = 0; c < sizeof counts / sizeof counts[0]; ++c) {
+        const size_t count = counts[c];
+        char buff[32];
+        {
+            std::vector<std::string> keys;
+            std::vector<std::string> misses;
+            keys.reserve (count);
+            for (size_t i = 0; i < count; ++i) {
+                makeSessionKey (buff, i, false);
+                keys.push_back (buff);
+            }
+            for (size_t i = 0; i < missCount; ++i) {
+                makeSessionKey (buff, i, true);
+                misses.push_back (buff);
+            }
+            timeMap<std::unordered_map<std::string, size_t> > (
+                        *this, "std::unordered_map<std::string>", count, keys, misses);
+        }
+        {
+            std::vector<FixedStr<24> > keys;
+            std::vector<FixedStr<24> > misses;
+            keys.reserve (count);
+            for (size_t i = 0; i < count; ++i) {
+                makeSessionKey (buff, i, false);
+                keys.push_back (FixedStr<24> (buff));
+            }
+            for (size_t i = 0; i < missCount; ++i) {
+                makeSessionKey (buff, i, true);
+                misses.push_back (FixedStr<24> (buff));
+            }
+            timeMap<FixedStrMap<24, size_t> > (
+                        *this, "FixedStrMap<24>", count, keys, misses);
+        }
+    }
+}
+
+void FixedStrBench::benchIntern() {
+    if (!groupSelected ("intern")) {
+        return;
+    }
+    const size_t count = 1000000;
+    std::vector<std::string> symbols;
+    makeSymbolKeys (symbols, count);
+
+    {
+        FixedStrPool pool;
+        double start = nowNs();
+        for (size_t i = 0; i < count; ++i) {
+            pool.intern (symbols[i].c_str());
+        }
+        report ("intern", "FixedStrPool 1M intern (mostly new)", count, nowNs() - start);
+    }
+    {
+        // what it replaces:  a locked std::unordered_map.
+        std::mutex mutex;
+        std::unordered_map<std::string, uint32_t> ids;
+        double start = nowNs();
+        for (size_t i = 0; i < count; ++i) {
+            std::lock_guard<std::mutex> lock (mutex);
+            ids.insert (std::make_pair (symbols[i], static_cast<uint32_t> (ids.size())));
+        }
+        report ("intern", "locked unordered_map 1M intern (mostly new)", count, nowNs() - start);
+
+        FixedStrPool pool;
+        for (size_t i = 0; i < 1000; ++i) {
+            pool.intern (symbols[i].c_str());
+        }
+        FixedStr<16> sym (symbols[500].c_str());
+        run ("intern", "FixedStrPool intern existing", [&] {
+            doNotOptimize (pool.intern (sym));
+        });
+        run ("intern", "locked unordered_map find existing", [&] {
+            std::lock_guard<std::mutex> lock (mutex);
+            doNotOptimize (ids.find (symbols[500])->second);
+        });
+
+        // the point of it:  comparing IDs instead of strings.
+        FixedStr<16> a ("net.if.eth0.7F3");
+        FixedStr<16> b ("net.if.eth0.7F3");
+        uint32_t idA = pool.intern (a);
+        uint32_t idB = pool.intern (b);
+        run ("intern", "FixedStr<16> == 15 chars", [&] {
+            doNotOptimize (a == b);
+        });
+        run ("intern", "ID ==", [&] {
+            doNotOptimize (idA == idB);
+        });
+    }
+}
+
+void FixedStrBench::benchArray() {
+    if (!groupSelected ("array")) {
+        return;
+    }
+    // host names, 1 in 100 too long for 32.
+    const size_t count = 4000000;
+    std::vector<FixedStr<32> > rows;
+    FixedStrArray<32> column;
+    rows.reserve (count);
+    column.reserve (count);
+    unsigned int seed = 7;
+    for (size_t i = 0; i < count; ++i) {
+        seed = seed * 1103515245 + 12345;
+        FixedStr<48> host;
+        const unsigned int n = (seed >> 8) % 100000;
+        if (i % 100 == 0) {
+            host.fmt ("db-{}.storage.eu-west-1.example.com", n);
+        }
+        else {
+            host.fmt ("{}-{}.example.com", (seed >> 16) % 2 ? "web" : "db", n);
+        }
+        rows.push_back (FixedStr<32> (host));
+        column.push_back (host);
+    }
+    const FixedStrView needle ("web-4242.example.com");
+    const size_t passes = 5;
+
+    size_t found = 0;
+    double start = nowNs();
+    for (size_t p = 0; p < passes; ++p) {
+        for (size_t i = 0; i < count; ++i) {
+            found += rows[i] == needle;
+        }
+    }
+    report ("array", "vector<FixedStr<32> > 4M, count ==", count * passes, nowNs() - start);
+    start = nowNs();
+    for (size_t p = 0; p < passes; ++p) {
+        found += column.count (needle);
+    }
+    report ("array", "FixedStrArray<32> 4M, count()", count * passes, nowNs() - start);
+
+    std::vector<size_t> hits;
+    hits.reserve (count);
+    start = nowNs();
+    for (size_t p = 0; p < passes; ++p) {
+        hits.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (rows[i].starts_with ("db-4")) {
+                hits.push_back (i);
+            }
+        }
+    }
+    report ("array", "vector<FixedStr<32> > 4M, starts_with", count * passes, nowNs() - start);
+    start = nowNs();
+    for (size_t p = 0; p < passes; ++p) {
+        hits.clear();
+        column.starts_with ("db-4", std::back_inserter (hits));
+    }
+    report ("array", "FixedStrArray<32> 4M, starts_with()", count * passes, nowNs() - start);
+
+    start = nowNs();
+    for (size_t p = 0; p < passes; ++p) {
+        hits.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (rows[i].length() > 32) {
+                hits.push_back (i);
+            }
+        }
+    }
+    report ("array", "vector<FixedStr<32> > 4M, length > 32", count * passes, nowNs() - start);
+    start = nowNs();
+    for (size_t p = 0; p < passes; ++p) {
+        hits.clear();
+        column.length_between (33, FixedStrArray<32>::npos, std::back_inserter (hits));
+    }
+    report ("array", "FixedStrArray<32> 4M, length_between()", count * passes, nowNs() - start);
+    doNotOptimize (found);
+}
+
+namespace {
+    // Drops the file from the page cache so the next open is cold.  Just
+    // a hint; it does nothing where there's no posix_fadvise.
+    void evictFile (const char* path) {
+#if defined(POSIX_FADV_DONTNEED)
+        int fd = open (path, O_RDONLY);
+        if (fd >= 0) {
+            fdatasync (fd);
+            posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+            close (fd);
+        }
+#else
+        (void) path;
+#endif
+    }
+}
+
+void FixedStrBench::benchTable() {
+    if (!groupSelected ("table")) {
+        return;
+    }
+    // 10M symbols and values, loaded by parsing text (what it replaces)
+    // and from a table file, cold and warm.  Each load is followed by a
+    // pass over every entry, so all the pages it needs are in.
+    const size_t count = 10000000;
+    const char* textPath =  "FixedStrBench.txt";
+    const char* tablePath = "FixedStrBench.fst";
+    {
+        FILE* text = fopen (textPath, "w");
+        FixedStrTableWriter<24> out;
+        out.reserve (count);
+        unsigned int seed = 11;
+        for (size_t i = 0; i < count; ++i) {
+            seed = seed * 1103515245 + 12345;
+            FixedStr<32> sym;
+            sym.fmt ("{}.{}", i % 7 == 0 ? "NASDAQ.GLOBAL" : "NYSE", i);
+            const uint64_t value = seed;
+            fprintf (text, "%s,%llu\n", sym.c_str(), static_cast<unsigned long long> (value));
+            out.add (sym, value);
+        }
+        fclose (text);
+        out.write (tablePath);
+    }
+
+    evictFile (textPath);
+    double start = nowNs();
+    {
+        FILE* text = fopen (textPath, "r");
+        std::vector<FixedStr<24> > syms;
+        std::vector<uint64_t> values;
+        syms.reserve (count);
+        values.reserve (count);
+        char line [128];
+        while (fgets (line, sizeof line, text)) {
+            char* comma = strchr (line, ',');
+            syms.push_back (FixedStr<24> ());
+            syms.back().assign (line, comma - line);
+            values.push_back (strtoull (comma + 1, NULL, 10));
+        }
+        fclose (text);
+        size_t total = 0;
+        for (size_t i = 0; i < syms.size(); ++i) {
+            total += syms[i].length() + values[i];
+        }
+        doNotOptimize (total);
+    }
+    report ("table", "10M parse text, cold", count, nowNs() - start);
+
+    for (int warm = 0; warm < 2; ++warm) {
+        if (!warm) {
+            evictFile (tablePath);
+        }
+        start = nowNs();
+        FixedStrTableFile<24> table (tablePath);
+        const double opened = nowNs() - start;
+        size_t total = 0;
+        for (size_t i = 0; i < table.size(); ++i) {
+            total += table[i].length() + table.value<uint64_t> (i);
+        }
+        doNotOptimize (total);
+        report ("table", warm ? "10M table open, warm" : "10M table open, cold", 1, opened);
+        report ("table", warm ? "10M table open + scan, warm" : "10M table open + scan, cold",
+                count, nowNs() - start);
+    }
+    {
+        FixedStrTableFile<24> table (tablePath);
+        start = nowNs();
+        table.open (tablePath, FixedStrTableFile<24>::VERIFY);
+        report ("table", "10M table open with VERIFY, warm", 1, nowNs() - start);
+        FixedStr<24> key ("NYSE.5000001");
+        run ("table", "FixedStrTableFile find_value", [&] {
+            doNotOptimize (table.find_value<uint64_t> (key));
+        });
+    }
+    remove (textPath);
+    remove (tablePath);
+}
+
+void FixedStrBench::benchReader() {
+    if (!groupSelected ("reader")) {
+        return;
+    }
+    // ~500MB of CSV lines, 40-80 bytes.  Warm (just written), so this is
+    // the CPU side of reading.
+    const char* path = "FixedStrBench.csv";
+    const size_t count = 8000000;
+    size_t bytes = 0;
+    {
+        FILE* file = fopen (path, "w");
+        unsigned int seed = 5;
+        for (size_t i = 0; i < count; ++i) {
+            seed = seed * 1103515245 + 12345;
+            bytes += fprintf (file, "2024-05-01T09:30:%02u.%06u,NYSE.%X,%u,%u.%02u,%s\n",
+                              (seed >> 8) % 60, seed % 1000000, seed % 0xfffff, (seed >> 4) % 1000,
+                              (seed >> 12) % 500, seed % 100, i % 3 ? "B" : "S,flagged,late,odd-lot");
+        }
+        fclose (file);
+    }
+    char name [96];
+
+    double start = nowNs();
+    {
+        std::ifstream in (path);
+        std::string line;
+        FixedStr<96> fixed;
+        size_t total = 0;
+        while (std::getline (in, line)) {
+            fixed.assign (line.data(), line.length());
+            total += fixed.length();
+        }
+        doNotOptimize (total);
+    }
+    double elapsed = nowNs() - start;
+    snprintf (name, sizeof name, "getline + FixedStr<96> assign (%.2f GB/s)", bytes / elapsed);
+    report ("reader", name, count, elapsed);
+
+    start = nowNs();
+    {
+        FILE* file = fopen (path, "r");
+        char line [256];
+        FixedStr<96> fixed;
+        size_t total = 0;
+        while (fgets (line, sizeof line, file)) {
+            fixed.assign (line, strlen (line) - 1);
+            total += fixed.length();
+        }
+        fclose (file);
+        doNotOptimize (total);
+    }
+    elapsed = nowNs() - start;
+    snprintf (name, sizeof name, "fgets + FixedStr<96> assign (%.2f GB/s)", bytes / elapsed);
+    report ("reader", name, count, elapsed);
+
+    start = nowNs();
+    {
+        FixedStrReader in (path);
+        FixedStrView line;
+        size_t total = 0;
+        while (in.next (line)) {
+            total += line.length();
+        }
+        doNotOptimize (total);
+    }
+    elapsed = nowNs() - start;
+    snprintf (name, sizeof name, "FixedStrReader views (%.2f GB/s)", bytes / elapsed);
+    report ("reader", name, count, elapsed);
+
+    start = nowNs();
+    {
+        FixedStrReader in (path);
+        FixedStr<96> fixed;
+        size_t total = 0;
+        while (in.next (fixed)) {
+            total += fixed.length();
+        }
+        doNotOptimize (total);
+    }
+    elapsed = nowNs() - start;
+    snprintf (name, sizeof name, "FixedStrReader into FixedStr<96> (%.2f GB/s)", bytes / elapsed);
+    report ("reader", name, count, elapsed);
+
+    remove (path);
+}
+
+void FixedStrBench::benchSearch() {
+    if (!groupSelected ("search")) {
+        return;
+    }
+    // Everything found at (or, for rfind, near) the far end, so each
+    // search scans the whole string.
+    const size_t lengths[] = { 16, 64, 256, 1024 };
+    for (size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i) {
+        const size_t len = lengths[i];
+        std::string text;
+        for (size_t c = 0; text.length() < len - 6; ++c) {
+            text += "GET /a/b?q=1&r=2 "[c % 17];
+        }
+        std::string tail = text + "#frag!";
+        const std::string reversed = "!frag#" + text;
+        FixedStr<16> fixed;
+        fixed.assign (tail.data(), tail.length());
+        FixedStr<16> fixedReversed;
+        fixedReversed.assign (reversed.data(), reversed.length());
+        char name [64];
+
+        snprintf (name, sizeof name, "std::string find(char) %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (tail.find ('#'));
+        });
+        snprintf (name, sizeof name, "FixedStr find(char) %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (fixed.find ('#'));
+        });
+        snprintf (name, sizeof name, "std::string find(str) %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (tail.find ("frag"));
+        });
+        snprintf (name, sizeof name, "FixedStr find(str) %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (fixed.find ("frag"));
+        });
+        // '/' is in every few chars, so memchr() on it finds little.
+        snprintf (name, sizeof name, "std::string find(str) common 1st %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (tail.find ("/frag"));
+        });
+        snprintf (name, sizeof name, "FixedStr find(str) common 1st %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (fixed.find ("/frag"));
+        });
+        snprintf (name, sizeof name, "std::string rfind(str) %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (reversed.rfind ("frag"));
+        });
+        snprintf (name, sizeof name, "FixedStr rfind(str) %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (fixedReversed.rfind ("frag"));
+        });
+        snprintf (name, sizeof name, "std::string find_first_of(5) %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (tail.find_first_of ("#!%;\t"));
+        });
+        snprintf (name, sizeof name, "FixedStr find_first_of(5) %zu", len);
+        run ("search", name, [&] {
+            doNotOptimize (fixed.find_first_of ("#!%;\t"));
+        });
+    }
+}
+
+void FixedStrBench::benchMatcher() {
+    if (!groupSelected ("matcher")) {
+        return;
+    }
+    // 1000 log-ish messages of ~200 bytes, against keyword sets of
+    // different sizes; about one message in 20 has a keyword.
+    const size_t messages = 1000;
+    std::vector<std::string> texts;
+    unsigned int seed = 3;
+    size_t bytes = 0;
+    for (size_t m = 0; m < messages; ++m) {
+        std::string text;
+        while (text.length() < 200) {
+            seed = seed * 1103515245 + 12345;
+            char word [32];
+            snprintf (word, sizeof word, "w%ux%u ", (seed >> 8) % 5000, (seed >> 20) % 7);
+            text += word;
+        }
+        if (m % 20 == 0) {
+            text += "kw17";
+        }
+        bytes += text.length();
+        texts.push_back (text);
+    }
+    // the last set starts with every letter, so it can't skip ahead.
+    const size_t counts[] = { 8, 64, 3000, 3000 };
+    for (size_t c = 0; c < sizeof counts / sizeof counts[0]; ++c) {
+        const bool mixed = c == 3;
+        std::vector<FixedStr<32> > keywords;
+        for (size_t k = 0; k < counts[c]; ++k) {
+            FixedStr<32> keyword;
+            if (mixed) {
+                keyword.fmt ("{}kw{}", static_cast<char> ('a' + k % 26), k + 10);
+            }
+            else {
+                keyword.fmt ("kw{}", k + 10);
+            }
+            keywords.push_back (keyword);
+        }
+        const FixedStrMatcher matcher (keywords.begin(), keywords.end());
+        char name [96];
+
+        double start = nowNs();
+        size_t hits = 0;
+        for (size_t m = 0; m < messages; ++m) {
+            for (size_t k = 0; k < keywords.size(); ++k) {
+                hits += texts[m].find (keywords[k].c_str(), 0, keywords[k].length()) != std::string::npos;
+            }
+        }
+        double elapsed = nowNs() - start;
+        doNotOptimize (hits);
+        snprintf (name, sizeof name, "std::string find() per keyword, %zu%s (%.2f GB/s)",
+                  counts[c], mixed ? " mixed" : "", bytes / elapsed);
+        report ("matcher", name, messages, elapsed);
+
+        hits = 0;
+        start = nowNs();
+        for (int rep = 0; rep < 20; ++rep) {
+            for (size_t m = 0; m < messages; ++m) {
+                hits += matcher.contains_any (FixedStrView (texts[m].data(), texts[m].length()));
+            }
+        }
+        elapsed = nowNs() - start;
+        doNotOptimize (hits);
+        snprintf (name, sizeof name, "FixedStrMatcher contains_any, %zu%s (%.2f GB/s)",
+                  counts[c], mixed ? " mixed" : "", 20 * bytes / elapsed);
+        report ("matcher", name, 20 * messages, elapsed);
+    }
+}
+
+void FixedStrBench::benchCase() {
+    if (!groupSelected ("case")) {
+        return;
+    }
+    // What this replaces:  lower case a scratch copy, then compare/hash it.
+    const char* names[] = { "Host", "Content-Length", "X-Forwarded-For-Original-Client-Address" };
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i) {
+        FixedStr<48> name (names[i]);
+        FixedStr<48> other (names[i]);
+        other.to_upper();
+        const size_t len = name.length();
+        char label [96];
+
+        snprintf (label, sizeof label, "lower copy + == %zu", len);
+        run ("case", label, [&] {
+            FixedStr<48> scratch (other);
+            char* p = const_cast<char*> (scratch.c_str());
+            for (size_t c = 0; c < scratch.length(); ++c) {
+                p[c] = static_cast<char> (tolower (static_cast<unsigned char> (p[c])));
+            }
+            doNotOptimize (scratch == name);
+        });
+        snprintf (label, sizeof label, "iequals %zu", len);
+        run ("case", label, [&] {
+            doNotOptimize (other.iequals (name));
+        });
+        snprintf (label, sizeof label, "lower copy + hash %zu", len);
+        run ("case", label, [&] {
+            FixedStr<48> scratch (other);
+            char* p = const_cast<char*> (scratch.c_str());
+            for (size_t c = 0; c < scratch.length(); ++c) {
+                p[c] = static_cast<char> (tolower (static_cast<unsigned char> (p[c])));
+            }
+            doNotOptimize (scratch.hash());
+        });
+        snprintf (label, sizeof label, "ihash %zu", len);
+        run ("case", label, [&] {
+            doNotOptimize (other.ihash());
+        });
+        snprintf (label, sizeof label, "to_lower + to_upper %zu", len);
+        run ("case", label, [&] {
+            doNotOptimize (other.to_lower().to_upper().length());
+        });
+    }
+}
+
+void FixedStrBench::benchUtf8() {
+    if (!groupSelected ("utf8")) {
+        return;
+    }
+    // What this replaces:  mbstowcs()/wcstombs() into a buffer in a UTF-8
+    // locale, or the locale's codecvt facet, then assign().
+    const char* savedLocale = setlocale (LC_CTYPE, NULL);
+    std::string saved (savedLocale ? savedLocale : "C");
+    if (!setlocale (LC_CTYPE, "C.UTF-8") && !setlocale (LC_CTYPE, "en_US.UTF-8")) {
+        printf ("utf8:  no UTF-8 locale, skipped\n");
+        return;
+    }
+    typedef std::codecvt<wchar_t, char, std::mbstate_t> Codecvt;
+    std::locale utf8Locale (setlocale (LC_CTYPE, NULL));
+    const Codecvt& codecvt = std::use_facet<Codecvt> (utf8Locale);
+
+    struct {
+        const char* name;
+        const char* text;
+    } texts[] = {
+        { "ascii",    "GET /api/v2/orders?symbol=IBM&side=buy HTTP/1.1" },
+        { "latin",    "Z\xc3\xbcrich, G\xc3\xa9n\xc3\xa9ral Dupr\xc3\xa9 & S\xc3\xb8ren M\xc3\xbcller, na\xc3\xafve caf\xc3\xa9" },
+        { "cyrillic", "\xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0, \xd0\xbf\xd1\x80\xd0\xbe\xd1\x81\xd0\xbf\xd0\xb5\xd0\xba\xd1\x82 "
+                      "\xd0\x9c\xd0\xb8\xd1\x80\xd0\xb0 \xd0\xb4\xd0\xbe\xd0\xbc 12" },
+        { "cjk",      "\xe6\x9d\xb1\xe4\xba\xac\xe9\x83\xbd\xe5\x8d\x83\xe4\xbb\xa3\xe7\x94\xb0\xe5\x8c\xba "
+                      "\xe4\xb8\xb8\xe3\x81\xae\xe5\x86\x85 1-1 \xf0\x9f\x98\x80" }
+    };
+    for (size_t i = 0; i < sizeof texts / sizeof texts[0]; ++i) {
+        FixedStrView utf8 (texts[i].text);
+        WFixedStr<64> wide;
+        FixedStrUtf8::decode (wide, utf8);
+        char label [96];
+
+        snprintf (label, sizeof label, "mbstowcs + assign %s %zu", texts[i].name, utf8.length());
+        run ("utf8", label, [&] {
+            wchar_t buff [256];
+            size_t n = mbstowcs (buff, texts[i].text, 256);
+            wide.assign (buff, n);
+            doNotOptimize (wide.length());
+        });
+        snprintf (label, sizeof label, "codecvt in + assign %s %zu", texts[i].name, utf8.length());
+        run ("utf8", label, [&] {
+            wchar_t buff [256];
+            std::mbstate_t state = std::mbstate_t();
+            const char* fromNext;
+            wchar_t* toNext;
+            codecvt.in (state, utf8.data(), utf8.data() + utf8.length(), fromNext, buff, buff + 256, toNext);
+            wide.assign (buff, toNext - buff);
+            doNotOptimize (wide.length());
+        });
+        snprintf (label, sizeof label, "decode %s %zu", texts[i].name, utf8.length());
+        run ("utf8", label, [&] {
+            doNotOptimize (FixedStrUtf8::decode (wide, utf8));
+        });
+
+        FixedStr<128> back;
+        snprintf (label, sizeof label, "wcstombs + assign %s %zu", texts[i].name, utf8.length());
+        run ("utf8", label, [&] {
+            char buff [512];
+            size_t n = wcstombs (buff, wide.c_str(), 512);
+            back.assign (buff, n);
+            doNotOptimize (back.length());
+        });
+        snprintf (label, sizeof label, "codecvt out + assign %s %zu", texts[i].name, utf8.length());
+        run ("utf8", label, [&] {
+            char buff [512];
+            std::mbstate_t state = std::mbstate_t();
+            const wchar_t* fromNext;
+            char* toNext;
+            codecvt.out (state, wide.c_str(), wide.c_str() + wide.length(), fromNext, buff, buff + 512, toNext);
+            back.assign (buff, toNext - buff);
+            doNotOptimize (back.length());
+        });
+        snprintf (label, sizeof label, "encode %s %zu", texts[i].name, utf8.length());
+        run ("utf8", label, [&] {
+            doNotOptimize (FixedStrUtf8::encode (back, wide));
+        });
+        snprintf (label, sizeof label, "decodeFits<64> %s %zu", texts[i].name, utf8.length());
+        run ("utf8", label, [&] {
+            doNotOptimize (FixedStrUtf8::decodeFits<64> (utf8));
+        });
+    }
+    setlocale (LC_CTYPE, saved.c_str());
+}
+
+void FixedStrBench::benchParse() {
+    if (!groupSelected ("parse")) {
+        return;
+    }
+    // Fields of a market data feed, as views into the line.  What this
+    // replaces:  strtoll()/strtod() on a FixedStr's c_str(), or on a
+    // terminated copy of a view.
+    struct {
+        const char* name;
+        const char* text;
+        bool        isFloat;
+    } fields[] = {
+        { "qty",       "2500",                  false },
+        { "orderid",   "88213901744",           false },
+        { "timestamp", "1697040000123456789",   false },
+        { "price",     "142.3750",              true },
+        { "pnl",       "-18234.56",             true },
+        { "rate",      "1.0875e-4",             true },
+        { "fxprice",   "0.000123456789012345",  true }
+    };
+    for (size_t i = 0; i < sizeof fields / sizeof fields[0]; ++i) {
+        std::string line (std::string ("IBM,") + fields[i].text + ",B,XNYS");
+        const FixedStrView field (line.c_str() + 4, strlen (fields[i].text));
+        const FixedStr<32> str (field);
+        const bool isFloat = fields[i].isFloat;
+        char label [96];
+
+        snprintf (label, sizeof label, "copy + %s %s", isFloat ? "strtod" : "strtoll", fields[i].name);
+        run ("parse", label, [&] {
+            char buff [64];
+            memcpy (buff, field.data(), field.length());
+            buff[field.length()] = 0;
+            doNotOptimize (isFloat ? strtod (buff, NULL) : static_cast<double> (strtoll (buff, NULL, 10)));
+        });
+        snprintf (label, sizeof label, "c_str + %s %s", isFloat ? "strtod" : "strtoll", fields[i].name);
+        run ("parse", label, [&] {
+            doNotOptimize (isFloat ? strtod (str.c_str(), NULL) : static_cast<double> (strtoll (str.c_str(), NULL, 10)));
+        });
+#ifdef FIXED_STR_HAS_TO_CHARS
+        snprintf (label, sizeof label, "std::from_chars %s", fields[i].name);
+        run ("parse", label, [&] {
+            double d = 0;
+            long long ll = 0;
+            if (isFloat) {
+                std::from_chars (field.data(), field.data() + field.length(), d);
+            }
+            else {
+                std::from_chars (field.data(), field.data() + field.length(), ll);
+            }
+            doNotOptimize (d + ll);
+        });
+#endif
+        snprintf (label, sizeof label, "parse %s", fields[i].name);
+        run ("parse", label, [&] {
+            doNotOptimize (isFloat ? field.parse<double>().value : static_cast<double> (field.parse<long long>().value));
+        });
+
+        std::wstring wideText (field.data(), field.data() + field.length());
+        const WFixedStr<32> wide (wideText.c_str());
+        snprintf (label, sizeof label, "c_str + %s %s", isFloat ? "wcstod" : "wcstoll", fields[i].name);
+        run ("parse", label, [&] {
+            doNotOptimize (isFloat ? wcstod (wide.c_str(), NULL) : static_cast<double> (wcstoll (wide.c_str(), NULL, 10)));
+        });
+        snprintf (label, sizeof label, "wide parse %s", fields[i].name);
+        run ("parse", label, [&] {
+            doNotOptimize (isFloat ? wide.parse<double>().value : static_cast<double> (wide.parse<long long>().value));
+        });
+    }
+}
+
+void FixedStrBench::benchWideFormat() {
+    if (!groupSelected ("wformat")) {
+        return;
+    }
+    const size_t lengths[] = { 8, 100, 1000, 10000 };
+    for (size_t l = 0; l < sizeof lengths / sizeof lengths[0]; ++l) {
+        const size_t len = lengths[l];
+        std::wstring arg (len, L'x');
+        const wchar_t* argPtr = arg.c_str();
+        char name[80];
+
+        snprintf (name, sizeof name, "len %u WFixedStr<16>", static_cast<unsigned> (len + 6));
+        run ("wformat", name, [&] {
+            doNotOptimize (argPtr);
+            WFixedStr<16> str;
+            str.format (L"%S-%05d", argPtr, 42);
+            doNotOptimize (str);
+        });
+
+        snprintf (name, sizeof name, "len %u std::wstring doubling", static_cast<unsigned> (len + 6));
+        run ("wformat", name, [&] {
+            doNotOptimize (argPtr);
+            std::wstring str (16, L'\0');
+            while (swprintf (&str[0], str.size(), L"%S-%05d", argPtr, 42) < 0) {
+                str.resize (str.size() * 2);
+            }
+            doNotOptimize (str);
+        });
+    }
+
+    // Formatting into a big overflow and then something that fits the array;
+    // the result used to stay in the overflow.
+    std::wstring arg (1000, L'x');
+    const wchar_t* argPtr = arg.c_str();
+    WFixedStr<16> str;
+    run ("wformat", "long then short WFixedStr<16>", [&] {
+        doNotOptimize (argPtr);
+        str.format (L"%S", argPtr);
+        str.format (L"%d", 42);
+        doNotOptimize (str);
+    });
+}
+
+namespace {
+    const char* s_lengthNames[] = { "inline", "full", "spilled" };
+
+    // Raw char[] buffers are sized to hold even the "spilled" strings; they're
+    // the baseline for when you know it always fits.
+    template<size_t _AllocSizeT>
+    struct RawBuff {
+        char chars[_AllocSizeT * 2 + 1];
+    };
+}
+
+// Every basic operation at 3 lengths relative to _AllocSizeT:  half full
+// (inline), exactly full, and twice the size (spilled), against std::string
+// and a raw char[].
+template<size_t _AllocSizeT>
+void FixedStrBench::benchAllocSize() {
+
+    const char* digits =
+        "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    const size_t lengths[] = { _AllocSizeT / 2, _AllocSizeT, _AllocSizeT * 2 };
+
+    for (size_t l = 0; l < 3; ++l) {
+        const size_t len = lengths[l];
+        char src[_AllocSizeT * 2 + 1];
+        memcpy (src, digits, len);
+        src[len] = '\0';
+        // same content, different object; and one differing at the end.
+        char srcSame[_AllocSizeT * 2 + 1];
+        memcpy (srcSame, src, len + 1);
+        char srcLater[_AllocSizeT * 2 + 1];
+        memcpy (srcLater, src, len + 1);
+        srcLater[len - 1] += 1;
+        const char* srcPtr = src;
+
+        char name[80];
+#define FIXED_STR_BENCH_NAME(what) \
+        (snprintf (name, sizeof name, "N=%u %s %s", static_cast<unsigned> (_AllocSizeT), \
+                   s_lengthNames[l], what), name)
+
+        //////////
+        // construct from a C string.
+        run ("construct", FIXED_STR_BENCH_NAME ("FixedStr"), [&] {
+            doNotOptimize (srcPtr);
+            FixedStr<_AllocSizeT> str (srcPtr);
+            doNotOptimize (str);
+        });
+        run ("construct", FIXED_STR_BENCH_NAME ("std::string"), [&] {
+            doNotOptimize (srcPtr);
+            std::string str (srcPtr);
+            doNotOptimize (str);
+        });
+        run ("construct", FIXED_STR_BENCH_NAME ("char[]"), [&] {
+            doNotOptimize (srcPtr);
+            RawBuff<_AllocSizeT> str;
+            strcpy (str.chars, srcPtr);
+            doNotOptimize (str);
+        });
+
+        //////////
+        // assign into an existing string, length known.
+        {
+            FixedStr<_AllocSizeT> fixed;
+            std::string           stdStr;
+            RawBuff<_AllocSizeT>  raw;
+            run ("assign", FIXED_STR_BENCH_NAME ("FixedStr"), [&] {
+                doNotOptimize (srcPtr);
+                fixed.assign (srcPtr, len);
+                doNotOptimize (fixed);
+            });
+            run ("assign", FIXED_STR_BENCH_NAME ("std::string"), [&] {
+                doNotOptimize (srcPtr);
+                stdStr.assign (srcPtr, len);
+                doNotOptimize (stdStr);
+            });
+            run ("assign", FIXED_STR_BENCH_NAME ("char[]"), [&] {
+                doNotOptimize (srcPtr);
+                memcpy (raw.chars, srcPtr, len);
+                raw.chars[len] = '\0';
+                doNotOptimize (raw);
+            });
+        }
+
+        //////////
+        // build from two halves.
+        {
+            const size_t half = len / 2;
+            FixedStr<_AllocSizeT> fixed;
+            std::string           stdStr;
+            RawBuff<_AllocSizeT>  raw;
+            run ("append", FIXED_STR_BENCH_NAME ("FixedStr"), [&] {
+                doNotOptimize (srcPtr);
+                fixed.clear();
+                fixed.append (srcPtr, half);
+                fixed.append (srcPtr + half, len - half);
+                doNotOptimize (fixed);
+            });
+            run ("append", FIXED_STR_BENCH_NAME ("std::string"), [&] {
+                doNotOptimize (srcPtr);
+                stdStr.clear();
+                stdStr.append (srcPtr, half);
+                stdStr.append (srcPtr + half, len - half);
+                doNotOptimize (stdStr);
+            });
+            run ("append", FIXED_STR_BENCH_NAME ("char[]"), [&] {
+                doNotOptimize (srcPtr);
+                raw.chars[0] = '\0';
+                strncat (raw.chars, srcPtr, half);
+                strncat (raw.chars, srcPtr + half, len - half);
+                doNotOptimize (raw);
+            });
+        }
+
+        //////////
+        // printf-style.
+        {
+            // "%.*s:%05d" makes prec + 6 chars.
+            const int prec = static_cast<int> (len >= 6 ? len - 6 : 0);
+            FixedStr<_AllocSizeT> fixed;
+            std::string           stdStr;
+            RawBuff<_AllocSizeT>  raw;
+            run ("format", FIXED_STR_BENCH_NAME ("FixedStr"), [&] {
+                doNotOptimize (srcPtr);
+                fixed.format ("%.*s:%05d", prec, srcPtr, 12345);
+                doNotOptimize (fixed);
+            });
+            run ("format", FIXED_STR_BENCH_NAME ("std::string"), [&] {
+                doNotOptimize (srcPtr);
+                int needed = snprintf (NULL, 0, "%.*s:%05d", prec, srcPtr, 12345);
+                stdStr.resize (needed);
+                snprintf (&stdStr[0], needed + 1, "%.*s:%05d", prec, srcPtr, 12345);
+                doNotOptimize (stdStr);
+            });
+            run ("format", FIXED_STR_BENCH_NAME ("char[]"), [&] {
+                doNotOptimize (srcPtr);
+                snprintf (raw.chars, sizeof raw.chars, "%.*s:%05d", prec, srcPtr, 12345);
+                doNotOptimize (raw);
+            });
+        }
+
+        //////////
+        // everything but the first and last char.
+        {
+            FixedStr<_AllocSizeT> fixedSrc (src);
+            FixedStr<_AllocSizeT> fixed;
+            std::string           stdSrc (src);
+            std::string           stdStr;
+            RawBuff<_AllocSizeT>  raw;
+            run ("substring", FIXED_STR_BENCH_NAME ("FixedStr"), [&] {
+                fixedSrc.substring (fixed, 1, len - 1);
+                doNotOptimize (fixed);
+            });
+            run ("substring", FIXED_STR_BENCH_NAME ("FixedStr substr() view"), [&] {
+                FixedStrView view = fixedSrc.substr (1, len - 2);
+                doNotOptimize (view);
+            });
+            run ("substring", FIXED_STR_BENCH_NAME ("std::string"), [&] {
+                stdStr.assign (stdSrc, 1, len - 2);
+                doNotOptimize (stdStr);
+            });
+            run ("substring", FIXED_STR_BENCH_NAME ("char[]"), [&] {
+                doNotOptimize (srcPtr);
+                memcpy (raw.chars, srcPtr + 1, len - 2);
+                raw.chars[len - 2] = '\0';
+                doNotOptimize (raw);
+            });
+        }
+
+        //////////
+        // equal content, different objects.
+        {
+            FixedStr<_AllocSizeT> fixed1 (src);
+            FixedStr<_AllocSizeT> fixed2 (srcSame);
+            std::string           std1 (src);
+            std::string           std2 (srcSame);
+            run ("==", FIXED_STR_BENCH_NAME ("FixedStr"), [&] {
+                doNotOptimize (fixed1);
+                bool res = fixed1 == fixed2;
+                doNotOptimize (res);
+            });
+            run ("==", FIXED_STR_BENCH_NAME ("std::string"), [&] {
+                doNotOptimize (std1);
+                bool res = std1 == std2;
+                doNotOptimize (res);
+            });
+            run ("==", FIXED_STR_BENCH_NAME ("char[]"), [&] {
+                doNotOptimize (srcPtr);
+                bool res = strcmp (srcPtr, srcSame) == 0;
+                doNotOptimize (res);
+            });
+        }
+
+        //////////
+        // differing in the last char.
+        {
+            FixedStr<_AllocSizeT> fixed1 (src);
+            FixedStr<_AllocSizeT> fixed2 (srcLater);
+            std::string           std1 (src);
+            std::string           std2 (srcLater);
+            run ("<", FIXED_STR_BENCH_NAME ("FixedStr"), [&] {
+                doNotOptimize (fixed1);
+                bool res = fixed1 < fixed2;
+                doNotOptimize (res);
+            });
+            run ("<", FIXED_STR_BENCH_NAME ("std::string"), [&] {
+                doNotOptimize (std1);
+                bool res = std1 < std2;
+                doNotOptimize (res);
+            });
+            run ("<", FIXED_STR_BENCH_NAME ("char[]"), [&] {
+                doNotOptimize (srcPtr);
+                bool res = strcmp (srcPtr, srcLater) < 0;
+                doNotOptimize (res);
+            });
+        }
+
+        //////////
+        // copy construct.
+        {
+            FixedStr<_AllocSizeT> fixedSrc (src);
+            std::string           stdSrc (src);
+            RawBuff<_AllocSizeT>  rawSrc;
+            memcpy (rawSrc.chars, src, len + 1);
+            run ("copy", FIXED_STR_BENCH_NAME ("FixedStr"), [&] {
+                doNotOptimize (fixedSrc);
+                FixedStr<_AllocSizeT> copy (fixedSrc);
+                doNotOptimize (copy);
+            });
+            run ("copy", FIXED_STR_BENCH_NAME ("std::string"), [&] {
+                doNotOptimize (stdSrc);
+                std::string copy (stdSrc);
+                doNotOptimize (copy);
+            });
+            run ("copy", FIXED_STR_BENCH_NAME ("char[]"), [&] {
+                doNotOptimize (rawSrc);
+                RawBuff<_AllocSizeT> copy = rawSrc;
+                doNotOptimize (copy);
+            });
+        }
+#undef FIXED_STR_BENCH_NAME
+    }
+}
+
+void FixedStrBench::benchBasics() {
+    benchAllocSize<8>();
+    benchAllocSize<16>();
+    benchAllocSize<32>();
+    benchAllocSize<64>();
+}
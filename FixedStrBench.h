@@ -0,0 +1,71 @@
+#ifndef FIXED_STR_BENCH_H
+#define FIXED_STR_BENCH_H
+
+/*
+ *  FixedStrBench.h
+ *  FixedStr
+ *
+ *  Benchmarks for FixedStr.
+ */
+
+#include "SimpleBench.h"
+
+class FixedStrBench : public SimpleBench {
+public:
+    FixedStrBench() {
+    }
+
+    void benchBasics();
+    void benchResourceChurn();
+    void benchSort();
+    void benchFmt();
+    void benchWideFormat();
+    void benchBuilder();
+    void benchConcat();
+    void benchGrowth();
+    void benchHash();
+    void benchMap();
+    void benchIntern();
+    void benchArray();
+    void benchTable();
+    void benchReader();
+    void benchSearch();
+    void benchMatcher();
+    void benchCase();
+    void benchUtf8();
+    void benchParse();
+
+    void runBenchmarks() {
+        // all benchmarks must be called out here.
+
+        benchBasics();
+        benchResourceChurn();
+        benchSort();
+        benchFmt();
+        benchWideFormat();
+        benchBuilder();
+        benchConcat();
+        benchGrowth();
+        benchHash();
+        benchMap();
+        benchIntern();
+        benchArray();
+        benchTable();
+        benchReader();
+        benchSearch();
+        benchMatcher();
+        benchCase();
+        benchUtf8();
+        benchParse();
+    }
+
+private:
+    template<size_t _AllocSizeT>
+    void benchAllocSize();
+
+    // disable these...
+    FixedStrBench(const FixedStrBench& other);
+    FixedStrBench& operator=(const FixedStrBench& other);
+};
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef FIXED_STR_BUILDER_H
+#define FIXED_STR_BUILDER_H
+
+#include <climits>
+#include <stdexcept>
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrBuilder
+ *  Collects the pieces of a string first and puts them together at the
+ *  end, when the total length is known:  one copy of each piece and at
+ *  most one allocation for the target, however many pieces there are.
+ *  Appending piece by piece instead grows the overflow (and copies what's
+ *  there) each time it runs out.
+ *
+ *      FixedStrBuilder b;
+ *      b.append (host).append (':').append (port).append (path);
+ *      b.build (url);
+ *
+ *  Strings are referenced, not copied, so they have to stay alive (and
+ *  unchanged) until build() or appendTo().  Numbers are kept by value.
+ *  The first _PiecesT pieces are kept inside the builder; more than that
+ *  puts the list on the heap.
+ *
+ *  join() is the same thing for a range of strings plus a separator.
+ */
+
+template<typename _CharT, size_t _PiecesT = 16>
+class BaseStrBuilder {
+public:
+    typedef BaseStrView<_CharT> View;
+
+    BaseStrBuilder()
+        :
+        m_pieces    (m_inline),
+        m_count     (0),
+        m_capacity  (_PiecesT),
+        m_length    (0)
+    {
+    }
+
+    ~BaseStrBuilder() {
+        if (m_pieces != m_inline) {
+            delete[] m_pieces;
+        }
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (const _CharT* str, size_t len) {
+        if (len > 0) {
+            Piece& piece = add (TEXT, len);
+            piece.str = str;
+        }
+        return *this;
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (const _CharT* str) {
+        return append (str, countLen (str));
+    }
+
+    // Also takes any FixedStr/WFixedStr and std::basic_string_view.
+    BaseStrBuilder<_CharT, _PiecesT>& append (View str) {
+        return append (str.data(), str.length());
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (_CharT ch) {
+        add (CHAR, 1).ch = ch;
+        return *this;
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (int value) {
+        return append (static_cast<long long> (value));
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (long value) {
+        return append (static_cast<long long> (value));
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (long long value) {
+        const size_t len = value < 0 ?
+            1 + countDigits (0ULL - static_cast<unsigned long long> (value)) :
+            countDigits (static_cast<unsigned long long> (value));
+        add (SIGNED, len).i = value;
+        return *this;
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (unsigned int value) {
+        return append (static_cast<unsigned long long> (value));
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (unsigned long value) {
+        return append (static_cast<unsigned long long> (value));
+    }
+
+    BaseStrBuilder<_CharT, _PiecesT>& append (unsigned long long value) {
+        add (UNSIGNED, countDigits (value)).u = value;
+        return *this;
+    }
+
+    // Written the same as BaseStr::append (double).  There's no cheap way
+    // to get the length so it's converted twice.
+    BaseStrBuilder<_CharT, _PiecesT>& append (double value) {
+        _CharT buff[NUMBER_CHARS_MAX];
+        add (DOUBLE, writeDouble (buff, value)).d = value;
+        return *this;
+    }
+
+    template<typename _ValueT>
+    BaseStrBuilder<_CharT, _PiecesT>& operator+= (const _ValueT& value) {
+        return append (value);
+    }
+
+    // Total length so far.
+    size_t length() const {
+        return m_length;
+    }
+
+    size_t pieces() const {
+        return m_count;
+    }
+
+    // Starts over; the piece list keeps its space.
+    void clear() {
+        m_count =  0;
+        m_length = 0;
+    }
+
+    // Replaces the content of 'target'.  Pieces that point into 'target'
+    // itself are fine.
+    template<size_t _AllocSizeT>
+    void build (BaseStr<_AllocSizeT, _CharT>& target) const {
+#ifdef FIXED_STR_STATS
+        const bool wasOverflow = target.isOverflow();
+#endif
+        size_t bytes = target.place (0, m_length, aliases (target), *this);
+        FIXED_STR_STATS_RECORD (ASSIGN, _AllocSizeT, sizeof (_CharT), m_length,
+                                wasOverflow, target.isOverflow(), bytes);
+        (void) bytes;
+    }
+
+    // Adds to the end of 'target'.
+    template<size_t _AllocSizeT>
+    void appendTo (BaseStr<_AllocSizeT, _CharT>& target) const {
+#ifdef FIXED_STR_STATS
+        const bool wasOverflow = target.isOverflow();
+#endif
+        const size_t keep = target.length();
+        size_t bytes = target.place (keep, keep + m_length, aliases (target), *this);
+        FIXED_STR_STATS_RECORD (APPEND, _AllocSizeT, sizeof (_CharT), keep + m_length,
+                                wasOverflow, target.isOverflow(), bytes);
+        (void) bytes;
+    }
+
+    // Writes the pieces at 'out' (no terminator).
+    void write (_CharT* out) const {
+        for (size_t i = 0; i < m_count; ++i) {
+            const Piece& piece = m_pieces[i];
+            switch (piece.kind) {
+            case TEXT:
+                copyBytes (out, piece.str, piece.len * sizeof (_CharT));
+                break;
+            case CHAR:
+                *out = piece.ch;
+                break;
+            case SIGNED:
+                writeSigned (out, piece.i);
+                break;
+            case UNSIGNED:
+                writeUnsigned (out, piece.u);
+                break;
+            case DOUBLE:
+                writeDouble (out, piece.d);
+                break;
+            }
+            out += piece.len;
+        }
+    }
+
+    // Replaces the content of 'target' with the strings in 'parts' (any
+    // range of things a View can be made from) with 'separator' between
+    // them.  Two passes over 'parts':  one to measure, one to copy.
+    template<size_t _AllocSizeT, typename _RangeT>
+    static void join (BaseStr<_AllocSizeT, _CharT>& target, const _RangeT& parts, View separator) {
+        size_t total = 0;
+        size_t count = 0;
+        bool aliased = false;
+        for (const auto& elem : parts) {
+            View part (elem);
+            total += part.length();
+            ++count;
+            aliased = aliased || target.overlaps (part.data(), part.length() * sizeof (_CharT));
+        }
+        if (count > 1) {
+            total += (count - 1) * separator.length();
+        }
+        aliased = aliased || target.overlaps (separator.data(), separator.length() * sizeof (_CharT));
+
+#ifdef FIXED_STR_STATS
+        const bool wasOverflow = target.isOverflow();
+#endif
+        JoinWriter<_RangeT> writer (parts, separator);
+        size_t bytes = target.place (0, total, aliased, writer);
+        FIXED_STR_STATS_RECORD (ASSIGN, _AllocSizeT, sizeof (_CharT), total,
+                                wasOverflow, target.isOverflow(), bytes);
+        (void) bytes;
+    }
+
+private:
+    enum Kind {
+        TEXT,
+        CHAR,
+        SIGNED,
+        UNSIGNED,
+        DOUBLE
+    };
+
+    // 16 bytes on 64-bit.
+    struct Piece {
+        unsigned int    kind;
+        unsigned int    len;
+        union {
+            const _CharT*       str;
+            _CharT              ch;
+            long long           i;
+            unsigned long long  u;
+            double              d;
+        };
+    };
+
+    template<typename _RangeT>
+    struct JoinWriter {
+        JoinWriter (const _RangeT& parts, View separator)
+            :
+            m_parts     (parts),
+            m_separator (separator)
+        {
+        }
+
+        void write (_CharT* out) const {
+            bool first = true;
+            for (const auto& elem : m_parts) {
+                if (!first) {
+                    copyBytes (out, m_separator.data(), m_separator.length() * sizeof (_CharT));
+                    out += m_separator.length();
+                }
+                first = false;
+                View part (elem);
+                copyBytes (out, part.data(), part.length() * sizeof (_CharT));
+                out += part.length();
+            }
+        }
+
+        const _RangeT&  m_parts;
+        View            m_separator;
+    };
+
+    Piece& add (Kind kind, size_t len) {
+        if (m_count == m_capacity) {
+            grow();
+        }
+        if (len >= UINT_MAX) {
+            throw std::length_error ("FixedStrBuilder piece too long");
+        }
+        Piece& piece = m_pieces[m_count++];
+        piece.kind = kind;
+        piece.len =  static_cast<unsigned int> (len);
+        m_length += len;
+        return piece;
+    }
+
+    void grow() {
+        Piece* pieces = new Piece [m_capacity * 2];
+        memcpy (pieces, m_pieces, m_count * sizeof (Piece));
+        if (m_pieces != m_inline) {
+            delete[] m_pieces;
+        }
+        m_pieces = pieces;
+        m_capacity *= 2;
+    }
+
+    template<size_t _AllocSizeT>
+    bool aliases (const BaseStr<_AllocSizeT, _CharT>& target) const {
+        for (size_t i = 0; i < m_count; ++i) {
+            if (m_pieces[i].kind == TEXT &&
+                    target.overlaps (m_pieces[i].str, m_pieces[i].len * sizeof (_CharT))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Piece*  m_pieces;
+    size_t  m_count;
+    size_t  m_capacity;
+    size_t  m_length;
+    Piece   m_inline [_PiecesT];
+
+    // disable these...
+    BaseStrBuilder (const BaseStrBuilder<_CharT, _PiecesT>& other);
+    BaseStrBuilder<_CharT, _PiecesT>& operator= (const BaseStrBuilder<_CharT, _PiecesT>& other);
+};
+
+typedef BaseStrBuilder<char>    FixedStrBuilder;
+typedef BaseStrBuilder<wchar_t> WFixedStrBuilder;
+
+// Replaces the content of 'target' with 'parts' separated by 'separator':
+//
+//      join (line, fields, ",");
+//
+template<size_t _AllocSizeT, typename _CharT, typename _RangeT>
+BaseStr<_AllocSizeT, _CharT>& join (
+                    BaseStr<_AllocSizeT, _CharT>&                       target,
+                    const _RangeT&                                      parts,
+                    typename BaseStrBuilder<_CharT>::View               separator) {
+    BaseStrBuilder<_CharT>::join (target, parts, separator);
+    return target;
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef FIXED_STR_HASH_H
+#define FIXED_STR_HASH_H
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#include "FixedStrSimd.hpp"
+
+/*
+ *  FixedStrHash
+ *  Byte hash used by FixedStr::hash(), FixedStrView::hash() and the
+ *  std::hash specializations.
+ *
+ *  It's the wyhash construction:  each step multiplies two 64-bit words
+ *  into 128 bits and folds the halves together.  Up to 16 bytes are done
+ *  with a couple of overlapping loads and no loop; longer input goes 16
+ *  bytes a step, or 48 (three independent lanes) when there's more than
+ *  48.  Hashes depend on the byte order of the machine, so they're for
+ *  in-memory tables, not for storing.
+ *
+ *  hashBytesAsciiLower() is the same hash of the bytes with ASCII letters
+ *  lower cased as they're loaded, and hashWideLower() of wchar_ts with
+ *  towlower(), for FixedStr::ihash().
+ */
+
+namespace {
+
+    const uint64_t s_hashSecret[4] = {
+        0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+        0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+    };
+
+    // 64 x 64 -> 128 multiply; the low half goes in 'a', the high in 'b'.
+    inline void hashMul (uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+        __uint128_t r = static_cast<__uint128_t> (a) * b;
+        a = static_cast<uint64_t> (r);
+        b = static_cast<uint64_t> (r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        a = _umul128 (a, b, &b);
+#else
+        uint64_t ha = a >> 32, la = static_cast<uint32_t> (a);
+        uint64_t hb = b >> 32, lb = static_cast<uint32_t> (b);
+        uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        uint64_t t = rl + (rm0 << 32);
+        uint64_t c = t < rl;
+        uint64_t lo = t + (rm1 << 32);
+        c += lo < t;
+        a = lo;
+        b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+    }
+
+    inline uint64_t hashMix (uint64_t a, uint64_t b) {
+        hashMul (a, b);
+        return a ^ b;
+    }
+
+    // How hashBytesAs() reads its input:  as it is, or with ASCII
+    // letters lower cased on the way in (so a case-insensitive hash needs
+    // no lower-cased copy, and is the same as hashing one).
+    struct HashLoads {
+        static uint64_t word64 (const unsigned char* p) { return load64 (p); }
+        static uint32_t word32 (const unsigned char* p) { return load32 (p); }
+        static unsigned char byte (const unsigned char* p) { return *p; }
+    };
+
+    struct HashLoadsAsciiLower {
+        static uint64_t word64 (const unsigned char* p) { return asciiLower64 (load64 (p)); }
+        static uint32_t word32 (const unsigned char* p) { return asciiLower32 (load32 (p)); }
+        static unsigned char byte (const unsigned char* p) { return asciiLower (*p); }
+    };
+
+    // wchar_t through towlower().  Every load hashBytesAs() makes of a
+    // wchar_t string starts on a wchar_t, except the single bytes of a
+    // one-char string with 16-bit wchar_t, which find theirs by address.
+    struct HashLoadsWideLower {
+        template<typename _WordT>
+        static _WordT word (const unsigned char* p) {
+            wchar_t units [sizeof (_WordT) / sizeof (wchar_t)];
+            memcpy (units, p, sizeof (units));
+            for (size_t i = 0; i < sizeof (units) / sizeof (wchar_t); ++i) {
+                units[i] = static_cast<wchar_t> (towlower (units[i]));
+            }
+            _WordT w;
+            memcpy (&w, units, sizeof (w));
+            return w;
+        }
+        static uint64_t word64 (const unsigned char* p) { return word<uint64_t> (p); }
+        static uint32_t word32 (const unsigned char* p) { return word<uint32_t> (p); }
+        static unsigned char byte (const unsigned char* p) {
+            const uintptr_t at = reinterpret_cast<uintptr_t> (p);
+            const wchar_t unit = static_cast<wchar_t> (
+                towlower (*reinterpret_cast<const wchar_t*> (at & ~(sizeof (wchar_t) - 1))));
+            return reinterpret_cast<const unsigned char*> (&unit)[at & (sizeof (wchar_t) - 1)];
+        }
+    };
+
+    template<typename _LoadsT>
+    inline size_t hashBytesAs (const void* data, size_t n, uint64_t seed) {
+        const unsigned char* p = static_cast<const unsigned char*> (data);
+        seed ^= hashMix (seed ^ s_hashSecret[0], s_hashSecret[1]);
+        uint64_t a, b;
+        if (n <= 16) {
+            if (n >= 4) {
+                // 4..16:  two pairs of overlapping 4-byte loads.
+                const size_t mid = (n >> 3) << 2;
+                a = (static_cast<uint64_t> (_LoadsT::word32 (p)) << 32) | _LoadsT::word32 (p + mid);
+                b = (static_cast<uint64_t> (_LoadsT::word32 (p + n - 4)) << 32) | _LoadsT::word32 (p + n - 4 - mid);
+            }
+            else if (n > 0) {
+                a = (static_cast<uint64_t> (_LoadsT::byte (p)) << 16) |
+                    (static_cast<uint64_t> (_LoadsT::byte (p + (n >> 1))) << 8) | _LoadsT::byte (p + n - 1);
+                b = 0;
+            }
+            else {
+                a = b = 0;
+            }
+        }
+        else {
+            size_t i = n;
+            if (i > 48) {
+                uint64_t lane1 = seed, lane2 = seed;
+                do {
+                    seed =  hashMix (_LoadsT::word64 (p)      ^ s_hashSecret[1], _LoadsT::word64 (p + 8)  ^ seed);
+                    lane1 = hashMix (_LoadsT::word64 (p + 16) ^ s_hashSecret[2], _LoadsT::word64 (p + 24) ^ lane1);
+                    lane2 = hashMix (_LoadsT::word64 (p + 32) ^ s_hashSecret[3], _LoadsT::word64 (p + 40) ^ lane2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= lane1 ^ lane2;
+            }
+            while (i > 16) {
+                seed = hashMix (_LoadsT::word64 (p) ^ s_hashSecret[1], _LoadsT::word64 (p + 8) ^ seed);
+                p += 16;
+                i -= 16;
+            }
+            // last 16 bytes, overlapping what came before if need be.
+            a = _LoadsT::word64 (p + i - 16);
+            b = _LoadsT::word64 (p + i - 8);
+        }
+        a ^= s_hashSecret[1];
+        b ^= seed;
+        hashMul (a, b);
+        return static_cast<size_t> (hashMix (a ^ s_hashSecret[0] ^ n, b ^ s_hashSecret[1]));
+    }
+
+    inline size_t hashBytes (const void* data, size_t n, uint64_t seed = 0) {
+        return hashBytesAs<HashLoads> (data, n, seed);
+    }
+
+    // Same as hashBytes() of the bytes with 'A'-'Z' lower cased.
+    inline size_t hashBytesAsciiLower (const void* data, size_t n, uint64_t seed = 0) {
+        return hashBytesAs<HashLoadsAsciiLower> (data, n, seed);
+    }
+
+    // Same as hashBytes() of the wchar_ts towlower()ed.
+    inline size_t hashWideLower (const wchar_t* str, size_t len, uint64_t seed = 0) {
+        return hashBytesAs<HashLoadsWideLower> (str, len * sizeof (wchar_t), seed);
+    }
+
+} // blank namespace
+
+#endif
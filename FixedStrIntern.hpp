@@ -0,0 +1,348 @@
+#ifndef FIXED_STR_INTERN_H
+#define FIXED_STR_INTERN_H
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrPool
+ *  Interning:  each distinct string gets a 32-bit ID, and the ID gives
+ *  back the string.  Symbols that are copied into FixedStrs over and over
+ *  (tickers, host names, metric names) can be kept as IDs instead, where
+ *  == and hashing are integer operations.
+ *
+ *      FixedStrPool symbols;
+ *      uint32_t id = symbols.intern (fields[2]);
+ *      ...
+ *      if (id == ibmId) ...
+ *      printf ("%s\n", symbols.c_str (id));
+ *
+ *  Safe to use from any number of threads at once.  Looking up a string
+ *  that's already in the pool takes no lock; adding one locks only one of
+ *  SHARDS shards, picked by hash.  The strings are copied into
+ *  append-only slabs that are never moved or freed until the pool goes,
+ *  so c_str()/view() stay valid for the life of the pool.
+ *
+ *  IDs are handed out in order from 0.  An ID only means
+ *  something to the pool that gave it out.
+ *
+ *  Nothing is ever removed, and tables that grow keep the old ones alive
+ *  (lock-free readers could still be in them), which costs up to as much
+ *  again as the current tables.  Meant for a bounded set of symbols.
+ */
+
+template<typename _CharT>
+class BaseStrPool {
+public:
+    typedef BaseStrView<_CharT> View;
+
+    enum {
+        SHARDS =        64,
+        NOT_FOUND =     0xffffffff
+    };
+
+    BaseStrPool()
+        :
+        m_nextId (0)
+    {
+        for (size_t i = 0; i < DIR_CHUNKS; ++i) {
+            m_dir[i].store (NULL, std::memory_order_relaxed);
+        }
+    }
+
+    ~BaseStrPool() {
+        for (size_t i = 0; i < DIR_CHUNKS; ++i) {
+            delete[] m_dir[i].load (std::memory_order_relaxed);
+        }
+    }
+
+    // ID for 'str' (anything a view can be made from), adding it if it's
+    // new.  Throws std::length_error when the 2^32 - 1 IDs run out.
+    uint32_t intern (View str) {
+        const size_t hash = str.hash();
+        Shard& shard = m_shards[hash % SHARDS];
+        const uint32_t id = shard.find (*this, str, hash);
+        if (id != NOT_FOUND) {
+            return id;
+        }
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        return shard.findOrAdd (*this, str, hash);
+    }
+
+    // Interns each of [first, last) and writes the IDs to 'out', in
+    // order.  Strings already there take no lock; the rest are grouped
+    // so each shard is locked once.
+    template<typename _InIterT, typename _OutIterT>
+    _OutIterT intern (_InIterT first, _InIterT last, _OutIterT out) {
+        std::vector<uint32_t>   ids;
+        std::vector<Pending>    pending;
+        for (size_t i = 0; first != last; ++first, ++i) {
+            View str (*first);
+            const size_t hash = str.hash();
+            const uint32_t id = m_shards[hash % SHARDS].find (*this, str, hash);
+            ids.push_back (id);
+            if (id == NOT_FOUND) {
+                Pending p = { str, hash, i };
+                pending.push_back (p);
+            }
+        }
+        for (size_t s = 0; s < SHARDS && !pending.empty(); ++s) {
+            Shard& shard = m_shards[s];
+            std::unique_lock<std::mutex> lock (shard.mutex, std::defer_lock);
+            for (size_t i = 0; i < pending.size(); ++i) {
+                if (pending[i].hash % SHARDS == s) {
+                    if (!lock.owns_lock()) {
+                        lock.lock();
+                    }
+                    ids[pending[i].index] = shard.findOrAdd (*this, pending[i].str, pending[i].hash);
+                }
+            }
+        }
+        for (size_t i = 0; i < ids.size(); ++i) {
+            *out++ = ids[i];
+        }
+        return out;
+    }
+
+    // ID if 'str' is in the pool, else NOT_FOUND.  Never locks.
+    uint32_t find (View str) const {
+        const size_t hash = str.hash();
+        return m_shards[hash % SHARDS].find (*this, str, hash);
+    }
+
+    // The string for an ID this pool gave out.  Valid (and terminated)
+    // until the pool is destroyed.
+    View view (uint32_t id) const {
+        const Entry& entry = dirEntry (id);
+        return View (entry.str, entry.len);
+    }
+
+    const _CharT* c_str (uint32_t id) const {
+        return dirEntry (id).str;
+    }
+
+    size_t length (uint32_t id) const {
+        return dirEntry (id).len;
+    }
+
+    // Number of distinct strings.
+    size_t size() const {
+        return m_nextId.load (std::memory_order_acquire);
+    }
+
+private:
+    // The directory (ID -> string) is chunks of 1024, 2048, 4096, ...
+    // entries; chunks never move, so it can be read without a lock.
+    enum {
+        DIR_FIRST_BITS =    10,
+        DIR_CHUNKS =        32 - DIR_FIRST_BITS + 1,
+        SLAB_CHARS =        16384 / sizeof (_CharT)
+    };
+
+    struct Entry {
+        const _CharT*   str;
+        size_t          len;
+    };
+
+    struct Pending {
+        View        str;
+        size_t      hash;
+        size_t      index;
+    };
+
+    // Open addressing, linear probing, at most half full.  Each slot is
+    // (32 bits of hash, ID + 1), or 0 if empty; written once.
+    struct Table {
+        explicit Table (size_t capacity)
+            :
+            slots   (new std::atomic<uint64_t> [capacity]),
+            mask    (capacity - 1),
+            count   (0)
+        {
+            for (size_t i = 0; i < capacity; ++i) {
+                slots[i].store (0, std::memory_order_relaxed);
+            }
+        }
+
+        ~Table() {
+            delete[] slots;
+        }
+
+        std::atomic<uint64_t>*  slots;
+        size_t                  mask;
+        size_t                  count;
+    };
+
+    struct Shard {
+        Shard()
+            :
+            table       (new Table (64)),
+            slabNext    (NULL),
+            slabLeft    (0)
+        {
+        }
+
+        ~Shard() {
+            delete table.load (std::memory_order_relaxed);
+            for (size_t i = 0; i < retired.size(); ++i) {
+                delete retired[i];
+            }
+            for (size_t i = 0; i < slabs.size(); ++i) {
+                delete[] slabs[i];
+            }
+        }
+
+        // Lock-free.
+        uint32_t find (const BaseStrPool<_CharT>& pool, View str, size_t hash) const {
+            const Table* t = table.load (std::memory_order_acquire);
+            const uint32_t tag = static_cast<uint32_t> (hash);
+            for (size_t i = (tag / SHARDS) & t->mask; ; i = (i + 1) & t->mask) {
+                const uint64_t slot = t->slots[i].load (std::memory_order_acquire);
+                if (slot == 0) {
+                    return NOT_FOUND;
+                }
+                if (static_cast<uint32_t> (slot >> 32) == tag) {
+                    const uint32_t id = static_cast<uint32_t> (slot) - 1;
+                    if (pool.view (id) == str) {
+                        return id;
+                    }
+                }
+            }
+        }
+
+        // With 'mutex' held.
+        uint32_t findOrAdd (BaseStrPool<_CharT>& pool, View str, size_t hash) {
+            // someone may have added it since the lock-free look.
+            uint32_t id = find (pool, str, hash);
+            if (id != NOT_FOUND) {
+                return id;
+            }
+            Table* t = table.load (std::memory_order_relaxed);
+            if ((t->count + 1) * 2 > t->mask + 1) {
+                t = grow (t);
+            }
+            const _CharT* copy = store (str);
+            id = pool.addEntry (copy, str.length());
+            put (t, (static_cast<uint64_t> (static_cast<uint32_t> (hash)) << 32) | (id + 1ULL));
+            return id;
+        }
+
+        // Copies 'str' (and a terminator) into the slab.
+        const _CharT* store (View str) {
+            const size_t need = str.length() + 1;
+            if (need > slabLeft) {
+                const size_t chars = need > SLAB_CHARS / 4 ? need : static_cast<size_t> (SLAB_CHARS);
+                _CharT* slab = new _CharT [chars];
+                slabs.push_back (slab);
+                if (chars == SLAB_CHARS) {
+                    slabNext = slab;
+                    slabLeft = chars;
+                }
+                else {
+                    // big ones get their own and leave the current slab be.
+                    memcpy (slab, str.data(), str.length() * sizeof (_CharT));
+                    slab[str.length()] = 0;
+                    return slab;
+                }
+            }
+            _CharT* dest = slabNext;
+            memcpy (dest, str.data(), str.length() * sizeof (_CharT));
+            dest[str.length()] = 0;
+            slabNext += need;
+            slabLeft -= need;
+            return dest;
+        }
+
+        // Readers may still be in the old table, so it's kept.
+        Table* grow (Table* old) {
+            Table* bigger = new Table ((old->mask + 1) * 2);
+            for (size_t i = 0; i <= old->mask; ++i) {
+                const uint64_t slot = old->slots[i].load (std::memory_order_relaxed);
+                if (slot != 0) {
+                    put (bigger, slot);
+                }
+            }
+            retired.push_back (old);
+            table.store (bigger, std::memory_order_release);
+            return bigger;
+        }
+
+        // Placed by its hash bits alone, so growing needs no strings.
+        static void put (Table* t, uint64_t slot) {
+            const uint32_t tag = static_cast<uint32_t> (slot >> 32);
+            size_t i = (tag / SHARDS) & t->mask;
+            while (t->slots[i].load (std::memory_order_relaxed) != 0) {
+                i = (i + 1) & t->mask;
+            }
+            t->slots[i].store (slot, std::memory_order_release);
+            ++t->count;
+        }
+
+        std::mutex              mutex;
+        std::atomic<Table*>     table;
+        std::vector<Table*>     retired;
+        std::vector<_CharT*>    slabs;
+        _CharT*                 slabNext;
+        size_t                  slabLeft;
+    };
+
+    // Chunk and offset of an ID:  chunk k starts at 1024 * (2^k - 1).
+    static size_t dirChunk (uint32_t id, size_t* offset) {
+        const uint64_t v = static_cast<uint64_t> (id) + (1u << DIR_FIRST_BITS);
+        const size_t top = highestBit64 (v);
+        *offset = static_cast<size_t> (v - (static_cast<uint64_t> (1) << top));
+        return top - DIR_FIRST_BITS;
+    }
+
+    const Entry& dirEntry (uint32_t id) const {
+        size_t offset;
+        const size_t chunk = dirChunk (id, &offset);
+        return m_dir[chunk].load (std::memory_order_acquire)[offset];
+    }
+
+    // Called with a shard locked; other shards may be adding at the same
+    // time, so the ID comes from a shared counter and a new directory
+    // chunk is put in place with a CAS.
+    uint32_t addEntry (const _CharT* str, size_t len) {
+        uint32_t mine = m_nextId.load (std::memory_order_relaxed);
+        do {
+            if (mine == NOT_FOUND) {
+                throw std::length_error ("FixedStrPool out of IDs");
+            }
+        } while (!m_nextId.compare_exchange_weak (mine, mine + 1, std::memory_order_relaxed));
+        size_t offset;
+        const size_t chunk = dirChunk (mine, &offset);
+        Entry* entries = m_dir[chunk].load (std::memory_order_acquire);
+        if (entries == NULL) {
+            Entry* fresh = new Entry [static_cast<size_t> (1) << (chunk + DIR_FIRST_BITS)];
+            if (m_dir[chunk].compare_exchange_strong (entries, fresh, std::memory_order_acq_rel)) {
+                entries = fresh;
+            }
+            else {
+                delete[] fresh;
+            }
+        }
+        entries[offset].str = str;
+        entries[offset].len = len;
+        return mine;
+    }
+
+    Shard                   m_shards [SHARDS];
+    std::atomic<Entry*>     m_dir [DIR_CHUNKS];
+    std::atomic<uint32_t>   m_nextId;
+
+    // disable these...
+    BaseStrPool (const BaseStrPool<_CharT>& other);
+    BaseStrPool<_CharT>& operator= (const BaseStrPool<_CharT>& other);
+};
+
+typedef BaseStrPool<char>       FixedStrPool;
+typedef BaseStrPool<wchar_t>    WFixedStrPool;
+
+#endif
@@ -0,0 +1,526 @@
+#ifndef FIXED_STR_MAP_H
+#define FIXED_STR_MAP_H
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrMap / FixedStrSet
+ *  Hash map and set keyed by FixedStr, with the entries stored by value
+ *  in one flat array (open addressing) instead of a node each.  A key that
+ *  fits its FixedStr costs no allocation at all, and a lookup touches the
+ *  control bytes and then, almost always, just the one entry it wants.
+ *
+ *      FixedStrMap<24, int> ids;
+ *      ids["alpha"] = 1;
+ *      ids.find (line.substr (0, 5));      // no temporary FixedStr
+ *
+ *  It's laid out like Abseil's Swiss tables:  a byte per slot holding 7
+ *  bits of the key's hash (or empty/deleted), looked at 16 at a time
+ *  (SSE2, or word at a time without it), so most misses are settled
+ *  without comparing a single key.  Kept at most 7/8 full; capacity is a
+ *  power of 2.
+ *
+ *  Lookups take a view, so C strings, views and FixedStrs of any size all
+ *  work as they are (their hashes agree, see FixedStrHash.hpp).  Keys that
+ *  spill to the heap are fine; entries are moved, not copied, when the
+ *  table grows, so a spilled key keeps its block.
+ *
+ *  Like std::unordered_map, anything that adds an entry can invalidate
+ *  iterators and references (the array gets reallocated), and erasing
+ *  doesn't move anything else.  Don't change a key through an iterator.
+ */
+
+template<typename _KeyT, typename _SlotT, typename _CharT>
+class BaseStrTable {
+public:
+    typedef BaseStrView<_CharT> View;
+
+    template<typename _EntryT>
+    class Iter {
+    public:
+        typedef std::forward_iterator_tag   iterator_category;
+        typedef _SlotT                      value_type;
+        typedef ptrdiff_t                   difference_type;
+        typedef _EntryT*                    pointer;
+        typedef _EntryT&                    reference;
+
+        Iter()
+            :
+            m_ctrl  (NULL),
+            m_slot  (NULL),
+            m_end   (NULL)
+        {
+        }
+
+        // iterator -> const_iterator.
+        template<typename _OtherT>
+        Iter (const Iter<_OtherT>& other)
+            :
+            m_ctrl  (other.m_ctrl),
+            m_slot  (other.m_slot),
+            m_end   (other.m_end)
+        {
+        }
+
+        reference operator*() const {
+            return *m_slot;
+        }
+
+        pointer operator->() const {
+            return m_slot;
+        }
+
+        Iter<_EntryT>& operator++() {
+            ++m_ctrl;
+            ++m_slot;
+            skipFree();
+            return *this;
+        }
+
+        Iter<_EntryT> operator++ (int) {
+            Iter<_EntryT> toRet (*this);
+            ++*this;
+            return toRet;
+        }
+
+        bool operator== (const Iter<_EntryT>& rhs) const {
+            return m_slot == rhs.m_slot;
+        }
+
+        bool operator!= (const Iter<_EntryT>& rhs) const {
+            return m_slot != rhs.m_slot;
+        }
+
+    private:
+        template<typename, typename, typename> friend class BaseStrTable;
+        template<typename> friend class Iter;
+
+        Iter (const unsigned char* ctrl, _EntryT* slot, const unsigned char* end)
+            :
+            m_ctrl  (ctrl),
+            m_slot  (slot),
+            m_end   (end)
+        {
+        }
+
+        void skipFree() {
+            while (m_ctrl != m_end && (*m_ctrl & CTRL_EMPTY)) {
+                ++m_ctrl;
+                ++m_slot;
+            }
+        }
+
+        const unsigned char*    m_ctrl;
+        _EntryT*                m_slot;
+        const unsigned char*    m_end;
+    };
+
+    typedef Iter<_SlotT>        iterator;
+    typedef Iter<const _SlotT>  const_iterator;
+
+    BaseStrTable()
+        :
+        m_ctrl          (NULL),
+        m_slots         (NULL),
+        m_capacity      (0),
+        m_size          (0),
+        m_growthLeft    (0)
+    {
+    }
+
+    BaseStrTable (const BaseStrTable<_KeyT, _SlotT, _CharT>& other)
+        :
+        m_ctrl          (NULL),
+        m_slots         (NULL),
+        m_capacity      (0),
+        m_size          (0),
+        m_growthLeft    (0)
+    {
+        reserve (other.m_size);
+        for (const_iterator it = other.begin(); it != other.end(); ++it) {
+            const size_t hash = keyOf (*it).hash();
+            const size_t idx = prepareInsert (hash);
+            new (&m_slots[idx]) _SlotT (*it);
+            commitInsert (idx, hash);
+        }
+    }
+
+    BaseStrTable (BaseStrTable<_KeyT, _SlotT, _CharT>&& other) noexcept
+        :
+        m_ctrl          (NULL),
+        m_slots         (NULL),
+        m_capacity      (0),
+        m_size          (0),
+        m_growthLeft    (0)
+    {
+        swap (other);
+    }
+
+    ~BaseStrTable() {
+        destroyAll();
+        release();
+    }
+
+    BaseStrTable<_KeyT, _SlotT, _CharT>& operator= (const BaseStrTable<_KeyT, _SlotT, _CharT>& rhs) {
+        if (this != &rhs) {
+            BaseStrTable<_KeyT, _SlotT, _CharT> copy (rhs);
+            swap (copy);
+        }
+        return *this;
+    }
+
+    BaseStrTable<_KeyT, _SlotT, _CharT>& operator= (BaseStrTable<_KeyT, _SlotT, _CharT>&& rhs) noexcept {
+        swap (rhs);
+        return *this;
+    }
+
+    void swap (BaseStrTable<_KeyT, _SlotT, _CharT>& other) noexcept {
+        std::swap (m_ctrl,          other.m_ctrl);
+        std::swap (m_slots,         other.m_slots);
+        std::swap (m_capacity,      other.m_capacity);
+        std::swap (m_size,          other.m_size);
+        std::swap (m_growthLeft,    other.m_growthLeft);
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    // Number of slots; up to 7/8 of them can be used.
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+    // Makes room for 'n' entries without growing again.
+    void reserve (size_t n) {
+        if (n == 0) {
+            return;
+        }
+        size_t cap = CTRL_GROUP;
+        while (cap / 8 * 7 < n) {
+            cap *= 2;
+        }
+        if (cap > m_capacity) {
+            rehash (cap);
+        }
+    }
+
+    // Keeps the space.
+    void clear() {
+        destroyAll();
+        if (m_capacity > 0) {
+            memset (m_ctrl, CTRL_EMPTY, m_capacity);
+        }
+        m_size = 0;
+        m_growthLeft = m_capacity / 8 * 7;
+    }
+
+    iterator begin() {
+        iterator it (m_ctrl, m_slots, m_ctrl + m_capacity);
+        it.skipFree();
+        return it;
+    }
+
+    iterator end() {
+        return iterator (m_ctrl + m_capacity, m_slots + m_capacity, m_ctrl + m_capacity);
+    }
+
+    const_iterator begin() const {
+        return const_cast<BaseStrTable<_KeyT, _SlotT, _CharT>*> (this)->begin();
+    }
+
+    const_iterator end() const {
+        return const_cast<BaseStrTable<_KeyT, _SlotT, _CharT>*> (this)->end();
+    }
+
+    // Lookups take anything a view can be made from.
+
+    iterator find (View key) {
+        const size_t idx = findIndex (key, key.hash());
+        return idx == NOT_FOUND ? end() : iterAt (idx);
+    }
+
+    const_iterator find (View key) const {
+        return const_cast<BaseStrTable<_KeyT, _SlotT, _CharT>*> (this)->find (key);
+    }
+
+    bool contains (View key) const {
+        return findIndex (key, key.hash()) != NOT_FOUND;
+    }
+
+    size_t count (View key) const {
+        return contains (key) ? 1 : 0;
+    }
+
+    size_t erase (View key) {
+        const size_t idx = findIndex (key, key.hash());
+        if (idx == NOT_FOUND) {
+            return 0;
+        }
+        eraseAt (idx);
+        return 1;
+    }
+
+    // Returns the one after.
+    iterator erase (const_iterator pos) {
+        const size_t idx = pos.m_ctrl - m_ctrl;
+        eraseAt (idx);
+        iterator it = iterAt (idx);
+        it.skipFree();
+        return it;
+    }
+
+protected:
+    enum { NOT_FOUND = ~static_cast<size_t> (0) };
+
+    static const _KeyT& keyOf (const _KeyT& key) {
+        return key;
+    }
+
+    template<typename _ValueT>
+    static const _KeyT& keyOf (const std::pair<_KeyT, _ValueT>& entry) {
+        return entry.first;
+    }
+
+    iterator iterAt (size_t idx) {
+        return iterator (m_ctrl + idx, m_slots + idx, m_ctrl + m_capacity);
+    }
+
+    size_t findIndex (View key, size_t hash) const {
+        if (m_capacity == 0) {
+            return NOT_FOUND;
+        }
+        const unsigned char h2 = static_cast<unsigned char> (hash & 0x7f);
+        const size_t groupMask = m_capacity / CTRL_GROUP - 1;
+        size_t group = (hash >> 7) & groupMask;
+        // Triangular steps over a power of 2 number of groups visit every
+        // group; there's always an empty slot somewhere to stop at.
+        for (size_t step = 1; ; ++step) {
+            const unsigned char* ctrl = m_ctrl + group * CTRL_GROUP;
+            for (uint32_t match = groupMatch (ctrl, h2); match != 0; match &= match - 1) {
+                const size_t idx = group * CTRL_GROUP + lowestBit (match);
+                if (keyOf (m_slots[idx]).view() == key) {
+                    return idx;
+                }
+            }
+            if (groupMatch (ctrl, CTRL_EMPTY) != 0) {
+                return NOT_FOUND;
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+
+    // Finds a free slot for a key known not to be there, growing first if
+    // need be.  The caller constructs the entry, then commitInsert(); if
+    // constructing throws, nothing has changed.
+    size_t prepareInsert (size_t hash) {
+        if (m_capacity == 0) {
+            rehash (CTRL_GROUP);
+        }
+        size_t idx = firstFree (hash);
+        if (m_growthLeft == 0 && m_ctrl[idx] == CTRL_EMPTY) {
+            // Full up, counting deleted slots.  If it's mostly deleted
+            // slots, clearing them out is enough.
+            rehash (m_size < m_capacity / 16 * 7 ? m_capacity : m_capacity * 2);
+            idx = firstFree (hash);
+        }
+        return idx;
+    }
+
+    void commitInsert (size_t idx, size_t hash) {
+        if (m_ctrl[idx] == CTRL_EMPTY) {
+            --m_growthLeft;
+        }
+        m_ctrl[idx] = static_cast<unsigned char> (hash & 0x7f);
+        ++m_size;
+    }
+
+    unsigned char*  m_ctrl;
+    _SlotT*         m_slots;
+    size_t          m_capacity;
+    size_t          m_size;
+    size_t          m_growthLeft;
+
+private:
+    size_t firstFree (size_t hash) const {
+        const size_t groupMask = m_capacity / CTRL_GROUP - 1;
+        size_t group = (hash >> 7) & groupMask;
+        for (size_t step = 1; ; ++step) {
+            uint32_t free = groupMatchFree (m_ctrl + group * CTRL_GROUP);
+            if (free != 0) {
+                return group * CTRL_GROUP + lowestBit (free);
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+
+    void eraseAt (size_t idx) {
+        m_slots[idx].~_SlotT();
+        --m_size;
+        // A group that still has an empty slot has never been full, so no
+        // probe has gone past it and the slot can go back to empty.
+        // Otherwise it has to stay a marker that lookups step over.
+        if (groupMatch (m_ctrl + idx / CTRL_GROUP * CTRL_GROUP, CTRL_EMPTY) != 0) {
+            m_ctrl[idx] = CTRL_EMPTY;
+            ++m_growthLeft;
+        }
+        else {
+            m_ctrl[idx] = CTRL_DELETED;
+        }
+    }
+
+    // Moves every entry to a fresh array of 'cap' slots.
+    void rehash (size_t cap) {
+        unsigned char*  oldCtrl =       m_ctrl;
+        _SlotT*         oldSlots =      m_slots;
+        const size_t    oldCapacity =   m_capacity;
+
+        m_slots = static_cast<_SlotT*> (::operator new (cap * sizeof (_SlotT)));
+        m_ctrl = new unsigned char [cap];
+        memset (m_ctrl, CTRL_EMPTY, cap);
+        m_capacity = cap;
+        m_growthLeft = cap / 8 * 7 - m_size;
+
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (!(oldCtrl[i] & CTRL_EMPTY)) {
+                const size_t hash = keyOf (oldSlots[i]).hash();
+                const size_t idx = firstFree (hash);
+                new (&m_slots[idx]) _SlotT (std::move (oldSlots[i]));
+                oldSlots[i].~_SlotT();
+                m_ctrl[idx] = static_cast<unsigned char> (hash & 0x7f);
+            }
+        }
+        delete[] oldCtrl;
+        ::operator delete (oldSlots);
+    }
+
+    void destroyAll() {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            if (!(m_ctrl[i] & CTRL_EMPTY)) {
+                m_slots[i].~_SlotT();
+            }
+        }
+    }
+
+    void release() {
+        delete[] m_ctrl;
+        ::operator delete (m_slots);
+    }
+};
+
+///////////////
+// Map:  entries are std::pair<key, value>, as in std::unordered_map.
+///////////////
+
+template<typename _KeyT, typename _ValueT, typename _CharT>
+class BaseStrMap : public BaseStrTable<_KeyT, std::pair<_KeyT, _ValueT>, _CharT> {
+    typedef BaseStrTable<_KeyT, std::pair<_KeyT, _ValueT>, _CharT> Table;
+public:
+    typedef typename Table::View            View;
+    typedef typename Table::iterator        iterator;
+    typedef typename Table::const_iterator  const_iterator;
+
+    // Makes the value from 'args' if 'key' isn't there yet.
+    template<typename... _ArgsT>
+    std::pair<iterator, bool> try_emplace (View key, _ArgsT&&... args) {
+        const size_t hash = key.hash();
+        size_t idx = this->findIndex (key, hash);
+        if (idx != Table::NOT_FOUND) {
+            return std::pair<iterator, bool> (this->iterAt (idx), false);
+        }
+        idx = this->prepareInsert (hash);
+        new (&this->m_slots[idx]) std::pair<_KeyT, _ValueT> (
+                    std::piecewise_construct,
+                    std::forward_as_tuple (key),
+                    std::forward_as_tuple (std::forward<_ArgsT> (args)...));
+        this->commitInsert (idx, hash);
+        return std::pair<iterator, bool> (this->iterAt (idx), true);
+    }
+
+    std::pair<iterator, bool> insert (View key, const _ValueT& value) {
+        return try_emplace (key, value);
+    }
+
+    std::pair<iterator, bool> insert (View key, _ValueT&& value) {
+        return try_emplace (key, std::move (value));
+    }
+
+    _ValueT& operator[] (View key) {
+        return try_emplace (key).first->second;
+    }
+
+    _ValueT& at (View key) {
+        iterator it = this->find (key);
+        if (it == this->end()) {
+            throw std::out_of_range ("FixedStrMap::at");
+        }
+        return it->second;
+    }
+
+    const _ValueT& at (View key) const {
+        return const_cast<BaseStrMap<_KeyT, _ValueT, _CharT>*> (this)->at (key);
+    }
+};
+
+///////////////
+// Set:  entries are the keys; iterators are always const.
+///////////////
+
+template<typename _KeyT, typename _CharT>
+class BaseStrSet : public BaseStrTable<_KeyT, _KeyT, _CharT> {
+    typedef BaseStrTable<_KeyT, _KeyT, _CharT> Table;
+public:
+    typedef typename Table::View            View;
+    typedef typename Table::const_iterator  iterator;
+    typedef typename Table::const_iterator  const_iterator;
+
+    std::pair<const_iterator, bool> insert (View key) {
+        const size_t hash = key.hash();
+        size_t idx = this->findIndex (key, hash);
+        if (idx != Table::NOT_FOUND) {
+            return std::pair<const_iterator, bool> (this->iterAt (idx), false);
+        }
+        idx = this->prepareInsert (hash);
+        new (&this->m_slots[idx]) _KeyT (key);
+        this->commitInsert (idx, hash);
+        return std::pair<const_iterator, bool> (this->iterAt (idx), true);
+    }
+
+    const_iterator begin() const {
+        return Table::begin();
+    }
+
+    const_iterator end() const {
+        return Table::end();
+    }
+
+    const_iterator find (View key) const {
+        return Table::find (key);
+    }
+};
+
+template<size_t _AllocSizeT, typename _ValueT>
+using FixedStrMap = BaseStrMap<FixedStr<_AllocSizeT>, _ValueT, char>;
+
+template<size_t _AllocSizeT, typename _ValueT>
+using WFixedStrMap = BaseStrMap<WFixedStr<_AllocSizeT>, _ValueT, wchar_t>;
+
+template<size_t _AllocSizeT>
+using FixedStrSet = BaseStrSet<FixedStr<_AllocSizeT>, char>;
+
+template<size_t _AllocSizeT>
+using WFixedStrSet = BaseStrSet<WFixedStr<_AllocSizeT>, wchar_t>;
+
+#endif
@@ -0,0 +1,462 @@
+#ifndef FIXED_STR_MATCHER_H
+#define FIXED_STR_MATCHER_H
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrMatcher
+ *  Finds every one of a set of patterns in a text in one pass, instead of
+ *  a find() per pattern.  Built once from the patterns (FixedStrs, views,
+ *  anything a view can be made from), then used as often as wanted.
+ *
+ *      std::vector<FixedStr<32> > keywords = ...;
+ *      const FixedStrMatcher matcher (keywords.begin(), keywords.end());
+ *      matcher.scan (message, [&] (const FixedStrMatcher::Match& m) {
+ *          flagged.push_back (m.id);   // index of the pattern in 'keywords'
+ *          return true;                // false stops the scan
+ *      });
+ *
+ *  It's an Aho-Corasick automaton over the bytes of the patterns, kept
+ *  small for the cache:  bytes that aren't in any pattern share one
+ *  column, states are numbered breadth first, and the shallow states,
+ *  where a scan spends nearly all its time, get a full row of next states
+ *  (up to DENSE_BYTES of them).  Deeper states keep just their own edges
+ *  and fall back along their failure links.
+ *
+ *  Whenever the automaton is back at its start it skips ahead with the
+ *  Teddy prefilter (see FixedStrSimd.hpp:  AVX2, SSSE3 or NEON) to where
+ *  one of the patterns could start:  on their first 3 bytes for up to
+ *  TEDDY_PATTERNS patterns, or just the first for more if they start
+ *  with no more than TEDDY_FIRST_BYTES different bytes.
+ *
+ *  Matches are reported as they end, in order of where they end, as (ID,
+ *  offset, length) in chars, where the ID is the pattern's position in
+ *  the range it was built from.  Patterns can overlap and repeat.
+ *
+ *  A matcher never changes after it's built, so any number of threads can
+ *  scan with the same one at once.  Text that arrives in pieces is
+ *  scanned with a Stream, which keeps the position in the automaton (and
+ *  the text) between pieces, so matches that span pieces are found.
+ */
+
+template<typename _CharT>
+class BaseStrMatcher {
+public:
+    typedef BaseStrView<_CharT> View;
+
+    struct Match {
+        uint32_t    id;
+        size_t      offset;
+        size_t      length;
+    };
+
+    enum {
+        TEDDY_PATTERNS =    64,
+        TEDDY_FIRST_BYTES = 16,
+        DENSE_BYTES =       1 << 20
+    };
+
+    // Throws std::invalid_argument if a pattern is empty.
+    template<typename _IterT>
+    BaseStrMatcher (_IterT first, _IterT last)
+        :
+        m_classes       (0),
+        m_dense         (0),
+        m_denseCodes    (0),
+        m_teddy         (false)
+    {
+        std::vector<std::vector<unsigned char> > patterns;
+        for (; first != last; ++first) {
+            View pattern (*first);
+            if (pattern.empty()) {
+                throw std::invalid_argument ("FixedStrMatcher empty pattern");
+            }
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*> (pattern.data());
+            patterns.push_back (std::vector<unsigned char> (bytes, bytes + pattern.length() * sizeof (_CharT)));
+            m_lengths.push_back (pattern.length());
+        }
+        build (patterns);
+    }
+
+    // Calls fn (const Match&) for each match in 'text'; fn returns false
+    // to stop.  False if it was stopped.
+    template<typename _FnT>
+    bool scan (View text, _FnT fn) const {
+        uint32_t state = 0;
+        size_t end = 0;
+        return run (text, &state, &end, fn);
+    }
+
+    // The first match to end, if there is one.
+    bool find_first (View text, Match* match) const {
+        return !scan (text, First (match));
+    }
+
+    bool contains_any (View text) const {
+        Match match = {};
+        return find_first (text, &match);
+    }
+
+    std::vector<Match> find_all (View text) const {
+        std::vector<Match> matches;
+        scan (text, All (&matches));
+        return matches;
+    }
+
+    // Number of patterns.
+    size_t size() const {
+        return m_lengths.size();
+    }
+
+    size_t states() const {
+        return m_edgeBegin.size() - 1;
+    }
+
+    // Scans text that comes in pieces; offsets are from the start of the
+    // first piece.  One per text (and thread); the matcher must outlive
+    // it.
+    class Stream {
+    public:
+        explicit Stream (const BaseStrMatcher<_CharT>& matcher)
+            :
+            m_matcher   (matcher),
+            m_state     (0),
+            m_end       (0)
+        {
+        }
+
+        // As BaseStrMatcher::scan(), for the next piece.  After a stop the
+        // rest of the piece is skipped; reset() to start again.
+        template<typename _FnT>
+        bool scan (View piece, _FnT fn) {
+            return m_matcher.run (piece, &m_state, &m_end, fn);
+        }
+
+        bool find_first (View piece, Match* match) {
+            return !scan (piece, First (match));
+        }
+
+        // Chars scanned so far.
+        size_t offset() const {
+            return m_end / sizeof (_CharT);
+        }
+
+        void reset() {
+            m_state = 0;
+            m_end = 0;
+        }
+
+    private:
+        const BaseStrMatcher<_CharT>&   m_matcher;
+        uint32_t                        m_state;    // code
+        size_t                          m_end;      // bytes
+    };
+
+private:
+    // A state with matches (its own or along its failure links) is
+    // flagged in the transitions to it.
+    static const uint32_t HAS_MATCH =   0x80000000;
+    static const uint32_t STATE_MASK =  0x7fffffff;
+
+    struct First {
+        explicit First (Match* match)
+            :
+            match (match)
+        {
+        }
+
+        bool operator() (const Match& m) const {
+            *match = m;
+            return false;
+        }
+
+        Match* match;
+    };
+
+    struct All {
+        explicit All (std::vector<Match>* matches)
+            :
+            matches (matches)
+        {
+        }
+
+        bool operator() (const Match& m) const {
+            matches->push_back (m);
+            return true;
+        }
+
+        std::vector<Match>* matches;
+    };
+
+    struct Edge {
+        unsigned char   cls;
+        uint32_t        next;       // code, flagged
+    };
+
+    // Bytes [*end, *end + text) of the whole text, from 'state'.
+    template<typename _FnT>
+    bool run (View text, uint32_t* state, size_t* end, _FnT& fn) const {
+        const unsigned char* p = reinterpret_cast<const unsigned char*> (text.data());
+        const size_t n = text.length() * sizeof (_CharT);
+        const size_t base = *end;
+        uint32_t s = *state;
+        for (size_t i = 0; i < n; ++i) {
+            if (s == 0 && m_teddy) {
+                i += teddyFind (p + i, n - i, m_teddyMasks);
+                if (i == n) {
+                    break;
+                }
+            }
+            s = next (s, m_class[p[i]]);
+            if (s & HAS_MATCH) {
+                s &= STATE_MASK;
+                if (!report (stateOf (s), base + i + 1, fn)) {
+                    *state = s;
+                    *end = base + i + 1;
+                    return false;
+                }
+            }
+        }
+        *state = s;
+        *end = base + n;
+        return true;
+    }
+
+    // Transitions and the scan's position are codes, not state numbers:
+    // a dense state's code is where its row starts, saving a multiply per
+    // byte, and the sparse states are numbered on from the last row.
+    uint32_t code (uint32_t s) const {
+        return s < m_dense ? s * static_cast<uint32_t> (m_classes) : m_denseCodes + (s - m_dense);
+    }
+
+    uint32_t stateOf (uint32_t code) const {
+        return code < m_denseCodes ? code / static_cast<uint32_t> (m_classes) : m_dense + (code - m_denseCodes);
+    }
+
+    uint32_t next (uint32_t c, unsigned char cls) const {
+        if (c < m_denseCodes) {
+            return m_denseNext[c + cls];
+        }
+        return nextState (m_dense + (c - m_denseCodes), cls);
+    }
+
+    // Follows failure links from state 's' until there's an edge for
+    // 'cls' or a dense row.
+    uint32_t nextState (uint32_t s, unsigned char cls) const {
+        for (;;) {
+            if (s < m_dense) {
+                return m_denseNext[s * m_classes + cls];
+            }
+            for (uint32_t e = m_edgeBegin[s]; e < m_edgeBegin[s + 1]; ++e) {
+                if (m_edges[e].cls == cls) {
+                    return m_edges[e].next;
+                }
+            }
+            s = m_fail[s];
+        }
+    }
+
+    // Matches ending at byte 'end' (one past) in state 's'.  For wide
+    // chars the automaton runs on bytes, so only those ending (and so
+    // starting) on a char boundary count.
+    template<typename _FnT>
+    bool report (uint32_t s, size_t end, _FnT& fn) const {
+        if (end % sizeof (_CharT) != 0) {
+            return true;
+        }
+        for (; s != 0; s = m_dictionary[s]) {
+            for (uint32_t o = m_outBegin[s]; o < m_outBegin[s + 1]; ++o) {
+                const uint32_t id = m_outIds[o];
+                const size_t length = m_lengths[id];
+                Match match = { id, end / sizeof (_CharT) - length, length };
+                if (!fn (match)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void build (const std::vector<std::vector<unsigned char> >& patterns) {
+        // byte classes:  0 for bytes in no pattern.
+        for (size_t b = 0; b < 256; ++b) {
+            m_class[b] = 0;
+        }
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            for (size_t i = 0; i < patterns[p].size(); ++i) {
+                m_class[patterns[p][i]] = 1;
+            }
+        }
+        m_classes = 1;
+        for (size_t b = 0; b < 256; ++b) {
+            if (m_class[b]) {
+                m_class[b] = static_cast<unsigned char> (m_classes++);
+            }
+        }
+
+        // the trie, in insertion order.
+        std::vector<std::vector<std::pair<unsigned char, uint32_t> > > children (1);
+        std::vector<std::vector<uint32_t> > ends (1);
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            uint32_t node = 0;
+            for (size_t i = 0; i < patterns[p].size(); ++i) {
+                const unsigned char cls = m_class[patterns[p][i]];
+                uint32_t child = 0;
+                for (size_t c = 0; c < children[node].size(); ++c) {
+                    if (children[node][c].first == cls) {
+                        child = children[node][c].second;
+                        break;
+                    }
+                }
+                if (child == 0) {
+                    child = static_cast<uint32_t> (children.size());
+                    if (child > STATE_MASK) {
+                        throw std::length_error ("FixedStrMatcher too many states");
+                    }
+                    children[node].push_back (std::make_pair (cls, child));
+                    children.push_back (std::vector<std::pair<unsigned char, uint32_t> >());
+                    ends.push_back (std::vector<uint32_t>());
+                }
+                node = child;
+            }
+            ends[node].push_back (static_cast<uint32_t> (p));
+        }
+
+        // renumbered breadth first, edges sorted.
+        const size_t count = children.size();
+        std::vector<uint32_t> order (1, 0);
+        std::vector<uint32_t> renumber (count, 0);
+        for (size_t i = 0; i < order.size(); ++i) {
+            std::vector<std::pair<unsigned char, uint32_t> >& edges = children[order[i]];
+            std::sort (edges.begin(), edges.end());
+            for (size_t c = 0; c < edges.size(); ++c) {
+                renumber[edges[c].second] = static_cast<uint32_t> (order.size());
+                order.push_back (edges[c].second);
+            }
+        }
+        m_edgeBegin.assign (1, 0);
+        m_outBegin.assign (1, 0);
+        for (size_t s = 0; s < count; ++s) {
+            const std::vector<std::pair<unsigned char, uint32_t> >& edges = children[order[s]];
+            for (size_t c = 0; c < edges.size(); ++c) {
+                Edge edge = { edges[c].first, renumber[edges[c].second] };
+                m_edges.push_back (edge);
+            }
+            m_edgeBegin.push_back (static_cast<uint32_t> (m_edges.size()));
+            m_outIds.insert (m_outIds.end(), ends[order[s]].begin(), ends[order[s]].end());
+            m_outBegin.push_back (static_cast<uint32_t> (m_outIds.size()));
+        }
+
+        // failure and dictionary links, breadth first so they're always
+        // to states already done.  Dense rows are filled in as they go,
+        // since a state's failure state is shallower and so is dense too
+        // if it is.
+        const size_t rowBytes = m_classes * sizeof (uint32_t);
+        m_dense = static_cast<uint32_t> (std::min (count, std::max (static_cast<size_t> (1), DENSE_BYTES / rowBytes)));
+        m_denseNext.assign (static_cast<size_t> (m_dense) * m_classes, 0);
+        m_fail.assign (count, 0);
+        m_dictionary.assign (count, 0);
+        for (uint32_t s = 0; s < count; ++s) {
+            if (s < m_dense) {
+                uint32_t* row = &m_denseNext[static_cast<size_t> (s) * m_classes];
+                if (s != 0) {
+                    const uint32_t* failRow = &m_denseNext[static_cast<size_t> (m_fail[s]) * m_classes];
+                    std::copy (failRow, failRow + m_classes, row);
+                }
+                for (uint32_t e = m_edgeBegin[s]; e < m_edgeBegin[s + 1]; ++e) {
+                    row[m_edges[e].cls] = m_edges[e].next;
+                }
+            }
+            for (uint32_t e = m_edgeBegin[s]; e < m_edgeBegin[s + 1]; ++e) {
+                const uint32_t child = m_edges[e].next;
+                const uint32_t fail = s == 0 ? 0 : nextState (m_fail[s], m_edges[e].cls);
+                m_fail[child] = fail;
+                m_dictionary[child] = m_outBegin[fail] != m_outBegin[fail + 1] ? fail : m_dictionary[fail];
+            }
+        }
+
+        // transitions to codes, flagged where there are matches.
+        m_denseCodes = m_dense * static_cast<uint32_t> (m_classes);
+        if (m_denseCodes + (count - m_dense) > STATE_MASK) {
+            throw std::length_error ("FixedStrMatcher too many states");
+        }
+        for (size_t e = 0; e < m_edges.size(); ++e) {
+            m_edges[e].next = flagged (m_edges[e].next);
+        }
+        for (size_t i = 0; i < m_denseNext.size(); ++i) {
+            m_denseNext[i] = flagged (m_denseNext[i]);
+        }
+
+#if defined(FIXED_STR_AVX2)
+        m_teddy = !patterns.empty() && (patterns.size() <= TEDDY_PATTERNS || m_edgeBegin[1] <= TEDDY_FIRST_BYTES) &&
+                  cpuHasAvx2();
+#endif
+        if (m_teddy) {
+            buildTeddy (patterns);
+        }
+    }
+
+    uint32_t flagged (uint32_t s) const {
+        const bool matches = m_outBegin[s] != m_outBegin[s + 1] || m_dictionary[s] != 0;
+        return matches ? code (s) | HAS_MATCH : code (s);
+    }
+
+    // Fingerprints are the first 1-3 bytes (as many as the shortest
+    // pattern has; just 1 for a big set); patterns with the same ones
+    // share a bucket, and the distinct ones are spread over the 8 buckets
+    // in sorted order, so similar ones go together.
+    void buildTeddy (const std::vector<std::vector<unsigned char> >& patterns) {
+        size_t bytes = patterns.size() <= TEDDY_PATTERNS ? 3 : 1;
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            bytes = std::min (bytes, patterns[p].size());
+        }
+        std::vector<std::vector<unsigned char> > prints;
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            prints.push_back (std::vector<unsigned char> (patterns[p].begin(), patterns[p].begin() + bytes));
+        }
+        std::sort (prints.begin(), prints.end());
+        prints.erase (std::unique (prints.begin(), prints.end()), prints.end());
+
+        m_teddyMasks.bytes = bytes;
+        memset (m_teddyMasks.lo, 0, sizeof m_teddyMasks.lo);
+        memset (m_teddyMasks.hi, 0, sizeof m_teddyMasks.hi);
+        for (size_t i = 0; i < prints.size(); ++i) {
+            const unsigned char bucket = static_cast<unsigned char> (1u << (i * 8 / prints.size()));
+            for (size_t f = 0; f < bytes; ++f) {
+                m_teddyMasks.lo[f][prints[i][f] & 0x0f] |= bucket;
+                m_teddyMasks.hi[f][prints[i][f] >> 4] |= bucket;
+            }
+        }
+    }
+
+    unsigned char           m_class [256];
+    size_t                  m_classes;
+    uint32_t                m_dense;        // states with a full row
+    uint32_t                m_denseCodes;   // codes of the sparse states start here
+    std::vector<uint32_t>   m_denseNext;    // [code + class], codes, flagged
+    std::vector<uint32_t>   m_edgeBegin;    // [state] into m_edges
+    std::vector<Edge>       m_edges;
+    std::vector<uint32_t>   m_fail;
+    std::vector<uint32_t>   m_dictionary;   // next state down the failure links with matches
+    std::vector<uint32_t>   m_outBegin;     // [state] into m_outIds
+    std::vector<uint32_t>   m_outIds;
+    std::vector<size_t>     m_lengths;      // [id], in chars
+    bool                    m_teddy;
+    TeddyMasks              m_teddyMasks;
+
+    // disable these...
+    BaseStrMatcher (const BaseStrMatcher<_CharT>& other);
+    BaseStrMatcher<_CharT>& operator= (const BaseStrMatcher<_CharT>& other);
+};
+
+typedef BaseStrMatcher<char>    FixedStrMatcher;
+typedef BaseStrMatcher<wchar_t> WFixedStrMatcher;
+
+#endif
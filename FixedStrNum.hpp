@@ -0,0 +1,120 @@
+#ifndef FIXED_STR_NUM_H
+#define FIXED_STR_NUM_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define FIXED_STR_HAS_TO_CHARS 1
+#endif
+#endif
+#endif
+
+/*
+ *  FixedStrNum
+ *  Number -> text conversion used by FixedStr::append(number) and fmt().
+ *
+ *  Unlike going through printf there's no format string to parse and the
+ *  length is known (or bounded) before anything is written, so callers can
+ *  put the result straight into the array or a single overflow allocation.
+ *
+ *  Integers use the usual two-digits-at-a-time table.  Doubles are written
+ *  in the shortest form that reads back exactly:  std::to_chars where the
+ *  library has it, otherwise the shortest of %.15g/%.16g/%.17g that round
+ *  trips (which, unlike to_chars, follows the C locale's decimal point).
+ */
+
+namespace {
+
+    // Longest anything below writes:  "-9223372036854775808" is 20,
+    // "-2.2250738585072014e-308" is 24.
+    enum { NUMBER_CHARS_MAX = 32 };
+
+    const char s_digitPairs[201] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    inline size_t countDigits (unsigned long long value) {
+        size_t digits = 1;
+        for (;;) {
+            if (value < 10)    return digits;
+            if (value < 100)   return digits + 1;
+            if (value < 1000)  return digits + 2;
+            if (value < 10000) return digits + 3;
+            value /= 10000;
+            digits += 4;
+        }
+    }
+
+    // Writes 'value' with no terminator; returns the count written.
+    template<typename _CharT>
+    inline size_t writeUnsigned (_CharT* out, unsigned long long value) {
+        const size_t digits = countDigits (value);
+        size_t pos = digits;
+        while (value >= 100) {
+            const char* pair = s_digitPairs + (value % 100) * 2;
+            value /= 100;
+            out[--pos] = pair[1];
+            out[--pos] = pair[0];
+        }
+        if (value >= 10) {
+            const char* pair = s_digitPairs + value * 2;
+            out[1] = pair[1];
+            out[0] = pair[0];
+        }
+        else {
+            out[0] = static_cast<_CharT> ('0' + value);
+        }
+        return digits;
+    }
+
+    template<typename _CharT>
+    inline size_t writeSigned (_CharT* out, long long value) {
+        if (value < 0) {
+            out[0] = '-';
+            // negate as unsigned; LLONG_MIN has no positive.
+            return 1 + writeUnsigned (out + 1, 0ULL - static_cast<unsigned long long> (value));
+        }
+        return writeUnsigned (out, static_cast<unsigned long long> (value));
+    }
+
+    // Shortest text that reads back as 'value'; "inf", "-inf", "nan" for those.
+    template<typename _CharT>
+    inline size_t writeDouble (_CharT* out, double value) {
+        char buff[NUMBER_CHARS_MAX];
+        size_t len;
+#ifdef FIXED_STR_HAS_TO_CHARS
+        std::to_chars_result res = std::to_chars (buff, buff + sizeof buff, value);
+        len = res.ptr - buff;
+#else
+        int res = 0;
+        for (int prec = 15; prec <= 17; ++prec) {
+            res = snprintf (buff, sizeof buff, "%.*g", prec, value);
+            if (prec == 17 || strtod (buff, NULL) == value) {
+                break;
+            }
+        }
+        len = res > 0 ? static_cast<size_t> (res) : 0;
+#endif
+        for (size_t i = 0; i < len; ++i) {
+            out[i] = buff[i];
+        }
+        return len;
+    }
+
+}
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef FIXED_STR_READER_H
+#define FIXED_STR_READER_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrReader
+ *  Reads a file a record (line) at a time, straight from its own buffer:
+ *  each record comes back as a view into the buffer, or copied once into
+ *  a FixedStr.  std::getline into a std::string, then assign() into a
+ *  FixedStr, copies every line twice and can allocate for each.
+ *
+ *      FixedStrReader in ("trades.csv");
+ *      FixedStr<128> line;
+ *      while (in.next (line)) {
+ *          ...
+ *      }
+ *
+ *  The file is read with read() (or fread() for a FILE*) into one big
+ *  buffer, 1MB by default, and the delimiters are found 64 bytes at a
+ *  time (SSE2) into a bitmask that's kept between records, so next() is
+ *  usually just a bit scan.  A record cut off at the end of the buffer is
+ *  moved to the front and the rest read in behind it; nothing is
+ *  allocated unless a single record is longer than the buffer, which
+ *  then doubles.
+ *
+ *  A view from next() is good until the next call.  The delimiter isn't
+ *  part of the record ('\r' of a "\r\n" is); a last record with no
+ *  delimiter after it is still returned.
+ *
+ *  Opened by path, the reader asks for sequential read-ahead
+ *  (posix_fadvise), and with DIRECT opens with O_DIRECT where there is
+ *  one, bypassing the page cache for files read once (if the file system
+ *  won't, it's opened normally).  Reads always go to page-aligned parts
+ *  of the buffer, as O_DIRECT needs.
+ */
+
+class FixedStrReader {
+public:
+    enum {
+        DEFAULT_BUFFER =    1 << 20,
+        DIRECT =            1           // open() flag:  O_DIRECT
+    };
+
+    // Throws std::runtime_error if the file can't be opened.
+    explicit FixedStrReader (const char* path, int flags = 0, size_t bufferSize = DEFAULT_BUFFER)
+        :
+        m_fd    (-1),
+        m_file  (NULL),
+        m_owned (true)
+    {
+        init (bufferSize);
+#if !defined(_WIN32)
+        int openFlags = O_RDONLY;
+#  if defined(O_DIRECT)
+        if (flags & DIRECT) {
+            m_fd = ::open (path, openFlags | O_DIRECT);
+        }
+#  endif
+        if (m_fd < 0) {
+            m_fd = ::open (path, openFlags);
+        }
+        if (m_fd < 0) {
+            release();
+            throw std::runtime_error (std::string ("FixedStrReader can't open ") + path);
+        }
+#  if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise (m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#  endif
+#else
+        (void) flags;
+        m_file = fopen (path, "rb");
+        if (m_file == NULL) {
+            release();
+            throw std::runtime_error (std::string ("FixedStrReader can't open ") + path);
+        }
+#endif
+    }
+
+#if !defined(_WIN32)
+    // Reads from 'fd', which is left open.
+    explicit FixedStrReader (int fd, size_t bufferSize = DEFAULT_BUFFER)
+        :
+        m_fd    (fd),
+        m_file  (NULL),
+        m_owned (false)
+    {
+        init (bufferSize);
+    }
+#endif
+
+    // Reads from 'file', which is left open.  Don't mix with other reads
+    // of the same FILE.
+    explicit FixedStrReader (FILE* file, size_t bufferSize = DEFAULT_BUFFER)
+        :
+        m_fd    (-1),
+        m_file  (file),
+        m_owned (false)
+    {
+        init (bufferSize);
+    }
+
+    ~FixedStrReader() {
+        if (m_owned) {
+#if !defined(_WIN32)
+            ::close (m_fd);
+#else
+            fclose (m_file);
+#endif
+        }
+        release();
+    }
+
+    // '\n' unless set.  Can be changed between records.
+    void delimiter (char delim) {
+        m_delim = static_cast<unsigned char> (delim);
+        scanFrom (m_begin);
+    }
+
+    // The next record, without its delimiter.  False at the end of the
+    // file.  Throws std::runtime_error if a read fails.
+    bool next (FixedStrView& record) {
+        for (;;) {
+            while (m_mask == 0 && m_scan + BLOCK < m_end) {
+                m_scan += BLOCK;
+                m_mask = blockMask (m_scan);
+            }
+            if (m_mask != 0) {
+                const size_t at = m_scan + lowestBit64 (m_mask);
+                m_mask &= m_mask - 1;
+                record = FixedStrView (m_buffer + m_begin, at - m_begin);
+                m_begin = at + 1;
+                ++m_records;
+                return true;
+            }
+            if (m_eof) {
+                if (m_begin == m_end) {
+                    return false;
+                }
+                record = FixedStrView (m_buffer + m_begin, m_end - m_begin);
+                m_begin = m_end;
+                ++m_records;
+                return true;
+            }
+            refill();
+        }
+    }
+
+    // The next record into 'str' (any FixedStr, or anything with
+    // assign (const char*, size_t)).
+    template<typename _StrT>
+    bool next (_StrT& str) {
+        FixedStrView record;
+        if (!next (record)) {
+            return false;
+        }
+        str.assign (record.data(), record.length());
+        return true;
+    }
+
+    // Records returned so far.
+    size_t records() const {
+        return m_records;
+    }
+
+private:
+    enum {
+        BLOCK =     64,         // bytes per delimiter mask
+        PAGE =      4096        // reads start on this boundary
+    };
+
+    void init (size_t bufferSize) {
+        m_capacity = bufferSize < 16 * PAGE ? 16 * PAGE : (bufferSize + PAGE - 1) / PAGE * PAGE;
+        allocate();
+        m_begin =   0;
+        m_end =     0;
+        m_scan =    0;
+        m_mask =    0;
+        m_delim =   '\n';
+        m_eof =     false;
+        m_records = 0;
+    }
+
+    // Page aligned, with a block spare at the end so a mask can be made
+    // of a partial block without reading past the allocation.
+    void allocate() {
+        m_alloc = static_cast<char*> (::operator new (m_capacity + PAGE + BLOCK));
+        m_buffer = m_alloc + (PAGE - reinterpret_cast<uintptr_t> (m_alloc) % PAGE) % PAGE;
+    }
+
+    void release() {
+        ::operator delete (m_alloc);
+        m_alloc = NULL;
+    }
+
+    uint64_t blockMask (size_t at) const {
+        uint64_t mask = byteMask64 (reinterpret_cast<const unsigned char*> (m_buffer + at), m_delim);
+        if (m_end - at < BLOCK) {
+            mask &= (static_cast<uint64_t> (1) << (m_end - at)) - 1;
+        }
+        return mask;
+    }
+
+    void scanFrom (size_t at) {
+        m_scan = at;
+        m_mask = at < m_end ? blockMask (at) : 0;
+    }
+
+    // No delimiter in [m_begin, m_end):  moves that to just before a page
+    // boundary and reads in after it.
+    void refill() {
+        const size_t partial = m_end - m_begin;
+        size_t readAt = (partial + PAGE - 1) / PAGE * PAGE;
+        if (readAt >= m_capacity) {
+            // one record as big as the buffer.
+            grow (readAt + PAGE);
+        }
+        const size_t start = readAt - partial;
+        if (start != m_begin && partial > 0) {
+            memmove (m_buffer + start, m_buffer + m_begin, partial);
+        }
+        m_begin = start;
+        m_end = readAt;
+
+        const size_t n = readSome (m_buffer + readAt, m_capacity - readAt);
+        if (n == 0) {
+            m_eof = true;
+        }
+        m_end += n;
+        // the partial record has been scanned already.
+        scanFrom (readAt);
+    }
+
+    void grow (size_t atLeast) {
+        char* oldAlloc = m_alloc;
+        char* oldBuffer = m_buffer;
+        while (m_capacity < atLeast) {
+            m_capacity *= 2;
+        }
+        allocate();
+        memcpy (m_buffer + m_begin, oldBuffer + m_begin, m_end - m_begin);
+        ::operator delete (oldAlloc);
+    }
+
+    size_t readSome (char* dest, size_t bytes) {
+        for (;;) {
+#if !defined(_WIN32)
+            if (m_fd >= 0) {
+                const ssize_t n = read (m_fd, dest, bytes);
+                if (n >= 0) {
+                    return static_cast<size_t> (n);
+                }
+                if (errno != EINTR) {
+                    throw std::runtime_error ("FixedStrReader read failed");
+                }
+                continue;
+            }
+#endif
+            const size_t n = fread (dest, 1, bytes, m_file);
+            if (n == 0 && ferror (m_file)) {
+                throw std::runtime_error ("FixedStrReader read failed");
+            }
+            return n;
+        }
+    }
+
+    int             m_fd;
+    FILE*           m_file;
+    bool            m_owned;
+    char*           m_alloc;        // as allocated
+    char*           m_buffer;       // page aligned, in m_alloc
+    size_t          m_capacity;
+    size_t          m_begin;        // start of the next record
+    size_t          m_end;          // end of what's been read
+    size_t          m_scan;         // block 'm_mask' is for
+    uint64_t        m_mask;         // delimiters in that block not yet returned
+    unsigned char   m_delim;
+    bool            m_eof;
+    size_t          m_records;
+
+    // disable these...
+    FixedStrReader (const FixedStrReader& other);
+    FixedStrReader& operator= (const FixedStrReader& other);
+};
+
+#endif
@@ -0,0 +1,1612 @@
+#ifndef FIXED_STR_SIMD_H
+#define FIXED_STR_SIMD_H
+
+#include <cstddef>
+#include <cstring>
+#include <wchar.h>
+#include <stdint.h>
+
+/*
+ *  FixedStrSimd
+ *  Vectorized kernels used by FixedStr.  Everything works on raw
+ *  (pointer, byte count) so the same code serves char and wchar_t and
+ *  nothing here is instantiated per _AllocSizeT.
+ *
+ *  SSE2 is used whenever the compiler targets it (always on x86-64).
+ *  AVX2 is used if the compiler targets it, or else picked at runtime on
+ *  gcc/clang when the CPU has it.  NEON on AArch64.  Define
+ *  FIXED_STR_NO_SIMD to get the plain scalar versions everywhere.
+ *
+ *  None of these read outside [p, p+n) except where noted.
+ *
+ *  The search kernels take the char type (char, wchar_t) and look at the
+ *  chars as 1, 2 or 4 byte lanes.
+ */
+
+#if !defined(FIXED_STR_NO_SIMD)
+#  if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define FIXED_STR_SSE2 1
+#  endif
+#  if defined(__AVX2__)
+#    include <immintrin.h>
+#    define FIXED_STR_AVX2 1
+#  elif defined(FIXED_STR_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    include <immintrin.h>
+#    define FIXED_STR_AVX2 1
+#    define FIXED_STR_AVX2_DISPATCH 1
+#  endif
+#  if defined(__SSSE3__)
+#    include <tmmintrin.h>
+#    define FIXED_STR_SSSE3 1
+#  elif defined(FIXED_STR_AVX2_DISPATCH)
+#    include <tmmintrin.h>
+#    define FIXED_STR_SSSE3 1
+#    define FIXED_STR_SSSE3_DISPATCH 1
+#  endif
+#  if defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define FIXED_STR_NEON 1
+#  endif
+#endif
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#if defined(FIXED_STR_AVX2_DISPATCH)
+#  define FIXED_STR_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#  define FIXED_STR_TARGET_AVX2
+#endif
+#if defined(FIXED_STR_SSSE3_DISPATCH)
+#  define FIXED_STR_TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#  define FIXED_STR_TARGET_SSSE3
+#endif
+
+namespace {
+
+    // Unaligned loads that don't break strict aliasing.  These compile
+    // down to a single mov.
+    inline uint64_t load64 (const unsigned char* p) {
+        uint64_t v;
+        memcpy (&v, p, sizeof v);
+        return v;
+    }
+
+    inline uint32_t load32 (const unsigned char* p) {
+        uint32_t v;
+        memcpy (&v, p, sizeof v);
+        return v;
+    }
+
+    inline uint16_t load16 (const unsigned char* p) {
+        uint16_t v;
+        memcpy (&v, p, sizeof v);
+        return v;
+    }
+
+    // Index of the lowest set bit.  'x' must be non zero.
+    inline unsigned int lowestBit (uint32_t x) {
+#if defined(__GNUC__)
+        return __builtin_ctz (x);
+#elif defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanForward (&idx, x);
+        return idx;
+#else
+        unsigned int idx = 0;
+        while (!(x & 1)) {
+            x >>= 1;
+            ++idx;
+        }
+        return idx;
+#endif
+    }
+
+    inline unsigned int lowestBit64 (uint64_t x) {
+#if defined(__GNUC__)
+        return __builtin_ctzll (x);
+#else
+        uint32_t lo = static_cast<uint32_t> (x);
+        return lo ? lowestBit (lo) : 32 + lowestBit (static_cast<uint32_t> (x >> 32));
+#endif
+    }
+
+    // Index of the highest set bit.  'x' must be non zero.
+    inline unsigned int highestBit64 (uint64_t x) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll (x);
+#else
+        unsigned int idx = 0;
+        while (x >>= 1) {
+            ++idx;
+        }
+        return idx;
+#endif
+    }
+
+    // Number of set bits.  Without a popcnt instruction the builtin is
+    // a library call, slower than doing it here.
+    inline unsigned int bitCount (uint32_t x) {
+#if defined(__GNUC__) && defined(__POPCNT__)
+        return __builtin_popcount (x);
+#else
+        x = x - ((x >> 1) & 0x55555555);
+        x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+        return (((x + (x >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+#endif
+    }
+
+    // Given the xor of two 8 byte loads (non zero), which byte in
+    // memory order is the first to differ.
+    inline size_t firstDiffByte (uint64_t x) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return __builtin_clzll (x) / 8;
+#else
+        return lowestBit64 (x) / 8;
+#endif
+    }
+
+    ////////////////////////
+    // Equality
+    ////////////////////////
+
+    // n <= 16.  Two overlapping loads of the widest size that fits, so
+    // there's no per-byte tail loop.
+    inline bool bytesEqualSmall (const unsigned char* a, const unsigned char* b, size_t n) {
+        if (n >= 8) {
+            return ((load64 (a) ^ load64 (b)) |
+                    (load64 (a + n - 8) ^ load64 (b + n - 8))) == 0;
+        }
+        if (n >= 4) {
+            return ((load32 (a) ^ load32 (b)) |
+                    (load32 (a + n - 4) ^ load32 (b + n - 4))) == 0;
+        }
+        if (n >= 2) {
+            return ((load16 (a) ^ load16 (b)) |
+                    (load16 (a + n - 2) ^ load16 (b + n - 2))) == 0;
+        }
+        return n == 0 || *a == *b;
+    }
+
+    // Word at a time; the fallback when there's no SIMD.
+    inline bool bytesEqualScalar (const void* lhs, const void* rhs, size_t n) {
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        while (n > 16) {
+            if (((load64 (a) ^ load64 (b)) | (load64 (a + 8) ^ load64 (b + 8))) != 0) {
+                return false;
+            }
+            a += 16;
+            b += 16;
+            n -= 16;
+        }
+        return bytesEqualSmall (a, b, n);
+    }
+
+#ifdef FIXED_STR_SSE2
+    inline bool eq16Sse2 (const unsigned char* a, const unsigned char* b) {
+        __m128i va = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (a));
+        __m128i vb = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (b));
+        return _mm_movemask_epi8 (_mm_cmpeq_epi8 (va, vb)) == 0xffff;
+    }
+
+    inline bool bytesEqualSse2 (const void* lhs, const void* rhs, size_t n) {
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        if (n < 16) {
+            return bytesEqualSmall (a, b, n);
+        }
+        const unsigned char* aLast = a + n - 16;
+        const unsigned char* bLast = b + n - 16;
+        while (a < aLast) {
+            if (!eq16Sse2 (a, b)) {
+                return false;
+            }
+            a += 16;
+            b += 16;
+        }
+        // last (possibly overlapping) block.
+        return eq16Sse2 (aLast, bLast);
+    }
+#endif
+
+#ifdef FIXED_STR_AVX2
+    FIXED_STR_TARGET_AVX2
+    inline bool bytesEqualAvx2 (const void* lhs, const void* rhs, size_t n) {
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        if (n < 32) {
+            return bytesEqualSse2 (a, b, n);
+        }
+        const unsigned char* aLast = a + n - 32;
+        const unsigned char* bLast = b + n - 32;
+        while (a < aLast) {
+            __m256i va = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (a));
+            __m256i vb = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (b));
+            if (static_cast<unsigned int> (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (va, vb))) != 0xffffffffu) {
+                return false;
+            }
+            a += 32;
+            b += 32;
+        }
+        __m256i va = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (aLast));
+        __m256i vb = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (bLast));
+        return static_cast<unsigned int> (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (va, vb))) == 0xffffffffu;
+    }
+#endif
+
+#ifdef FIXED_STR_NEON
+    inline bool eq16Neon (const unsigned char* a, const unsigned char* b) {
+        return vminvq_u8 (vceqq_u8 (vld1q_u8 (a), vld1q_u8 (b))) == 0xff;
+    }
+
+    inline bool bytesEqualNeon (const void* lhs, const void* rhs, size_t n) {
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        if (n < 16) {
+            return bytesEqualSmall (a, b, n);
+        }
+        const unsigned char* aLast = a + n - 16;
+        const unsigned char* bLast = b + n - 16;
+        while (a < aLast) {
+            if (!eq16Neon (a, b)) {
+                return false;
+            }
+            a += 16;
+            b += 16;
+        }
+        return eq16Neon (aLast, bLast);
+    }
+#endif
+
+    // Does the CPU we're running on have AVX2?  Only asked once.
+    inline bool cpuHasAvx2() {
+#if defined(FIXED_STR_AVX2_DISPATCH)
+        struct Check {
+            static bool run() {
+                // needed if we're first called from a static ctor.
+                __builtin_cpu_init();
+                return __builtin_cpu_supports ("avx2") != 0;
+            }
+        };
+        static const bool has = Check::run();
+        return has;
+#elif defined(FIXED_STR_AVX2)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // pshufb, for the few kernels that need a 16-byte table lookup.
+    inline bool cpuHasSsse3() {
+#if defined(FIXED_STR_SSSE3_DISPATCH)
+        struct Check {
+            static bool run() {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports ("ssse3") != 0;
+            }
+        };
+        static const bool has = Check::run();
+        return has;
+#elif defined(FIXED_STR_SSSE3)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Best kernel available without looking at the CPU.
+    inline bool bytesEqualBase (const void* lhs, const void* rhs, size_t n) {
+#if defined(FIXED_STR_SSE2)
+        return bytesEqualSse2 (lhs, rhs, n);
+#elif defined(FIXED_STR_NEON)
+        return bytesEqualNeon (lhs, rhs, n);
+#else
+        return bytesEqualScalar (lhs, rhs, n);
+#endif
+    }
+
+    // Equality of two byte ranges.  Short ranges (the usual case) stay
+    // inline; only long ones pay for the runtime dispatch.
+    inline bool bytesEqual (const void* lhs, const void* rhs, size_t n) {
+#if defined(FIXED_STR_AVX2)
+        if (n > 64 && cpuHasAvx2()) {
+            return bytesEqualAvx2 (lhs, rhs, n);
+        }
+#endif
+        return bytesEqualBase (lhs, rhs, n);
+    }
+
+    // Same as bytesEqual() but both ranges are known to sit at the start of
+    // buffers at least 'BuffBytes' long.  That lets short ranges be compared
+    // with one vector load each, masking off whatever follows the
+    // string (this reads past 'n' but never past the buffer).  With buffers
+    // up to 32 bytes no loop is ever needed.
+    template<size_t BuffBytes>
+    inline bool bufferBytesEqual (const void* lhs, const void* rhs, size_t n) {
+#if defined(FIXED_STR_SSE2)
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        if (BuffBytes >= 16 && n <= 16) {
+            __m128i va = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (a));
+            __m128i vb = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (b));
+            unsigned int diff = ~_mm_movemask_epi8 (_mm_cmpeq_epi8 (va, vb));
+            return (diff & ((1u << n) - 1)) == 0;
+        }
+        if (BuffBytes > 16 && BuffBytes <= 32) {
+            // 16 < n < 32; two overlapping loads.
+            return eq16Sse2 (a, b) && eq16Sse2 (a + n - 16, b + n - 16);
+        }
+#endif
+        return bytesEqual (lhs, rhs, n);
+    }
+
+    ////////////////////////
+    // Copying
+    ////////////////////////
+
+    // memcpy() for the many short copies of a string put together from
+    // pieces.  Up to 16 bytes is two overlapping loads and stores of the
+    // widest size that fits (no call, no tail loop); longer goes to memcpy.
+    // The ranges mustn't overlap.
+    inline void copyBytes (void* dst, const void* src, size_t n) {
+        unsigned char*       d = static_cast<unsigned char*> (dst);
+        const unsigned char* s = static_cast<const unsigned char*> (src);
+        if (n > 16) {
+            memcpy (d, s, n);
+        }
+        else if (n >= 8) {
+            uint64_t head = load64 (s);
+            uint64_t tail = load64 (s + n - 8);
+            memcpy (d, &head, 8);
+            memcpy (d + n - 8, &tail, 8);
+        }
+        else if (n >= 4) {
+            uint32_t head = load32 (s);
+            uint32_t tail = load32 (s + n - 4);
+            memcpy (d, &head, 4);
+            memcpy (d + n - 4, &tail, 4);
+        }
+        else if (n > 0) {
+            // 1-3:  first, middle, last (some the same).
+            unsigned char first = s[0];
+            unsigned char mid =   s[n / 2];
+            unsigned char last =  s[n - 1];
+            d[0] =     first;
+            d[n / 2] = mid;
+            d[n - 1] = last;
+        }
+    }
+
+    ////////////////////////
+    // First mismatch.  These return the byte offset of the first
+    // difference, or 'n' if the ranges are the same.
+    ////////////////////////
+
+    inline size_t bytesMismatchScalar (const void* lhs, const void* rhs, size_t n) {
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        if (n < 8) {
+            for (size_t i = 0; i < n; ++i) {
+                if (a[i] != b[i]) {
+                    return i;
+                }
+            }
+            return n;
+        }
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            uint64_t x = load64 (a + i) ^ load64 (b + i);
+            if (x) {
+                return i + firstDiffByte (x);
+            }
+        }
+        if (i < n) {
+            // last (overlapping) word.
+            i = n - 8;
+            uint64_t x = load64 (a + i) ^ load64 (b + i);
+            if (x) {
+                return i + firstDiffByte (x);
+            }
+        }
+        return n;
+    }
+
+#ifdef FIXED_STR_SSE2
+    // Bit per byte that differs.
+    inline unsigned int diff16Sse2 (const unsigned char* a, const unsigned char* b) {
+        __m128i va = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (a));
+        __m128i vb = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (b));
+        return _mm_movemask_epi8 (_mm_cmpeq_epi8 (va, vb)) ^ 0xffff;
+    }
+
+    inline size_t bytesMismatchSse2 (const void* lhs, const void* rhs, size_t n) {
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        if (n < 16) {
+            return bytesMismatchScalar (a, b, n);
+        }
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            unsigned int diff = diff16Sse2 (a + i, b + i);
+            if (diff) {
+                return i + lowestBit (diff);
+            }
+        }
+        if (i < n) {
+            i = n - 16;
+            unsigned int diff = diff16Sse2 (a + i, b + i);
+            if (diff) {
+                return i + lowestBit (diff);
+            }
+        }
+        return n;
+    }
+#endif
+
+#ifdef FIXED_STR_AVX2
+    FIXED_STR_TARGET_AVX2
+    inline uint32_t diff32Avx2 (const unsigned char* a, const unsigned char* b) {
+        __m256i va = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (a));
+        __m256i vb = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (b));
+        return ~static_cast<uint32_t> (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (va, vb)));
+    }
+
+    FIXED_STR_TARGET_AVX2
+    inline size_t bytesMismatchAvx2 (const void* lhs, const void* rhs, size_t n) {
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        if (n < 32) {
+            return bytesMismatchSse2 (a, b, n);
+        }
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            uint32_t diff = diff32Avx2 (a + i, b + i);
+            if (diff) {
+                return i + lowestBit (diff);
+            }
+        }
+        if (i < n) {
+            i = n - 32;
+            uint32_t diff = diff32Avx2 (a + i, b + i);
+            if (diff) {
+                return i + lowestBit (diff);
+            }
+        }
+        return n;
+    }
+#endif
+
+#ifdef FIXED_STR_NEON
+    // 4 bits per byte that differs.
+    inline uint64_t diff16Neon (const unsigned char* a, const unsigned char* b) {
+        uint8x16_t ne = vmvnq_u8 (vceqq_u8 (vld1q_u8 (a), vld1q_u8 (b)));
+        return vget_lane_u64 (vreinterpret_u64_u8 (vshrn_n_u16 (vreinterpretq_u16_u8 (ne), 4)), 0);
+    }
+
+    inline size_t bytesMismatchNeon (const void* lhs, const void* rhs, size_t n) {
+        const unsigned char* a = static_cast<const unsigned char*> (lhs);
+        const unsigned char* b = static_cast<const unsigned char*> (rhs);
+        if (n < 16) {
+            return bytesMismatchScalar (a, b, n);
+        }
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            uint64_t diff = diff16Neon (a + i, b + i);
+            if (diff) {
+                return i + lowestBit64 (diff) / 4;
+            }
+        }
+        if (i < n) {
+            i = n - 16;
+            uint64_t diff = diff16Neon (a + i, b + i);
+            if (diff) {
+                return i + lowestBit64 (diff) / 4;
+            }
+        }
+        return n;
+    }
+#endif
+
+    inline size_t bytesMismatch (const void* lhs, const void* rhs, size_t n) {
+#if defined(FIXED_STR_AVX2)
+        if (n > 64 && cpuHasAvx2()) {
+            return bytesMismatchAvx2 (lhs, rhs, n);
+        }
+#endif
+#if defined(FIXED_STR_SSE2)
+        return bytesMismatchSse2 (lhs, rhs, n);
+#elif defined(FIXED_STR_NEON)
+        return bytesMismatchNeon (lhs, rhs, n);
+#else
+        return bytesMismatchScalar (lhs, rhs, n);
+#endif
+    }
+
+    // As bufferBytesEqual():  both ranges start buffers at least
+    // 'BuffBytes' long, so short ones take one masked load.
+    template<size_t BuffBytes>
+    inline size_t bufferBytesMismatch (const void* lhs, const void* rhs, size_t n) {
+#if defined(FIXED_STR_SSE2)
+        if (BuffBytes >= 16 && n <= 16) {
+            const unsigned char* a = static_cast<const unsigned char*> (lhs);
+            const unsigned char* b = static_cast<const unsigned char*> (rhs);
+            unsigned int diff = diff16Sse2 (a, b) & ((1u << n) - 1);
+            return diff ? lowestBit (diff) : n;
+        }
+#endif
+        return bytesMismatch (lhs, rhs, n);
+    }
+
+    ////////////////////////
+    // Searching.  Lengths and positions are in chars; a kernel returns
+    // 'n' when there's nothing found.
+    ////////////////////////
+
+#ifdef FIXED_STR_SSE2
+    // Compares by char width.
+    template<size_t _WidthT> struct Sse2Lanes;
+
+    template<> struct Sse2Lanes<1> {
+        static __m128i splat (uint32_t v) { return _mm_set1_epi8 (static_cast<char> (v)); }
+        static __m128i eq (__m128i a, __m128i b) { return _mm_cmpeq_epi8 (a, b); }
+    };
+
+    template<> struct Sse2Lanes<2> {
+        static __m128i splat (uint32_t v) { return _mm_set1_epi16 (static_cast<short> (v)); }
+        static __m128i eq (__m128i a, __m128i b) { return _mm_cmpeq_epi16 (a, b); }
+    };
+
+    template<> struct Sse2Lanes<4> {
+        static __m128i splat (uint32_t v) { return _mm_set1_epi32 (static_cast<int> (v)); }
+        static __m128i eq (__m128i a, __m128i b) { return _mm_cmpeq_epi32 (a, b); }
+    };
+
+    // A bit per byte of the 16 at 'p', set for the bytes of each char
+    // equal to the one in 'v'.
+    template<typename _T>
+    inline unsigned int eqMask16 (const _T* p, __m128i v) {
+        __m128i x = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p));
+        return _mm_movemask_epi8 (Sse2Lanes<sizeof (_T)>::eq (x, v));
+    }
+
+    template<typename _T>
+    inline __m128i splatChar (_T ch) {
+        return Sse2Lanes<sizeof (_T)>::splat (static_cast<uint32_t> (ch));
+    }
+#endif
+
+#ifdef FIXED_STR_AVX2
+    template<size_t _WidthT> struct Avx2Lanes;
+
+    template<> struct Avx2Lanes<1> {
+        FIXED_STR_TARGET_AVX2 static __m256i splat (uint32_t v) { return _mm256_set1_epi8 (static_cast<char> (v)); }
+        FIXED_STR_TARGET_AVX2 static __m256i eq (__m256i a, __m256i b) { return _mm256_cmpeq_epi8 (a, b); }
+    };
+
+    template<> struct Avx2Lanes<2> {
+        FIXED_STR_TARGET_AVX2 static __m256i splat (uint32_t v) { return _mm256_set1_epi16 (static_cast<short> (v)); }
+        FIXED_STR_TARGET_AVX2 static __m256i eq (__m256i a, __m256i b) { return _mm256_cmpeq_epi16 (a, b); }
+    };
+
+    template<> struct Avx2Lanes<4> {
+        FIXED_STR_TARGET_AVX2 static __m256i splat (uint32_t v) { return _mm256_set1_epi32 (static_cast<int> (v)); }
+        FIXED_STR_TARGET_AVX2 static __m256i eq (__m256i a, __m256i b) { return _mm256_cmpeq_epi32 (a, b); }
+    };
+
+    template<typename _T>
+    FIXED_STR_TARGET_AVX2
+    inline uint32_t eqMask32 (const _T* p, __m256i v) {
+        __m256i x = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p));
+        return static_cast<uint32_t> (_mm256_movemask_epi8 (Avx2Lanes<sizeof (_T)>::eq (x, v)));
+    }
+
+    // From *pos, which is left where the blocks stopped; see findSeq().
+    template<typename _T>
+    FIXED_STR_TARGET_AVX2
+    inline size_t findSeqAvx2 (const _T* p, size_t n, const _T* needle, size_t k, size_t* pos) {
+        const size_t lanes = 32 / sizeof (_T);
+        const __m256i first = Avx2Lanes<sizeof (_T)>::splat (static_cast<uint32_t> (needle[0]));
+        const __m256i last =  Avx2Lanes<sizeof (_T)>::splat (static_cast<uint32_t> (needle[k - 1]));
+        size_t i = *pos;
+        for (; i + 2 * lanes + k - 1 <= n; i += 2 * lanes) {
+            const uint64_t mask = (eqMask32 (p + i, first) & eqMask32 (p + i + k - 1, last)) |
+                                  static_cast<uint64_t> (eqMask32 (p + i + lanes, first) &
+                                                         eqMask32 (p + i + lanes + k - 1, last)) << 32;
+            if (mask) {
+                break;
+            }
+        }
+        for (; i + lanes + k - 1 <= n; i += lanes) {
+            uint32_t mask = eqMask32 (p + i, first) & eqMask32 (p + i + k - 1, last);
+            while (mask) {
+                const unsigned int bit = lowestBit (mask);
+                const size_t at = i + bit / sizeof (_T);
+                if (bytesEqual (p + at + 1, needle + 1, (k - 2) * sizeof (_T))) {
+                    return at;
+                }
+                mask &= ~(((1u << sizeof (_T)) - 1) << bit);
+            }
+        }
+        *pos = i;
+        return n;
+    }
+
+    // Nibble tables, as in findAnyOf().
+    FIXED_STR_TARGET_AVX2
+    inline size_t findAnyOfAvx2 (const unsigned char* p, size_t n, const unsigned char* lowTable,
+                                 const unsigned char* highTable, size_t* tail) {
+        const __m256i low =   _mm256_broadcastsi128_si256 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (lowTable)));
+        const __m256i high =  _mm256_broadcastsi128_si256 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (highTable)));
+        const __m256i bits =  _mm256_setr_epi8 (1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const __m256i nibble = _mm256_set1_epi8 (0x0f);
+        const __m256i zero =   _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i x =  _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p + i));
+            __m256i lo = _mm256_and_si256 (x, nibble);
+            __m256i hi = _mm256_and_si256 (_mm256_srli_epi16 (x, 4), nibble);
+            // the low nibble's row, from the table for the high nibble's half.
+            __m256i row = _mm256_blendv_epi8 (_mm256_shuffle_epi8 (low, lo), _mm256_shuffle_epi8 (high, lo), x);
+            __m256i hit = _mm256_and_si256 (row, _mm256_shuffle_epi8 (bits, hi));
+            uint32_t mask = ~static_cast<uint32_t> (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (hit, zero)));
+            if (mask) {
+                return i + lowestBit (mask);
+            }
+        }
+        *tail = i;
+        return n;
+    }
+#endif
+
+    // memchr() / wmemchr(), which the C library already vectorizes (AVX2
+    // where there is one) but behind a call; short strings are done here.
+    inline size_t libcFindElem (const char* p, size_t n, char ch) {
+        const void* found = memchr (p, ch, n);
+        return found ? static_cast<const char*> (found) - p : n;
+    }
+
+    inline size_t libcFindElem (const wchar_t* p, size_t n, wchar_t ch) {
+        const wchar_t* found = wmemchr (p, ch, n);
+        return found ? found - p : n;
+    }
+
+    template<typename _T>
+    inline size_t findElem (const _T* p, size_t n, _T ch) {
+#if defined(FIXED_STR_SSE2)
+        const size_t lanes = 16 / sizeof (_T);
+        if (n >= lanes && n <= 4 * lanes) {
+            const __m128i v = splatChar (ch);
+            size_t i = 0;
+            for (; i + lanes <= n; i += lanes) {
+                unsigned int mask = eqMask16 (p + i, v);
+                if (mask) {
+                    return i + lowestBit (mask) / sizeof (_T);
+                }
+            }
+            if (i < n) {
+                // last (overlapping) block; what it repeats didn't match.
+                i = n - lanes;
+                unsigned int mask = eqMask16 (p + i, v);
+                if (mask) {
+                    return i + lowestBit (mask) / sizeof (_T);
+                }
+            }
+            return n;
+        }
+#endif
+        return libcFindElem (p, n, ch);
+    }
+
+    // Last 'ch' in p[0..n).
+    template<typename _T>
+    inline size_t rfindElem (const _T* p, size_t n, _T ch) {
+#if defined(FIXED_STR_SSE2)
+        const size_t lanes = 16 / sizeof (_T);
+        if (n >= lanes) {
+            const __m128i v = splatChar (ch);
+            size_t i = n;
+            for (; i >= lanes; i -= lanes) {
+                unsigned int mask = eqMask16 (p + i - lanes, v);
+                if (mask) {
+                    return i - lanes + highestBit64 (mask) / sizeof (_T);
+                }
+            }
+            if (i > 0) {
+                unsigned int mask = eqMask16 (p, v);
+                if (mask) {
+                    return highestBit64 (mask) / sizeof (_T);
+                }
+            }
+            return n;
+        }
+#endif
+        for (size_t i = n; i-- > 0; ) {
+            if (p[i] == ch) {
+                return i;
+            }
+        }
+        return n;
+    }
+
+    // First p[i..i+k) equal to needle[0..k), k >= 1.  While the first
+    // char of the needle is rare it's skipped to with findElem(); after a
+    // few false starts, candidates are where both the first and last
+    // chars match (Mula's "generic SIMD" filter), which rules out nearly
+    // every position with two compares per block.  What's left is checked
+    // with bytesEqual().
+    template<typename _T>
+    inline size_t findSeq (const _T* p, size_t n, const _T* needle, size_t k) {
+        if (k > n) {
+            return n;
+        }
+        if (k == 1) {
+            return findElem (p, n, needle[0]);
+        }
+        size_t i = 0;
+        for (int falseStarts = 0; falseStarts < 4; ++falseStarts) {
+            const size_t at = findElem (p + i, n - k + 1 - i, needle[0]);
+            if (at == n - k + 1 - i) {
+                return n;
+            }
+            i += at;
+            if (bytesEqual (p + i + 1, needle + 1, (k - 1) * sizeof (_T))) {
+                return i;
+            }
+            if (++i > n - k) {
+                return n;
+            }
+        }
+#if defined(FIXED_STR_AVX2)
+        if ((n - i) * sizeof (_T) > 64 && cpuHasAvx2()) {
+            const size_t at = findSeqAvx2 (p, n, needle, k, &i);
+            if (at != n) {
+                return at;
+            }
+        }
+#endif
+#if defined(FIXED_STR_SSE2)
+        const size_t lanes = 16 / sizeof (_T);
+        if (i + lanes + k - 1 <= n) {
+            const __m128i first = splatChar (needle[0]);
+            const __m128i last =  splatChar (needle[k - 1]);
+            for (; i + lanes + k - 1 <= n; i += lanes) {
+                unsigned int mask = eqMask16 (p + i, first) & eqMask16 (p + i + k - 1, last);
+                while (mask) {
+                    const unsigned int bit = lowestBit (mask);
+                    const size_t at = i + bit / sizeof (_T);
+                    if (bytesEqual (p + at + 1, needle + 1, (k - 2) * sizeof (_T))) {
+                        return at;
+                    }
+                    mask &= ~(((1u << sizeof (_T)) - 1) << bit);
+                }
+            }
+        }
+#endif
+        for (; i + k <= n; ++i) {
+            if (p[i] == needle[0] && p[i + k - 1] == needle[k - 1] &&
+                bytesEqual (p + i + 1, needle + 1, (k - 2) * sizeof (_T))) {
+                return i;
+            }
+        }
+        return n;
+    }
+
+    // Last p[i..i+k) equal to needle[0..k), k >= 1.
+    template<typename _T>
+    inline size_t rfindSeq (const _T* p, size_t n, const _T* needle, size_t k) {
+        if (k > n) {
+            return n;
+        }
+        size_t limit = n - k + 1;
+        while (limit > 0) {
+            const size_t at = rfindElem (p, limit, needle[0]);
+            if (at == limit) {
+                return n;
+            }
+            if (bytesEqual (p + at + 1, needle + 1, (k - 1) * sizeof (_T))) {
+                return at;
+            }
+            limit = at;
+        }
+        return n;
+    }
+
+    // First p[i] that's one of set[0..m).  A set of bytes is looked up in
+    // nibble tables with AVX2 (any size of set, 32 bytes a step):  each
+    // byte's low nibble picks a row, its high nibble a bit in the row.
+    // Otherwise small sets are a compare per member, bigger ones a bitmap
+    // (or, for wide chars outside it, a search of the set).
+    template<typename _T>
+    inline size_t findAnyOf (const _T* p, size_t n, const _T* set, size_t m) {
+        size_t i = 0;
+#if defined(FIXED_STR_AVX2)
+        if (sizeof (_T) == 1 && m > 2 && n > 32 && cpuHasAvx2()) {
+            unsigned char lowTable [16] = { 0 };
+            unsigned char highTable [16] = { 0 };
+            for (size_t s = 0; s < m; ++s) {
+                const unsigned char c = static_cast<unsigned char> (set[s]);
+                (c < 0x80 ? lowTable : highTable)[c & 0x0f] |= static_cast<unsigned char> (1u << ((c >> 4) & 7));
+            }
+            const size_t at = findAnyOfAvx2 (reinterpret_cast<const unsigned char*> (p), n,
+                                             lowTable, highTable, &i);
+            if (at != n) {
+                return at;
+            }
+        }
+#endif
+#if defined(FIXED_STR_SSE2)
+        const size_t lanes = 16 / sizeof (_T);
+        if (m <= 4 && n >= lanes) {
+            __m128i v [4];
+            for (size_t s = 0; s < m; ++s) {
+                v[s] = splatChar (set[s]);
+            }
+            for (; i + lanes <= n; i += lanes) {
+                unsigned int mask = 0;
+                for (size_t s = 0; s < m; ++s) {
+                    mask |= eqMask16 (p + i, v[s]);
+                }
+                if (mask) {
+                    return i + lowestBit (mask) / sizeof (_T);
+                }
+            }
+        }
+#endif
+        uint64_t bitmap [4] = { 0, 0, 0, 0 };
+        bool wide = false;
+        for (size_t s = 0; s < m; ++s) {
+            const uint32_t c = static_cast<uint32_t> (set[s]) & (sizeof (_T) == 4 ? 0xffffffffu : (1u << (8 * sizeof (_T))) - 1);
+            if (c < 256) {
+                bitmap[c >> 6] |= static_cast<uint64_t> (1) << (c & 63);
+            }
+            else {
+                wide = true;
+            }
+        }
+        for (; i < n; ++i) {
+            const uint32_t c = static_cast<uint32_t> (p[i]) & (sizeof (_T) == 4 ? 0xffffffffu : (1u << (8 * sizeof (_T))) - 1);
+            if (c < 256) {
+                if ((bitmap[c >> 6] >> (c & 63)) & 1) {
+                    return i;
+                }
+            }
+            else if (wide) {
+                for (size_t s = 0; s < m; ++s) {
+                    if (set[s] == p[i]) {
+                        return i;
+                    }
+                }
+            }
+        }
+        return n;
+    }
+
+    ////////////////////////
+    // ASCII case.  Only 'A'-'Z' and 'a'-'z' change; other bytes,
+    // including all of UTF-8's multibyte sequences, are left as they are.
+    ////////////////////////
+
+    // 0x80 in each byte of 'x' from 'first' to 'first' + 25 (a letter
+    // range).  No byte carries into the next:  the top bit is masked off
+    // before adding.
+    inline uint64_t asciiRange64 (uint64_t x, unsigned char first) {
+        const uint64_t ones = 0x0101010101010101ULL;
+        const uint64_t low7 = x & (0x7f * ones);
+        const uint64_t atLeastFirst = low7 + (0x80 - first) * ones;
+        const uint64_t pastLast =     low7 + (0x80 - first - 26) * ones;
+        return atLeastFirst & ~pastLast & ~x & (0x80 * ones);
+    }
+
+    // 'A'-'Z' to lower case in each byte of 'x'.
+    inline uint64_t asciiLower64 (uint64_t x) {
+        return x | (asciiRange64 (x, 'A') >> 2);
+    }
+
+    inline uint32_t asciiLower32 (uint32_t x) {
+        return static_cast<uint32_t> (asciiLower64 (x));
+    }
+
+#ifdef FIXED_STR_SSE2
+    // 0xff in each byte from 'first' to 'last' (both below 0x80).
+    inline __m128i byteRange (__m128i x, char first, char last) {
+        return _mm_and_si128 (_mm_cmpgt_epi8 (x, _mm_set1_epi8 (first - 1)),
+                              _mm_cmpgt_epi8 (_mm_set1_epi8 (last + 1), x));
+    }
+
+    inline __m128i asciiLower16 (__m128i x) {
+        return _mm_or_si128 (x, _mm_and_si128 (byteRange (x, 'A', 'Z'), _mm_set1_epi8 (0x20)));
+    }
+#endif
+
+    inline unsigned char asciiLower (unsigned char c) {
+        return static_cast<unsigned int> (c - 'A') < 26 ? static_cast<unsigned char> (c | 0x20) : c;
+    }
+
+    inline unsigned char asciiUpper (unsigned char c) {
+        return static_cast<unsigned int> (c - 'a') < 26 ? static_cast<unsigned char> (c & ~0x20) : c;
+    }
+
+    // p[0..n) to lower (or upper) case, in place.  The last block
+    // overlaps the one before rather than leave a tail; it's loaded
+    // first, so it isn't read back from a store just made.
+    inline void asciiConvert (unsigned char* p, size_t n, bool upper) {
+        const unsigned char first = upper ? 'a' : 'A';
+#if defined(FIXED_STR_SSE2)
+        if (n >= 16) {
+            const __m128i bit = _mm_set1_epi8 (0x20);
+            __m128i* lastAt = reinterpret_cast<__m128i*> (p + n - 16);
+            __m128i last = _mm_loadu_si128 (lastAt);
+            last = _mm_xor_si128 (last, _mm_and_si128 (byteRange (last, first, first + 25), bit));
+            for (size_t i = 0; i + 16 < n; i += 16) {
+                __m128i* q = reinterpret_cast<__m128i*> (p + i);
+                __m128i x = _mm_loadu_si128 (q);
+                _mm_storeu_si128 (q, _mm_xor_si128 (x, _mm_and_si128 (byteRange (x, first, first + 25), bit)));
+            }
+            _mm_storeu_si128 (lastAt, last);
+            return;
+        }
+#endif
+        if (n >= 8) {
+            uint64_t last = load64 (p + n - 8);
+            last ^= asciiRange64 (last, first) >> 2;
+            for (size_t i = 0; i + 8 < n; i += 8) {
+                uint64_t x = load64 (p + i);
+                x ^= asciiRange64 (x, first) >> 2;
+                memcpy (p + i, &x, sizeof x);
+            }
+            memcpy (p + n - 8, &last, sizeof last);
+            return;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            p[i] = upper ? asciiUpper (p[i]) : asciiLower (p[i]);
+        }
+    }
+
+    // First i where lhs[i] and rhs[i] differ ignoring ASCII case, or n.
+    // Like bytesEqual(), the last block overlaps the one before.
+    inline size_t asciiCaseMismatch (const unsigned char* lhs, const unsigned char* rhs, size_t n) {
+#if defined(FIXED_STR_SSE2)
+        if (n >= 16) {
+            for (size_t i = 0; ; i += 16) {
+                if (i + 16 > n) {
+                    i = n - 16;
+                }
+                __m128i a = asciiLower16 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (lhs + i)));
+                __m128i b = asciiLower16 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (rhs + i)));
+                unsigned int differ = ~_mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b)) & 0xffff;
+                if (differ) {
+                    return i + lowestBit (differ);
+                }
+                if (i + 16 == n) {
+                    return n;
+                }
+            }
+        }
+#endif
+        if (n >= 8) {
+            for (size_t i = 0; ; i += 8) {
+                if (i + 8 > n) {
+                    i = n - 8;
+                }
+                uint64_t differ = asciiLower64 (load64 (lhs + i)) ^ asciiLower64 (load64 (rhs + i));
+                if (differ) {
+                    return i + firstDiffByte (differ);
+                }
+                if (i + 8 == n) {
+                    return n;
+                }
+            }
+        }
+        if (n >= 4) {
+            uint64_t differ = asciiLower32 (load32 (lhs)) ^ asciiLower32 (load32 (rhs));
+            if (differ) {
+                return firstDiffByte (differ);
+            }
+            differ = asciiLower32 (load32 (lhs + n - 4)) ^ asciiLower32 (load32 (rhs + n - 4));
+            return differ ? n - 4 + firstDiffByte (differ) : n;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (asciiLower (lhs[i]) != asciiLower (rhs[i])) {
+                return i;
+            }
+        }
+        return n;
+    }
+
+    ////////////////////////
+    // UTF-8 (FixedStrUtf8).  Blocks of 16 that are ASCII, or only 1 and
+    // 2 byte chars, are done here whole; everything else is a char at a
+    // time over there.  A "unit" is a wchar_t:  2 bytes on Windows, 4
+    // elsewhere.
+    ////////////////////////
+
+    // A bit per byte of the 16 at 'p' that's 'first' (0x80 or over) or
+    // more.  Signed, those bytes are all negative and compare the same.
+    inline uint32_t bytesFrom16 (const unsigned char* p, unsigned char first) {
+#if defined(FIXED_STR_SSE2)
+        const __m128i x = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p));
+        const uint32_t high = _mm_movemask_epi8 (x);
+        if (first == 0x80) {
+            return high;
+        }
+        return high & _mm_movemask_epi8 (_mm_cmpgt_epi8 (x, _mm_set1_epi8 (static_cast<char> (first - 1))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < 16; ++i) {
+            mask |= static_cast<uint32_t> (p[i] >= first) << i;
+        }
+        return mask;
+#endif
+    }
+
+    // How many of the 16 bytes at 'p' are ASCII before the first that
+    // isn't:  16 if they all are.
+    inline size_t asciiPrefix16 (const unsigned char* p) {
+        const uint32_t high = bytesFrom16 (p, 0x80);
+        return high ? lowestBit (high) : 16;
+    }
+
+    // If the 16 bytes at 'p', after the first 'skip', are nothing but
+    // ASCII and whole 2 byte sequences (C2-DF then a continuation), how
+    // many bytes that is:  one less when the last is a lead, left for the
+    // next block.  'chars' gets the chars they make.  0 if there's
+    // anything else.  Latin, Greek, Cyrillic, Hebrew and Arabic text is
+    // all like that.  A 'skip' lets the end of a string be done with a
+    // block that overlaps the one before.
+    inline size_t utf8TwoByteBlock (const unsigned char* p, size_t skip, size_t& chars) {
+        const uint32_t high = bytesFrom16 (p, 0x80) >> skip;
+        const uint32_t leads = bytesFrom16 (p, 0xc0) >> skip;
+        if ((bytesFrom16 (p, 0xe0) >> skip) != 0 || (bytesFrom16 (p, 0xc2) >> skip) != leads) {
+            return 0;
+        }
+        // each lead has a continuation right after it, and nothing else does.
+        const uint32_t conts = high & ~leads;
+        if (((leads << 1) & (0xffff >> skip)) != conts) {
+            return 0;
+        }
+        const size_t width = 16 - skip;
+        const size_t len = (leads >> (width - 1)) & 1 ? width - 1 : width;
+        chars = len - bitCount (conts);
+        return len;
+    }
+
+    // Decodes a block utf8TwoByteBlock() would pass (and the input has
+    // been checked) to 'out', moving it past what's written.  Returns the
+    // bytes used, the same as utf8TwoByteBlock().  The chars are worked
+    // out side by side, then copied out skipping continuations, so
+    // nothing waits on the byte before.
+    template<typename _UnitT>
+    inline size_t utf8TwoByteDecode16 (_UnitT*& out, const unsigned char* in, size_t skip) {
+        uint16_t chars[16];
+#if defined(FIXED_STR_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i x = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (in));
+        const __m128i next = _mm_srli_si128 (x, 1);
+        const __m128i halves[2][2] = {
+            { _mm_unpacklo_epi8 (x, zero), _mm_unpacklo_epi8 (next, zero) },
+            { _mm_unpackhi_epi8 (x, zero), _mm_unpackhi_epi8 (next, zero) }
+        };
+        for (int h = 0; h < 2; ++h) {
+            const __m128i lead = _mm_cmpgt_epi16 (halves[h][0], _mm_set1_epi16 (0xbf));
+            const __m128i pair = _mm_or_si128 (_mm_slli_epi16 (_mm_and_si128 (halves[h][0], _mm_set1_epi16 (0x1f)), 6),
+                                               _mm_and_si128 (halves[h][1], _mm_set1_epi16 (0x3f)));
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (chars + 8 * h),
+                              _mm_or_si128 (_mm_and_si128 (lead, pair), _mm_andnot_si128 (lead, halves[h][0])));
+        }
+#else
+        for (size_t i = 0; i < 16; ++i) {
+            chars[i] = in[i] >= 0xc0 && i < 15 ? ((in[i] & 0x1f) << 6) | (in[i + 1] & 0x3f) : in[i];
+        }
+#endif
+        const uint32_t high = bytesFrom16 (in, 0x80);
+        const uint32_t leads = bytesFrom16 (in, 0xc0);
+        const size_t end = leads & 0x8000 ? 15 : 16;
+        uint32_t keep = ~(high & ~leads) & ((1u << end) - 1) & ~((1u << skip) - 1);
+        while (keep) {
+            *out++ = static_cast<_UnitT> (chars[lowestBit (keep)]);
+            keep &= keep - 1;
+        }
+        return end - skip;
+    }
+
+    // Encodes the 16 units at 'in' after the first 'skip', all below
+    // U+0800, to 'out' as UTF-8, moving it past what's written.  Like
+    // utf8TwoByteDecode16(), the bytes are worked out side by side first;
+    // each char but the last is then stored as 2 bytes, the second
+    // written over by the next char if it's just the one.
+    template<typename _UnitT>
+    inline void utf8TwoByteEncode16 (unsigned char*& out, const _UnitT* in, size_t skip) {
+        uint16_t pairs[16];
+        uint32_t two;
+#if defined(FIXED_STR_SSE2)
+        const __m128i* p = reinterpret_cast<const __m128i*> (in);
+        __m128i units[2];
+        if (sizeof (_UnitT) == 2) {
+            units[0] = _mm_loadu_si128 (p);
+            units[1] = _mm_loadu_si128 (p + 1);
+        }
+        else {
+            units[0] = _mm_packs_epi32 (_mm_loadu_si128 (p),     _mm_loadu_si128 (p + 1));
+            units[1] = _mm_packs_epi32 (_mm_loadu_si128 (p + 2), _mm_loadu_si128 (p + 3));
+        }
+        __m128i ascii[2];
+        for (int h = 0; h < 2; ++h) {
+            const __m128i u = units[h];
+            ascii[h] = _mm_cmpgt_epi16 (_mm_set1_epi16 (0x80), u);
+            const __m128i lead = _mm_or_si128 (_mm_srli_epi16 (u, 6), _mm_set1_epi16 (0xc0));
+            const __m128i first = _mm_or_si128 (_mm_and_si128 (ascii[h], u), _mm_andnot_si128 (ascii[h], lead));
+            const __m128i second = _mm_or_si128 (_mm_and_si128 (u, _mm_set1_epi16 (0x3f)), _mm_set1_epi16 (0x80));
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (pairs + 8 * h), _mm_or_si128 (first, _mm_slli_epi16 (second, 8)));
+        }
+        two = ~_mm_movemask_epi8 (_mm_packs_epi16 (ascii[0], ascii[1])) & 0xffff;
+#else
+        two = 0;
+        for (size_t i = 0; i < 16; ++i) {
+            const uint32_t c = static_cast<uint32_t> (in[i]);
+            const uint32_t first = c < 0x80 ? c : 0xc0 | (c >> 6);
+            pairs[i] = static_cast<uint16_t> (first | ((0x80 | (c & 0x3f)) << 8));
+            two |= static_cast<uint32_t> (c >= 0x80) << i;
+        }
+#endif
+        for (size_t i = skip; i < 15; ++i) {
+            const uint16_t pair = pairs[i];
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            out[0] = static_cast<unsigned char> (pair);
+            out[1] = static_cast<unsigned char> (pair >> 8);
+#else
+            memcpy (out, &pair, 2);
+#endif
+            out += 1 + ((two >> i) & 1);
+        }
+        *out++ = static_cast<unsigned char> (pairs[15]);
+        if (two & 0x8000) {
+            *out++ = static_cast<unsigned char> (pairs[15] >> 8);
+        }
+    }
+
+    // The 16 bytes at 'in' as 16 units at 'out'.  Only the ASCII ones
+    // come out as anything useful; the caller writes over the rest.
+    template<typename _UnitT>
+    inline void widen16 (_UnitT* out, const unsigned char* in) {
+#if defined(FIXED_STR_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i x = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (in));
+        __m128i lo = _mm_unpacklo_epi8 (x, zero);
+        __m128i hi = _mm_unpackhi_epi8 (x, zero);
+        __m128i* q = reinterpret_cast<__m128i*> (out);
+        if (sizeof (_UnitT) == 2) {
+            _mm_storeu_si128 (q,     lo);
+            _mm_storeu_si128 (q + 1, hi);
+        }
+        else {
+            _mm_storeu_si128 (q,     _mm_unpacklo_epi16 (lo, zero));
+            _mm_storeu_si128 (q + 1, _mm_unpackhi_epi16 (lo, zero));
+            _mm_storeu_si128 (q + 2, _mm_unpacklo_epi16 (hi, zero));
+            _mm_storeu_si128 (q + 3, _mm_unpackhi_epi16 (hi, zero));
+        }
+#else
+        for (size_t i = 0; i < 16; ++i) {
+            out[i] = in[i];
+        }
+#endif
+    }
+
+    // A bit per unit of the 16 at 'in' that's below 'limit' (a power of
+    // two).  Negative ones aren't.
+    template<typename _UnitT>
+    inline uint32_t unitsBelow16 (const _UnitT* in, uint32_t limit) {
+#if defined(FIXED_STR_SSE2)
+        const __m128i* p = reinterpret_cast<const __m128i*> (in);
+        const __m128i zero = _mm_setzero_si128();
+        __m128i below;
+        if (sizeof (_UnitT) == 2) {
+            const __m128i high = _mm_set1_epi16 (static_cast<short> (~(limit - 1)));
+            below = _mm_packs_epi16 (_mm_cmpeq_epi16 (_mm_and_si128 (_mm_loadu_si128 (p), high), zero),
+                                     _mm_cmpeq_epi16 (_mm_and_si128 (_mm_loadu_si128 (p + 1), high), zero));
+        }
+        else {
+            const __m128i high = _mm_set1_epi32 (static_cast<int> (~(limit - 1)));
+            below = _mm_packs_epi16 (_mm_packs_epi32 (_mm_cmpeq_epi32 (_mm_and_si128 (_mm_loadu_si128 (p), high), zero),
+                                                      _mm_cmpeq_epi32 (_mm_and_si128 (_mm_loadu_si128 (p + 1), high), zero)),
+                                     _mm_packs_epi32 (_mm_cmpeq_epi32 (_mm_and_si128 (_mm_loadu_si128 (p + 2), high), zero),
+                                                      _mm_cmpeq_epi32 (_mm_and_si128 (_mm_loadu_si128 (p + 3), high), zero)));
+        }
+        return _mm_movemask_epi8 (below);
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < 16; ++i) {
+            mask |= static_cast<uint32_t> (static_cast<uint32_t> (in[i]) < limit) << i;
+        }
+        return mask;
+#endif
+    }
+
+    // The 16 units at 'in' as bytes at 'out'.  Like widen16(), only the
+    // ASCII ones mean anything.
+    template<typename _UnitT>
+    inline void narrow16 (unsigned char* out, const _UnitT* in) {
+#if defined(FIXED_STR_SSE2)
+        const __m128i* p = reinterpret_cast<const __m128i*> (in);
+        __m128i packed;
+        if (sizeof (_UnitT) == 2) {
+            packed = _mm_packus_epi16 (_mm_loadu_si128 (p), _mm_loadu_si128 (p + 1));
+        }
+        else {
+            packed = _mm_packus_epi16 (_mm_packs_epi32 (_mm_loadu_si128 (p),     _mm_loadu_si128 (p + 1)),
+                                       _mm_packs_epi32 (_mm_loadu_si128 (p + 2), _mm_loadu_si128 (p + 3)));
+        }
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (out), packed);
+#else
+        for (size_t i = 0; i < 16; ++i) {
+            out[i] = static_cast<unsigned char> (in[i]);
+        }
+#endif
+    }
+
+    // Units the (valid) UTF-8 at 'in' decodes to, without decoding it:
+    // one per byte that isn't a continuation (10xxxxxx), plus one for
+    // each 4 byte lead (11110xxx) when it takes a surrogate pair.
+    template<typename _UnitT>
+    inline size_t utf8Units (const unsigned char* in, size_t n) {
+        size_t units = 0;
+        size_t i = 0;
+#if defined(FIXED_STR_SSE2)
+        for (; i + 16 <= n; i += 16) {
+            __m128i x = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (in + i));
+            // as signed, continuation bytes are -128 to -65, 4 byte leads -16 up.
+            units += bitCount (_mm_movemask_epi8 (_mm_cmpgt_epi8 (x, _mm_set1_epi8 (-65))));
+            if (sizeof (_UnitT) == 2) {
+                units += bitCount (_mm_movemask_epi8 (x) &
+                                   _mm_movemask_epi8 (_mm_cmpgt_epi8 (x, _mm_set1_epi8 (-17))));
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            units += (in[i] & 0xc0) != 0x80;
+            if (sizeof (_UnitT) == 2) {
+                units += in[i] >= 0xf0;
+            }
+        }
+        return units;
+    }
+
+    ////////////////////////
+    // Digits (FixedStrParse).  8 ASCII digits are checked and made into a
+    // number with a few multiplies on one 64-bit word; 16 with SSE2.
+    // Wide chars are narrowed to bytes first, in a way that nothing but an
+    // ASCII digit can end up as one.
+    ////////////////////////
+
+    // The 8 chars at 'p' as bytes in a word, first char lowest.
+    inline uint64_t digitBytes8 (const char* p) {
+        uint64_t x = load64 (reinterpret_cast<const unsigned char*> (p));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        x = __builtin_bswap64 (x);
+#endif
+        return x;
+    }
+
+    template<typename _CharT>
+    inline uint64_t digitBytes8 (const _CharT* p) {
+        uint64_t x = 0;
+#if defined(FIXED_STR_SSE2)
+        // saturating packs:  anything past 0x7f ends up not a digit.
+        const __m128i* q = reinterpret_cast<const __m128i*> (p);
+        __m128i bytes = _mm_loadu_si128 (q);
+        if (sizeof (_CharT) == 4) {
+            bytes = _mm_packs_epi32 (bytes, _mm_loadu_si128 (q + 1));
+        }
+        _mm_storel_epi64 (reinterpret_cast<__m128i*> (&x), _mm_packus_epi16 (bytes, bytes));
+#else
+        for (size_t i = 0; i < 8; ++i) {
+            const uint32_t c = static_cast<uint32_t> (p[i]);
+            x |= static_cast<uint64_t> (c < 0x80 ? c : 0xff) << (8 * i);
+        }
+#endif
+        return x;
+    }
+
+    // Whether all 8 bytes of 'x' are '0'-'9'.
+    inline bool allDigits8 (uint64_t x) {
+        return ((x & 0xf0f0f0f0f0f0f0f0ULL) |
+                (((x + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4)) == 0x3333333333333333ULL;
+    }
+
+    // The 8 digits in 'x' (allDigits8()) as a number:  pairs, then
+    // fours, then the eight, each step one multiply.
+    inline uint32_t digits8 (uint64_t x) {
+        x -= 0x3030303030303030ULL;
+        x = x * 10 + (x >> 8);
+        x = ((x & 0x000000ff000000ffULL) * 0x000f424000000064ULL +
+             ((x >> 16) & 0x000000ff000000ffULL) * 0x0000271000000001ULL) >> 32;
+        return static_cast<uint32_t> (x);
+    }
+
+#if defined(FIXED_STR_SSE2)
+    // The 16 chars at 'p' as bytes.
+    inline __m128i digitBytes16 (const char* p) {
+        return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p));
+    }
+
+    template<typename _CharT>
+    inline __m128i digitBytes16 (const _CharT* p) {
+        const __m128i* q = reinterpret_cast<const __m128i*> (p);
+        if (sizeof (_CharT) == 2) {
+            return _mm_packus_epi16 (_mm_loadu_si128 (q), _mm_loadu_si128 (q + 1));
+        }
+        return _mm_packus_epi16 (_mm_packs_epi32 (_mm_loadu_si128 (q),     _mm_loadu_si128 (q + 1)),
+                                 _mm_packs_epi32 (_mm_loadu_si128 (q + 2), _mm_loadu_si128 (q + 3)));
+    }
+
+    // If the 16 bytes of 'x' are all digits, them as a number in 'value':
+    // pairs with a 16-bit multiply, then fours and eights with madd.
+    inline bool digits16 (__m128i x, uint64_t& value) {
+        const __m128i nine = _mm_set1_epi8 (9);
+        const __m128i t = _mm_sub_epi8 (x, _mm_set1_epi8 ('0'));
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_max_epu8 (t, nine), nine)) != 0xffff) {
+            return false;
+        }
+        const __m128i pairs = _mm_add_epi16 (_mm_mullo_epi16 (_mm_and_si128 (t, _mm_set1_epi16 (0xff)), _mm_set1_epi16 (10)),
+                                             _mm_srli_epi16 (t, 8));
+        const __m128i fours = _mm_madd_epi16 (pairs, _mm_set1_epi32 (0x00010064));
+        const __m128i eights = _mm_madd_epi16 (_mm_packs_epi32 (fours, fours), _mm_set1_epi32 (0x00012710));
+        value = static_cast<uint64_t> (_mm_cvtsi128_si32 (eights)) * 100000000 +
+                static_cast<uint32_t> (_mm_cvtsi128_si32 (_mm_srli_si128 (eights, 4)));
+        return true;
+    }
+#endif
+
+    ////////////////////////
+    // Hash table control bytes (FixedStrMap).  A group is 16 of them,
+    // one per slot:  0..127 is a full slot holding 7 bits of its key's
+    // hash, CTRL_EMPTY and CTRL_DELETED have the top bit set.  Each of
+    // these returns a bit per byte of the group, lowest bit first byte.
+    ////////////////////////
+
+    enum {
+        CTRL_EMPTY =    0x80,
+        CTRL_DELETED =  0xfe,
+        CTRL_GROUP =    16
+    };
+
+    // The top bit of each of the 8 bytes, packed into 8 bits.
+    inline uint32_t topBits64 (uint64_t x) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        x = __builtin_bswap64 (x);
+#endif
+        x = (x >> 7) & 0x0101010101010101ULL;
+        return static_cast<uint32_t> ((x * 0x0102040810204080ULL) >> 56);
+    }
+
+    inline uint32_t groupMatchScalar (const unsigned char* ctrl, unsigned char b) {
+        const uint64_t lows = 0x7f7f7f7f7f7f7f7fULL;
+        uint32_t mask = 0;
+        for (size_t half = 0; half < CTRL_GROUP; half += 8) {
+            uint64_t x = load64 (ctrl + half) ^ (0x0101010101010101ULL * b);
+            // top bit set in exactly the zero bytes (no borrow between bytes).
+            uint64_t zero = ~(((x & lows) + lows) | x | lows);
+            mask |= topBits64 (zero) << half;
+        }
+        return mask;
+    }
+
+    // Slots with this byte.
+    inline uint32_t groupMatch (const unsigned char* ctrl, unsigned char b) {
+#if defined(FIXED_STR_SSE2)
+        __m128i group = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (ctrl));
+        return _mm_movemask_epi8 (_mm_cmpeq_epi8 (group, _mm_set1_epi8 (static_cast<char> (b))));
+#else
+        return groupMatchScalar (ctrl, b);
+#endif
+    }
+
+    // Slots that are empty or deleted, i.e. free to insert into.
+    inline uint32_t groupMatchFree (const unsigned char* ctrl) {
+#if defined(FIXED_STR_SSE2)
+        return _mm_movemask_epi8 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (ctrl)));
+#else
+        return topBits64 (load64 (ctrl)) | (topBits64 (load64 (ctrl + 8)) << 8);
+#endif
+    }
+
+    ////////////////////////
+    // Column scans (FixedStrArray).
+    ////////////////////////
+
+    // A bit per element of p[0..16) with lo <= p[i] <= hi.
+    inline uint32_t blockInRange32 (const uint32_t* p, uint32_t lo, uint32_t hi) {
+        const uint32_t width = hi - lo;
+#if defined(FIXED_STR_SSE2)
+        // unsigned (x - lo) <= width, as a signed compare with the top bits
+        // flipped (SSE2 has no unsigned compare).
+        const __m128i sign = _mm_set1_epi32 (static_cast<int> (0x80000000u));
+        const __m128i vlo =  _mm_set1_epi32 (static_cast<int> (lo));
+        const __m128i vmax = _mm_set1_epi32 (static_cast<int> (width ^ 0x80000000u));
+        uint32_t misses = 0;
+        for (size_t i = 0; i < 16; i += 4) {
+            __m128i x = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p + i));
+            x = _mm_xor_si128 (_mm_sub_epi32 (x, vlo), sign);
+            misses |= static_cast<uint32_t> (_mm_movemask_ps (_mm_castsi128_ps (_mm_cmpgt_epi32 (x, vmax)))) << i;
+        }
+        return misses ^ 0xffff;
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < 16; ++i) {
+            mask |= static_cast<uint32_t> (p[i] - lo <= width) << i;
+        }
+        return mask;
+#endif
+    }
+
+    ////////////////////////
+    // Delimiter scan (FixedStrReader).
+    ////////////////////////
+
+    // A bit per byte of p[0..64) equal to 'b', lowest bit first byte.
+    inline uint64_t byteMask64 (const unsigned char* p, unsigned char b) {
+#if defined(FIXED_STR_SSE2)
+        const __m128i v = _mm_set1_epi8 (static_cast<char> (b));
+        uint64_t mask = 0;
+        for (size_t i = 0; i < 64; i += 16) {
+            __m128i x = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p + i));
+            mask |= static_cast<uint64_t> (_mm_movemask_epi8 (_mm_cmpeq_epi8 (x, v))) << i;
+        }
+        return mask;
+#else
+        const uint64_t lows = 0x7f7f7f7f7f7f7f7fULL;
+        uint64_t mask = 0;
+        for (size_t i = 0; i < 64; i += 8) {
+            uint64_t x = load64 (p + i) ^ (0x0101010101010101ULL * b);
+            uint64_t zero = ~(((x & lows) + lows) | x | lows);
+            mask |= static_cast<uint64_t> (topBits64 (zero)) << i;
+        }
+        return mask;
+#endif
+    }
+
+    ////////////////////////
+    // Multi-pattern prefilter (FixedStrMatcher).  "Teddy", from Intel's
+    // Hyperscan:  the first 1-3 bytes of each pattern, its fingerprint,
+    // go in one of 8 buckets, and per fingerprint byte there are two
+    // 16-entry tables, for the low and high nibble, of the buckets with
+    // that nibble there.  A position is a candidate if some bucket's bit
+    // survives ANDing the tables for the bytes from there on.
+    ////////////////////////
+
+    struct TeddyMasks {
+        unsigned char   lo [3][16];
+        unsigned char   hi [3][16];
+        size_t          bytes;          // fingerprint length, 1-3
+    };
+
+    inline bool teddyAt (const unsigned char* p, const TeddyMasks& masks) {
+        unsigned int buckets = 0xff;
+        for (size_t f = 0; f < masks.bytes; ++f) {
+            buckets &= masks.lo[f][p[f] & 0x0f] & masks.hi[f][p[f] >> 4];
+        }
+        return buckets != 0;
+    }
+
+#ifdef FIXED_STR_AVX2
+    // First candidate in p[0..n), or where the 32-byte steps stopped.
+    FIXED_STR_TARGET_AVX2
+    inline size_t teddyAvx2 (const unsigned char* p, size_t n, const TeddyMasks& masks) {
+        const __m256i nibble = _mm256_set1_epi8 (0x0f);
+        const __m256i zero =   _mm256_setzero_si256();
+        __m256i lo [3];
+        __m256i hi [3];
+        for (size_t f = 0; f < masks.bytes; ++f) {
+            lo[f] = _mm256_broadcastsi128_si256 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (masks.lo[f])));
+            hi[f] = _mm256_broadcastsi128_si256 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (masks.hi[f])));
+        }
+        size_t i = 0;
+        for (; i + 32 + masks.bytes - 1 <= n; i += 32) {
+            __m256i buckets = _mm256_set1_epi8 (-1);
+            for (size_t f = 0; f < masks.bytes; ++f) {
+                __m256i x = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p + i + f));
+                buckets = _mm256_and_si256 (buckets, _mm256_and_si256 (
+                              _mm256_shuffle_epi8 (lo[f], _mm256_and_si256 (x, nibble)),
+                              _mm256_shuffle_epi8 (hi[f], _mm256_and_si256 (_mm256_srli_epi16 (x, 4), nibble))));
+            }
+            uint32_t mask = ~static_cast<uint32_t> (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (buckets, zero)));
+            if (mask) {
+                return i + lowestBit (mask);
+            }
+        }
+        return i;
+    }
+#endif
+
+#ifdef FIXED_STR_SSSE3
+    // 16 bytes a step, for CPUs with pshufb but not AVX2 (and the tail
+    // AVX2 leaves).
+    FIXED_STR_TARGET_SSSE3
+    inline size_t teddySsse3 (const unsigned char* p, size_t n, const TeddyMasks& masks) {
+        const __m128i nibble = _mm_set1_epi8 (0x0f);
+        const __m128i zero =   _mm_setzero_si128();
+        __m128i lo [3];
+        __m128i hi [3];
+        for (size_t f = 0; f < masks.bytes; ++f) {
+            lo[f] = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (masks.lo[f]));
+            hi[f] = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (masks.hi[f]));
+        }
+        size_t i = 0;
+        for (; i + 16 + masks.bytes - 1 <= n; i += 16) {
+            __m128i buckets = _mm_set1_epi8 (-1);
+            for (size_t f = 0; f < masks.bytes; ++f) {
+                __m128i x = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p + i + f));
+                buckets = _mm_and_si128 (buckets, _mm_and_si128 (
+                              _mm_shuffle_epi8 (lo[f], _mm_and_si128 (x, nibble)),
+                              _mm_shuffle_epi8 (hi[f], _mm_and_si128 (_mm_srli_epi16 (x, 4), nibble))));
+            }
+            unsigned int mask = ~static_cast<unsigned int> (_mm_movemask_epi8 (_mm_cmpeq_epi8 (buckets, zero))) & 0xffff;
+            if (mask) {
+                return i + lowestBit (mask);
+            }
+        }
+        return i;
+    }
+#endif
+
+#ifdef FIXED_STR_NEON
+    // The same with tbl.
+    inline size_t teddyNeon (const unsigned char* p, size_t n, const TeddyMasks& masks) {
+        const uint8x16_t nibble = vdupq_n_u8 (0x0f);
+        uint8x16_t lo [3];
+        uint8x16_t hi [3];
+        for (size_t f = 0; f < masks.bytes; ++f) {
+            lo[f] = vld1q_u8 (masks.lo[f]);
+            hi[f] = vld1q_u8 (masks.hi[f]);
+        }
+        size_t i = 0;
+        for (; i + 16 + masks.bytes - 1 <= n; i += 16) {
+            uint8x16_t buckets = vdupq_n_u8 (0xff);
+            for (size_t f = 0; f < masks.bytes; ++f) {
+                uint8x16_t x = vld1q_u8 (p + i + f);
+                buckets = vandq_u8 (buckets, vandq_u8 (vqtbl1q_u8 (lo[f], vandq_u8 (x, nibble)),
+                                                       vqtbl1q_u8 (hi[f], vshrq_n_u8 (x, 4))));
+            }
+            // 4 bits per byte with a bucket left.
+            uint64_t mask = vget_lane_u64 (vreinterpret_u64_u8 (
+                                vshrn_n_u16 (vreinterpretq_u16_u8 (vtstq_u8 (buckets, buckets)), 4)), 0);
+            if (mask) {
+                return i + lowestBit64 (mask) / 4;
+            }
+        }
+        return i;
+    }
+#endif
+
+    // First position in p[0..n) where a pattern could start:  a
+    // candidate, or one too near the end to tell (n if there's none).
+    inline size_t teddyFind (const unsigned char* p, size_t n, const TeddyMasks& masks) {
+        size_t i = 0;
+#if defined(FIXED_STR_AVX2)
+        if (cpuHasAvx2()) {
+            i = teddyAvx2 (p, n, masks);
+        }
+#endif
+#if defined(FIXED_STR_SSSE3)
+        if (cpuHasSsse3()) {
+            i += teddySsse3 (p + i, n - i, masks);
+        }
+#elif defined(FIXED_STR_NEON)
+        i += teddyNeon (p + i, n - i, masks);
+#endif
+        for (; i + masks.bytes <= n; ++i) {
+            if (teddyAt (p + i, masks)) {
+                return i;
+            }
+        }
+        return i;
+    }
+
+} // blank namespace
+
+#endif
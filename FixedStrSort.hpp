@@ -0,0 +1,448 @@
+#ifndef FIXED_STR_SORT_H
+#define FIXED_STR_SORT_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrSort
+ *  sort_strings() / unique_strings() for big ranges of FixedStr (any
+ *  size, char or wchar_t), in the same order as operator<:
+ *
+ *      sort_strings (keys.begin(), keys.end());
+ *      keys.erase (unique_strings (keys.begin(), keys.end()), keys.end());
+ *
+ *  Instead of O(n log n) compares through std::sort, it's an MSD radix
+ *  sort:  one pass per byte position, each string's byte counted into one
+ *  of 257 buckets (ended, then byte values), so shared prefixes are gone
+ *  through once per bucket rather than once per compare.  Buckets under
+ *  RADIX_MIN strings go to a multikey quicksort, and that to insertion
+ *  sort for the last few.
+ *
+ *  The sort works on a separate array of (pointer, length, index)
+ *  entries, so the strings themselves aren't moved until the end, when
+ *  they're moved out in order to a buffer and back.  The pointer is
+ *  c_str():  into the FixedStr's own array unless it has spilled.  Each
+ *  entry also carries 8 bytes of its key, so the string is only read once
+ *  every 8 byte positions.  Strings are limited to 4G characters.
+ *
+ *  With more than one thread (default:  all cores) the first pass is split
+ *  across the threads, and after that each bucket is a task in a shared
+ *  pool:  big ones are split again and their buckets put back for idle
+ *  threads, small ones are finished by whoever took them.
+ *
+ *  Characters compare as in compare():  plain char as unsigned, wchar_t
+ *  as wchar_t (signed on most Unix).  Not stable.
+ */
+
+template<typename _CharT>
+class BaseStrSorter {
+public:
+    enum {
+        RADIX_MIN =     128,        // smaller buckets go to quicksort
+        INSERTION_MAX = 12,         // and smaller than this to insertion sort
+        TASK_MIN =      1 << 15     // buckets worth splitting again in parallel
+    };
+
+    // Sorts [first, last), which can be any random access range of things
+    // with c_str() and length() (FixedStr, WFixedStr, HashedFixedStr).
+    // 'threads' 0 means all cores.
+    template<typename _IterT>
+    static void sort (_IterT first, _IterT last, size_t threads = 0) {
+        const size_t n = last - first;
+        if (n < 2) {
+            return;
+        }
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        if (threads == 0 || n < TASK_MIN) {
+            threads = 1;
+        }
+
+        std::vector<Entry> entries (n);
+        for (size_t i = 0; i < n; ++i) {
+            entries[i].str =        first[i].c_str();
+            entries[i].len =        static_cast<uint32_t> (first[i].length());
+            entries[i].cacheDepth = NO_CACHE;
+            entries[i].idx =        i;
+        }
+        {
+            std::vector<Entry>          tmp (n);
+            std::vector<unsigned short> digits (n);
+            Context ctx = { &entries[0], &tmp[0], &digits[0] };
+            if (threads == 1) {
+                sortRange (ctx, 0, n, 0);
+            }
+            else {
+                sortParallel (ctx, n, threads);
+            }
+        }
+        permute (first, entries);
+    }
+
+private:
+    typedef typename CompareAs<_CharT>::type                    OrderT;
+    typedef typename std::make_unsigned<_CharT>::type           UnsignedT;
+
+    enum { NO_CACHE = 0x80000000 };
+
+    // 32 bytes on 64-bit.  'cache' holds the 8 key bytes from 'cacheDepth'
+    // on, so each pass doesn't go back to the string (likely a cache miss,
+    // once entries are no longer in the strings' order).
+    struct Entry {
+        const _CharT*   str;
+        uint32_t        len;
+        uint32_t        cacheDepth;
+        uint64_t        cache;
+        size_t          idx;
+    };
+
+    // The entry array, where buckets are scattered to, and each entry's
+    // digit for the pass in progress (so the string is read once a pass).
+    struct Context {
+        Entry*          entries;
+        Entry*          tmp;
+        unsigned short* digits;
+    };
+
+    struct Task {
+        size_t  begin;
+        size_t  n;
+        size_t  depth;
+    };
+
+    // Byte 'depth' of the key, plus 1; 0 once the string has ended.
+    static unsigned int digit (Entry& e, size_t depth) {
+        if (depth / sizeof (_CharT) >= e.len) {
+            return 0;
+        }
+        uint32_t rel = static_cast<uint32_t> (depth) - e.cacheDepth;
+        if (rel >= 8) {
+            fillCache (e, depth);
+            rel = 0;
+        }
+        return static_cast<unsigned int> ((e.cache >> (56 - 8 * rel)) & 0xff) + 1;
+    }
+
+    // The key is the chars as order-preserving big-endian numbers:  signed
+    // chars get their sign bit flipped so negative ones come first.
+    static void fillCache (Entry& e, size_t depth) {
+        uint64_t cache = 0;
+        for (size_t i = depth; i < depth + 8; ++i) {
+            unsigned int byte = 0;
+            const size_t pos = i / sizeof (_CharT);
+            if (pos < e.len) {
+                UnsignedT ch = static_cast<UnsignedT> (e.str[pos]);
+                if (static_cast<OrderT> (-1) < static_cast<OrderT> (0)) {
+                    ch ^= static_cast<UnsignedT> (static_cast<UnsignedT> (1) << (sizeof (_CharT) * 8 - 1));
+                }
+                byte = (ch >> (8 * (sizeof (_CharT) - 1 - i % sizeof (_CharT)))) & 0xff;
+            }
+            cache = (cache << 8) | byte;
+        }
+        e.cache = cache;
+        e.cacheDepth = static_cast<uint32_t> (depth);
+    }
+
+    // Everything in [begin, begin + n) agrees on the first 'depth' bytes.
+    static void sortRange (const Context& ctx, size_t begin, size_t n, size_t depth) {
+        size_t counts [257];
+        while (n >= RADIX_MIN) {
+            radixPass (ctx, begin, n, depth, counts);
+            // bucket 0 has ended:  all equal, nothing more to do.
+            size_t at = begin + counts[0];
+            size_t biggest = 0;
+            size_t biggestAt = 0;
+            for (size_t d = 1; d < 257; ++d) {
+                if (counts[d] > biggest) {
+                    if (biggest > 1) {
+                        sortRange (ctx, biggestAt, biggest, depth + 1);
+                    }
+                    biggest = counts[d];
+                    biggestAt = at;
+                }
+                else if (counts[d] > 1) {
+                    sortRange (ctx, at, counts[d], depth + 1);
+                }
+                at += counts[d];
+            }
+            // loop on the biggest rather than recursing, which bounds the
+            // stack.
+            begin = biggestAt;
+            n = biggest;
+            ++depth;
+        }
+        multikeyQuicksort (ctx.entries + begin, n, depth);
+    }
+
+    // Distributes [begin, begin + n) by digit at 'depth'.  'counts' gets
+    // the size of each bucket.
+    static void radixPass (const Context& ctx, size_t begin, size_t n, size_t depth, size_t* counts) {
+        Entry*          entries = ctx.entries + begin;
+        unsigned short* digits =  ctx.digits + begin;
+        memset (counts, 0, 257 * sizeof (size_t));
+        for (size_t i = 0; i < n; ++i) {
+            digits[i] = static_cast<unsigned short> (digit (entries[i], depth));
+            ++counts[digits[i]];
+        }
+        // all in one bucket (a shared prefix):  nothing to move.
+        if (counts[digits[0]] == n) {
+            return;
+        }
+        size_t offsets [257];
+        size_t at = 0;
+        for (size_t d = 0; d < 257; ++d) {
+            offsets[d] = at;
+            at += counts[d];
+        }
+        Entry* tmp = ctx.tmp + begin;
+        for (size_t i = 0; i < n; ++i) {
+            tmp[offsets[digits[i]]++] = entries[i];
+        }
+        memcpy (entries, tmp, n * sizeof (Entry));
+    }
+
+    // Bentley & Sedgewick:  3-way partition on one byte, then the equal
+    // part moves on to the next byte.
+    static void multikeyQuicksort (Entry* a, size_t n, size_t depth) {
+        while (n > INSERTION_MAX) {
+            // median of three.
+            unsigned int x = digit (a[0], depth);
+            unsigned int y = digit (a[n / 2], depth);
+            unsigned int z = digit (a[n - 1], depth);
+            const unsigned int pivot = std::max (std::min (x, y), std::min (std::max (x, y), z));
+
+            size_t lt = 0;
+            size_t gt = n;
+            size_t i = 0;
+            while (i < gt) {
+                const unsigned int d = digit (a[i], depth);
+                if (d < pivot) {
+                    std::swap (a[lt++], a[i++]);
+                }
+                else if (d > pivot) {
+                    std::swap (a[i], a[--gt]);
+                }
+                else {
+                    ++i;
+                }
+            }
+            multikeyQuicksort (a, lt, depth);
+            if (pivot != 0) {
+                multikeyQuicksort (a + lt, gt - lt, depth + 1);
+            }
+            a += gt;
+            n -= gt;
+        }
+        insertionSort (a, n, depth / sizeof (_CharT));
+    }
+
+    // All agree on the first 'skip' characters.
+    static void insertionSort (Entry* a, size_t n, size_t skip) {
+        for (size_t i = 1; i < n; ++i) {
+            Entry e = a[i];
+            size_t j = i;
+            while (j > 0 && less (e, a[j - 1], skip)) {
+                a[j] = a[j - 1];
+                --j;
+            }
+            a[j] = e;
+        }
+    }
+
+    static bool less (const Entry& lhs, const Entry& rhs, size_t skip) {
+        return compareImpl<_CharT, OrderT> (lhs.str + skip, lhs.len - skip,
+                                            rhs.str + skip, rhs.len - skip) < 0;
+    }
+
+    ////////////////
+    // Threads.
+    ////////////////
+
+    struct Pool {
+        std::mutex              mutex;
+        std::condition_variable wake;
+        std::vector<Task>       tasks;
+        size_t                  busy;
+    };
+
+    static void sortParallel (const Context& ctx, size_t n, size_t threads) {
+        size_t counts [257];
+        firstPassParallel (ctx, n, threads, counts);
+
+        Pool pool;
+        pool.busy = 0;
+        size_t at = counts[0];
+        for (size_t d = 1; d < 257; ++d) {
+            if (counts[d] > 1) {
+                Task task = { at, counts[d], 1 };
+                pool.tasks.push_back (task);
+            }
+            at += counts[d];
+        }
+        // biggest last, so they're taken first.
+        std::sort (pool.tasks.begin(), pool.tasks.end(), smallerTask);
+
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t) {
+            workers.push_back (std::thread (work, std::cref (ctx), std::ref (pool)));
+        }
+        work (ctx, pool);
+        for (size_t t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+    }
+
+    static bool smallerTask (const Task& lhs, const Task& rhs) {
+        return lhs.n < rhs.n;
+    }
+
+    static void work (const Context& ctx, Pool& pool) {
+        std::unique_lock<std::mutex> lock (pool.mutex);
+        for (;;) {
+            while (pool.tasks.empty() && pool.busy > 0) {
+                pool.wake.wait (lock);
+            }
+            if (pool.tasks.empty()) {
+                // nothing left, and nobody working who could add more.
+                pool.wake.notify_all();
+                return;
+            }
+            Task task = pool.tasks.back();
+            pool.tasks.pop_back();
+            ++pool.busy;
+            lock.unlock();
+
+            if (task.n >= TASK_MIN) {
+                // split and put the buckets back for whoever's free.
+                size_t counts [257];
+                radixPass (ctx, task.begin, task.n, task.depth, counts);
+                std::vector<Task> more;
+                size_t at = task.begin + counts[0];
+                for (size_t d = 1; d < 257; ++d) {
+                    if (counts[d] > 1) {
+                        Task sub = { at, counts[d], task.depth + 1 };
+                        more.push_back (sub);
+                    }
+                    at += counts[d];
+                }
+                lock.lock();
+                pool.tasks.insert (pool.tasks.end(), more.begin(), more.end());
+                pool.wake.notify_all();
+            }
+            else {
+                sortRange (ctx, task.begin, task.n, task.depth);
+                lock.lock();
+            }
+            --pool.busy;
+            if (pool.busy == 0 && pool.tasks.empty()) {
+                pool.wake.notify_all();
+            }
+        }
+    }
+
+    // The first pass over everything, split across the threads:  each
+    // counts its slice, then scatters it to its own offsets in each bucket.
+    static void firstPassParallel (const Context& ctx, size_t n, size_t threads, size_t* counts) {
+        std::vector<size_t> sliceCounts (threads * 257, 0);
+        const size_t slice = (n + threads - 1) / threads;
+
+        runSlices (threads, [&] (size_t t) {
+            const size_t begin = t * slice;
+            const size_t end = std::min (n, begin + slice);
+            size_t* mine = &sliceCounts[t * 257];
+            for (size_t i = begin; i < end; ++i) {
+                ctx.digits[i] = static_cast<unsigned short> (digit (ctx.entries[i], 0));
+                ++mine[ctx.digits[i]];
+            }
+        });
+
+        std::vector<size_t> offsets (threads * 257);
+        size_t at = 0;
+        for (size_t d = 0; d < 257; ++d) {
+            counts[d] = 0;
+            for (size_t t = 0; t < threads; ++t) {
+                offsets[t * 257 + d] = at;
+                at += sliceCounts[t * 257 + d];
+                counts[d] += sliceCounts[t * 257 + d];
+            }
+        }
+
+        runSlices (threads, [&] (size_t t) {
+            const size_t begin = t * slice;
+            const size_t end = std::min (n, begin + slice);
+            size_t* mine = &offsets[t * 257];
+            for (size_t i = begin; i < end; ++i) {
+                ctx.tmp[mine[ctx.digits[i]]++] = ctx.entries[i];
+            }
+        });
+        runSlices (threads, [&] (size_t t) {
+            const size_t begin = t * slice;
+            const size_t end = std::min (n, begin + slice);
+            if (begin < end) {
+                memcpy (ctx.entries + begin, ctx.tmp + begin, (end - begin) * sizeof (Entry));
+            }
+        });
+    }
+
+    template<typename _FnT>
+    static void runSlices (size_t threads, const _FnT& fn) {
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t) {
+            workers.push_back (std::thread (fn, t));
+        }
+        fn (0);
+        for (size_t t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+    }
+
+    // Moves the strings into sorted order:  out to a buffer in order,
+    // then back.  Move construction is cheaper than following the cycles
+    // with move assignment (and the writes are in order both ways).
+    template<typename _IterT>
+    static void permute (_IterT first, const std::vector<Entry>& entries) {
+        typedef typename std::iterator_traits<_IterT>::value_type ValueT;
+        const size_t n = entries.size();
+        ValueT* sorted = static_cast<ValueT*> (::operator new (n * sizeof (ValueT)));
+        for (size_t i = 0; i < n; ++i) {
+            new (&sorted[i]) ValueT (std::move (first[entries[i].idx]));
+        }
+        for (size_t i = 0; i < n; ++i) {
+            first[i] = std::move (sorted[i]);
+            sorted[i].~ValueT();
+        }
+        ::operator delete (sorted);
+    }
+};
+
+// Sorts [first, last) of FixedStrs into operator< order, on 'threads'
+// threads (0:  all cores).
+template<typename _IterT>
+void sort_strings (_IterT first, _IterT last, size_t threads = 0) {
+    typedef typename std::remove_const<typename std::remove_pointer<
+        decltype (first->c_str())>::type>::type CharT;
+    BaseStrSorter<CharT>::sort (first, last, threads);
+}
+
+// sort_strings() then drops repeats, like std::unique:  returns the new
+// end, and what's after it is left moved-from.
+template<typename _IterT>
+_IterT unique_strings (_IterT first, _IterT last, size_t threads = 0) {
+    sort_strings (first, last, threads);
+    return std::unique (first, last);
+}
+
+#endif
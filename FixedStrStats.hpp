@@ -0,0 +1,383 @@
+#ifndef FIXED_STR_STATS_H
+#define FIXED_STR_STATS_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+/*
+ *  FixedStrStats
+ *  Optional instrumentation for picking _AllocSizeT from real data.
+ *
+ *  Compile everything with FIXED_STR_STATS defined (it has to be the same
+ *  for the whole program) and FixedStr's assign/append/format record, per
+ *  _AllocSizeT and char type:  operation counts, how many results ended up
+ *  in the overflow, spills (array -> overflow), reallocations (overflow ->
+ *  bigger overflow), bytes allocated and a histogram of resulting lengths.
+ *  Without FIXED_STR_STATS none of this is compiled in.
+ *
+ *  Counters live in per-thread shards that only their own thread writes, so
+ *  recording is a few relaxed loads and stores with no locking or shared
+ *  cache lines.  snapshot() merges all the shards (and those of threads that
+ *  have exited); dump() prints something like
+ *
+ *      FixedStr<32>: 7.0% spill, p99 length 41, recommend 48 (...)
+ */
+
+// One _AllocSizeT / char type combination, as returned by snapshot().
+struct FixedStrTypeStats {
+    // Lengths 0..255 get their own bucket, longer ones a bucket per
+    // power of 2.
+    enum { EXACT_BUCKETS = 256, BUCKETS = EXACT_BUCKETS + 24 };
+
+    size_t      allocSize;
+    size_t      charSize;
+
+    uint64_t    assigns;
+    uint64_t    appends;
+    uint64_t    formats;
+    // operations whose result was in the overflow.
+    uint64_t    overflowOps;
+    // array -> overflow.
+    uint64_t    spills;
+    // overflow replaced by a new one.
+    uint64_t    reallocs;
+    uint64_t    bytesAllocated;
+    uint64_t    lengths[BUCKETS];
+
+    uint64_t ops() const {
+        return assigns + appends + formats;
+    }
+
+    // % of operations whose result didn't fit in the array.
+    double spillPercent() const {
+        return ops() ? 100.0 * overflowOps / ops() : 0;
+    }
+
+    // Upper bound of the length at 'pct' percent.
+    size_t lengthPercentile (double pct) const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            total += lengths[i];
+        }
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t want = static_cast<uint64_t> (pct / 100.0 * total + 0.5);
+        if (want == 0) {
+            want = 1;
+        }
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += lengths[i];
+            if (seen >= want) {
+                return bucketMax (i);
+            }
+        }
+        return bucketMax (BUCKETS - 1);
+    }
+
+    // Smallest multiple of 8 covering the p99 length.
+    size_t recommendedAlloc() const {
+        size_t p99 = lengthPercentile (99);
+        return p99 == 0 ? 8 : (p99 + 7) / 8 * 8;
+    }
+
+    static size_t bucketFor (size_t len) {
+        if (len < EXACT_BUCKETS) {
+            return len;
+        }
+        size_t bucket = EXACT_BUCKETS;
+        len >>= 9;
+        while (len && bucket < BUCKETS - 1) {
+            len >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    static size_t bucketMax (size_t bucket) {
+        if (bucket < EXACT_BUCKETS) {
+            return bucket;
+        }
+        // bucket 256 holds 256..511, 257 holds 512..1023, ...
+        return (static_cast<size_t> (EXACT_BUCKETS) << (bucket - EXACT_BUCKETS + 1)) - 1;
+    }
+};
+
+class FixedStrStats {
+public:
+    enum OpKind {
+        ASSIGN,
+        APPEND,
+        FORMAT
+    };
+
+    // Called by FixedStr's helpers after each operation.
+    //   alloc:          _AllocSizeT
+    //   newLen:         resulting length
+    //   wasOverflow:    overflow used before the operation
+    //   isOverflow:     overflow used after
+    //   bytesAllocated: size of any new overflow block, else 0
+    static void record (OpKind kind, size_t alloc, size_t charSize, size_t newLen,
+                        bool wasOverflow, bool isOverflow, size_t bytesAllocated) {
+        Counters* c = threadShard().find (alloc, charSize);
+        if (!c) {
+            return;
+        }
+        bump (c->ops[kind]);
+        bump (c->lengths[FixedStrTypeStats::bucketFor (newLen)]);
+        if (isOverflow) {
+            bump (c->overflowOps);
+            if (!wasOverflow) {
+                bump (c->spills);
+            }
+        }
+        if (bytesAllocated) {
+            if (wasOverflow) {
+                bump (c->reallocs);
+            }
+            bump (c->bytesAllocated, bytesAllocated);
+        }
+    }
+
+    // Totals so far across all threads, ordered by char size then alloc.
+    static std::vector<FixedStrTypeStats> snapshot() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock (reg.mutex);
+        std::vector<FixedStrTypeStats> toRet (reg.retired);
+        for (size_t i = 0; i < reg.shards.size(); ++i) {
+            reg.shards[i]->mergeInto (toRet);
+        }
+        sortStats (toRet);
+        return toRet;
+    }
+
+    // Zeroes everything.  Counts recorded by other threads while this
+    // runs may be lost.
+    static void reset() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock (reg.mutex);
+        reg.retired.clear();
+        for (size_t i = 0; i < reg.shards.size(); ++i) {
+            reg.shards[i]->zero();
+        }
+    }
+
+    // One line per type with a suggested _AllocSizeT.
+    static void dump (FILE* out) {
+        std::vector<FixedStrTypeStats> stats = snapshot();
+        for (size_t i = 0; i < stats.size(); ++i) {
+            const FixedStrTypeStats& s = stats[i];
+            fprintf (out, "%s<%lu>: %.1f%% spill, p50 length %lu, p99 length %lu, recommend %lu "
+                     "(ops %llu, spills %llu, reallocs %llu, bytes %llu)\n",
+                     s.charSize == 1 ? "FixedStr" : "WFixedStr",
+                     static_cast<unsigned long> (s.allocSize),
+                     s.spillPercent(),
+                     static_cast<unsigned long> (s.lengthPercentile (50)),
+                     static_cast<unsigned long> (s.lengthPercentile (99)),
+                     static_cast<unsigned long> (s.recommendedAlloc()),
+                     static_cast<unsigned long long> (s.ops()),
+                     static_cast<unsigned long long> (s.spills),
+                     static_cast<unsigned long long> (s.reallocs),
+                     static_cast<unsigned long long> (s.bytesAllocated));
+        }
+    }
+
+private:
+    typedef std::atomic<uint64_t> Counter;
+
+    // Only ever written by the owning thread, so a relaxed load and store
+    // is enough (and much cheaper than fetch_add).
+    static void bump (Counter& c, uint64_t by = 1) {
+        c.store (c.load (std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    struct Counters {
+        size_t      allocSize;
+        size_t      charSize;
+        Counter     ops[3];
+        Counter     overflowOps;
+        Counter     spills;
+        Counter     reallocs;
+        Counter     bytesAllocated;
+        Counter     lengths[FixedStrTypeStats::BUCKETS];
+    };
+
+    enum { MAX_TYPES = 256 };
+
+    class Shard;
+
+    struct Registry {
+        std::mutex                      mutex;
+        std::vector<Shard*>             shards;
+        // from threads that have exited.
+        std::vector<FixedStrTypeStats>  retired;
+    };
+
+    class Shard {
+    public:
+        Shard()
+            :
+            m_count (0),
+            m_last  (NULL),
+            m_registered (false) {
+        }
+
+        ~Shard() {
+            if (m_registered) {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock (reg.mutex);
+                mergeInto (reg.retired);
+                for (size_t i = 0; i < reg.shards.size(); ++i) {
+                    if (reg.shards[i] == this) {
+                        reg.shards.erase (reg.shards.begin() + i);
+                        break;
+                    }
+                }
+            }
+            size_t count = m_count.load (std::memory_order_relaxed);
+            for (size_t i = 0; i < count; ++i) {
+                m_types[i]->~Counters();
+                free (m_types[i]);
+            }
+        }
+
+        Counters* find (size_t alloc, size_t charSize) {
+            if (m_last && m_last->allocSize == alloc && m_last->charSize == charSize) {
+                return m_last;
+            }
+            size_t count = m_count.load (std::memory_order_relaxed);
+            for (size_t i = 0; i < count; ++i) {
+                Counters* c = m_types[i];
+                if (c->allocSize == alloc && c->charSize == charSize) {
+                    m_last = c;
+                    return c;
+                }
+            }
+            if (count == MAX_TYPES) {
+                return NULL;
+            }
+            if (!m_registered) {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock (reg.mutex);
+                reg.shards.push_back (this);
+                m_registered = true;
+            }
+            // calloc rather than new:  don't show up in the program's own
+            // heap accounting.
+            void* mem = calloc (1, sizeof (Counters));
+            if (!mem) {
+                return NULL;
+            }
+            Counters* c = new (mem) Counters();
+            c->allocSize = alloc;
+            c->charSize =  charSize;
+            zeroCounters (*c);
+            m_types[count] = c;
+            // publish to snapshot().
+            m_count.store (count + 1, std::memory_order_release);
+            m_last = c;
+            return c;
+        }
+
+        // Caller holds the registry lock.
+        void mergeInto (std::vector<FixedStrTypeStats>& stats) const {
+            size_t count = m_count.load (std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i) {
+                const Counters& c = *m_types[i];
+                FixedStrTypeStats& s = statsFor (stats, c.allocSize, c.charSize);
+                s.assigns +=        c.ops[ASSIGN].load (std::memory_order_relaxed);
+                s.appends +=        c.ops[APPEND].load (std::memory_order_relaxed);
+                s.formats +=        c.ops[FORMAT].load (std::memory_order_relaxed);
+                s.overflowOps +=    c.overflowOps.load (std::memory_order_relaxed);
+                s.spills +=         c.spills.load (std::memory_order_relaxed);
+                s.reallocs +=       c.reallocs.load (std::memory_order_relaxed);
+                s.bytesAllocated += c.bytesAllocated.load (std::memory_order_relaxed);
+                for (size_t b = 0; b < FixedStrTypeStats::BUCKETS; ++b) {
+                    s.lengths[b] += c.lengths[b].load (std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Caller holds the registry lock.
+        void zero() {
+            size_t count = m_count.load (std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i) {
+                zeroCounters (*m_types[i]);
+            }
+        }
+
+    private:
+        Counters*           m_types[MAX_TYPES];
+        std::atomic<size_t> m_count;
+        // last one found; most threads hammer one or two types.
+        Counters*           m_last;
+        bool                m_registered;
+
+        // disable these...
+        Shard(const Shard& other);
+        Shard& operator=(const Shard& other);
+    };
+
+    static void zeroCounters (Counters& c) {
+        for (size_t i = 0; i < 3; ++i) {
+            c.ops[i].store (0, std::memory_order_relaxed);
+        }
+        c.overflowOps.store (0, std::memory_order_relaxed);
+        c.spills.store (0, std::memory_order_relaxed);
+        c.reallocs.store (0, std::memory_order_relaxed);
+        c.bytesAllocated.store (0, std::memory_order_relaxed);
+        for (size_t b = 0; b < FixedStrTypeStats::BUCKETS; ++b) {
+            c.lengths[b].store (0, std::memory_order_relaxed);
+        }
+    }
+
+    static FixedStrTypeStats& statsFor (std::vector<FixedStrTypeStats>& stats,
+                                        size_t alloc, size_t charSize) {
+        for (size_t i = 0; i < stats.size(); ++i) {
+            if (stats[i].allocSize == alloc && stats[i].charSize == charSize) {
+                return stats[i];
+            }
+        }
+        FixedStrTypeStats s;
+        memset (&s, 0, sizeof s);
+        s.allocSize = alloc;
+        s.charSize =  charSize;
+        stats.push_back (s);
+        return stats.back();
+    }
+
+    static void sortStats (std::vector<FixedStrTypeStats>& stats) {
+        // insertion sort; there are only ever a handful.
+        for (size_t i = 1; i < stats.size(); ++i) {
+            FixedStrTypeStats s = stats[i];
+            size_t j = i;
+            while (j > 0 && (stats[j - 1].charSize > s.charSize ||
+                   (stats[j - 1].charSize == s.charSize && stats[j - 1].allocSize > s.allocSize))) {
+                stats[j] = stats[j - 1];
+                --j;
+            }
+            stats[j] = s;
+        }
+    }
+
+    // Inline function statics are shared across translation units.
+    static Registry& registry() {
+        static Registry reg;
+        return reg;
+    }
+
+    static Shard& threadShard() {
+        static thread_local Shard shard;
+        return shard;
+    }
+};
+
+#endif
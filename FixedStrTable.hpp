@@ -0,0 +1,596 @@
+#ifndef FIXED_STR_TABLE_H
+#define FIXED_STR_TABLE_H
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrTableWriter / FixedStrTableFile
+ *  A file format for big tables of FixedStr<N> (or WFixedStr<N>), with or
+ *  without a fixed-size value per string, that's used straight from an
+ *  mmap:  opening it reads the header and nothing else, and entries come
+ *  back as views into the mapping, with no copy and no allocation.  A
+ *  table that used to be parsed from text at startup is instead paged in
+ *  as it's used.
+ *
+ *      FixedStrTableWriter<24> out;
+ *      out.add (symbol, price);        // or add (symbol) for a plain array
+ *      out.write ("symbols.fst");
+ *
+ *      FixedStrTableFile<24> symbols ("symbols.fst");
+ *      FixedStrView s = symbols[7];
+ *      const double* p = symbols.find_value<double> ("NYSE.IBM");
+ *
+ *  Layout (version 1), all in the byte order of the machine that wrote
+ *  it:  a Header, then these sections, each at a 64-byte boundary:
+ *
+ *      LENGTHS     uint32_t per entry
+ *      ROWS        N + 1 chars per entry, terminated; a string longer than
+ *                  N has its first N chars here
+ *      SPILLS      (entry, offset into BLOB) pairs, by entry, for strings
+ *                  longer than N
+ *      BLOB        the strings longer than N, terminated
+ *      VALUES      the values, if any, in entry order
+ *      INDEX       open addressing hash index:  entry + 1 per slot, 0 if
+ *                  empty; probed linearly from hash() of the string
+ *
+ *  The header holds the char width, N, the count, value size, the offset
+ *  and size of each section and a checksum of the sections.  The hashes
+ *  are those of hash(), which aren't the same across byte orders or
+ *  format versions, so both are checked on open.
+ *
+ *  open() checks everything in the header (char width, N, version, that
+ *  every section is inside the file and the size it should be), so a bad
+ *  or truncated file throws std::runtime_error then, not later.  Checking
+ *  the checksum means reading the whole file, which is what this is meant
+ *  to avoid, so that's only done on request (VERIFY).  Entries that don't
+ *  add up (a spilled string that isn't in SPILLS or runs past BLOB) throw
+ *  when they're looked at.
+ *
+ *  No mmap on Windows; there the file is read in whole.
+ */
+
+struct FixedStrTableHeader {
+    enum {
+        LENGTHS,
+        ROWS,
+        SPILLS,
+        BLOB,
+        VALUES,
+        INDEX,
+        SECTIONS
+    };
+
+    enum {
+        VERSION =       1,
+        ORDER_MARK =    0x01020304,
+        ALIGN =         64
+    };
+
+    struct Section {
+        uint64_t    offset;
+        uint64_t    bytes;
+    };
+
+    char        magic [8];
+    uint32_t    version;
+    uint32_t    byteOrder;
+    uint32_t    charSize;
+    uint32_t    valueSize;
+    uint64_t    allocSize;
+    uint64_t    count;
+    uint64_t    spillCount;
+    uint64_t    indexSlots;
+    uint64_t    checksum;
+    Section     sections [SECTIONS];
+
+    static const char* expectedMagic() {
+        return "FXSTRTB";
+    }
+
+    // Each section hashed and the hashes chained.
+    static uint64_t sectionsChecksum (const void* const* data, const uint64_t* bytes) {
+        uint64_t sum = 0;
+        for (size_t s = 0; s < SECTIONS; ++s) {
+            sum = hashBytes (data[s], static_cast<size_t> (bytes[s]), sum);
+        }
+        return sum;
+    }
+};
+
+template<size_t _AllocSizeT, typename _CharT>
+class BaseStrTableWriter {
+public:
+    typedef BaseStrView<_CharT> View;
+
+    BaseStrTableWriter()
+        :
+        m_valueSize (0)
+    {
+    }
+
+    size_t size() const {
+        return m_lens.size();
+    }
+
+    void reserve (size_t n) {
+        m_lens.reserve (n);
+        m_rows.reserve (n * ROW);
+    }
+
+    // A string with no value.  Throws std::invalid_argument if others were
+    // added with values.
+    void add (View str) {
+        checkValueSize (0);
+        addStr (str);
+    }
+
+    // A string and its value, which is copied as bytes.  All must have
+    // the same type of value.
+    template<typename _ValueT>
+    void add (View str, const _ValueT& value) {
+        static_assert (std::is_trivially_copyable<_ValueT>::value, "FixedStrTable values are stored as bytes");
+        checkValueSize (sizeof (_ValueT));
+        addStr (str);
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*> (&value);
+        m_values.insert (m_values.end(), bytes, bytes + sizeof (_ValueT));
+    }
+
+    // Each of [first, last), anything a view can be made from.
+    template<typename _IterT>
+    void add (_IterT first, _IterT last) {
+        for (; first != last; ++first) {
+            add (View (*first));
+        }
+    }
+
+    // Writes to 'path' + ".tmp" and renames it over 'path', so readers
+    // never see a half-written file.  Throws std::runtime_error if the
+    // file can't be written.
+    void write (const char* path) const {
+        typedef FixedStrTableHeader Header;
+        std::vector<uint32_t> index;
+        buildIndex (index);
+
+        const void* data [Header::SECTIONS] = {
+            dataOf (m_lens), dataOf (m_rows), dataOf (m_spills),
+            dataOf (m_blob), dataOf (m_values), dataOf (index)
+        };
+        uint64_t bytes [Header::SECTIONS] = {
+            m_lens.size() * sizeof (uint32_t),
+            m_rows.size() * sizeof (_CharT),
+            m_spills.size() * sizeof (uint64_t),
+            m_blob.size() * sizeof (_CharT),
+            m_values.size(),
+            index.size() * sizeof (uint32_t)
+        };
+
+        Header header;
+        memset (&header, 0, sizeof header);
+        memcpy (header.magic, Header::expectedMagic(), sizeof header.magic);
+        header.version =    Header::VERSION;
+        header.byteOrder =  Header::ORDER_MARK;
+        header.charSize =   sizeof (_CharT);
+        header.valueSize =  static_cast<uint32_t> (m_valueSize);
+        header.allocSize =  _AllocSizeT;
+        header.count =      m_lens.size();
+        header.spillCount = m_spills.size() / 2;
+        header.indexSlots = index.size();
+        header.checksum =   Header::sectionsChecksum (data, bytes);
+        uint64_t at = alignUp (sizeof header);
+        for (size_t s = 0; s < Header::SECTIONS; ++s) {
+            header.sections[s].offset = at;
+            header.sections[s].bytes = bytes[s];
+            at = alignUp (at + bytes[s]);
+        }
+
+        const std::string tmpPath = std::string (path) + ".tmp";
+        FILE* file = fopen (tmpPath.c_str(), "wb");
+        if (file == NULL) {
+            throw std::runtime_error ("FixedStrTableWriter can't create " + tmpPath);
+        }
+        bool ok = fwrite (&header, sizeof header, 1, file) == 1;
+        uint64_t written = sizeof header;
+        static const char zeroes [Header::ALIGN] = { 0 };
+        for (size_t s = 0; s < Header::SECTIONS && ok; ++s) {
+            ok = fwrite (zeroes, 1, header.sections[s].offset - written, file) == header.sections[s].offset - written;
+            ok = ok && (bytes[s] == 0 || fwrite (data[s], 1, bytes[s], file) == bytes[s]);
+            written = header.sections[s].offset + bytes[s];
+        }
+        ok = fclose (file) == 0 && ok;
+        if (!ok || rename (tmpPath.c_str(), path) != 0) {
+            remove (tmpPath.c_str());
+            throw std::runtime_error (std::string ("FixedStrTableWriter can't write ") + path);
+        }
+    }
+
+private:
+    enum {
+        ROW = _AllocSizeT + 1
+    };
+
+    static uint64_t alignUp (uint64_t n) {
+        return (n + FixedStrTableHeader::ALIGN - 1) / FixedStrTableHeader::ALIGN * FixedStrTableHeader::ALIGN;
+    }
+
+    template<typename _T>
+    static const void* dataOf (const std::vector<_T>& v) {
+        return v.empty() ? NULL : &v[0];
+    }
+
+    void checkValueSize (size_t valueSize) {
+        if (m_lens.empty()) {
+            m_valueSize = valueSize;
+        }
+        else if (valueSize != m_valueSize) {
+            throw std::invalid_argument ("FixedStrTableWriter values must all be the same size");
+        }
+    }
+
+    void addStr (View str) {
+        const size_t len = str.length();
+        if (len > 0xffffffffu || m_lens.size() >= 0xffffffffu) {
+            throw std::length_error ("FixedStrTableWriter too big");
+        }
+        const size_t inRow = len <= _AllocSizeT ? len : _AllocSizeT;
+        const size_t at = m_rows.size();
+        m_rows.resize (at + ROW);
+        memcpy (&m_rows[at], str.data(), inRow * sizeof (_CharT));
+        if (len > _AllocSizeT) {
+            m_spills.push_back (m_lens.size());
+            m_spills.push_back (m_blob.size());
+            m_blob.insert (m_blob.end(), str.data(), str.data() + len);
+            m_blob.push_back (0);
+        }
+        m_lens.push_back (static_cast<uint32_t> (len));
+    }
+
+    View entry (size_t i, size_t* spill) const {
+        if (m_lens[i] <= _AllocSizeT) {
+            return View (&m_rows[i * ROW], m_lens[i]);
+        }
+        const size_t offset = static_cast<size_t> (m_spills[2 * (*spill)++ + 1]);
+        return View (&m_blob[offset], m_lens[i]);
+    }
+
+    // At most half full.
+    void buildIndex (std::vector<uint32_t>& index) const {
+        size_t slots = 16;
+        while (slots < m_lens.size() * 2) {
+            slots *= 2;
+        }
+        index.assign (slots, 0);
+        const size_t mask = slots - 1;
+        size_t spill = 0;
+        for (size_t i = 0; i < m_lens.size(); ++i) {
+            size_t slot = entry (i, &spill).hash() & mask;
+            while (index[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            index[slot] = static_cast<uint32_t> (i + 1);
+        }
+    }
+
+    std::vector<uint32_t>       m_lens;
+    std::vector<_CharT>         m_rows;
+    std::vector<uint64_t>       m_spills;
+    std::vector<_CharT>         m_blob;
+    std::vector<unsigned char>  m_values;
+    size_t                      m_valueSize;
+
+    // disable these...
+    BaseStrTableWriter (const BaseStrTableWriter<_AllocSizeT, _CharT>& other);
+    BaseStrTableWriter<_AllocSizeT, _CharT>& operator= (const BaseStrTableWriter<_AllocSizeT, _CharT>& other);
+};
+
+template<size_t _AllocSizeT, typename _CharT>
+class BaseStrTableFile {
+public:
+    typedef BaseStrView<_CharT>         View;
+    typedef FixedStrTableHeader         Header;
+
+    static const size_t npos = -1;
+
+    enum {
+        VERIFY = 1          // open() also checks the checksum
+    };
+
+    BaseStrTableFile()
+    {
+        reset();
+    }
+
+    explicit BaseStrTableFile (const char* path, int flags = 0)
+    {
+        reset();
+        open (path, flags);
+    }
+
+    ~BaseStrTableFile() {
+        close();
+    }
+
+    // Throws std::runtime_error if the file can't be read or isn't a
+    // table of this N and char type.
+    void open (const char* path, int flags = 0) {
+        close();
+        try {
+            map (path);
+            check (path, flags);
+        }
+        catch (...) {
+            close();
+            throw;
+        }
+    }
+
+    void close() {
+#if !defined(_WIN32)
+        if (m_base != NULL) {
+            munmap (const_cast<unsigned char*> (m_base), m_bytes);
+        }
+#endif
+        m_buffer.clear();
+        reset();
+    }
+
+    bool is_open() const {
+        return m_header != NULL;
+    }
+
+    size_t size() const {
+        return m_count;
+    }
+
+    bool empty() const {
+        return m_count == 0;
+    }
+
+    // Views into the mapping, valid until close().
+
+    View operator[] (size_t i) const {
+        const uint32_t len = m_lens[i];
+        if (len <= _AllocSizeT) {
+            return View (m_rows + i * ROW, len);
+        }
+        return spilled (i, len);
+    }
+
+    // Throws std::out_of_range if 'i' is past the end.
+    View at (size_t i) const {
+        if (i >= m_count) {
+            throw std::out_of_range ("FixedStrTableFile::at");
+        }
+        return (*this)[i];
+    }
+
+    // The first entry equal to 'str', or npos.
+    size_t find (View str) const {
+        const size_t mask = m_indexSlots - 1;
+        size_t slot = str.hash() & mask;
+        for (size_t probes = 0; probes < m_indexSlots; ++probes) {
+            const uint32_t entry = m_index[slot];
+            if (entry == 0) {
+                return npos;
+            }
+            if (entry <= m_count && (*this)[entry - 1] == str) {
+                return entry - 1;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return npos;
+    }
+
+    bool contains (View str) const {
+        return find (str) != npos;
+    }
+
+    // Value of entry 'i'.  Throws std::invalid_argument if the table's
+    // values aren't the size of _ValueT.
+    template<typename _ValueT>
+    const _ValueT& value (size_t i) const {
+        if (sizeof (_ValueT) != m_header->valueSize) {
+            throw std::invalid_argument ("FixedStrTableFile value size doesn't match");
+        }
+        return *reinterpret_cast<const _ValueT*> (m_values + i * sizeof (_ValueT));
+    }
+
+    // Value for the first entry equal to 'str', or NULL.
+    template<typename _ValueT>
+    const _ValueT* find_value (View str) const {
+        const size_t i = find (str);
+        return i == npos ? NULL : &value<_ValueT> (i);
+    }
+
+private:
+    enum {
+        ROW = _AllocSizeT + 1
+    };
+
+    void reset() {
+        m_base =       NULL;
+        m_bytes =      0;
+        m_header =     NULL;
+        m_count =      0;
+        m_lens =       NULL;
+        m_rows =       NULL;
+        m_spills =     NULL;
+        m_spillCount = 0;
+        m_blob =       NULL;
+        m_blobChars =  0;
+        m_values =     NULL;
+        m_index =      NULL;
+        m_indexSlots = 0;
+    }
+
+    void map (const char* path) {
+#if !defined(_WIN32)
+        const int fd = ::open (path, O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error (std::string ("FixedStrTableFile can't open ") + path);
+        }
+        struct stat st;
+        if (fstat (fd, &st) != 0) {
+            ::close (fd);
+            throw std::runtime_error (std::string ("FixedStrTableFile can't stat ") + path);
+        }
+        m_bytes = static_cast<size_t> (st.st_size);
+        if (m_bytes > 0) {
+            void* p = mmap (NULL, m_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close (fd);
+                m_bytes = 0;
+                throw std::runtime_error (std::string ("FixedStrTableFile can't map ") + path);
+            }
+            m_base = static_cast<const unsigned char*> (p);
+        }
+        ::close (fd);
+#else
+        FILE* file = fopen (path, "rb");
+        if (file == NULL) {
+            throw std::runtime_error (std::string ("FixedStrTableFile can't open ") + path);
+        }
+        unsigned char chunk [65536];
+        size_t got;
+        while ((got = fread (chunk, 1, sizeof chunk, file)) > 0) {
+            m_buffer.insert (m_buffer.end(), chunk, chunk + got);
+        }
+        fclose (file);
+        m_bytes = m_buffer.size();
+#endif
+    }
+
+    void check (const char* path, int flags) {
+        const unsigned char* base = m_base != NULL ? m_base : (m_buffer.empty() ? NULL : &m_buffer[0]);
+        if (m_bytes < sizeof (Header)) {
+            fail (path, "too short");
+        }
+        const Header* header = reinterpret_cast<const Header*> (base);
+        if (memcmp (header->magic, Header::expectedMagic(), sizeof header->magic) != 0) {
+            fail (path, "not a table");
+        }
+        if (header->version != Header::VERSION || header->byteOrder != Header::ORDER_MARK) {
+            fail (path, "wrong version or byte order");
+        }
+        if (header->charSize != sizeof (_CharT) || header->allocSize != _AllocSizeT) {
+            fail (path, "wrong char type or size");
+        }
+        const uint64_t count = header->count;
+        if (count >= 0xffffffffu) {
+            fail (path, "bad count");
+        }
+        const uint64_t expected [Header::SECTIONS] = {
+            count * sizeof (uint32_t),
+            count * ROW * sizeof (_CharT),
+            header->spillCount * 2 * sizeof (uint64_t),
+            header->sections[Header::BLOB].bytes,
+            count * header->valueSize,
+            header->indexSlots * sizeof (uint32_t)
+        };
+        const void* data [Header::SECTIONS];
+        uint64_t bytes [Header::SECTIONS];
+        for (size_t s = 0; s < Header::SECTIONS; ++s) {
+            const Header::Section& section = header->sections[s];
+            if (section.bytes != expected[s] || section.offset % Header::ALIGN != 0 ||
+                section.offset > m_bytes || section.bytes > m_bytes - section.offset) {
+                fail (path, "bad section");
+            }
+            data[s] = base + section.offset;
+            bytes[s] = section.bytes;
+        }
+        const uint64_t slots = header->indexSlots;
+        if (slots < 16 || (slots & (slots - 1)) != 0 || slots < count || header->spillCount > count ||
+            header->sections[Header::BLOB].bytes % sizeof (_CharT) != 0) {
+            fail (path, "bad index or blob");
+        }
+        if ((flags & VERIFY) && Header::sectionsChecksum (data, bytes) != header->checksum) {
+            fail (path, "checksum doesn't match");
+        }
+
+        m_header =     header;
+        m_count =      static_cast<size_t> (count);
+        m_lens =       static_cast<const uint32_t*> (data[Header::LENGTHS]);
+        m_rows =       static_cast<const _CharT*> (data[Header::ROWS]);
+        m_spills =     static_cast<const uint64_t*> (data[Header::SPILLS]);
+        m_spillCount = static_cast<size_t> (header->spillCount);
+        m_blob =       static_cast<const _CharT*> (data[Header::BLOB]);
+        m_blobChars =  static_cast<size_t> (bytes[Header::BLOB] / sizeof (_CharT));
+        m_values =     static_cast<const unsigned char*> (data[Header::VALUES]);
+        m_index =      static_cast<const uint32_t*> (data[Header::INDEX]);
+        m_indexSlots = static_cast<size_t> (slots);
+    }
+
+    static void fail (const char* path, const char* why) {
+        throw std::runtime_error (std::string ("FixedStrTableFile ") + path + ":  " + why);
+    }
+
+    // Binary search of the spill table, which is by entry.
+    View spilled (size_t i, uint32_t len) const {
+        size_t lo = 0;
+        size_t hi = m_spillCount;
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (m_spills[2 * mid] < i) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        if (lo == m_spillCount || m_spills[2 * lo] != i ||
+            m_spills[2 * lo + 1] >= m_blobChars || len > m_blobChars - m_spills[2 * lo + 1]) {
+            throw std::runtime_error ("FixedStrTableFile entry is corrupt");
+        }
+        return View (m_blob + m_spills[2 * lo + 1], len);
+    }
+
+    const unsigned char*        m_base;
+    size_t                      m_bytes;
+    std::vector<unsigned char>  m_buffer;
+    const Header*               m_header;
+    size_t                      m_count;
+    const uint32_t*             m_lens;
+    const _CharT*               m_rows;
+    const uint64_t*             m_spills;
+    size_t                      m_spillCount;
+    const _CharT*               m_blob;
+    size_t                      m_blobChars;
+    const unsigned char*        m_values;
+    const uint32_t*             m_index;
+    size_t                      m_indexSlots;
+
+    // disable these...
+    BaseStrTableFile (const BaseStrTableFile<_AllocSizeT, _CharT>& other);
+    BaseStrTableFile<_AllocSizeT, _CharT>& operator= (const BaseStrTableFile<_AllocSizeT, _CharT>& other);
+};
+
+template<size_t _AllocSizeT, typename _CharT>
+const size_t BaseStrTableFile<_AllocSizeT, _CharT>::npos;
+
+template<size_t _AllocSizeT>
+using FixedStrTableWriter = BaseStrTableWriter<_AllocSizeT, char>;
+
+template<size_t _AllocSizeT>
+using WFixedStrTableWriter = BaseStrTableWriter<_AllocSizeT, wchar_t>;
+
+template<size_t _AllocSizeT>
+using FixedStrTableFile = BaseStrTableFile<_AllocSizeT, char>;
+
+template<size_t _AllocSizeT>
+using WFixedStrTableFile = BaseStrTableFile<_AllocSizeT, wchar_t>;
+
+#endif
@@ -9,11 +9,80 @@
 
 #include "FixedStrTest.h"
 #include "FixedStr.hpp"
+#include "FixedStrBuilder.hpp"
+#include "HashedFixedStr.hpp"
+#include "FixedStrMap.hpp"
+#include "FixedStrIntern.hpp"
+#include "FixedStrSort.hpp"
+#include "FixedStrArray.hpp"
+#include "FixedStrTable.hpp"
+#include "FixedStrReader.hpp"
+#include "FixedStrMatcher.hpp"
+#include "FixedStrUtf8.hpp"
 #include <iostream>
+#include <new>
+#include <vector>
+#include <list>
+#include <string>
+#include <set>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
 using std::cout;
 using std::wcout;
 using std::endl;
 
+namespace {
+    // Counts heap allocations so tests can check that some paths
+    // don't touch the heap at all.  Atomic since some tests run threads.
+    std::atomic<size_t> s_newCount (0);
+}
+
+// GCC inlines these into the std containers and then flags free() as not
+// matching operator new, though these are the operators that pair them.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new (size_t sz) {
+    ++s_newCount;
+    void* p = malloc (sz ? sz : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[] (size_t sz) {
+    ++s_newCount;
+    void* p = malloc (sz ? sz : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete (void* p) noexcept {
+    free (p);
+}
+
+void operator delete[] (void* p) noexcept {
+    free (p);
+}
+
+void operator delete (void* p, size_t) noexcept {
+    free (p);
+}
+
+void operator delete[] (void* p, size_t) noexcept {
+    free (p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#  pragma GCC diagnostic pop
+#endif
+
 void FixedStrTest::testSizeof() {
 
     // OS X 64-bit sizeofs:
@@ -38,6 +107,38 @@ void FixedStrTest::testSizeof() {
 
     FixedStr<80> f3;
     sz = sizeof f3;
+
+#ifndef FIXED_STR_NO_COMPACT
+    // Compact layout:  no separate length, so N+1 rounded up to a pointer.
+    assertEquals ("FixedStr<7>",   16, sizeof (FixedStr<7>));
+    assertEquals ("FixedStr<15>",  16, sizeof (FixedStr<15>));
+    assertEquals ("FixedStr<23>",  24, sizeof (FixedStr<23>));
+    assertEquals ("FixedStr<31>",  32, sizeof (FixedStr<31>));
+    assertEquals ("FixedStr<127>", 128, sizeof (FixedStr<127>));
+    // too small to hold the overflow pointer and length otherwise.
+    assertEquals ("FixedStr<2>",   sizeof (void*) == 8 ? 16 : 12, sizeof (FixedStr<2>));
+    assertEquals ("WFixedStr<3>",  4 * sizeof (wchar_t), sizeof (WFixedStr<3>));
+#endif
+    // Full layout above 127.
+    assertEquals ("FixedStr<128>", 144, sizeof (FixedStr<128>));
+
+    // Every length up to and past full, and back.
+    FixedStr<15> s15;
+    const char* digits = "0123456789abcdefghij";
+    for (size_t len = 0; len <= 20; ++len) {
+        s15.assign (digits, len);
+        assertEquals ("length", len, s15.length());
+        assertEquals ("overflow", len > 15, s15.isUsingOverflow());
+        assertEquals ("terminated", len, strlen (s15.c_str()));
+        assertTrue   ("content", memcmp (s15.c_str(), digits, len) == 0);
+        assertEquals ("alloc", len > 15 ? len : 15, s15.getAlloc());
+    }
+    s15.assign ("full-15-chars!!");
+    assertEquals ("full", "full-15-chars!!", s15.c_str());
+    assertEquals ("full", 15, s15.length());
+    s15.clear();
+    assertTrue   ("cleared", s15.empty());
+    assertFalse  ("cleared", s15.isUsingOverflow());
 }
 
 void FixedStrTest::testAssign() {
@@ -167,6 +268,373 @@ void FixedStrTest::testCtors() {
 
 }
 
+namespace {
+    // Spilled string returned by value.
+    FixedStr<4> makeSpilled() {
+        FixedStr<4> toRet ("0123456789");
+        return toRet;
+    }
+}
+
+void FixedStrTest::testMove() {
+
+    // same size; overflow handed over.
+    FixedStr<4> src ("0123456789");
+    const char* heap = src.c_str();
+    size_t before = s_newCount;
+    FixedStr<4> dst (std::move(src));
+    assertEquals ("move ctor", "0123456789", dst.c_str());
+    assertTrue   ("stolen", dst.c_str() == heap);
+    assertEquals ("isUsingOverflow", 1, dst.isUsingOverflow());
+    assertEquals ("alloc", 10, dst.getAlloc());
+    assertEquals ("source emptied", "", src.c_str());
+    assertEquals ("source length", 0, src.length());
+    assertEquals ("source isUsingOverflow", 0, src.isUsingOverflow());
+    assertEquals ("no heap", 0, s_newCount - before);
+
+    // move assignment, target already spilled; only its own overflow is freed.
+    FixedStr<4> dst2 ("abcdefgh");
+    before = s_newCount;
+    dst2 = std::move(dst);
+    assertEquals ("move assign", "0123456789", dst2.c_str());
+    assertTrue   ("stolen", dst2.c_str() == heap);
+    assertEquals ("no heap", 0, s_newCount - before);
+
+    // self move-assignment leaves it alone.
+    FixedStr<4>& alias = dst2;
+    dst2 = std::move(alias);
+    assertEquals ("self move", "0123456789", dst2.c_str());
+
+    // cross size; target would spill anyway.
+    FixedStr<32> big ("0123456789012345678901234567890123456789");
+    heap = big.c_str();
+    before = s_newCount;
+    FixedStr<16> small (std::move(big));
+    assertEquals ("cross size", "0123456789012345678901234567890123456789", small.c_str());
+    assertTrue   ("stolen", small.c_str() == heap);
+    assertEquals ("no heap", 0, s_newCount - before);
+
+    FixedStr<8> smaller;
+    before = s_newCount;
+    smaller = std::move(small);
+    assertEquals ("cross size assign", "0123456789012345678901234567890123456789", smaller.c_str());
+    assertTrue   ("stolen", smaller.c_str() == heap);
+    assertEquals ("no heap", 0, s_newCount - before);
+
+    // spilled source fits in the target's array; copied, not stolen.
+    FixedStr<4> spilled ("012345");
+    before = s_newCount;
+    FixedStr<10> roomy (std::move(spilled));
+    assertEquals ("fits inline", "012345", roomy.c_str());
+    assertEquals ("isUsingOverflow", 0, roomy.isUsingOverflow());
+    assertEquals ("no heap", 0, s_newCount - before);
+
+    // inline source is a plain copy.
+    FixedStr<8> inl ("abc");
+    before = s_newCount;
+    FixedStr<8> inl2 (std::move(inl));
+    assertEquals ("inline move", "abc", inl2.c_str());
+    assertEquals ("no heap", 0, s_newCount - before);
+
+    // returning by value.
+    before = s_newCount;
+    FixedStr<4> ret = makeSpilled();
+    assertEquals ("returned", "0123456789", ret.c_str());
+    assertEquals ("one alloc", 1, s_newCount - before);
+
+    // growing a vector moves the elements.
+    std::vector<FixedStr<4> > vec;
+    vec.reserve (1);
+    vec.push_back (FixedStr<4> ("spilled-0"));
+    heap = vec[0].c_str();
+    vec.push_back (FixedStr<4> ("spilled-1"));
+    assertEquals ("vector grow", "spilled-0", vec[0].c_str());
+    assertTrue   ("stolen", vec[0].c_str() == heap);
+
+    // same-size copy still deep copies.
+    FixedStr<4> orig ("0123456789");
+    FixedStr<4> copy (orig);
+    assertEquals ("copy", "0123456789", copy.c_str());
+    assertTrue   ("deep copy", copy.c_str() != orig.c_str());
+
+    // wide
+    WFixedStr<4> wsrc (L"0123456789");
+    const wchar_t* wheap = wsrc.c_str();
+    before = s_newCount;
+    WFixedStr<2> wdst (std::move(wsrc));
+    assertEquals ("wide move", L"0123456789", wdst.c_str());
+    assertTrue   ("stolen", wdst.c_str() == wheap);
+    WFixedStr<4> wdst2;
+    wdst2 = std::move(wdst);
+    assertEquals ("wide move assign", L"0123456789", wdst2.c_str());
+    assertTrue   ("stolen", wdst2.c_str() == wheap);
+    assertEquals ("no heap", 0, s_newCount - before);
+
+    // move assignment is noexcept, so a shrink policy (which has assign()
+    // swap an overflow for a smaller one) mustn't make it allocate.
+    {
+        FixedStrGrowth growth;
+        growth.shrinkPercent = 50;
+        growth.inlinePercent = 0;
+        FixedStrGrowthScope scope (growth);
+        FixedStr<4> target;
+        target.reserve (300);
+        target = "abcdefgh";
+        FixedStr<4> fits ("ab");
+        FixedStr<4> spilledSrc ("0123456789");
+        heap = spilledSrc.c_str();
+        before = s_newCount;
+        target = std::move(fits);
+        assertEquals ("shrink policy", "ab", target.c_str());
+        assertEquals ("isUsingOverflow", 0, target.isUsingOverflow());
+        target = std::move(spilledSrc);
+        assertTrue   ("stolen", target.c_str() == heap);
+        assertEquals ("no heap", 0, s_newCount - before);
+    }
+}
+
+namespace {
+    // Forwards to the heap, counting what goes through it.
+    class CountingResource : public FixedStrResource {
+    public:
+        CountingResource() : allocs(0), deallocs(0), outstanding(0) {
+        }
+
+        void* allocate (size_t bytes) {
+            ++allocs;
+            outstanding += bytes;
+            return FixedStrResource::heap()->allocate (bytes);
+        }
+
+        void deallocate (void* p, size_t bytes) {
+            ++deallocs;
+            outstanding -= bytes;
+            FixedStrResource::heap()->deallocate (p, bytes);
+        }
+
+        int     allocs;
+        int     deallocs;
+        size_t  outstanding;
+    };
+}
+
+void FixedStrTest::testResource() {
+
+    CountingResource counting;
+    assertTrue ("default is heap", FixedStrResource::getDefault() == FixedStrResource::heap());
+    {
+        FixedStr<4> s1;
+        {
+            FixedStrResourceScope scope (&counting);
+            assertTrue ("scoped", FixedStrResource::getDefault() == &counting);
+
+            // fits; no resource used.
+            s1.assign ("abc");
+            assertEquals ("inline", 0, counting.allocs);
+
+            s1.assign ("0123456789");
+            assertEquals ("spilled", "0123456789", s1.c_str());
+            assertEquals ("allocs", 1, counting.allocs);
+
+            // nested scope
+            {
+                FixedStrResourceScope inner (NULL);
+                assertTrue ("nested", FixedStrResource::getDefault() == FixedStrResource::heap());
+            }
+            assertTrue ("restored", FixedStrResource::getDefault() == &counting);
+        }
+        assertTrue ("restored", FixedStrResource::getDefault() == FixedStrResource::heap());
+
+        // growing sticks with the resource the overflow came from.
+        s1.append ("0123456789");
+        assertEquals ("grown", "01234567890123456789", s1.c_str());
+        assertEquals ("allocs", 2, counting.allocs);
+        assertEquals ("deallocs", 1, counting.deallocs);
+
+        // fits in the existing overflow.
+        s1.assign ("012345678901234567890123456789");
+        assertEquals ("reassigned", "012345678901234567890123456789", s1.c_str());
+        assertEquals ("allocs", 2, counting.allocs);
+        assertEquals ("alloc", 40, s1.getAlloc());
+
+        FixedStr<4> w1;
+        w1.format ("%s-%s", "0123456789", "0123456789");
+        assertEquals ("format", "0123456789-0123456789", w1.c_str());
+
+        // moved overflow goes back to where it came from.
+        FixedStr<8> moved (std::move(s1));
+        assertEquals ("moved", "012345678901234567890123456789", moved.c_str());
+        assertEquals ("no dealloc on move", 1, counting.deallocs);
+    }
+    assertEquals ("all returned", 2, counting.deallocs);
+    assertEquals ("nothing outstanding", 0, counting.outstanding);
+
+    // a long wide format is measured first, then written straight into
+    // one overflow from the resource.
+    {
+        CountingResource wideCounting;
+        {
+            FixedStrResourceScope scope (&wideCounting);
+            WFixedStr<4> wide;
+            wide.format (L"%ls-%05d", L"0123456789", 42);
+            assertEquals ("wide format", L"0123456789-00042", wide.c_str());
+            assertEquals ("wide format", 1, wideCounting.allocs);
+            // past what the counting stream keeps, then one after it's
+            // been reopened.
+            std::wstring big (3000, L'x');
+            WFixedStr<4> wideBig;
+            wideBig.format (L"%ls!", big.c_str());
+            assertEquals ("wide big", (big + L"!").c_str(), wideBig.c_str());
+            WFixedStr<4> wideAfter;
+            wideAfter.format (L"%ls-%05d", L"abcdefghij", 7);
+            assertEquals ("wide after", L"abcdefghij-00007", wideAfter.c_str());
+            assertEquals ("wide format", 3, wideCounting.allocs);
+        }
+        assertEquals ("nothing outstanding", 0, wideCounting.outstanding);
+    }
+
+    // arena on the stack; no heap at all.
+    char buff[1024];
+    FixedStrArena arena (buff, sizeof buff);
+    size_t before = s_newCount;
+    {
+        FixedStrResourceScope scope (&arena);
+        FixedStr<4>  a1 ("0123456789");
+        WFixedStr<4> a2 (L"0123456789");
+        a1 += "more stuff";
+        a2 += L"more stuff";
+        assertEquals ("arena", "0123456789more stuff", a1.c_str());
+        assertEquals ("arena", L"0123456789more stuff", a2.c_str());
+        WFixedStr<4> a3;
+        a3.format (L"%ls-%05d", L"0123456789", 42);
+        assertEquals ("arena", L"0123456789-00042", a3.c_str());
+        const char* at = reinterpret_cast<const char*> (a3.c_str());
+        assertTrue   ("arena", at >= buff && at < buff + sizeof buff);
+    }
+    assertEquals ("no heap", 0, s_newCount - before);
+    assertTrue   ("used", arena.bytesUsed() > 0);
+    arena.release();
+    assertEquals ("released", 0, arena.bytesUsed());
+
+    // a caller's buffer that starts anywhere still hands out aligned blocks.
+    FixedStrArena offset (buff + 1, sizeof buff - 1);
+    assertEquals ("aligned", 0, static_cast<int> (reinterpret_cast<uintptr_t> (offset.allocate (24)) % 16));
+    assertEquals ("aligned", 0, static_cast<int> (reinterpret_cast<uintptr_t> (offset.allocate (8)) % 16));
+
+    // arena going to its upstream once the buffer is used up.
+    FixedStrArena small (buff, 64, 256, &counting);
+    {
+        FixedStrResourceScope scope (&small);
+        FixedStr<4> b1 ("01234567890123456789");
+        FixedStr<4> b2 ("01234567890123456789");
+        FixedStr<4> b3 ("0123456789012345678901234567890123456789012345678901234567890123456789"
+                        "0123456789012345678901234567890123456789012345678901234567890123456789"
+                        "0123456789012345678901234567890123456789012345678901234567890123456789"
+                        "0123456789012345678901234567890123456789012345678901234567890123456789");
+        assertEquals ("chunk", "01234567890123456789", b2.c_str());
+        assertEquals ("big", 280, b3.length());
+        assertEquals ("upstream", 4, counting.allocs);
+    }
+    small.release();
+    assertEquals ("upstream released", 0, counting.outstanding);
+
+#ifdef FIXED_STR_HAS_PMR
+    std::pmr::monotonic_buffer_resource mono (buff, sizeof buff);
+    FixedStrPmrResource pmr (&mono);
+    before = s_newCount;
+    {
+        FixedStrResourceScope scope (&pmr);
+        FixedStr<4> p1 ("0123456789");
+        assertEquals ("pmr", "0123456789", p1.c_str());
+    }
+    assertEquals ("no heap", 0, s_newCount - before);
+#endif
+}
+
+// Only built with FIXED_STR_STATS, which has to be on for every file;
+// see the README for the second test binary.
+#ifdef FIXED_STR_STATS
+namespace {
+    // Stats for one type, or all zeroes if it hasn't been seen.
+    FixedStrTypeStats statsFor (size_t alloc, size_t charSize) {
+        std::vector<FixedStrTypeStats> all = FixedStrStats::snapshot();
+        for (size_t i = 0; i < all.size(); ++i) {
+            if (all[i].allocSize == alloc && all[i].charSize == charSize) {
+                return all[i];
+            }
+        }
+        FixedStrTypeStats none;
+        memset (&none, 0, sizeof none);
+        return none;
+    }
+}
+
+void FixedStrTest::testStats() {
+
+    FixedStrStats::reset();
+    // sizes no other test uses.
+    {
+        FixedStr<11> s1;
+        s1.assign ("abc");
+        s1.assign ("0123456789");
+        // spill
+        s1.assign ("0123456789012345");
+        // fits the existing overflow
+        s1.assign ("01234567890123");
+        // back in the array
+        s1.assign ("abc");
+        // spill, then realloc
+        s1.append ("0123456789");
+        s1.append ("01234567890123456789012345678901234567890123456789");
+        s1.format ("%d", 12);
+    }
+    FixedStrTypeStats st = statsFor (11, sizeof (char));
+    assertEquals ("assigns", 5, st.assigns);
+    assertEquals ("appends", 2, st.appends);
+    assertEquals ("formats", 1, st.formats);
+    // 16, 14, 13, 63; the format goes back in the array.
+    assertEquals ("overflow ops", 4, st.overflowOps);
+    assertEquals ("spills", 2, st.spills);
+    assertEquals ("reallocs", 1, st.reallocs);
+    assertEquals ("bytes", 17 + 27 + 127, st.bytesAllocated);
+    assertEquals ("len 3", 2, st.lengths[3]);
+    assertEquals ("len 63", 1, st.lengths[63]);
+    assertEquals ("p50", 10, st.lengthPercentile (50));
+    assertEquals ("p99", 63, st.lengthPercentile (99));
+    assertEquals ("recommend", 64, st.recommendedAlloc());
+    assertTrue   ("spill %", st.spillPercent() == 50);
+
+    // wide strings are kept apart.
+    WFixedStr<11> w1 (L"0123456789012345");
+    FixedStrTypeStats wst = statsFor (11, sizeof (wchar_t));
+    assertEquals ("wide assigns", 1, wst.assigns);
+    assertEquals ("wide spills", 1, wst.spills);
+    assertEquals ("wide bytes", 17 * sizeof (wchar_t), wst.bytesAllocated);
+    assertEquals ("narrow unchanged", 5, statsFor (11, sizeof (char)).assigns);
+
+    // long lengths land in power of 2 buckets.
+    assertEquals ("bucket", 256, FixedStrTypeStats::bucketFor (300));
+    assertEquals ("bucket", 257, FixedStrTypeStats::bucketFor (1000));
+    assertEquals ("bucket max", 1023, FixedStrTypeStats::bucketMax (257));
+
+    // other threads' counts show up, including after they've exited.
+    std::thread worker ([] {
+        FixedStr<11> t1;
+        for (int i = 0; i < 100; ++i) {
+            t1.assign ("abc");
+        }
+    });
+    worker.join();
+    assertEquals ("merged", 105, statsFor (11, sizeof (char)).assigns);
+
+    FixedStrStats::reset();
+    assertEquals ("reset", 0, statsFor (11, sizeof (char)).ops());
+}
+#else
+void FixedStrTest::testStats() {
+}
+#endif
+
 void FixedStrTest::testAppend() {
     FixedStr<5> f1;
         
@@ -379,6 +847,212 @@ void FixedStrTest::testEqualStr() {
 
 }
 
+namespace {
+    typedef bool (*BytesEqualFn) (const void*, const void*, size_t);
+
+    // Every length up to 'maxLen', with a mismatch at every position.
+    bool checkBytesEqual (BytesEqualFn fn, size_t maxLen) {
+        unsigned char a[256];
+        unsigned char b[256];
+        for (size_t len = 0; len <= maxLen; ++len) {
+            for (size_t i = 0; i < sizeof a; ++i) {
+                a[i] = b[i] = static_cast<unsigned char> (i * 7 + 1);
+            }
+            // junk after the range mustn't matter.
+            if (len < sizeof a) b[len] ^= 0x80;
+            if (!fn (a, b, len)) return false;
+            for (size_t pos = 0; pos < len; ++pos) {
+                b[pos] ^= 0x01;
+                if (fn (a, b, len)) return false;
+                b[pos] ^= 0x01;
+            }
+        }
+        return true;
+    }
+
+    template<size_t BuffBytes>
+    bool bufferEqualFn (const void* lhs, const void* rhs, size_t n) {
+        return bufferBytesEqual<BuffBytes> (lhs, rhs, n);
+    }
+}
+
+void FixedStrTest::testEqualKernels() {
+    assertTrue ("scalar", checkBytesEqual (bytesEqualScalar, 200));
+    assertTrue ("default", checkBytesEqual (bytesEqual, 200));
+#ifdef FIXED_STR_SSE2
+    assertTrue ("sse2", checkBytesEqual (bytesEqualSse2, 200));
+#endif
+#ifdef FIXED_STR_AVX2
+    if (cpuHasAvx2()) {
+        assertTrue ("avx2", checkBytesEqual (bytesEqualAvx2, 200));
+    }
+#endif
+#ifdef FIXED_STR_NEON
+    assertTrue ("neon", checkBytesEqual (bytesEqualNeon, 200));
+#endif
+    // strings are always shorter than their buffers.
+    assertTrue ("buffer 8",  checkBytesEqual (bufferEqualFn<8>,  7));
+    assertTrue ("buffer 16", checkBytesEqual (bufferEqualFn<16>, 15));
+    assertTrue ("buffer 20", checkBytesEqual (bufferEqualFn<20>, 19));
+    assertTrue ("buffer 32", checkBytesEqual (bufferEqualFn<32>, 31));
+    assertTrue ("buffer 64", checkBytesEqual (bufferEqualFn<64>, 63));
+
+    // inline vs inline, inline vs overflow, across sizes, at every length.
+    const char* digits = "0123456789012345678901234567890123456789012345678901234567890123456789";
+    for (size_t len = 0; len < 70; ++len) {
+        FixedStr<15> a;
+        FixedStr<31> b;
+        FixedStr<64> c;
+        a.assign (digits, len);
+        b.assign (digits, len);
+        c.assign (digits, len);
+        assertTrue ("15 == 31", a == b);
+        assertTrue ("31 == 64", b == c);
+        assertTrue ("64 == 15", c == a);
+        if (len > 0) {
+            c.clear();
+            c.assign (digits, len - 1);
+            c += 'x';
+            assertFalse ("15 != 64", a == c);
+            assertFalse ("31 != 64", b == c);
+            b.clear();
+            b.assign (digits, len - 1);
+            assertFalse ("shorter", a == b);
+        }
+    }
+
+    WFixedStr<7> w1 (L"0123456");
+    WFixedStr<7> w2 (L"0123456");
+    WFixedStr<3> w3 (L"0123456");
+    WFixedStr<7> w4 (L"0123457");
+    assertTrue  ("wide", w1 == w2);
+    assertTrue  ("wide overflow", w1 == w3);
+    assertFalse ("wide", w1 == w4);
+    assertFalse ("wide overflow", w3 == w4);
+}
+
+namespace {
+    typedef size_t (*BytesMismatchFn) (const void*, const void*, size_t);
+
+    bool checkBytesMismatch (BytesMismatchFn fn, size_t maxLen) {
+        unsigned char a[256];
+        unsigned char b[256];
+        for (size_t len = 0; len <= maxLen; ++len) {
+            for (size_t i = 0; i < sizeof a; ++i) {
+                a[i] = b[i] = static_cast<unsigned char> (i * 13 + 5);
+            }
+            if (len < sizeof a) b[len] ^= 0x80;
+            if (fn (a, b, len) != len) return false;
+            for (size_t pos = 0; pos < len; ++pos) {
+                b[pos] ^= 0x10;
+                // a later difference mustn't matter.
+                if (pos + 3 < len) b[pos + 3] ^= 0x01;
+                if (fn (a, b, len) != pos) return false;
+                if (pos + 3 < len) b[pos + 3] ^= 0x01;
+                b[pos] ^= 0x10;
+            }
+        }
+        return true;
+    }
+
+    template<size_t BuffBytes>
+    size_t bufferMismatchFn (const void* lhs, const void* rhs, size_t n) {
+        return bufferBytesMismatch<BuffBytes> (lhs, rhs, n);
+    }
+
+    // The old character at a time ordering, as the reference.
+    template<typename _CharT, typename _UnsignedCharT>
+    int refCompare (const _CharT* lhs, size_t lhsLen, const _CharT* rhs, size_t rhsLen) {
+        for (size_t i = 0; i < lhsLen && i < rhsLen; ++i) {
+            _UnsignedCharT l = static_cast<_UnsignedCharT> (lhs[i]);
+            _UnsignedCharT r = static_cast<_UnsignedCharT> (rhs[i]);
+            if (l != r) return l < r ? -1 : 1;
+        }
+        if (lhsLen == rhsLen) return 0;
+        return lhsLen < rhsLen ? -1 : 1;
+    }
+
+    int sign (int v) {
+        return v < 0 ? -1 : v > 0 ? 1 : 0;
+    }
+}
+
+void FixedStrTest::testCompare() {
+    assertTrue ("scalar", checkBytesMismatch (bytesMismatchScalar, 200));
+    assertTrue ("default", checkBytesMismatch (bytesMismatch, 200));
+#ifdef FIXED_STR_SSE2
+    assertTrue ("sse2", checkBytesMismatch (bytesMismatchSse2, 200));
+#endif
+#ifdef FIXED_STR_AVX2
+    if (cpuHasAvx2()) {
+        assertTrue ("avx2", checkBytesMismatch (bytesMismatchAvx2, 200));
+    }
+#endif
+#ifdef FIXED_STR_NEON
+    assertTrue ("neon", checkBytesMismatch (bytesMismatchNeon, 200));
+#endif
+    assertTrue ("buffer 8",  checkBytesMismatch (bufferMismatchFn<8>,  7));
+    assertTrue ("buffer 16", checkBytesMismatch (bufferMismatchFn<16>, 15));
+    assertTrue ("buffer 64", checkBytesMismatch (bufferMismatchFn<64>, 63));
+
+    // against the reference on pseudo-random strings over a small
+    // alphabet (lots of common prefixes), with high bytes and zeros.
+    const char alphabet[] = { 'a', 'b', '\0', '\x7f', '\x80', '\xff' };
+    unsigned int seed = 12345;
+    for (int iter = 0; iter < 20000; ++iter) {
+        char l[40];
+        char r[40];
+        seed = seed * 1103515245 + 12345;
+        size_t lLen = (seed >> 8) % 40;
+        seed = seed * 1103515245 + 12345;
+        size_t rLen = (seed >> 8) % 40;
+        for (size_t i = 0; i < 40; ++i) {
+            seed = seed * 1103515245 + 12345;
+            l[i] = r[i] = alphabet[(seed >> 16) % 2];
+            if ((seed >> 24) % 8 == 0) {
+                r[i] = alphabet[(seed >> 8) % sizeof alphabet];
+            }
+        }
+        FixedStr<8>  a;
+        FixedStr<31> b;
+        a.assign (l, lLen);
+        b.assign (r, rLen);
+        int expected = refCompare<char, unsigned char> (l, lLen, r, rLen);
+        assertEquals ("compare", expected, sign (a.compare (b)));
+        assertEquals ("reversed", -expected, sign (b.compare (a)));
+        assertEqualsBool ("<",  expected <  0, a <  b);
+        assertEqualsBool ("<=", expected <= 0, a <= b);
+        assertEqualsBool (">",  expected >  0, a >  b);
+        assertEqualsBool (">=", expected >= 0, a >= b);
+        assertEqualsBool ("==", expected == 0, a == b);
+    }
+
+    FixedStr<10> abc ("abc");
+    assertEquals ("c string", 0,  abc.compare ("abc"));
+    assertEquals ("c string", -1, sign (abc.compare ("abd")));
+    assertEquals ("c string", 1,  sign (abc.compare ("ab")));
+    assertEquals ("c string", -1, sign (abc.compare ("\xe9")));
+
+    // wide strings compare as wchar_t, as before.
+    wchar_t wl[] = { L'a', 0x4e2d, L'b' };
+    wchar_t wr[] = { L'a', 0x4e2e, L'a' };
+    WFixedStr<2> w1;
+    WFixedStr<8> w2;
+    w1.assign (wl, 3);
+    w2.assign (wr, 3);
+    assertTrue  ("wide <",  w1 <  w2);
+    assertTrue  ("wide >=", w2 >= w1);
+    assertEquals ("wide", -1, sign (w1.compare (w2)));
+    w2.assign (wl, 2);
+    assertTrue  ("wide prefix", w2 < w1);
+
+#ifdef FIXED_STR_HAS_SPACESHIP
+    assertTrue ("<=>", (abc <=> FixedStr<2> ("abd")) < 0);
+    assertTrue ("<=>", (abc <=> FixedStr<2> ("abc")) == 0);
+    assertTrue ("<=>", (w1 <=> w2) > 0);
+#endif
+}
+
 void FixedStrTest::testWFixedStr() {
 
     // mostly testing the ctors.
@@ -471,9 +1145,14 @@ void FixedStrTest::testFormat() {
     assertEquals ("format-5", "01234567890123", s1.c_str());
     assertTrue("overflow", s1.isUsingOverflow());
 
-    // fits in array , but for now it goes in overflow.
+    // fits in array; moves back from the overflow.
     s1.format("%s", "abc");
     assertEquals ("format-5", "abc", s1.c_str());
+    assertFalse("overflow", s1.isUsingOverflow());
+
+    // and appending to it afterwards.
+    s1.append ("def");
+    assertEquals ("format-5a", "abcdef", s1.c_str());
     
     // This should go in array.
     s1.clear();
@@ -505,10 +1184,10 @@ void FixedStrTest::testFormat() {
     assertEquals ("format-8", L"01234567891", ws1.c_str());
     assertTrue("overflow", ws1.isUsingOverflow());
 
-    // fits in array , but for now it goes in overflow.
+    // fits in array; moves back from the overflow.
     ws1.format(L"%S", L"abc");
     assertEquals ("format-9", L"abc", ws1.c_str());
-    assertTrue("overflow", ws1.isUsingOverflow());
+    assertFalse("overflow", ws1.isUsingOverflow());
 
     // This should go in array.
     ws1.clear();
@@ -516,11 +1195,131 @@ void FixedStrTest::testFormat() {
     assertEquals ("format-10", L"abc", ws1.c_str());
     assertFalse("overflow", ws1.isUsingOverflow());
 
-    // Multiple iterations trying to allocate.
+    // Far too big for the array.
     WFixedStr<4> ws2;
     ws2.format(L"%S", L"01234567890123456789");
     assertEquals ("format-11", L"01234567890123456789", ws2.c_str());
     assertTrue("overflow", ws2.isUsingOverflow());
+    assertEquals ("exact", 20, ws2.getAlloc());
+
+    // Used to give up after 8 doublings (4 << 8 chars).
+    std::vector<wchar_t> big (5000, L'x');
+    big.push_back (L'\0');
+    ok = ws2.format(L"%S-%d", &big[0], 42);
+    assertEqualsBool ("long", true, ok);
+    assertEquals ("long length", 5003, ws2.length());
+    assertEquals ("long tail", L"x-42", ws2.c_str() + 4999);
+
+    // and back inline.
+    ws2.format(L"%d", 1234);
+    assertEquals ("format-12", L"1234", ws2.c_str());
+    assertFalse("overflow", ws2.isUsingOverflow());
+
+    // bad conversion still fails, leaving it empty.
+    ws2.format(L"%S", L"0123456789");
+    assertEqualsBool ("bad", false, ws2.format(L"%s", "\xff\xfe"));
+    assertEquals ("emptied", L"", ws2.c_str());
+    assertEquals ("emptied", 0, ws2.length());
+    assertFalse("overflow", ws2.isUsingOverflow());
+}
+
+void FixedStrTest::testFmt() {
+
+    //////////////
+    // numbers
+    //////////////
+
+    FixedStr<32> n1;
+    n1.append (0).append (',').append (-7).append (',').append (INT_MIN);
+    assertEquals ("int", "0,-7,-2147483648", n1.c_str());
+    n1.clear();
+    n1.append (LLONG_MIN).append (',').append (ULLONG_MAX);
+    assertEquals ("long long", "-9223372036854775808,18446744073709551615", n1.c_str());
+    n1.clear();
+    n1.append (10u).append (',').append (99ul).append (',').append (100l);
+    assertEquals ("unsigned", "10,99,100", n1.c_str());
+    // chars are still chars.
+    n1.clear();
+    n1.append ('A');
+    assertEquals ("char", "A", n1.c_str());
+
+    // doubles:  shortest form that reads back the same.
+    n1.clear();
+    n1.append (0.1).append (' ').append (1.5).append (' ').append (-2.25).append (' ').append (100.0);
+    assertEquals ("double", "0.1 1.5 -2.25 100", n1.c_str());
+    n1.clear();
+    n1.append (1.0 / 3).append (' ').append (1e20);
+    assertEquals ("double", "0.3333333333333333 1e+20", n1.c_str());
+
+    WFixedStr<8> wn1;
+    wn1.append (-12345).append (L'|').append (2.5);
+    assertEquals ("wide numbers", L"-12345|2.5", wn1.c_str());
+
+    //////////////
+    // fmt()
+    //////////////
+
+    FixedStr<16> k1;
+    FixedStr<4>  name ("abc");
+    assertTrue   ("ok", k1.fmt ("{}:{}:{}", name, 42, 7u));
+    assertEquals ("fmt-1", "abc:42:7", k1.c_str());
+    assertFalse  ("inline", k1.isUsingOverflow());
+
+    k1.fmt ("{{{}}} {}{}", "x", 'y', -1.5);
+    assertEquals ("braces", "{x} y-1.5", k1.c_str());
+    k1.fmt ("no args");
+    assertEquals ("no args", "no args", k1.c_str());
+    k1.fmt ("{}", "");
+    assertEquals ("empty", "", k1.c_str());
+
+    // bad formats leave the string alone.
+    k1.assign ("same");
+    assertFalse  ("too few args", k1.fmt ("{}:{}", 1));
+    assertFalse  ("too many args", k1.fmt ("{}", 1, 2));
+    assertFalse  ("lone brace", k1.fmt ("{", 1));
+    assertFalse  ("lone brace", k1.fmt ("}{}", 1));
+    assertFalse  ("spec", k1.fmt ("{:x}", 1));
+    assertEquals ("untouched", "same", k1.c_str());
+
+    // too big for the array:  exactly one allocation, exactly sized.
+    size_t before = s_newCount;
+    k1.fmt ("{}/{}/{}", "0123456789", 1234567890, "0123456789");
+    assertEquals ("spilled", "0123456789/1234567890/0123456789", k1.c_str());
+    assertEquals ("one alloc", 1, s_newCount - before);
+    assertEquals ("exact", 32, k1.getAlloc());
+
+    // smaller; reuses the overflow.
+    before = s_newCount;
+    k1.fmt ("{}-{}", "0123456789", 123456789);
+    assertEquals ("reused", "0123456789-123456789", k1.c_str());
+    assertEquals ("no alloc", 0, s_newCount - before);
+    assertTrue   ("overflow", k1.isUsingOverflow());
+
+    // fits again; goes back in the array.
+    k1.fmt ("{}", 5);
+    assertEquals ("back inline", "5", k1.c_str());
+    assertFalse  ("inline", k1.isUsingOverflow());
+
+    // args pointing into the string being formatted.
+    k1.assign ("abc");
+    k1.fmt ("{}{}", k1, k1);
+    assertEquals ("alias", "abcabc", k1.c_str());
+    assertFalse  ("inline", k1.isUsingOverflow());
+    k1.fmt ("{}-{}-{}", k1, k1, k1);
+    assertEquals ("alias spilled", "abcabc-abcabc-abcabc", k1.c_str());
+    k1.fmt ("[{}]", k1.c_str() + 7);
+    assertEquals ("alias overflow", "[abcabc-abcabc]", k1.c_str());
+    k1.fmt ("{}", k1.c_str() + 11);
+    assertEquals ("alias to inline", "abc]", k1.c_str());
+    assertFalse  ("inline", k1.isUsingOverflow());
+
+    // wide
+    WFixedStr<8> wk1;
+    WFixedStr<8> wname (L"abc");
+    wk1.fmt (L"{}={}", wname, 3);
+    assertEquals ("wide fmt", L"abc=3", wk1.c_str());
+    wk1.fmt (L"{}={}:{}", wname, 3.25, L"0123456789");
+    assertEquals ("wide fmt spilled", L"abc=3.25:0123456789", wk1.c_str());
 }
 
 void FixedStrTest::testSubstring() {
@@ -563,26 +1362,1937 @@ void FixedStrTest::testSubstring() {
     assertEquals ("substring-w", L"23", wf2.c_str());        
 }
 
-void FixedStrTest::testPerf() {
+void FixedStrTest::testView() {
+
+    FixedStrView empty;
+    assertTrue   ("empty", empty.empty());
+    assertEquals ("empty", 0, FixedStrView (NULL).length());
+
+    // tokenizing without copying.
+    FixedStr<64> line ("GET /index.html HTTP/1.1");
+    FixedStrView rest = line;
+    FixedStrView fields[3];
+    for (size_t i = 0; i < 3; ++i) {
+        size_t sp = rest.find (' ');
+        fields[i] = rest.substr (0, sp);
+        rest.remove_prefix (sp == FixedStrView::npos ? rest.length() : sp + 1);
+    }
+    assertTrue   ("method", fields[0] == "GET");
+    assertTrue   ("path", fields[1] == "/index.html");
+    assertTrue   ("version", fields[2] == "HTTP/1.1");
+    assertTrue   ("points into line", fields[1].data() == line.c_str() + 4);
+    assertTrue   ("rest", rest.empty());
+
+    // substr
+    FixedStrView v (line);
+    assertEquals ("substr", 11, v.substr (4, 11).length());
+    assertTrue   ("substr to end", v.substr (16) == "HTTP/1.1");
+    assertTrue   ("substr at end", v.substr (v.length()).empty());
+    assertTrue   ("substr on string", line.substr (4, 6) == "/index");
+    bool threw = false;
+    try {
+        v.substr (v.length() + 1);
+    }
+    catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assertTrue   ("out of range", threw);
+
+    // find
+    assertEquals ("find", 4, v.find ("/index"));
+    assertEquals ("find pos", 16, v.find ("HTTP", 5));
+    assertEquals ("find char", 3, v.find (' '));
+    assertEquals ("find char pos", 15, v.find (' ', 4));
+    assertTrue   ("not found", v.find ("POST") == FixedStrView::npos);
+    assertTrue   ("not found", v.find ('z') == FixedStrView::npos);
+    assertTrue   ("past end", v.find ("1", 100) == FixedStrView::npos);
+    assertEquals ("empty needle", 5, v.find ("", 5));
+    assertEquals ("at end", 23, v.find ("1", 22));
+    assertEquals ("repeats", 2, FixedStrView ("aaab").find ("ab"));
+    assertEquals ("on string", 16, line.find ("HTTP"));
+
+    // starts/ends
+    assertTrue   ("starts_with", v.starts_with ("GET "));
+    assertFalse  ("starts_with", v.starts_with ("GETX"));
+    assertTrue   ("starts_with char", v.starts_with ('G'));
+    assertTrue   ("ends_with", v.ends_with ("1.1"));
+    assertFalse  ("ends_with", FixedStrView ("1").ends_with ("1.1"));
+    assertTrue   ("on string", line.starts_with (fields[0]));
+
+    // comparisons between views, FixedStrs and C strings.
+    FixedStr<4>  small ("GET");
+    FixedStr<32> other ("POST");
+    assertTrue   ("str == view", small == fields[0]);
+    assertTrue   ("view == str", fields[0] == small);
+    assertTrue   ("str != view", other != fields[0]);
+    assertTrue   ("view < str", fields[0] < other);
+    assertFalse  ("str < view", small < fields[1]);
+    assertTrue   ("view < view", fields[1] < fields[2]);
+    assertTrue   ("view >= view", fields[2] >= fields[1]);
+    assertTrue   ("C string", "GET" == fields[0]);
+    assertTrue   ("compare", small.compare (fields[0]) == 0);
+    assertTrue   ("compare", fields[0].compare (other) < 0);
+    // embedded zeros count.
+    FixedStrView zeros ("a\0b", 3);
+    assertTrue   ("zeros", zeros != FixedStrView ("a\0c", 3));
+    assertTrue   ("zeros", zeros > FixedStrView ("a"));
+
+    // hashing:  same for the same content wherever it lives.
+    std::hash<FixedStrView> hasher;
+    assertTrue   ("hash", hasher (fields[0]) == hasher (small));
+    assertTrue   ("hash", hasher (fields[0]) == FixedStrView ("GET").hash());
+    assertTrue   ("hash", hasher (fields[0]) != hasher (fields[1]));
+    std::unordered_set<FixedStrView> seen;
+    seen.insert (fields[0]);
+    seen.insert (fields[1]);
+    assertTrue   ("set", seen.count (FixedStrView ("GET")) == 1);
+    std::set<FixedStrView> ordered (fields, fields + 3);
+    assertTrue   ("ordered", *ordered.begin() == "/index.html");
+
+    // materializing
+    FixedStr<8> kept (fields[1]);
+    assertEquals ("ctor", "/index.html", kept.c_str());
+    kept = fields[0];
+    assertEquals ("operator=", "GET", kept.c_str());
+    kept += fields[2];
+    assertEquals ("operator+=", "GETHTTP/1.1", kept.c_str());
+    kept.assign (line.substr (4, 3));
+    assertEquals ("assign", "/in", kept.c_str());
+    kept.append (line.substr (7, 3));
+    assertEquals ("append", "/index", kept.c_str());
+    kept.fmt ("{}={}", fields[0], 1);
+    assertEquals ("fmt", "GET=1", kept.c_str());
+    // from itself.
+    kept.assign (kept.substr (1));
+    assertEquals ("self", "ET=1", kept.c_str());
+    kept.append ("0123456789");
+    kept.append (kept.substr (2, 6));
+    assertEquals ("self append", "ET=10123456789=10123", kept.c_str());
+    kept.assign (kept.substr (4, 12));
+    assertEquals ("self spilled", "0123456789=1", kept.c_str());
+    kept.assign (kept.substr (9));
+    assertEquals ("self back inline", "9=1", kept.c_str());
+
+    WFixedStr<16> wide (L"key=value");
+    WFixedStrView wv = wide;
+    size_t eq = wv.find (L'=');
+    assertTrue   ("wide", wv.substr (0, eq) == L"key");
+    assertTrue   ("wide", wv.substr (eq + 1) == L"value");
+    assertEquals ("wide find", 4, wide.find (L"value"));
+
+#ifdef FIXED_STR_HAS_STRING_VIEW
+    std::string_view sv ("abc:def");
+    FixedStrView fromStd = sv;
+    assertEquals ("string_view", 7, fromStd.length());
+    std::string_view back = fields[1];
+    assertTrue   ("to string_view", back == "/index.html");
+    FixedStr<4> fromSv;
+    fromSv.assign (sv.substr (4));
+    assertEquals ("assign string_view", "def", fromSv.c_str());
+    fromSv.append (std::string_view ("ghi"));
+    assertEquals ("append string_view", "defghi", fromSv.c_str());
+    assertTrue   ("== string_view", fromSv == FixedStrView (std::string_view ("defghi")));
+    std::wstring_view wsv = wide.view();
+    assertEquals ("wstring_view", 9, wsv.length());
+#endif
+}
+
+void FixedStrTest::testBuilder() {
+
+    FixedStrBuilder b;
+    FixedStr<16> host ("example.com");
+    b.append ("http://").append (host).append (':').append (8080);
+    b.append ("/items/").append (-42).append ('?').append (3000000017u).append ("&p=").append (0.5);
+    assertEquals ("length", 50, b.length());
+    assertEquals ("pieces", 10, b.pieces());
+
+    // one allocation for the whole thing.
+    FixedStr<16> url ("old");
+    size_t newCount = s_newCount;
+    b.build (url);
+    assertEquals ("one alloc", 1, s_newCount - newCount);
+    assertEquals ("build", "http://example.com:8080/items/-42?3000000017&p=0.5", url.c_str());
+    assertEquals ("build len", 50, url.length());
+
+    // fits inline:  no heap at all.
+    FixedStr<16> small;
+    FixedStrBuilder parts;
+    parts += "id=";
+    parts += 7;
+    parts += ',';
+    parts += FixedStrView ("ok");
+    newCount = s_newCount;
+    parts.build (small);
+    assertEquals ("no alloc", 0, s_newCount - newCount);
+    assertEquals ("inline", "id=7,ok", small.c_str());
+    assertFalse  ("inline", small.isUsingOverflow());
+
+    // appendTo keeps what's there; spills once.
+    newCount = s_newCount;
+    parts.appendTo (small);
+    assertEquals ("appendTo", "id=7,okid=7,ok", small.c_str());
+    assertEquals ("appendTo no alloc", 0, s_newCount - newCount);
+    parts.appendTo (small);
+    assertEquals ("appendTo spill", "id=7,okid=7,okid=7,ok", small.c_str());
+    assertEquals ("appendTo one alloc", 1, s_newCount - newCount);
+    assertTrue   ("spilled", small.isUsingOverflow());
+    // existing overflow is big enough: no more allocation.
+    small.assign ("x");
+    assertFalse  ("back inline", small.isUsingOverflow());
+
+    // many pieces:  the piece list spills, the string still gets one alloc.
+    FixedStrBuilder many;
+    for (int i = 0; i < 200; ++i) {
+        many.append (i % 10);
+    }
+    assertEquals ("many", 200, many.length());
+    FixedStr<8> target;
+    newCount = s_newCount;
+    many.build (target);
+    assertEquals ("many one alloc", 1, s_newCount - newCount);
+    assertEquals ("many len", 200, target.length());
+    assertTrue   ("many", target.substr (190) == "0123456789");
+
+    // pieces from the target itself.
+    FixedStr<8> self ("abc");
+    FixedStrBuilder again;
+    again.append (self).append ('-').append (self).append (self.c_str() + 1);
+    again.build (self);
+    assertEquals ("self", "abc-abcbc", self.c_str());
+    FixedStrBuilder twice;
+    twice.append (self.substr (4, 3)).append (self);
+    twice.appendTo (self);
+    assertEquals ("self appendTo", "abc-abcbcabcabc-abcbc", self.c_str());
+    twice.clear();
+    assertEquals ("clear", 0, twice.length());
+    twice.append (self.substr (0, 3));
+    twice.build (self);
+    assertEquals ("self shrinks", "abc", self.c_str());
+    assertFalse  ("self shrinks", self.isUsingOverflow());
+
+    FixedStrBuilder nothing;
+    nothing.build (self);
+    assertEquals ("empty", "", self.c_str());
+
+    WFixedStrBuilder wb;
+    WFixedStr<4> wide (L"k");
+    wb.append (wide).append (L'=').append (1.25).append (L" units");
+    WFixedStr<4> wout;
+    wb.build (wout);
+    assertEquals ("wide", L"k=1.25 units", wout.c_str());
+
+    // join
+    std::vector<FixedStr<8> > fields;
+    fields.push_back (FixedStr<8> ("a"));
+    fields.push_back (FixedStr<8> ("bb"));
+    fields.push_back (FixedStr<8> ("ccc"));
+    FixedStr<32> line;
+    newCount = s_newCount;
+    join (line, fields, ", ");
+    assertEquals ("join", "a, bb, ccc", line.c_str());
+    assertEquals ("join no alloc", 0, s_newCount - newCount);
+    FixedStr<4> joined;
+    newCount = s_newCount;
+    join (joined, fields, FixedStrView (" | "));
+    assertEquals ("join spill", "a | bb | ccc", joined.c_str());
+    assertEquals ("join one alloc", 1, s_newCount - newCount);
+
+    const char* words[] = { "x", "y", "z" };
+    join (line, words, "");
+    assertEquals ("join array", "xyz", line.c_str());
+    std::list<FixedStrView> views;
+    join (line, views, ",");
+    assertEquals ("join none", "", line.c_str());
+    views.push_back (FixedStrView ("only"));
+    join (line, views, ",");
+    assertEquals ("join one", "only", line.c_str());
+    // a field that's part of the target.
+    views.push_back (line.substr (1, 2));
+    join (line, views, "+");
+    assertEquals ("join self", "only+nl", line.c_str());
+
+    std::vector<WFixedStr<2> > wparts (2, WFixedStr<2> (L"ab"));
+    join (wout, wparts, L"/");
+    assertEquals ("join wide", L"ab/ab", wout.c_str());
+
+    // char append works in place until the space runs out.
+    FixedStr<4> chars;
+    for (int i = 0; i < 10; ++i) {
+        chars += static_cast<char> ('0' + i);
+        assertEquals ("char len", i + 1, chars.length());
+    }
+    assertEquals ("chars", "0123456789", chars.c_str());
+    chars.assign ("ab");
+    chars += 'c';
+    assertEquals ("chars inline", "abc", chars.c_str());
+}
+
+void FixedStrTest::testConcat() {
+
+    FixedStr<8>  name ("orders");
+    FixedStr<16> region ("eu-west-1");
+    FixedStrView id ("48213");
+
+    size_t newCount = s_newCount;
+    FixedStr<32> key = name + ':' + region + ":" + id;
+    assertEquals ("3-way", "orders:eu-west-1:48213", key.c_str());
+    assertEquals ("no alloc", 0, s_newCount - newCount);
+
+    // nothing happens until it's assigned.
+    auto expr = "[" + name + "]";
+    assertEquals ("length", 8, expr.length());
+    FixedStr<4> small;
+    newCount = s_newCount;
+    small = expr;
+    assertEquals ("assign", "[orders]", small.c_str());
+    assertEquals ("one alloc", 1, s_newCount - newCount);
+    small = name.substr (0, 3) + "";
+    assertEquals ("back inline", "ord", small.c_str());
+    assertFalse  ("back inline", small.isUsingOverflow());
+
+    // append
+    small += ':' + name;
+    assertEquals ("+=", "ord:orders", small.c_str());
+    small.append (FixedStrView ("") + '!');
+    assertEquals ("append", "ord:orders!", small.c_str());
+
+    // operands from the target itself.
+    FixedStr<8> self ("ab");
+    self = self + "-" + self;
+    assertEquals ("self", "ab-ab", self.c_str());
+    self = self + self + self;
+    assertEquals ("self spill", "ab-abab-abab-ab", self.c_str());
+    self += self.substr (0, 2) + '.';
+    assertEquals ("self append", "ab-abab-abab-abab.", self.c_str());
+    self = self.substr (3, 2) + '|';
+    assertEquals ("self shrink", "ab|", self.c_str());
+
+    // char arrays go to the terminator.
+    char buff[16] = "xyz";
+    FixedStr<16> fromArray = name + buff;
+    assertEquals ("array", "ordersxyz", fromArray.c_str());
+    char* ptr = buff;
+    fromArray = ptr + name;
+    assertEquals ("pointer", "xyzorders", fromArray.c_str());
 
+    FixedStr<4> empty;
+    fromArray = empty + "" + empty;
+    assertEquals ("empty", "", fromArray.c_str());
+
+    WFixedStr<8> wname (L"k");
+    WFixedStr<4> wide = wname + L'=' + WFixedStrView (L"value");
+    assertEquals ("wide", L"k=value", wide.c_str());
+
+#ifdef FIXED_STR_HAS_STRING_VIEW
+    std::string_view sv ("sv");
+    FixedStr<8> withSv = name + sv;
+    assertEquals ("string_view", "orderssv", withSv.c_str());
+#endif
+
+    // 10-way, still one exact allocation.
+    FixedStr<8> part ("0123456");
+    FixedStr<8> ten;
+    newCount = s_newCount;
+    ten = part + part + part + part + part + part + part + part + part + part;
+    assertEquals ("10-way", 70, ten.length());
+    assertEquals ("10-way one alloc", 1, s_newCount - newCount);
+    assertTrue   ("10-way", ten.substr (63) == "0123456");
+}
 
-    //FixedStr<16> foo   ("01234567890123456789");      
-    //FixedStr<16> foo_2 ("01234567890123456789");
+void FixedStrTest::testCapacity() {
+
+    FixedStr<16> str ("abc");
+    assertEquals ("inline capacity", 16, str.capacity());
+    str.reserve (10);
+    assertFalse  ("reserve fits", str.isUsingOverflow());
+
+    // reserved space is used by appends without more allocation.
+    str.reserve (100);
+    assertTrue   ("reserve", str.isUsingOverflow());
+    assertTrue   ("reserve", str.capacity() >= 100);
+    assertEquals ("reserve keeps", "abc", str.c_str());
+    size_t newCount = s_newCount;
+    for (int i = 0; i < 97; ++i) {
+        str += 'x';
+    }
+    str.append ("", 0);
+    assertEquals ("no alloc", 0, s_newCount - newCount);
+    assertEquals ("appended", 100, str.length());
+    str.reserve (50);
+    assertTrue   ("never shrinks", str.capacity() >= 100);
+
+    // shrink_to_fit
+    str.assign ("0123456789012345678901234567890123456789");
+    assertEquals ("kept", 100, str.capacity());
+    str.shrink_to_fit();
+    assertEquals ("exact", 40, str.capacity());
+    assertEquals ("exact", "0123456789012345678901234567890123456789", str.c_str());
+    str.assign ("short");
+    str.shrink_to_fit();
+    assertFalse  ("inline", str.isUsingOverflow());
+    assertEquals ("inline", "short", str.c_str());
+    str.reserve (64);
+    str.shrink_to_fit();
+    assertFalse  ("inline again", str.isUsingOverflow());
+    assertEquals ("inline again", "short", str.c_str());
+
+    WFixedStr<4> wide (L"wide string");
+    wide.reserve (32);
+    wide.shrink_to_fit();
+    assertEquals ("wide", 11, wide.capacity());
+    assertEquals ("wide", L"wide string", wide.c_str());
+
+    {
+        // growth factor
+        FixedStrGrowth growth;
+        growth.growPercent = 100;
+        FixedStrGrowthScope scope (growth);
+        FixedStr<4> exact ("abcd");
+        exact += "e";
+        assertEquals ("exact growth", 5, exact.capacity());
+        growth.growPercent = 150;
+        FixedStrGrowthScope nested (growth);
+        exact += "fghijklmn";
+        assertEquals ("150%", 21, exact.capacity());
+    }
+    FixedStr<4> doubled ("abcd");
+    doubled += "e";
+    assertEquals ("default doubles", 10, doubled.capacity());
+
+    {
+        // size classes
+        FixedStrGrowth growth;
+        growth.roundToSizeClass = true;
+        FixedStrGrowthScope scope (growth);
+        FixedStr<4> rounded ("0123456789");
+        // 16 byte header + 11 rounds to 32.
+        assertEquals ("rounded", 32 - 16 - 1, rounded.capacity());
+        FixedStr<4> bigger;
+        bigger.reserve (300);
+        // 317 is between 256 and 512; those go in steps of 64.
+        assertEquals ("rounded big", 320 - 16 - 1, bigger.capacity());
+        bigger.shrink_to_fit();
+        assertFalse  ("rounded shrink", bigger.isUsingOverflow());
+    }
 
-    FixedStr<16> foo   ("01234"); 
-    FixedStr<16> foo_2 ("01234");
+    {
+        // hysteresis for going back inline.
+        FixedStrGrowth growth;
+        growth.inlinePercent = 50;
+        FixedStrGrowthScope scope (growth);
+        FixedStr<16> bouncing ("01234567890123456789");
+        bouncing.assign ("0123456789012");
+        assertTrue   ("kept", bouncing.isUsingOverflow());
+        newCount = s_newCount;
+        for (int i = 0; i < 10; ++i) {
+            bouncing.assign ("01234567890123456789");
+            bouncing.assign ("0123456789012");
+        }
+        assertEquals ("no thrash", 0, s_newCount - newCount);
+        bouncing.fmt ("{}", 12345678901LL);
+        assertTrue   ("fmt kept", bouncing.isUsingOverflow());
+        bouncing.format ("%d", 123456789);
+        assertTrue   ("format kept", bouncing.isUsingOverflow());
+        assertEquals ("format kept", "123456789", bouncing.c_str());
+        bouncing.assign ("01234567");
+        assertFalse  ("back inline", bouncing.isUsingOverflow());
+        assertEquals ("back inline", "01234567", bouncing.c_str());
+
+        growth.inlinePercent = 0;
+        FixedStrGrowthScope never (growth);
+        FixedStr<4> sticky ("0123456789");
+        sticky.clear();
+        assertTrue   ("clear kept", sticky.isUsingOverflow());
+        assertEquals ("clear kept", "", sticky.c_str());
+        sticky = FixedStrView ("a") + 'b';
+        assertTrue   ("concat kept", sticky.isUsingOverflow());
+        assertEquals ("concat kept", "ab", sticky.c_str());
+    }
 
-    int iters = 260000000;
-    time_t start = time(NULL);
-    for (int i=0; i<iters; ++i) {
-        foo == foo_2;
+    {
+        // long-lived strings give back a big overflow.
+        FixedStrGrowth growth;
+        growth.shrinkPercent = 25;
+        FixedStrGrowthScope scope (growth);
+        std::string big (1000, 'x');
+        FixedStr<16> conn (big.c_str());
+        assertEquals ("big", 1000, conn.capacity());
+        conn.assign (big.c_str(), 100);
+        assertEquals ("shrunk", 200, conn.capacity());
+        conn.assign (big.c_str(), 60);
+        assertEquals ("hysteresis", 200, conn.capacity());
+        conn.assign (big.c_str(), 40);
+        assertEquals ("shrunk again", 80, conn.capacity());
+        conn.assign (big.c_str(), 10);
+        assertFalse  ("inline", conn.isUsingOverflow());
+        conn.assign (big.c_str(), 1000);
+        conn.format ("%s", "0123456789012345678901234567890123456789");
+        assertEquals ("format shrinks", 80, conn.capacity());
+        assertEquals ("format shrinks", 40, conn.length());
     }
-    time_t elapsed = time(NULL) - start;
-    printf("Elapsed: %ld; %ld iters/ms", elapsed, iters/elapsed/1000);
-    
-    
 }
 
+void FixedStrTest::testHash() {
+
+    // only the content counts:  any size, view, std::hash.
+    std::string text;
+    std::set<size_t> seen;
+    for (int len = 0; len < 200; ++len) {
+        FixedStr<8>   small (text.c_str());
+        FixedStr<256> big (text.c_str());
+        size_t h = small.hash();
+        assertTrue   ("same hash", h == big.hash());
+        assertTrue   ("same hash", h == FixedStrView (text.c_str()).hash());
+        assertTrue   ("same hash", h == std::hash<FixedStr<8> >() (small));
+        assertTrue   ("same hash", h == std::hash<FixedStr<256> >() (big));
+        assertTrue   ("same hash", h == FixedStrHash() (text.c_str()));
+        seen.insert (h);
+        text += static_cast<char> ('a' + len % 26);
+    }
+    assertEquals ("distinct", 200, seen.size());
+
+    // one bit flipped anywhere changes it.
+    char bytes[64];
+    memset (bytes, 'x', sizeof bytes);
+    seen.clear();
+    for (int bit = 0; bit < 64 * 7; ++bit) {
+        bytes[bit / 7] ^= static_cast<char> (1 << (bit % 7));
+        seen.insert (FixedStrView (bytes, sizeof bytes).hash());
+        bytes[bit / 7] ^= static_cast<char> (1 << (bit % 7));
+    }
+    assertEquals ("bit flips", 64 * 7, seen.size());
+
+    WFixedStr<4>  wsmall (L"wide string");
+    WFixedStr<64> wbig (L"wide string");
+    assertTrue   ("wide", wsmall.hash() == wbig.hash());
+    assertTrue   ("wide", wsmall.hash() == std::hash<WFixedStr<4> >() (wsmall));
+    assertTrue   ("wide", wsmall.hash() == WFixedStrHash() (WFixedStrView (L"wide string")));
+    assertTrue   ("wide", wsmall.hash() != WFixedStrView (L"wide strinG").hash());
+
+    std::unordered_set<FixedStr<16> > keys;
+    keys.insert (FixedStr<16> ("alpha"));
+    keys.insert (FixedStr<16> ("beta"));
+    keys.insert (FixedStr<16> ("alpha"));
+    assertEquals ("set", 2, keys.size());
+    assertEquals ("set", 1, keys.count (FixedStr<16> ("beta")));
+
+#if defined(__cpp_lib_generic_unordered_lookup)
+    // looked up without making a FixedStr<16>.
+    std::unordered_set<FixedStr<16>, FixedStrHash, std::equal_to<> > ids;
+    ids.insert (FixedStr<16> ("GET"));
+    ids.insert (FixedStr<16> ("POST"));
+    FixedStr<64> line ("POST /index.html");
+    assertEquals ("heterogeneous", 1, ids.count (line.substr (0, 4)));
+    assertEquals ("heterogeneous", 0, ids.count (line.substr (0, 3)));
+    assertEquals ("heterogeneous", 1, ids.count (FixedStr<4> ("GET")));
+#endif
+
+    // cached hash, dropped by every change.
+    HashedFixedStr<8> key ("alpha");
+    assertTrue   ("cached", key.hash() == FixedStrView ("alpha").hash());
+    assertTrue   ("cached", key.hash() == std::hash<HashedFixedStr<8> >() (key));
+    key.append ("bet");
+    assertTrue   ("append", key.hash() == FixedStrView ("alphabet").hash());
+    key += '!';
+    assertTrue   ("+=", key.hash() == FixedStrView ("alphabet!").hash());
+    key.assign ("x");
+    assertTrue   ("assign", key.hash() == FixedStrView ("x").hash());
+    key = "yy";
+    assertTrue   ("=", key.hash() == FixedStrView ("yy").hash());
+    key.format ("%d-%s", 42, "overflowing");
+    assertEquals ("format", "42-overflowing", key.c_str());
+    assertTrue   ("format", key.hash() == FixedStrView ("42-overflowing").hash());
+    key.fmt ("{}:{}", "id", 7);
+    assertTrue   ("fmt", key.hash() == FixedStrView ("id:7").hash());
+    key.reserve (100);
+    assertTrue   ("reserve", key.hash() == FixedStrView ("id:7").hash());
+    key.clear();
+    assertTrue   ("clear", key.hash() == FixedStrView ("").hash());
+
+    HashedFixedStr<8> a ("same");
+    HashedFixedStr<8> b ("same");
+    HashedFixedStr<8> c ("diff");
+    a.hash();
+    c.hash();
+    assertTrue   ("==", a == b);
+    assertTrue   ("!=", a != c);
+    assertTrue   ("<",  c < a);
+    assertTrue   ("== view", a == FixedStrView ("same"));
+    assertTrue   ("== FixedStr", FixedStr<32> ("same") == a);
+
+    std::unordered_set<HashedFixedStr<8> > cached;
+    cached.insert (a);
+    cached.insert (b);
+    cached.insert (c);
+    assertEquals ("cached set", 2, cached.size());
+    assertEquals ("cached set", 1, cached.count (HashedFixedStr<8> ("diff")));
+
+    WHashedFixedStr<4> wkey;
+    wkey.format (L"%ls", L"wide string");
+    assertTrue   ("wide cached", wkey.hash() == wsmall.hash());
+}
 
+void FixedStrTest::testMap() {
+
+    // control group kernels against a byte loop.
+    unsigned int seed = 777;
+    const unsigned char ctrlBytes[] = { CTRL_EMPTY, CTRL_DELETED, 0, 1, 0x3f, 0x7f };
+    for (int iter = 0; iter < 2000; ++iter) {
+        unsigned char ctrl[CTRL_GROUP];
+        for (size_t i = 0; i < CTRL_GROUP; ++i) {
+            seed = seed * 1103515245 + 12345;
+            ctrl[i] = ctrlBytes[(seed >> 16) % sizeof ctrlBytes];
+        }
+        const unsigned char b = ctrlBytes[iter % sizeof ctrlBytes];
+        uint32_t want = 0;
+        uint32_t wantFree = 0;
+        for (size_t i = 0; i < CTRL_GROUP; ++i) {
+            want |= (ctrl[i] == b ? 1u : 0u) << i;
+            wantFree |= (ctrl[i] & 0x80 ? 1u : 0u) << i;
+        }
+        assertEquals ("scalar match", want, groupMatchScalar (ctrl, b));
+        assertEquals ("match", want, groupMatch (ctrl, b));
+        assertEquals ("free", wantFree, groupMatchFree (ctrl));
+    }
 
+    FixedStrMap<16, int> ids;
+    assertTrue   ("empty", ids.empty());
+    assertTrue   ("empty find", ids.find ("x") == ids.end());
+    assertTrue   ("empty begin", ids.begin() == ids.end());
+    ids["alpha"] = 1;
+    ids["beta"] =  2;
+    assertTrue   ("insert", ids.insert ("gamma", 3).second);
+    assertFalse  ("insert dup", ids.insert ("gamma", 4).second);
+    assertEquals ("size", 3, ids.size());
+    assertEquals ("kept first", 3, ids.at ("gamma"));
+
+    // any view will do, no temporary key.
+    FixedStr<64> line ("beta,alpha");
+    assertEquals ("view", 2, ids.find (line.substr (0, 4))->second);
+    assertEquals ("view", 1, ids.at (line.substr (5)));
+    assertEquals ("other size", 1, ids.at (FixedStr<4> ("alpha")));
+    assertTrue   ("contains", ids.contains ("beta"));
+    assertFalse  ("contains", ids.contains ("bet"));
+    assertEquals ("count", 0, ids.count ("alphabet"));
+#if __cplusplus >= 201703L
+    assertEquals ("string_view", 2, ids.at (std::string_view ("beta")));
+#endif
+    bool threw = false;
+    try {
+        ids.at ("delta");
+    }
+    catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assertTrue   ("at throws", threw);
 
+    int sum = 0;
+    for (FixedStrMap<16, int>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+        sum += it->second;
+    }
+    assertEquals ("iterate", 6, sum);
+    assertEquals ("erase", 1, ids.erase ("beta"));
+    assertEquals ("erase", 0, ids.erase ("beta"));
+    assertEquals ("erased", 2, ids.size());
+    FixedStrMap<16, int>::iterator next = ids.erase (ids.find ("alpha"));
+    assertTrue   ("erase it", next == ids.end() || next->second == 3);
+    assertEquals ("erase it", 1, ids.size());
+
+    // inline keys:  after reserve(), inserting allocates nothing.
+    FixedStrMap<16, int> counts;
+    counts.reserve (100);
+    size_t before = s_newCount;
+    for (int i = 0; i < 100; ++i) {
+        FixedStr<16> key;
+        key.fmt ("k{}", i);
+        counts[key] = i;
+    }
+    assertEquals ("no heap", 0, s_newCount - before);
+    assertEquals ("reserved", 100, counts.size());
+    counts.clear();
+    assertTrue   ("clear", counts.empty());
+    assertTrue   ("clear", counts.find ("k1") == counts.end());
+    assertTrue   ("clear keeps", counts.capacity() >= 100);
+
+    // spilled keys, and lots of inserts and erases (deleted markers,
+    // regrowth) checked against std::unordered_map.
+    FixedStrMap<4, int> spilled;
+    std::unordered_map<std::string, int> reference;
+    for (int iter = 0; iter < 20000; ++iter) {
+        seed = seed * 1103515245 + 12345;
+        FixedStr<64> key;
+        key.fmt ("key-{}-spills", (seed >> 8) % 3000);
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 3 == 0) {
+            assertEquals ("erase", reference.erase (key.c_str()), spilled.erase (key));
+        }
+        else {
+            spilled[key] = iter;
+            reference[key.c_str()] = iter;
+        }
+    }
+    assertEquals ("churn size", reference.size(), spilled.size());
+    bool same = true;
+    for (std::unordered_map<std::string, int>::const_iterator it = reference.begin(); it != reference.end(); ++it) {
+        FixedStrMap<4, int>::iterator found = spilled.find (it->first.c_str());
+        same = same && found != spilled.end() && found->second == it->second &&
+               found->first == FixedStrView (it->first.c_str());
+    }
+    assertTrue   ("churn", same);
+    size_t visited = 0;
+    for (FixedStrMap<4, int>::iterator it = spilled.begin(); it != spilled.end(); ++it) {
+        ++visited;
+    }
+    assertEquals ("churn iterate", reference.size(), visited);
+
+    FixedStrMap<4, int> copy (spilled);
+    assertEquals ("copy", spilled.size(), copy.size());
+    assertEquals ("copy", spilled.begin()->second, copy.at (spilled.begin()->first));
+    FixedStrMap<4, int> moved (std::move (copy));
+    assertEquals ("move", spilled.size(), moved.size());
+    assertTrue   ("moved from", copy.empty());
+    copy = moved;
+    assertEquals ("copy assign", moved.size(), copy.size());
+
+    FixedStrSet<8> seen;
+    assertTrue   ("set insert", seen.insert ("GET").second);
+    assertTrue   ("set insert", seen.insert ("a long method name").second);
+    assertFalse  ("set dup", seen.insert (FixedStrView ("GET")).second);
+    assertEquals ("set size", 2, seen.size());
+    assertTrue   ("set contains", seen.contains (FixedStr<64> ("a long method name")));
+    assertTrue   ("set find", *seen.find ("GET") == FixedStrView ("GET"));
+
+    WFixedStrMap<8, int> wide;
+    wide[L"wide key"] = 5;
+    assertEquals ("wide", 5, wide.at (WFixedStr<64> (L"wide key")));
+}
+
+void FixedStrTest::testIntern() {
+
+    FixedStrPool pool;
+    const uint32_t ibm = pool.intern ("NYSE.IBM");
+    assertEquals ("first", 0, ibm);
+    assertEquals ("same", ibm, pool.intern (FixedStr<4> ("NYSE.IBM")));
+    assertEquals ("same", ibm, pool.intern (FixedStr<64> ("NYSE.IBM,100").substr (0, 8)));
+    const uint32_t aapl = pool.intern ("NASDAQ.AAPL");
+    assertEquals ("next", 1, aapl);
+    assertEquals ("c_str", "NASDAQ.AAPL", pool.c_str (aapl));
+    assertEquals ("length", 11, pool.length (aapl));
+    assertTrue   ("view", pool.view (ibm) == FixedStrView ("NYSE.IBM"));
+    assertEquals ("find", aapl, pool.find ("NASDAQ.AAPL"));
+    assertEquals ("find", FixedStrPool::NOT_FOUND, pool.find ("LSE.VOD"));
+    assertEquals ("empty", 2, pool.intern (""));
+    assertEquals ("empty", "", pool.c_str (2));
+    assertEquals ("size", 3, pool.size());
+
+    // pointers stay put while lots more go in (tables grow, slabs fill,
+    // directory chunks are added); long ones get their own slab.
+    const char* ibmStr = pool.c_str (ibm);
+    std::string big (40000, 'b');
+    const uint32_t bigId = pool.intern (big.c_str());
+    for (int i = 0; i < 10000; ++i) {
+        FixedStr<32> sym;
+        sym.fmt ("sym.{}", i);
+        pool.intern (sym);
+    }
+    assertTrue   ("stable", ibmStr == pool.c_str (ibm));
+    assertEquals ("stable", "NYSE.IBM", ibmStr);
+    assertEquals ("big", 40000, pool.length (bigId));
+    assertEquals ("size", 10004, pool.size());
+    bool same = true;
+    for (int i = 0; i < 10000; i += 7) {
+        FixedStr<32> sym;
+        sym.fmt ("sym.{}", i);
+        uint32_t id = pool.find (sym);
+        same = same && id == static_cast<uint32_t> (i + 4) && pool.view (id) == sym;
+    }
+    assertTrue   ("ids", same);
+
+    // batch, in order, mixing new and old.
+    std::vector<FixedStr<16> > batch;
+    batch.push_back (FixedStr<16> ("LSE.VOD"));
+    batch.push_back (FixedStr<16> ("NYSE.IBM"));
+    batch.push_back (FixedStr<16> ("LSE.VOD"));
+    batch.push_back (FixedStr<16> ("LSE.BP"));
+    std::vector<uint32_t> ids;
+    pool.intern (batch.begin(), batch.end(), std::back_inserter (ids));
+    assertEquals ("batch", 4, ids.size());
+    assertEquals ("batch new", 10004, ids[0]);
+    assertEquals ("batch old", ibm, ids[1]);
+    assertEquals ("batch dup", ids[0], ids[2]);
+    assertEquals ("batch new", 10005, ids[3]);
+
+    // many threads adding the same strings agree on the IDs.
+    FixedStrPool shared;
+    const int threadCount = 8;
+    const int symbols = 5000;
+    std::vector<std::vector<uint32_t> > seen (threadCount, std::vector<uint32_t> (symbols));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.push_back (std::thread ([&shared, &seen, t, symbols] {
+            for (int n = 0; n < symbols; ++n) {
+                int i = (n * 7 + t * 997) % symbols;
+                FixedStr<24> sym;
+                sym.fmt ("host-{}.example.com", i);
+                seen[t][i] = shared.intern (sym);
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    assertEquals ("threads size", symbols, shared.size());
+    same = true;
+    for (int i = 0; i < symbols; ++i) {
+        FixedStr<24> sym;
+        sym.fmt ("host-{}.example.com", i);
+        for (int t = 0; t < threadCount; ++t) {
+            same = same && seen[t][i] == seen[0][i];
+        }
+        same = same && shared.view (seen[0][i]) == sym;
+    }
+    assertTrue   ("threads agree", same);
+
+    WFixedStrPool wide;
+    const uint32_t w = wide.intern (L"wide");
+    assertEquals ("wide", w, wide.intern (WFixedStr<2> (L"wide")));
+    assertEquals ("wide", L"wide", wide.c_str (w));
+}
+
+void FixedStrTest::testSort() {
+
+    std::vector<FixedStr<16> > none;
+    sort_strings (none.begin(), none.end());
+    std::vector<FixedStr<16> > one (1, FixedStr<16> ("x"));
+    sort_strings (one.begin(), one.end());
+    assertEquals ("one", "x", one[0].c_str());
+
+    // enough for the parallel path:  shared prefixes, high bytes (which
+    // sort after ASCII), empties, and some that spill past 16.
+    static const char* prefixes[] = { "NYSE.", "NYSE.I", "cpu.load.", "\xc3\xa9t\xc3\xa9.", "", "x" };
+    std::vector<FixedStr<16> > keys;
+    unsigned int seed = 1;
+    for (int i = 0; i < 50000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        FixedStr<16> key (prefixes[(seed >> 16) % 6]);
+        const size_t extra = (seed >> 8) % (i % 10 == 0 ? 24 : 6);
+        for (size_t c = 0; c < extra; ++c) {
+            seed = seed * 1103515245 + 12345;
+            key += static_cast<char> (c % 3 == 0 ? 0x80 + (seed >> 16) % 128 : 'A' + (seed >> 16) % 4);
+        }
+        keys.push_back (key);
+    }
+    std::vector<FixedStr<16> > expected (keys);
+    std::sort (expected.begin(), expected.end());
+
+    const size_t threadCounts[] = { 1, 4 };
+    for (size_t t = 0; t < 2; ++t) {
+        std::vector<FixedStr<16> > sorted (keys);
+        sort_strings (sorted.begin(), sorted.end(), threadCounts[t]);
+        assertTrue   ("sorted", sorted == expected);
+    }
+
+    std::vector<FixedStr<16> > unique (keys);
+    unique.erase (unique_strings (unique.begin(), unique.end()), unique.end());
+    expected.erase (std::unique (expected.begin(), expected.end()), expected.end());
+    assertTrue   ("unique", unique == expected);
+
+    // wchar_t order is the compiler's:  negative first where it's signed.
+    std::vector<WFixedStr<4> > wide;
+    for (int i = 0; i < 2000; ++i) {
+        WFixedStr<4> key;
+        key += static_cast<wchar_t> (i % 3 == 0 ? -(i % 7) : 0x100 * (i % 5) + 'a');
+        key += static_cast<wchar_t> (0x10000 + i % 11);
+        wide.push_back (key);
+    }
+    std::vector<WFixedStr<4> > wideExpected (wide);
+    std::sort (wideExpected.begin(), wideExpected.end());
+    sort_strings (wide.begin(), wide.end());
+    assertTrue   ("wide", wide == wideExpected);
+
+    std::vector<HashedFixedStr<8> > hashed;
+    hashed.push_back (HashedFixedStr<8> ("b"));
+    hashed.push_back (HashedFixedStr<8> ("a"));
+    hashed.push_back (HashedFixedStr<8> ("ab"));
+    sort_strings (hashed.begin(), hashed.end());
+    assertEquals ("hashed", "a", hashed[0].c_str());
+    assertEquals ("hashed", "ab", hashed[1].c_str());
+    assertEquals ("hashed", "b", hashed[2].c_str());
+}
+
+void FixedStrTest::testArray() {
+
+    FixedStrArray<8> a;
+    assertTrue   ("empty", a.empty());
+    a.push_back ("alpha");
+    a.push_back ("");
+    a.push_back ("exactly8");
+    a.push_back ("alphabet soup");          // spills
+    a.push_back (FixedStr<4> ("alpha"));
+    assertEquals ("size", 5, a.size());
+    assertEquals ("view", "alpha", a[0].c_str());
+    assertEquals ("empty", "", a.at (1).data());
+    assertEquals ("full", "exactly8", a[2].c_str());
+    assertEquals ("spilled", "alphabet soup", a[3].c_str());
+    assertEquals ("length", 13, a.length (3));
+    assertTrue   ("view ==", a.view (4) == FixedStrView ("alpha"));
+
+    bool threw = false;
+    try {
+        a.at (5);
+    }
+    catch (std::out_of_range&) {
+        threw = true;
+    }
+    assertTrue   ("at", threw);
+
+    // through the proxy.
+    a[1] = "beta";
+    assertEquals ("assign", "beta", a[1].c_str());
+    a[1] += "max";
+    assertEquals ("append", "betamax", a[1].c_str());
+    a[1].append (" tape");
+    assertEquals ("append spills", "betamax tape", a[1].c_str());
+    assertEquals ("proxy length", 12, a[1].length());
+    assertTrue   ("proxy ==", a[1] == "betamax tape");
+    assertTrue   ("proxy starts_with", a[1].starts_with ("beta"));
+    assertEquals ("proxy find", 8, a[1].find ("tape"));
+    assertEquals ("proxy hash", FixedStr<32> ("betamax tape").hash(), a[1].hash());
+    a[1] = "short";
+    assertEquals ("unspill", "short", a[1].c_str());
+    a[0] = a[3];
+    assertEquals ("copy spilled", "alphabet soup", a[0].c_str());
+    a[3] = a[3].view().substr (9);
+    assertEquals ("self", "soup", a[3].c_str());
+    a[0].clear();
+    assertTrue   ("clear", a[0].empty());
+    a[0] = "alpha";
+    a[3] = "alphabet soup";
+
+    // bulk scans:  alpha, short, exactly8, alphabet soup, alpha.
+    std::vector<size_t> hits;
+    a.find_all ("alpha", std::back_inserter (hits));
+    assertEquals ("find_all", 2, hits.size());
+    assertEquals ("find_all", 0, hits[0]);
+    assertEquals ("find_all", 4, hits[1]);
+    assertEquals ("find", 4, a.find ("alpha", 1));
+    assertEquals ("find long", 3, a.find ("alphabet soup"));
+    assertTrue   ("find none", a.find ("alphabet") == FixedStrArray<8>::npos);
+    assertEquals ("count", 2, a.count ("alpha"));
+    hits.clear();
+    a.starts_with ("alph", std::back_inserter (hits));
+    assertEquals ("starts_with", 3, hits.size());
+    assertEquals ("starts_with", 3, hits[1]);
+    hits.clear();
+    a.starts_with ("alphabet so", std::back_inserter (hits));
+    assertEquals ("starts_with long", 1, hits.size());
+    hits.clear();
+    a.starts_with ("", std::back_inserter (hits));
+    assertEquals ("starts_with empty", 5, hits.size());
+    hits.clear();
+    a.length_between (5, 8, std::back_inserter (hits));
+    assertEquals ("length_between", 4, hits.size());
+    assertEquals ("length_between", 4, hits[3]);
+
+    // lots, against the obvious loop; every 9th spills and replacing them
+    // makes the arena compact.
+    FixedStrArray<16> big;
+    std::vector<std::string> plain;
+    for (int i = 0; i < 20000; ++i) {
+        FixedStr<40> s;
+        s.fmt (i % 9 == 0 ? "host-{}.long.example.com" : "h{}.ex", i % 3000);
+        big.push_back (s);
+        plain.push_back (s.c_str());
+    }
+    for (int round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < plain.size(); i += 9) {
+            FixedStr<40> s;
+            s.fmt ("host-{}.longer.example.com", (i + round) % 3000);
+            big[i] = s;
+            plain[i] = s.c_str();
+        }
+    }
+    bool same = true;
+    for (size_t i = 0; i < plain.size(); ++i) {
+        same = same && big[i] == FixedStrView (plain[i].c_str());
+    }
+    assertTrue   ("big", same);
+    const char* needles[] = { "h17.ex", "host-18.longer.example.com", "h", "nope" };
+    for (size_t n = 0; n < 4; ++n) {
+        std::vector<size_t> found, expected, prefixed, expectedPrefix;
+        big.find_all (needles[n], std::back_inserter (found));
+        big.starts_with (needles[n], std::back_inserter (prefixed));
+        for (size_t i = 0; i < plain.size(); ++i) {
+            if (plain[i] == needles[n]) {
+                expected.push_back (i);
+            }
+            if (plain[i].compare (0, strlen (needles[n]), needles[n]) == 0) {
+                expectedPrefix.push_back (i);
+            }
+        }
+        assertTrue   ("big find_all", found == expected);
+        assertTrue   ("big starts_with", prefixed == expectedPrefix);
+    }
+
+    while (big.size() > 1) {
+        big.pop_back();
+    }
+    assertEquals ("pop_back", plain[0].c_str(), big[0].c_str());
+    big.clear();
+    assertTrue   ("clear", big.empty());
+
+    WFixedStrArray<4> wide;
+    wide.push_back (L"wide");
+    wide.push_back (L"wider still");
+    assertEquals ("wide", L"wider still", wide[1].c_str());
+    assertEquals ("wide find", 1, wide.find (L"wider still"));
+    assertEquals ("wide count", 1, wide.count (L"wide"));
+}
+
+void FixedStrTest::testTable() {
+
+    const char* path = "FixedStrTest.fst";
+
+    // an array:  empty, full, spilled and repeated strings.
+    FixedStrTableWriter<8> out;
+    out.add ("alpha");
+    out.add ("");
+    out.add ("exactly8");
+    out.add ("alphabet soup");
+    out.add (FixedStr<4> ("alpha"));
+    for (int i = 0; i < 1000; ++i) {
+        FixedStr<32> s;
+        s.fmt (i % 10 == 0 ? "a longer one {}" : "s{}", i);
+        out.add (s);
+    }
+    out.write (path);
+
+    {
+        FixedStrTableFile<8> in (path, FixedStrTableFile<8>::VERIFY);
+        assertTrue   ("open", in.is_open());
+        assertEquals ("size", 1005, in.size());
+        assertTrue   ("row", in[0] == FixedStrView ("alpha"));
+        assertTrue   ("empty", in[1].empty());
+        assertTrue   ("full", in[2] == FixedStrView ("exactly8"));
+        assertTrue   ("spilled", in[3] == FixedStrView ("alphabet soup"));
+        assertEquals ("terminated", "alphabet soup", in[3].data());
+        assertEquals ("find", 0, in.find ("alpha"));
+        assertEquals ("find spilled", 3, in.find ("alphabet soup"));
+        assertEquals ("find empty", 1, in.find (""));
+        assertTrue   ("find none", in.find ("alphabet") == FixedStrTableFile<8>::npos);
+        bool same = true;
+        for (int i = 0; i < 1000; ++i) {
+            FixedStr<32> s;
+            s.fmt (i % 10 == 0 ? "a longer one {}" : "s{}", i);
+            same = same && in.at (5 + i) == s.view() && in.find (s) == static_cast<size_t> (5 + i);
+        }
+        assertTrue   ("all", same);
+        bool threw = false;
+        try {
+            in.value<int> (0);
+        }
+        catch (std::invalid_argument&) {
+            threw = true;
+        }
+        assertTrue   ("no values", threw);
+    }
+
+    // a map.
+    FixedStrTableWriter<16> prices;
+    prices.add ("NYSE.IBM", 141.5);
+    prices.add ("LSE.VOD", 0.72);
+    prices.add ("NASDAQ.AAPL.LONG.NAME", 190.25);
+    bool threw = false;
+    try {
+        prices.add ("no value");
+    }
+    catch (std::invalid_argument&) {
+        threw = true;
+    }
+    assertTrue   ("mixed values", threw);
+    prices.write (path);
+    {
+        FixedStrTableFile<16> in (path);
+        assertTrue   ("value", in.value<double> (1) == 0.72);
+        assertTrue   ("find_value", *in.find_value<double> ("NASDAQ.AAPL.LONG.NAME") == 190.25);
+        assertTrue   ("find_value none", in.find_value<double> ("LSE.BP") == NULL);
+
+        // open checks N and the char type.
+        threw = false;
+        try {
+            FixedStrTableFile<8> wrongSize (path);
+        }
+        catch (std::runtime_error&) {
+            threw = true;
+        }
+        assertTrue   ("wrong N", threw);
+        threw = false;
+        try {
+            WFixedStrTableFile<16> wrongChar (path);
+        }
+        catch (std::runtime_error&) {
+            threw = true;
+        }
+        assertTrue   ("wrong char", threw);
+    }
+
+    // damage:  a truncated file fails on open, a changed byte with VERIFY.
+    std::string bytes;
+    FILE* file = fopen (path, "rb");
+    char chunk [4096];
+    size_t got;
+    while ((got = fread (chunk, 1, sizeof chunk, file)) > 0) {
+        bytes.append (chunk, got);
+    }
+    fclose (file);
+    file = fopen (path, "wb");
+    fwrite (bytes.data(), 1, bytes.size() - 1, file);
+    fclose (file);
+    threw = false;
+    try {
+        FixedStrTableFile<16> truncated (path);
+    }
+    catch (std::runtime_error&) {
+        threw = true;
+    }
+    assertTrue   ("truncated", threw);
+    bytes[bytes.size() - 1] ^= 1;
+    file = fopen (path, "wb");
+    fwrite (bytes.data(), 1, bytes.size(), file);
+    fclose (file);
+    threw = false;
+    try {
+        FixedStrTableFile<16> changed (path, FixedStrTableFile<16>::VERIFY);
+    }
+    catch (std::runtime_error&) {
+        threw = true;
+    }
+    assertTrue   ("checksum", threw);
+    FixedStrTableFile<16> unchecked (path);
+    assertEquals ("unchecked", 3, unchecked.size());
+
+    threw = false;
+    try {
+        FixedStrTableFile<16> missing ("no/such/file.fst");
+    }
+    catch (std::runtime_error&) {
+        threw = true;
+    }
+    assertTrue   ("missing", threw);
+
+    WFixedStrTableWriter<4> wout;
+    wout.add (L"wide");
+    wout.add (L"wider still");
+    wout.write (path);
+    WFixedStrTableFile<4> win (path);
+    assertEquals ("wide", L"wider still", win[1].data());
+    assertEquals ("wide find", 1, win.find (L"wider still"));
+    win.close();
+    assertTrue   ("closed", !win.is_open());
+
+    remove (path);
+}
+
+void FixedStrTest::testReader() {
+
+    const char* path = "FixedStrTest.txt";
+
+    // records of all lengths, so plenty straddle the 64KB buffer, some
+    // empty, one much longer than the buffer, \r\n, and no newline at the
+    // end.
+    std::vector<std::string> expected;
+    std::string text;
+    unsigned int seed = 3;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        std::string line (i == 5000 ? 200000 : (seed >> 16) % (i % 50 == 0 ? 300 : 40), 'a' + i % 26);
+        if (i % 7 == 0) {
+            line += '\r';
+        }
+        expected.push_back (line);
+        text += line;
+        if (i < 19999) {
+            text += '\n';
+        }
+    }
+    FILE* file = fopen (path, "wb");
+    fwrite (text.data(), 1, text.size(), file);
+    fclose (file);
+
+    {
+        FixedStrReader in (path, 0, 1);
+        FixedStrView record;
+        bool same = true;
+        size_t n = 0;
+        while (in.next (record)) {
+            same = same && n < expected.size() && record == FixedStrView (expected[n].c_str(), expected[n].length());
+            ++n;
+        }
+        assertTrue   ("records", same);
+        assertEquals ("count", expected.size(), n);
+        assertEquals ("records()", expected.size(), in.records());
+        assertTrue   ("end", !in.next (record));
+    }
+    {
+        // into a FixedStr, from a FILE*, direct I/O asked for (and maybe
+        // not given).
+        FixedStrReader direct (path, FixedStrReader::DIRECT);
+        FixedStr<48> line;
+        size_t n = 0;
+        bool same = true;
+        while (direct.next (line)) {
+            same = same && line == FixedStrView (expected[n].c_str(), expected[n].length());
+            ++n;
+        }
+        assertTrue   ("direct", same && n == expected.size());
+
+        file = fopen (path, "rb");
+        FixedStrReader in (file);
+        n = 0;
+        same = true;
+        while (in.next (line)) {
+            same = same && line == FixedStrView (expected[n].c_str(), expected[n].length());
+            ++n;
+        }
+        fclose (file);
+        assertTrue   ("FILE*", same && n == expected.size());
+    }
+
+    // other delimiters, changed part way; a trailing delimiter gives no
+    // empty last record.
+    file = fopen (path, "wb");
+    fputs ("a,b,,c\nd;e;", file);
+    fclose (file);
+    {
+        FixedStrReader in (path);
+        in.delimiter (',');
+        FixedStrView record;
+        in.next (record);
+        assertTrue   ("comma", record == FixedStrView ("a"));
+        in.next (record);
+        assertTrue   ("comma", record == FixedStrView ("b"));
+        in.next (record);
+        assertTrue   ("empty", record.empty());
+        in.delimiter (';');
+        in.next (record);
+        assertTrue   ("switched", record == FixedStrView ("c\nd"));
+        in.next (record);
+        assertTrue   ("semicolon", record == FixedStrView ("e"));
+        assertTrue   ("end", !in.next (record));
+    }
+
+    file = fopen (path, "wb");
+    fclose (file);
+    {
+        FixedStrReader in (path);
+        FixedStrView record;
+        assertTrue   ("empty file", !in.next (record));
+    }
+
+    bool threw = false;
+    try {
+        FixedStrReader missing ("no/such/file.txt");
+    }
+    catch (std::runtime_error&) {
+        threw = true;
+    }
+    assertTrue   ("missing", threw);
+
+    remove (path);
+}
+
+void FixedStrTest::testSearch() {
+
+    FixedStr<64> s ("GET /index.html HTTP/1.1 /index");
+    assertEquals ("rfind", 25, s.rfind ("/index"));
+    assertEquals ("rfind pos", 4, s.rfind ("/index", 24));
+    assertEquals ("rfind char", 24, s.rfind (' '));
+    assertEquals ("rfind char pos", 15, s.rfind (' ', 23));
+    assertTrue   ("rfind not found", s.rfind ("POST") == FixedStrView::npos);
+    assertTrue   ("rfind before", s.rfind ("HTTP", 3) == FixedStrView::npos);
+    assertEquals ("rfind empty", 31, s.rfind (""));
+    assertEquals ("rfind empty pos", 7, s.rfind ("", 7));
+    assertEquals ("first of", 3, s.find_first_of (" /."));
+    assertEquals ("first of pos", 10, s.find_first_of (" /.", 5));
+    assertTrue   ("first of none", s.find_first_of ("qz#") == FixedStrView::npos);
+    assertTrue   ("first of empty", s.find_first_of ("") == FixedStrView::npos);
+    assertTrue   ("contains", s.contains ("HTTP/1.1"));
+    assertTrue   ("contains", !s.contains ("HTTP/2"));
+    assertTrue   ("contains char", s.contains ('.') && !s.contains ('#'));
+    assertTrue   ("view", FixedStrView (s).rfind ('G') == 0);
+
+    // embedded zeros are just chars.
+    FixedStr<16> zeros;
+    zeros.assign ("ab\0cd\0ef", 8);
+    assertEquals ("zero", 2, zeros.find ('\0'));
+    assertEquals ("zero", 5, zeros.rfind ('\0'));
+    assertEquals ("zero seq", 5, zeros.find (FixedStrView ("\0e", 2)));
+    assertEquals ("zero set", 2, zeros.find_first_of (FixedStrView ("\0d", 2)));
+
+    WFixedStr<32> w (L"wide \x4e2d\x6587 string \x4e2d");
+    assertEquals ("wide find", 5, w.find (L'\x4e2d'));
+    assertEquals ("wide rfind", 15, w.rfind (L'\x4e2d'));
+    assertEquals ("wide seq", 5, w.find (L"\x4e2d\x6587"));
+    assertEquals ("wide first of", 4, w.find_first_of (L" \x6587"));
+    assertTrue   ("wide contains", w.contains (L"string"));
+
+    // every kernel against std::string, over lengths on both sides of the
+    // vector widths, small alphabets (lots of near misses) and high bytes.
+    unsigned int seed = 7;
+    for (int round = 0; round < 3000; ++round) {
+        seed = seed * 1103515245 + 12345;
+        const size_t len = (seed >> 16) % 200;
+        const char base = round % 2 ? 'a' : static_cast<char> (0xf0);
+        std::string hay;
+        for (size_t i = 0; i < len; ++i) {
+            seed = seed * 1103515245 + 12345;
+            hay += static_cast<char> (base + (seed >> 16) % 3);
+        }
+        seed = seed * 1103515245 + 12345;
+        const size_t needleLen = (seed >> 16) % 6;
+        std::string needle;
+        for (size_t i = 0; i < needleLen; ++i) {
+            seed = seed * 1103515245 + 12345;
+            needle += static_cast<char> (base + (seed >> 16) % 4);
+        }
+        seed = seed * 1103515245 + 12345;
+        const size_t pos = (seed >> 16) % (len + 2);
+        std::string set = needle + (round % 5 == 0 ? "0123456789:;<=>?@" : "");
+
+        FixedStr<256> str;
+        str.assign (hay.data(), hay.length());
+        FixedStrView n (needle.data(), needle.length());
+        FixedStrView c (set.data(), set.length());
+        const char ch = needleLen ? needle[0] : base;
+        assertTrue   ("find", str.find (n, pos) == hay.find (needle, pos));
+        assertTrue   ("find char", str.find (ch, pos) == hay.find (ch, pos));
+        assertTrue   ("rfind", str.rfind (n, pos) == hay.rfind (needle, pos));
+        assertTrue   ("rfind all", str.rfind (n) == hay.rfind (needle));
+        assertTrue   ("rfind char", str.rfind (ch, pos) == hay.rfind (ch, pos));
+        assertTrue   ("first of", str.find_first_of (c, pos) == hay.find_first_of (set, pos));
+        assertTrue   ("length", countLen (str.c_str() + pos % (len + 1)) == len - pos % (len + 1));
+
+        std::wstring wideHay (hay.begin(), hay.end());
+        std::wstring wideNeedle (needle.begin(), needle.end());
+        std::wstring wideSet (set.begin(), set.end());
+        WFixedStr<256> wideStr (wideHay.c_str());
+        assertTrue   ("wide find", wideStr.find (WFixedStrView (wideNeedle.c_str()), pos) == wideHay.find (wideNeedle, pos));
+        assertTrue   ("wide rfind", wideStr.rfind (WFixedStrView (wideNeedle.c_str()), pos) == wideHay.rfind (wideNeedle, pos));
+        assertTrue   ("wide first of", wideStr.find_first_of (WFixedStrView (wideSet.c_str()), pos) == wideHay.find_first_of (wideSet, pos));
+        assertTrue   ("wide length", countLen (wideStr.c_str()) == len);
+    }
+}
+
+namespace {
+    // Every (id, offset) of every pattern, by where it ends, the way the
+    // matcher reports them.
+    template<typename _StrT, typename _CharT>
+    std::vector<std::pair<size_t, std::pair<size_t, size_t> > > naiveMatches (
+                    const std::vector<_StrT>& patterns, BaseStrView<_CharT> text) {
+        std::vector<std::pair<size_t, std::pair<size_t, size_t> > > found;
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            BaseStrView<_CharT> pattern (patterns[p]);
+            for (size_t at = text.find (pattern); at != BaseStrView<_CharT>::npos; at = text.find (pattern, at + 1)) {
+                found.push_back (std::make_pair (at + pattern.length(), std::make_pair (p, at)));
+            }
+        }
+        std::sort (found.begin(), found.end());
+        return found;
+    }
+
+    template<typename _MatchT>
+    std::vector<std::pair<size_t, std::pair<size_t, size_t> > > sortedMatches (const std::vector<_MatchT>& matches) {
+        std::vector<std::pair<size_t, std::pair<size_t, size_t> > > found;
+        for (size_t i = 0; i < matches.size(); ++i) {
+            found.push_back (std::make_pair (matches[i].offset + matches[i].length,
+                                             std::make_pair (static_cast<size_t> (matches[i].id), matches[i].offset)));
+        }
+        // same end:  any order.
+        std::sort (found.begin(), found.end());
+        return found;
+    }
+}
+
+void FixedStrTest::testMatcher() {
+
+    std::vector<FixedStr<32> > keywords;
+    keywords.push_back (FixedStr<32> ("he"));
+    keywords.push_back (FixedStr<32> ("she"));
+    keywords.push_back (FixedStr<32> ("his"));
+    keywords.push_back (FixedStr<32> ("hers"));
+    keywords.push_back (FixedStr<32> ("she"));
+    const FixedStrMatcher matcher (keywords.begin(), keywords.end());
+    assertEquals ("size", 5, matcher.size());
+
+    std::vector<FixedStrMatcher::Match> matches = matcher.find_all ("ushers");
+    assertEquals ("count", 4, matches.size());
+    assertEquals ("she", 1, matches[0].id);
+    assertEquals ("she", 1, matches[0].offset);
+    assertEquals ("dup", 4, matches[1].id);
+    assertEquals ("he", 0, matches[2].id);
+    assertEquals ("he", 2, matches[2].offset);
+    assertEquals ("hers", 3, matches[3].id);
+    assertEquals ("hers", 4, matches[3].length);
+    assertTrue   ("none", matcher.find_all ("xyz").empty());
+    assertTrue   ("empty text", !matcher.contains_any (""));
+
+    FixedStrMatcher::Match first = {};
+    assertTrue   ("first", matcher.find_first ("this is hers", &first));
+    assertEquals ("first", 2, first.id);
+    assertEquals ("first", 1, first.offset);
+    assertTrue   ("contains", matcher.contains_any (FixedStr<16> ("a shell")));
+
+    size_t seen = 0;
+    const bool finished = matcher.scan ("she said he had his", [&] (const FixedStrMatcher::Match&) {
+        return ++seen < 3;
+    });
+    assertTrue   ("stopped", !finished);
+    assertEquals ("stopped", 3, seen);
+
+    bool threw = false;
+    std::vector<FixedStrView> withEmpty (1, FixedStrView (""));
+    try {
+        FixedStrMatcher bad (withEmpty.begin(), withEmpty.end());
+    }
+    catch (std::invalid_argument&) {
+        threw = true;
+    }
+    assertTrue   ("empty pattern", threw);
+
+    // against find() of each pattern:  a few patterns (the prefilter, with
+    // AVX2) and many (deep, sparse states), over a small alphabet with
+    // high bytes, whole and in random pieces.
+    unsigned int seed = 11;
+    const size_t patternCounts[] = { 3, 40, 2000 };
+    for (size_t c = 0; c < 3; ++c) {
+        std::vector<FixedStr<32> > patterns;
+        for (size_t p = 0; p < patternCounts[c]; ++p) {
+            seed = seed * 1103515245 + 12345;
+            FixedStr<32> pattern;
+            const size_t len = 1 + (seed >> 16) % (c == 2 ? 12 : 5);
+            for (size_t i = 0; i < len; ++i) {
+                seed = seed * 1103515245 + 12345;
+                pattern += static_cast<char> ((c == 1 ? 0xe0 : 'a') + (seed >> 16) % 4);
+            }
+            patterns.push_back (pattern);
+        }
+        if (c == 2) {
+            // every byte in some pattern:  wide rows, so only the first
+            // thousand or so states are dense.
+            for (int b = 1; b < 256; b += 31) {
+                FixedStr<32> pattern;
+                for (int i = b; i < b + 31 && i < 256; ++i) {
+                    pattern += static_cast<char> (i);
+                }
+                patterns.push_back (pattern);
+            }
+        }
+        const FixedStrMatcher many (patterns.begin(), patterns.end());
+        for (int round = 0; round < 20; ++round) {
+            std::string text;
+            const size_t len = (round * 37) % 500;
+            for (size_t i = 0; i < len; ++i) {
+                seed = seed * 1103515245 + 12345;
+                const unsigned int r = (seed >> 16) % 10;
+                text += r < 4 ? static_cast<char> ((c == 1 ? 0xe0 : 'a') + r) : static_cast<char> ('0' + r);
+            }
+            FixedStrView view (text.data(), text.length());
+            assertTrue   ("all", sortedMatches (many.find_all (view)) == naiveMatches (patterns, view));
+
+            FixedStrMatcher::Stream stream (many);
+            std::vector<FixedStrMatcher::Match> pieces;
+            for (size_t at = 0; at < text.length(); ) {
+                seed = seed * 1103515245 + 12345;
+                const size_t piece = std::min (text.length() - at, static_cast<size_t> ((seed >> 16) % 70));
+                stream.scan (view.substr (at, piece), [&] (const FixedStrMatcher::Match& m) {
+                    pieces.push_back (m);
+                    return true;
+                });
+                at += piece;
+            }
+            assertEquals ("stream offset", text.length(), stream.offset());
+            assertTrue   ("stream", sortedMatches (pieces) == naiveMatches (patterns, view));
+        }
+    }
+
+    // wide:  the automaton is on bytes, so nothing matches across chars.
+    std::vector<WFixedStr<8> > wide;
+    wide.push_back (WFixedStr<8> (L"\x4e2d\x6587"));
+    wide.push_back (WFixedStr<8> (L"a"));
+    wide.push_back (WFixedStr<8> (L"\x6587" L"a"));
+    const WFixedStrMatcher wideMatcher (wide.begin(), wide.end());
+    const wchar_t* wideText = L"x\x4e2d\x6587" L"ab\x6100";
+    std::vector<WFixedStrMatcher::Match> wideMatches = wideMatcher.find_all (wideText);
+    assertTrue   ("wide", sortedMatches (wideMatches) == naiveMatches (wide, WFixedStrView (wideText)));
+    assertEquals ("wide", 3, wideMatches.size());
+
+    // shared by threads.
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += "the shells she sells are hers; ";
+    }
+    const size_t expected = matcher.find_all (text.c_str()).size();
+    std::atomic<size_t> total (0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back (std::thread ([&] {
+            total += matcher.find_all (text.c_str()).size();
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    assertEquals ("threads", 4 * expected, total.load());
+}
+
+void FixedStrTest::testCase() {
+
+    FixedStr<32> header ("Content-Length");
+    assertTrue   ("iequals", header.iequals ("content-length"));
+    assertTrue   ("iequals", header.iequals ("CONTENT-LENGTH"));
+    assertTrue   ("not equal", !header.iequals ("content-lengths"));
+    assertTrue   ("not equal", !header.iequals ("content_length"));
+    assertTrue   ("icompare", header.icompare ("content-length") == 0);
+    assertTrue   ("icompare", header.icompare ("CONTENT-TYPE") < 0);
+    assertTrue   ("icompare", header.icompare ("content") > 0);
+    // compared lower cased, like strcasecmp():  '_' < 'a'.
+    assertTrue   ("icompare", FixedStrView ("A").icompare ("_") > 0);
+    assertTrue   ("ihash", header.ihash() == FixedStrView ("CONTENT-length").ihash());
+    assertTrue   ("ihash", header.ihash() == FixedStr<32> ("content-length").hash());
+
+    FixedStr<8> mixed ("MiXeD 1!");
+    assertEquals ("to_lower", "mixed 1!", mixed.to_lower().c_str());
+    assertEquals ("to_upper", "MIXED 1!", mixed.to_upper().c_str());
+
+    // only ASCII letters change:  UTF-8, '@', '[', '`', '{' stay.
+    FixedStr<64> utf8 ("\xc3\x89t\xc3\xa9 @[`{ \xc3\x80Z");
+    utf8.to_upper();
+    assertEquals ("utf8", "\xc3\x89T\xc3\xa9 @[`{ \xc3\x80Z", utf8.c_str());
+    utf8.to_lower();
+    assertEquals ("utf8", "\xc3\x89t\xc3\xa9 @[`{ \xc3\x80z", utf8.c_str());
+    assertTrue   ("utf8", !FixedStrView ("\xc3\xa9").iequals ("\xc3\x89"));
+
+    // every byte, at every length and offset the vector code splits on,
+    // against one byte at a time.
+    std::string all;
+    for (int b = 0; b < 256; ++b) {
+        all += static_cast<char> (b);
+    }
+    for (size_t len = 0; len <= 80; ++len) {
+        for (size_t start = 0; start + len <= all.length(); start += 37) {
+            std::string lower = all.substr (start, len);
+            std::string upper = lower;
+            for (size_t i = 0; i < len; ++i) {
+                if (lower[i] >= 'A' && lower[i] <= 'Z') lower[i] += 'a' - 'A';
+                if (upper[i] >= 'a' && upper[i] <= 'z') upper[i] -= 'a' - 'A';
+            }
+            FixedStr<16> str;
+            str.assign (all.data() + start, len);
+            FixedStrView lowerView (lower.data(), lower.length());
+            FixedStrView upperView (upper.data(), upper.length());
+            assertTrue   ("iequals", str.iequals (lowerView) && str.iequals (upperView));
+            assertTrue   ("ihash", str.ihash() == lowerView.hash() && str.ihash() == upperView.ihash());
+            str.to_lower();
+            assertTrue   ("to_lower", str == lowerView);
+            str.to_upper();
+            assertTrue   ("to_upper", str == upperView);
+            if (len > 0) {
+                // differs only in the last char, by more than case.
+                std::string other = lower;
+                other[len - 1] = other[len - 1] == 'q' ? 'r' : 'q';
+                FixedStrView otherView (other.data(), other.length());
+                assertTrue   ("differs", !str.iequals (otherView));
+                const int expected = strcmp (lower.c_str() + len - 1, other.c_str() + len - 1) < 0 ? -1 : 1;
+                if (lower.find ('\0') == std::string::npos) {
+                    assertEquals ("icompare", expected, str.icompare (otherView) < 0 ? -1 : 1);
+                }
+            }
+        }
+    }
+
+    WFixedStr<16> wide (L"Stra\x00df" L"e \x00c4ND");
+    assertTrue   ("wide iequals", wide.iequals (L"STRA\x00df" L"E \x00e4nd") == (towlower (0xc4) == 0xe4));
+    assertTrue   ("wide iequals", wide.iequals (L"strA\x00df" L"e \x00c4nd"));
+    assertTrue   ("wide ihash", wide.ihash() == WFixedStrView (L"STRA\x00df" L"E \x00c4nd").ihash());
+    assertTrue   ("wide icompare", wide.icompare (L"strasse") > 0);
+    wide.to_lower();
+    assertTrue   ("wide to_lower", wide.iequals (L"stra\x00df" L"e \x00c4nd") && wide.c_str()[8] == L'n');
+    std::wstring longWide (150, L'Q');
+    WFixedStr<8> longWideStr (longWide.c_str());
+    std::wstring longWideLower (150, L'q');
+    assertTrue   ("wide long ihash", longWideStr.ihash() == WFixedStrView (longWideLower.c_str()).ihash());
+    // the hash of the lower-cased string at every length, short or long.
+    for (size_t len = 0; len <= 150; ++len) {
+        std::wstring mixedCase;
+        for (size_t i = 0; i < len; ++i) {
+            mixedCase += static_cast<wchar_t> (i % 3 ? L'A' + i % 26 : L'z' - i % 26);
+        }
+        WFixedStr<8> lowered (mixedCase.c_str());
+        lowered.to_lower();
+        assertTrue   ("wide ihash", WFixedStrView (mixedCase.c_str()).ihash() == lowered.hash());
+    }
+
+    std::unordered_map<FixedStr<32>, int, FixedStrIHash, FixedStrIEqual> headers;
+    headers[FixedStr<32> ("Content-Length")] = 1;
+    headers[FixedStr<32> ("HOST")] = 2;
+    headers[FixedStr<32> ("content-length")] = 3;
+    assertEquals ("map", 2, headers.size());
+    assertEquals ("map", 3, headers[FixedStr<32> ("CONTENT-LENGTH")]);
+    assertEquals ("map", 2, headers[FixedStr<32> ("host")]);
+
+    HashedFixedStr<16> hashed ("AbC");
+    const size_t before = hashed.hash();
+    hashed.to_lower();
+    assertTrue   ("hashed", hashed.hash() != before && hashed.hash() == FixedStrView ("abc").hash());
+}
+
+void FixedStrTest::testUtf8() {
+
+    // 1, 2, 3 and 4 byte chars.
+    const char* text = "caf\xc3\xa9 \xe2\x82\xac" "5 \xf0\x9f\x98\x80!";
+    WFixedStr<32> wide;
+    assertTrue   ("decode", FixedStrUtf8::decode (wide, text));
+    assertFalse  ("inline", wide.isUsingOverflow());
+    if (sizeof (wchar_t) == 4) {
+        assertTrue   ("decode", wide == WFixedStrView (L"caf\x00e9 \x20ac" L"5 \x1f600!"));
+    }
+    else {
+        assertTrue   ("decode", wide == WFixedStrView (L"caf\x00e9 \x20ac" L"5 \xd83d\xde00!"));
+    }
+    assertEquals ("decodedLength", wide.length(), FixedStrUtf8::decodedLength (text));
+    FixedStr<32> back;
+    assertTrue   ("encode", FixedStrUtf8::encode (back, wide));
+    assertEquals ("encode", text, back.c_str());
+    assertEquals ("encodedLength", strlen (text), FixedStrUtf8::encodedLength (wide));
+
+    // the limits of each length, both ways.
+    const uint32_t points[] = { 0x01, 0x7f, 0x80, 0x7ff, 0x800, 0xd7ff, 0xe000, 0xfffd, 0xffff,
+                                0x10000, 0x10ffff };
+    for (size_t i = 0; i < sizeof (points) / sizeof (points[0]); ++i) {
+        unsigned char utf8[4];
+        size_t len = 0;
+        std::u32string one (1, static_cast<char32_t> (points[i]));
+        len = utf8EncodedMeasure (one.data(), 1, NULL);
+        utf8Encode (utf8, len, one.data(), 1);
+        char32_t decoded = 0;
+        assertEquals ("measure", 1, utf8Measure<char32_t> (utf8, len, NULL));
+        utf8Decode (&decoded, 1, utf8, len);
+        assertTrue   ("round trip", decoded == points[i]);
+        assertEquals ("length", points[i] < 0x80 ? 1 : points[i] < 0x800 ? 2 : points[i] < 0x10000 ? 3 : 4, len);
+    }
+
+    // malformed:  where it's reported, and the target isn't touched.
+    struct {
+        const char* in;
+        size_t      errorAt;
+    } bad[] = {
+        { "\x80", 0 },                  // lone continuation
+        { "ab\xc3", 2 },                // cut off
+        { "ab\xe2\x82", 2 },
+        { "\xc3\x28", 0 },              // not a continuation
+        { "\xc0\xaf", 0 },              // overlong
+        { "\xc1\xbf", 0 },
+        { "x\xe0\x80\xaf", 1 },
+        { "xy\xf0\x8f\xbf\xbf", 2 },
+        { "\xed\xa0\x80", 0 },          // surrogate
+        { "\xed\xbf\xbf", 0 },
+        { "\xf4\x90\x80\x80", 0 },      // past U+10FFFF
+        { "\xf5\x80\x80\x80", 0 },
+        { "\xff", 0 },
+        { "0123456789abcdef0123456789abcdef\xe2\x82\xac\xe2\x28\xac", 35 }
+    };
+    const WFixedStr<32> before (wide);
+    for (size_t i = 0; i < sizeof (bad) / sizeof (bad[0]); ++i) {
+        size_t errorAt = 99;
+        assertFalse  ("invalid", FixedStrUtf8::decode (wide, bad[i].in, &errorAt));
+        assertEquals ("errorAt", bad[i].errorAt, errorAt);
+        assertTrue   ("untouched", wide == before);
+        assertTrue   ("decodedLength", FixedStrUtf8::decodedLength (bad[i].in) == FixedStrView::npos);
+    }
+    assertTrue   ("valid edges", FixedStrUtf8::decodedLength ("\xed\x9f\xbf\xee\x80\x80\xf4\x8f\xbf\xbf") == (sizeof (wchar_t) == 4 ? 3 : 4));
+
+    const wchar_t loneSurrogate[] = { L'a', static_cast<wchar_t> (0xdc00), 0 };
+    size_t errorAt = 99;
+    assertFalse  ("lone surrogate", FixedStrUtf8::encode (back, loneSurrogate, &errorAt));
+    assertEquals ("lone surrogate", 1, errorAt);
+    assertEquals ("untouched", text, back.c_str());
+    if (sizeof (wchar_t) == 4) {
+        const wchar_t tooBig[] = { static_cast<wchar_t> (0x110000), 0 };
+        assertFalse  ("past U+10FFFF", FixedStrUtf8::encode (back, tooBig, &errorAt));
+        assertEquals ("past U+10FFFF", 0, errorAt);
+    }
+
+    // UTF-16 (2 byte wchar_t):  surrogate pairs.
+    const unsigned char grin[] = { 0xf0, 0x9f, 0x98, 0x80 };
+    char16_t pair[2];
+    assertEquals ("utf16 measure", 2, utf8Measure<char16_t> (grin, 4, NULL));
+    utf8Decode (pair, 2, grin, 4);
+    assertTrue   ("utf16 pair", pair[0] == 0xd83d && pair[1] == 0xde00);
+    unsigned char grinBack[4];
+    assertEquals ("utf16 encoded", 4, utf8EncodedMeasure (pair, 2, NULL));
+    utf8Encode (grinBack, 4, pair, 2);
+    assertTrue   ("utf16 round trip", memcmp (grin, grinBack, 4) == 0);
+    const char16_t highAtEnd[] = { u'a', 0xd83d };
+    const char16_t lowFirst[] = { 0xde00, 0xd83d };
+    const char16_t highThenA[] = { 0xd83d, u'a' };
+    assertTrue   ("utf16 high at end", utf8EncodedMeasure (highAtEnd, 2, &errorAt) == UTF8_INVALID && errorAt == 1);
+    assertTrue   ("utf16 low first", utf8EncodedMeasure (lowFirst, 2, &errorAt) == UTF8_INVALID && errorAt == 0);
+    assertTrue   ("utf16 unpaired", utf8EncodedMeasure (highThenA, 2, &errorAt) == UTF8_INVALID && errorAt == 0);
+    assertEquals ("utf16 units", 2, utf8Units<char16_t> (grin, 4));
+    assertEquals ("utf32 units", 1, utf8Units<char32_t> (grin, 4));
+
+    // a 2, 3 or 4 byte char at every spot the block code splits on, or
+    // 2 byte chars from there on, both ways.
+    for (size_t len = 0; len <= 80; ++len) {
+        for (size_t at = 0; at <= len; ++at) {
+            std::string utf8;
+            std::wstring expected;
+            const size_t kind = (len + at) % 4;
+            for (size_t i = 0; i < len; ++i) {
+                if (i == at && kind == 0) {
+                    utf8 += "\xc3\xa9";
+                    expected += static_cast<wchar_t> (0xe9);
+                }
+                if (i == at && kind == 1) {
+                    utf8 += "\xe2\x82\xac";
+                    expected += static_cast<wchar_t> (0x20ac);
+                }
+                if (i == at && kind == 2) {
+                    utf8 += "\xf0\x9f\x98\x80";
+                    if (sizeof (wchar_t) == 4) {
+                        expected += static_cast<wchar_t> (0x1f600);
+                    }
+                    else {
+                        expected += static_cast<wchar_t> (0xd83d);
+                        expected += static_cast<wchar_t> (0xde00);
+                    }
+                }
+                if (i >= at && kind == 3 && i % 3 != 0) {
+                    utf8 += "\xd0\xb4";
+                    expected += static_cast<wchar_t> (0x434);
+                }
+                else {
+                    utf8 += static_cast<char> ('!' + i % 90);
+                    expected += static_cast<wchar_t> ('!' + i % 90);
+                }
+            }
+            WFixedStr<16> decoded;
+            assertTrue   ("blocks decode", FixedStrUtf8::decode (decoded, FixedStrView (utf8.data(), utf8.length())));
+            assertTrue   ("blocks decode", decoded == WFixedStrView (expected.data(), expected.length()));
+            FixedStr<16> encoded;
+            assertTrue   ("blocks encode", FixedStrUtf8::encode (encoded, decoded));
+            assertTrue   ("blocks encode", encoded == FixedStrView (utf8.data(), utf8.length()));
+            assertEquals ("blocks units", expected.length(),
+                          utf8Units<wchar_t> (reinterpret_cast<const unsigned char*> (utf8.data()), utf8.length()));
+            assertEquals ("blocks length", utf8.length(), FixedStrUtf8::encodedLength (decoded));
+            if (!utf8.empty()) {
+                // cut off in the last char.
+                const size_t last = utf8.length() - 1;
+                const bool multi = (utf8[last] & 0xc0) == 0x80;
+                assertEquals ("cut off", multi, FixedStrUtf8::decodedLength (FixedStrView (utf8.data(), last)) == FixedStrView::npos);
+            }
+        }
+    }
+
+    // one allocation of exactly the right size.
+    std::string longText;
+    for (int i = 0; i < 10; ++i) {
+        longText += "na\xc3\xafve ";
+    }
+    WFixedStr<8> longWide;
+    assertTrue   ("overflow", FixedStrUtf8::decode (longWide, longText.c_str()));
+    assertTrue   ("overflow", longWide.isUsingOverflow());
+    assertEquals ("exact", 60, longWide.capacity());
+    FixedStr<8> longBack;
+    assertTrue   ("overflow", FixedStrUtf8::encode (longBack, longWide));
+    assertEquals ("exact", 70, longBack.capacity());
+    assertEquals ("overflow", longText.c_str(), longBack.c_str());
+
+    // will it fit?
+    assertTrue   ("decodeFits", FixedStrUtf8::decodeFits<8> ("12345678"));
+    assertFalse  ("decodeFits", FixedStrUtf8::decodeFits<8> ("123456789"));
+    assertTrue   ("decodeFits", FixedStrUtf8::decodeFits<8> ("\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9"));
+    assertFalse  ("decodeFits", FixedStrUtf8::decodeFits<8> (longText.c_str()));
+    assertTrue   ("decodeFits", FixedStrUtf8::decodeFits<60> (longText.c_str()));
+    assertFalse  ("decodeFits", FixedStrUtf8::decodeFits<59> (longText.c_str()));
+    assertTrue   ("encodeFits", FixedStrUtf8::encodeFits<8> (L"ab"));
+    assertTrue   ("encodeFits", FixedStrUtf8::encodeFits<8> (L"abcdefgh"));
+    assertFalse  ("encodeFits", FixedStrUtf8::encodeFits<8> (L"abcdefghi"));
+    assertFalse  ("encodeFits", FixedStrUtf8::encodeFits<8> (L"abcdefg\x00e9"));
+    assertTrue   ("encodeFits", FixedStrUtf8::encodeFits<70> (longWide));
+    assertFalse  ("encodeFits", FixedStrUtf8::encodeFits<69> (longWide));
+    assertTrue   ("back inline", FixedStrUtf8::decode (longWide, "short") && !longWide.isUsingOverflow());
+}
+
+void FixedStrTest::testParse() {
+
+    FixedStr<32> qty ("-12345 shares");
+    FixedStrParsed<int> parsed = qty.parse<int>();
+    assertTrue   ("ok", parsed.ok());
+    assertEquals ("value", -12345, parsed.value);
+    assertEquals ("length", 6, static_cast<int> (parsed.length));
+    int whole = 7;
+    assertFalse  ("whole", qty.parse (whole));
+    assertEquals ("untouched", 7, whole);
+    assertTrue   ("whole", FixedStrView ("+42").parse (whole));
+    assertEquals ("whole", 42, whole);
+
+    const char* invalid[] = { "", "-", "+", " 1", "x1", "--1", "+-1" };
+    for (size_t i = 0; i < sizeof (invalid) / sizeof (invalid[0]); ++i) {
+        parsed = FixedStrView (invalid[i]).parse<int>();
+        assertTrue   ("invalid", parsed.status == FixedStrParse::INVALID && parsed.length == 0);
+    }
+    assertTrue   ("unsigned", FixedStrView ("-1").parse<unsigned>().status == FixedStrParse::INVALID);
+    assertTrue   ("unsigned", FixedStrView ("-0").parse<unsigned>().status == FixedStrParse::INVALID);
+
+    // limits, and one past them:  clamped, but still consumed.
+    assertEquals ("max", INT_MAX, FixedStrView ("2147483647").parse<int>().value);
+    assertEquals ("min", INT_MIN, FixedStrView ("-2147483648").parse<int>().value);
+    parsed = FixedStrView ("2147483648;").parse<int>();
+    assertTrue   ("over", parsed.status == FixedStrParse::OUT_OF_RANGE && parsed.value == INT_MAX);
+    assertEquals ("over", 10, static_cast<int> (parsed.length));
+    parsed = FixedStrView ("-2147483649").parse<int>();
+    assertTrue   ("under", parsed.status == FixedStrParse::OUT_OF_RANGE && parsed.value == INT_MIN);
+    assertTrue   ("llong", FixedStrView ("9223372036854775807").parse<long long>().value == LLONG_MAX);
+    assertTrue   ("llong", FixedStrView ("-9223372036854775808").parse<long long>().value == LLONG_MIN);
+    assertFalse  ("llong", FixedStrView ("9223372036854775808").parse<long long>().ok());
+    assertTrue   ("ullong", FixedStrView ("18446744073709551615").parse<unsigned long long>().value == ULLONG_MAX);
+    assertFalse  ("ullong", FixedStrView ("18446744073709551616").parse<unsigned long long>().ok());
+    assertFalse  ("ullong", FixedStrView ("99999999999999999999").parse<unsigned long long>().ok());
+    assertFalse  ("ullong", FixedStrView ("100000000000000000000").parse<unsigned long long>().ok());
+    assertTrue   ("uchar", FixedStrView ("255").parse<unsigned char>().value == 255);
+    assertFalse  ("uchar", FixedStrView ("256").parse<unsigned char>().ok());
+    assertTrue   ("zeros", FixedStrView ("0000000000000000000000000000042").parse<long long>().value == 42);
+    assertTrue   ("zero", FixedStrView ("-0").parse<int>().ok());
+
+    // stops at an embedded zero like any other char.
+    assertEquals ("embedded", 2, static_cast<int> (FixedStrView ("12\0" "34", 5).parse<int>().length));
+
+    // every length, with a stop at every place the 16 and 8 digit blocks
+    // could miss it.
+    const char digits[] = "98765432109876543210987654321";
+    for (size_t len = 1; len <= 19; ++len) {
+        for (size_t stop = 0; stop <= len; ++stop) {
+            std::string text (digits, len);
+            if (stop < len) {
+                text[stop] = stop % 2 ? '/' : ':';
+            }
+            text += "12345678901234567890";
+            const unsigned long long expected = strtoull (text.c_str(), NULL, 10);
+            const FixedStrParsed<unsigned long long> got =
+                FixedStrView (text.c_str(), text.length()).parse<unsigned long long>();
+            const size_t expectedLength = stop < len ? stop : text.length();
+            if (expectedLength > 20 || expectedLength == 0) {
+                continue;
+            }
+            assertTrue   ("digits", got.value == expected && got.length == expectedLength);
+
+            std::wstring wide (text.begin(), text.end());
+            const FixedStrParsed<unsigned long long> gotWide =
+                WFixedStrView (wide.c_str(), wide.length()).parse<unsigned long long>();
+            assertTrue   ("wide digits", gotWide.value == expected && gotWide.length == expectedLength);
+        }
+    }
+
+    // a wide char that narrows to a digit's low byte isn't one.
+    std::wstring wide (L"12345678901234567890");
+    wide[13] = static_cast<wchar_t> (0x100 + '4');
+    assertEquals ("wide", 13, static_cast<int> (WFixedStrView (wide.c_str()).parse<long long>().length));
+    wide[13] = '4';
+    wide[5] = static_cast<wchar_t> (0x100 + '6');
+    assertEquals ("wide", 5, static_cast<int> (WFixedStrView (wide.c_str()).parse<long long>().length));
+    WFixedStr<8> wideQty (L"-250000000000 units");
+    assertTrue   ("wide", wideQty.parse<long long>().value == -250000000000LL);
+
+    // floats.
+    FixedStrParsed<double> price = FixedStrView ("101.25,B").parse<double>();
+    assertTrue   ("double", price.ok() && price.value == 101.25);
+    assertEquals ("double", 6, static_cast<int> (price.length));
+    double value = 0;
+    assertTrue   ("double", FixedStrView ("-.5").parse (value) && value == -0.5);
+    assertTrue   ("double", FixedStrView ("5.").parse (value) && value == 5);
+    assertTrue   ("double", FixedStrView ("1.5e-7").parse (value) && value == 1.5e-7);
+    assertTrue   ("double", FixedStrView ("2E+3").parse (value) && value == 2000);
+    assertTrue   ("neg zero", FixedStrView ("-0.0").parse (value) && value == 0 && std::signbit (value));
+    assertTrue   ("zero", FixedStrView ("0e999999999999").parse (value) && value == 0);
+    // an 'e' without digits isn't part of the number.
+    assertEquals ("exponent", 1, static_cast<int> (FixedStrView ("1e").parse<double>().length));
+    assertEquals ("exponent", 1, static_cast<int> (FixedStrView ("1e+").parse<double>().length));
+    assertEquals ("exponent", 2, static_cast<int> (FixedStrView ("1.e-x").parse<double>().length));
+    assertTrue   ("invalid", FixedStrView (".").parse<double>().status == FixedStrParse::INVALID);
+    assertTrue   ("invalid", FixedStrView ("-.e1").parse<double>().status == FixedStrParse::INVALID);
+    assertTrue   ("invalid", FixedStrView ("in").parse<double>().status == FixedStrParse::INVALID);
+
+    assertTrue   ("inf", FixedStrView ("inf").parse (value) && value == HUGE_VAL);
+    assertTrue   ("inf", FixedStrView ("-Infinity").parse (value) && value == -HUGE_VAL);
+    assertEquals ("inf", 3, static_cast<int> (FixedStrView ("infinite").parse<double>().length));
+    assertTrue   ("nan", FixedStrView ("NaN").parse (value) && value != value);
+
+    price = FixedStrView ("1e400").parse<double>();
+    assertTrue   ("overflow", price.status == FixedStrParse::OUT_OF_RANGE && price.value == HUGE_VAL);
+    price = FixedStrView ("-1e-400").parse<double>();
+    assertTrue   ("underflow", price.status == FixedStrParse::OUT_OF_RANGE && price.value == 0);
+    assertEquals ("underflow", 7, static_cast<int> (price.length));
+
+    // the hard ones:  halfway points, subnormals, more digits than fit.
+    const char* hard[] = {
+        "9007199254740993",
+        "9007199254740993.0000000000000000000001",
+        "9007199254740995",
+        "2.2250738585072011e-308",
+        "2.2250738585072014e-308",
+        "4.9406564584124654e-324",
+        "2.4703282292062327e-324",
+        "2.4703282292062328e-324",
+        "1.7976931348623157e308",
+        "1.7976931348623158e308",
+        "0.1000000000000000055511151231257827021181583404541015625",
+        "0.1000000000000000055511151231257827021181583404541015624",
+        "7.2057594037927933e+16",
+        "123456789012345678901234567890e-30",
+        "0.000000000000000000000000000000000000000000000000000000000001234",
+        "3.14159265358979323846264338327950288419716939937510582097494459"
+    };
+    for (size_t i = 0; i < sizeof (hard) / sizeof (hard[0]); ++i) {
+        // (some round to 0 or inf:  OUT_OF_RANGE, but the same value.)
+        assertTrue   (hard[i], FixedStrView (hard[i]).parse<double>().value == strtod (hard[i], NULL));
+        std::string text (hard[i]);
+        std::wstring wideText (text.begin(), text.end());
+        assertTrue   (hard[i], WFixedStrView (wideText.c_str()).parse<double>().value == strtod (hard[i], NULL));
+        assertTrue   (hard[i], FixedStrView (hard[i]).parse<float>().value == strtof (hard[i], NULL));
+    }
+
+    // round trips of doubles all over the range.
+    uint64_t bits = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < 20000; ++i) {
+        bits ^= bits << 13;
+        bits ^= bits >> 7;
+        bits ^= bits << 17;
+        double expected;
+        memcpy (&expected, &bits, sizeof (expected));
+        if (expected != expected || expected - expected != 0) {
+            continue;
+        }
+        char text[32];
+        snprintf (text, sizeof (text), "%.17g", expected);
+        assertTrue   ("round trip", FixedStrView (text).parse (value) && value == expected);
+        snprintf (text, sizeof (text), "%.*g", 1 + i % 16, expected);
+        assertTrue   ("short", FixedStrView (text).parse<double>().value == strtod (text, NULL));
+    }
+
+    float single = 0;
+    assertTrue   ("float", FixedStrView ("3.4028235e38").parse (single) && single == FLT_MAX);
+    assertTrue   ("float", FixedStrView ("1.17549435e-38").parse (single) && single == FLT_MIN);
+    assertTrue   ("float", FixedStrView ("1.4e-45").parse (single) && single == std::numeric_limits<float>::denorm_min());
+    assertTrue   ("float", FixedStrView ("0.1").parse (single) && single == 0.1f);
+    assertTrue   ("float", FixedStrView ("16777217").parse (single) && single == 16777216.0f);
+    assertTrue   ("float", FixedStrView ("1e39").parse<float>().status == FixedStrParse::OUT_OF_RANGE);
+
+    // from a string on its overflow.
+    FixedStr<8> longPrice ("1234567.890123456789");
+    assertTrue   ("overflow", longPrice.isUsingOverflow() && longPrice.parse (value) && value == 1234567.890123456789);
+    WFixedStr<8> widePrice (L"0.00012345 BTC");
+    price = widePrice.parse<double>();
+    assertTrue   ("wide", price.ok() && price.value == 0.00012345);
+    assertEquals ("wide", 10, static_cast<int> (price.length));
+}
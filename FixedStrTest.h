@@ -18,15 +18,36 @@ public:
     void testSizeof();
     void testAssign();
     void testCtors();
+    void testMove();
+    void testResource();
+    void testStats();
+    void testCapacity();
     void testAppend();
     void testEmbeddedZeroes();
     void testEmbeddedZeroesW();
     void testNonMemberOpers();
     void testEqualStr();    
+    void testEqualKernels();
+    void testCompare();
     void testWFixedStr();
     void testFormat();
+    void testFmt();
+    void testBuilder();
+    void testConcat();
     void testSubstring();
-    void testPerf();
+    void testView();
+    void testHash();
+    void testMap();
+    void testIntern();
+    void testSort();
+    void testArray();
+    void testTable();
+    void testReader();
+    void testSearch();
+    void testMatcher();
+    void testCase();
+    void testUtf8();
+    void testParse();
 
 
     void runTests() {
@@ -35,16 +56,36 @@ public:
         testSizeof();
         testAssign();
         testCtors();
+        testMove();
+        testResource();
+        testStats();
+        testCapacity();
         testAppend();
         testEmbeddedZeroes();        
         testEmbeddedZeroesW();
         testNonMemberOpers();
         testEqualStr();        
+        testEqualKernels();
+        testCompare();
         testWFixedStr();
         testFormat();        
+        testFmt();
+        testBuilder();
+        testConcat();
         testSubstring();        
-                        
-        //testPerf();
+        testView();
+        testHash();
+        testMap();
+        testIntern();
+        testSort();
+        testArray();
+        testTable();
+        testReader();
+        testSearch();
+        testMatcher();
+        testCase();
+        testUtf8();
+        testParse();
         
     }
 
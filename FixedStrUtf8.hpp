@@ -0,0 +1,462 @@
+#ifndef FIXED_STR_UTF8_H
+#define FIXED_STR_UTF8_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "FixedStr.hpp"
+
+/*
+ *  FixedStrUtf8
+ *  UTF-8 <-> wchar_t, between a FixedStr (or any view of chars) and a
+ *  WFixedStr.  mbstowcs()/wcstombs() depend on the locale, go a char at a
+ *  time through mbrtowc(), and want a buffer of their own to copy from.
+ *
+ *      WFixedStr<64> name;
+ *      size_t bad;
+ *      if (!FixedStrUtf8::decode (name, field, &bad)) {
+ *          ... field isn't UTF-8 from byte 'bad' on ...
+ *      }
+ *      FixedStrUtf8::encode (out, name);
+ *
+ *  The input is checked first, which also gives the exact length, and
+ *  then converted straight into the target's array, or one overflow of
+ *  exactly that size.  Invalid input (bad or cut-off sequences, overlong
+ *  forms, surrogates, anything past U+10FFFF) leaves the target as it
+ *  was.  Blocks of ASCII, and of 1 and 2 byte chars, are checked and
+ *  converted 16 at a time (SSE2).
+ *
+ *  wchar_t is UTF-32 where it's 4 bytes and UTF-16 where it's 2
+ *  (Windows):  there, chars past U+FFFF become surrogate pairs, and only
+ *  properly paired surrogates encode.
+ *
+ *  decodeFits()/encodeFits() say whether the result would fit a given
+ *  array without converting, and mostly without reading the input:  its
+ *  length alone decides unless it's close.
+ */
+
+namespace {
+
+    const size_t UTF8_INVALID = static_cast<size_t> (-1);
+
+    // ASCII bytes from in[i] on (there's at least one).  Near the end, a
+    // block that overlaps the one before is used rather than go a byte at
+    // a time.
+    inline size_t asciiRun (const unsigned char* in, size_t i, size_t n) {
+        if (n - i >= 16) {
+            return asciiPrefix16 (in + i);
+        }
+        if (n >= 16) {
+            const uint32_t high = bytesFrom16 (in + n - 16, 0x80) >> (16 - (n - i));
+            return high ? lowestBit (high) : n - i;
+        }
+        return 1;
+    }
+
+    // The same for units.
+    template<typename _UnitT>
+    inline size_t asciiRun (const _UnitT* in, size_t i, size_t n) {
+        if (n - i >= 16) {
+            const uint32_t other = ~unitsBelow16 (in + i, 0x80) & 0xffff;
+            return other ? lowestBit (other) : 16;
+        }
+        if (n >= 16) {
+            const uint32_t other = (~unitsBelow16 (in + n - 16, 0x80) & 0xffff) >> (16 - (n - i));
+            return other ? lowestBit (other) : n - i;
+        }
+        return 1;
+    }
+
+    // Units the UTF-8 at 'in' decodes to, checking it as it goes.
+    // UTF8_INVALID if it isn't valid, with the offset of the bad sequence
+    // in 'errorAt'.
+    //
+    // Blocks of ASCII and 2 byte chars are checked whole, the last one
+    // overlapping the one before.  A block with anything else goes a char
+    // at a time, and the next block check waits until past it.
+    template<typename _UnitT>
+    inline size_t utf8Measure (const unsigned char* in, size_t n, size_t* errorAt) {
+        size_t units = 0;
+        size_t i = 0;
+        size_t blockFrom = 0;
+        while (i < n) {
+            if (i >= blockFrom && n >= 16) {
+                const size_t at = n - i >= 16 ? i : n - 16;
+                size_t chars;
+                const size_t len = utf8TwoByteBlock (in + at, i - at, chars);
+                if (len) {
+                    units += chars;
+                    i += len;
+                    continue;
+                }
+                blockFrom = i + 16;
+            }
+            const unsigned int c = in[i];
+            if (c < 0x80) {
+                const size_t run = asciiRun (in, i, n);
+                units += run;
+                i += run;
+                continue;
+            }
+            // the second byte's range rules out overlong forms, surrogates
+            // and anything past U+10FFFF.
+            size_t len = 0;
+            unsigned int lo = 0x80;
+            unsigned int hi = 0xbf;
+            if (c >= 0xc2 && c < 0xe0) {
+                len = 2;
+            }
+            else if (c >= 0xe0 && c < 0xf0) {
+                len = 3;
+                lo = c == 0xe0 ? 0xa0 : lo;
+                hi = c == 0xed ? 0x9f : hi;
+            }
+            else if (c >= 0xf0 && c < 0xf5) {
+                len = 4;
+                lo = c == 0xf0 ? 0x90 : lo;
+                hi = c == 0xf4 ? 0x8f : hi;
+            }
+            if (len == 0 ||
+                n - i < len ||
+                in[i + 1] < lo || in[i + 1] > hi ||
+                (len > 2 && (in[i + 2] & 0xc0) != 0x80) ||
+                (len > 3 && (in[i + 3] & 0xc0) != 0x80)) {
+                if (errorAt) {
+                    *errorAt = i;
+                }
+                return UTF8_INVALID;
+            }
+            units += len == 4 && sizeof (_UnitT) == 2 ? 2 : 1;
+            i += len;
+        }
+        return units;
+    }
+
+    // Decodes the UTF-8 at 'in', which utf8Measure() has passed as
+    // 'units' long, to 'out'.  Blocks go the same way as there:  ASCII is
+    // widened a block at a time while the block fits the output, and
+    // blocks of 1 and 2 byte chars go without a branch per char.
+    template<typename _UnitT>
+    inline void utf8Decode (_UnitT* out, size_t units, const unsigned char* in, size_t n) {
+        _UnitT* const outEnd = out + units;
+        size_t i = 0;
+        size_t blockFrom = 0;
+        while (i < n) {
+            if (i >= blockFrom && n >= 16) {
+                const size_t at = n - i >= 16 ? i : n - 16;
+                if (at == i && bytesFrom16 (in + i, 0x80) == 0) {
+                    widen16 (out, in + i);
+                    out += 16;
+                    i += 16;
+                    continue;
+                }
+                if ((bytesFrom16 (in + at, 0xe0) >> (i - at)) == 0) {
+                    i += utf8TwoByteDecode16 (out, in + at, i - at);
+                    continue;
+                }
+                blockFrom = i + 16;
+            }
+            const uint32_t c = in[i];
+            if (c < 0x80) {
+                if (n - i >= 16 && outEnd - out >= 16) {
+                    widen16 (out, in + i);
+                    const size_t run = asciiPrefix16 (in + i);
+                    out += run;
+                    i += run;
+                }
+                else {
+                    *out++ = static_cast<_UnitT> (c);
+                    ++i;
+                }
+            }
+            else if (c < 0xe0) {
+                *out++ = static_cast<_UnitT> (((c & 0x1f) << 6) | (in[i + 1] & 0x3f));
+                i += 2;
+            }
+            else if (c < 0xf0) {
+                *out++ = static_cast<_UnitT> (((c & 0x0f) << 12) | ((in[i + 1] & 0x3f) << 6) | (in[i + 2] & 0x3f));
+                i += 3;
+            }
+            else {
+                const uint32_t cp = ((c & 0x07) << 18) | ((in[i + 1] & 0x3f) << 12) |
+                                    ((in[i + 2] & 0x3f) << 6) | (in[i + 3] & 0x3f);
+                if (sizeof (_UnitT) == 2) {
+                    *out++ = static_cast<_UnitT> (0xd800 + ((cp - 0x10000) >> 10));
+                    *out++ = static_cast<_UnitT> (0xdc00 + (cp & 0x3ff));
+                }
+                else {
+                    *out++ = static_cast<_UnitT> (cp);
+                }
+                i += 4;
+            }
+        }
+    }
+
+    // UTF-8 bytes the units at 'in' encode to, checking them as it goes:
+    // UTF8_INVALID for a surrogate that isn't part of a pair (or any, with
+    // 4 byte units) or a value past U+10FFFF, with its index in 'errorAt'.
+    // Blocks below U+0800 can't be either, and are counted whole (the
+    // last overlapping the one before).
+    template<typename _UnitT>
+    inline size_t utf8EncodedMeasure (const _UnitT* in, size_t n, size_t* errorAt) {
+        size_t bytes = 0;
+        size_t i = 0;
+        size_t blockFrom = 0;
+        while (i < n) {
+            if (i >= blockFrom && n >= 16) {
+                const size_t at = n - i >= 16 ? i : n - 16;
+                const size_t skip = i - at;
+                if ((unitsBelow16 (in + at, 0x800) >> skip) == (0xffffu >> skip)) {
+                    bytes += 2 * (16 - skip) - bitCount (unitsBelow16 (in + at, 0x80) >> skip);
+                    i = at + 16;
+                    continue;
+                }
+                blockFrom = i + 16;
+            }
+            const uint32_t c = static_cast<uint32_t> (in[i]);
+            if (c < 0x80) {
+                const size_t run = asciiRun (in, i, n);
+                bytes += run;
+                i += run;
+                continue;
+            }
+            if (c < 0x800) {
+                bytes += 2;
+            }
+            else if (c - 0xd800 < 0x800) {
+                if (sizeof (_UnitT) != 2 ||
+                    c >= 0xdc00 ||
+                    i + 1 == n ||
+                    static_cast<uint32_t> (in[i + 1]) - 0xdc00 >= 0x400) {
+                    if (errorAt) {
+                        *errorAt = i;
+                    }
+                    return UTF8_INVALID;
+                }
+                bytes += 4;
+                ++i;
+            }
+            else if (c < 0x10000) {
+                bytes += 3;
+            }
+            else if (c < 0x110000) {
+                bytes += 4;
+            }
+            else {
+                if (errorAt) {
+                    *errorAt = i;
+                }
+                return UTF8_INVALID;
+            }
+            ++i;
+        }
+        return bytes;
+    }
+
+    // UTF-8 bytes the (valid) units at 'in' encode to, without checking.
+    // A surrogate counts 2, so a pair is 4.
+    template<typename _UnitT>
+    inline size_t utf8EncodedBytes (const _UnitT* in, size_t n) {
+        size_t bytes = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t c = static_cast<uint32_t> (in[i]);
+            bytes += c < 0x80 ? 1 : c < 0x800 ? 2 : c - 0xd800 < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        }
+        return bytes;
+    }
+
+    // Encodes the units at 'in', which utf8EncodedMeasure() has passed
+    // as 'bytes' long, to 'out'.  Like utf8Decode(), ASCII goes a block at
+    // a time, and blocks below U+0800 without a branch per char.
+    template<typename _UnitT>
+    inline void utf8Encode (unsigned char* out, size_t bytes, const _UnitT* in, size_t n) {
+        unsigned char* const outEnd = out + bytes;
+        size_t i = 0;
+        size_t blockFrom = 0;
+        while (i < n) {
+            if (i >= blockFrom && n >= 16) {
+                const size_t at = n - i >= 16 ? i : n - 16;
+                const size_t skip = i - at;
+                if (skip == 0 && unitsBelow16 (in + i, 0x80) == 0xffff) {
+                    narrow16 (out, in + i);
+                    out += 16;
+                    i += 16;
+                    continue;
+                }
+                if ((unitsBelow16 (in + at, 0x800) >> skip) == (0xffffu >> skip)) {
+                    utf8TwoByteEncode16 (out, in + at, skip);
+                    i = at + 16;
+                    continue;
+                }
+                blockFrom = i + 16;
+            }
+            uint32_t c = static_cast<uint32_t> (in[i]);
+            if (c < 0x80) {
+                if (n - i >= 16 && outEnd - out >= 16) {
+                    narrow16 (out, in + i);
+                    const size_t run = asciiRun (in, i, n);
+                    out += run;
+                    i += run;
+                }
+                else {
+                    *out++ = static_cast<unsigned char> (c);
+                    ++i;
+                }
+                continue;
+            }
+            if (c < 0x800) {
+                out[0] = static_cast<unsigned char> (0xc0 | (c >> 6));
+                out[1] = static_cast<unsigned char> (0x80 | (c & 0x3f));
+                out += 2;
+                ++i;
+                continue;
+            }
+            if (c - 0xd800 < 0x800) {
+                c = 0x10000 + ((c - 0xd800) << 10) + (static_cast<uint32_t> (in[i + 1]) - 0xdc00);
+                ++i;
+            }
+            if (c < 0x10000) {
+                out[0] = static_cast<unsigned char> (0xe0 | (c >> 12));
+                out[1] = static_cast<unsigned char> (0x80 | ((c >> 6) & 0x3f));
+                out[2] = static_cast<unsigned char> (0x80 | (c & 0x3f));
+                out += 3;
+            }
+            else {
+                out[0] = static_cast<unsigned char> (0xf0 | (c >> 18));
+                out[1] = static_cast<unsigned char> (0x80 | ((c >> 12) & 0x3f));
+                out[2] = static_cast<unsigned char> (0x80 | ((c >> 6) & 0x3f));
+                out[3] = static_cast<unsigned char> (0x80 | (c & 0x3f));
+                out += 4;
+            }
+            ++i;
+        }
+    }
+
+    // Writers for BaseStr::place().
+    struct Utf8Decoder {
+        Utf8Decoder (size_t units, const unsigned char* in, size_t n)
+            :
+            m_units (units),
+            m_in    (in),
+            m_n     (n)
+        {
+        }
+
+        void write (wchar_t* out) const {
+            utf8Decode (out, m_units, m_in, m_n);
+        }
+
+        size_t                  m_units;
+        const unsigned char*    m_in;
+        size_t                  m_n;
+    };
+
+    struct Utf8Encoder {
+        Utf8Encoder (size_t bytes, const wchar_t* in, size_t n)
+            :
+            m_bytes (bytes),
+            m_in    (in),
+            m_n     (n)
+        {
+        }
+
+        void write (char* out) const {
+            utf8Encode (reinterpret_cast<unsigned char*> (out), m_bytes, m_in, m_n);
+        }
+
+        size_t          m_bytes;
+        const wchar_t*  m_in;
+        size_t          m_n;
+    };
+
+} // blank namespace
+
+class FixedStrUtf8 {
+public:
+    // Replaces the content of 'out' with the UTF-8 'in' as wchar_t's.
+    // False if 'in' isn't valid UTF-8, with 'out' left alone and the
+    // offset of the first bad sequence in 'errorAt'.
+    template<size_t _AllocSizeT>
+    static bool decode (BaseStr<_AllocSizeT, wchar_t>& out, FixedStrView in, size_t* errorAt = NULL) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*> (in.data());
+        const size_t units = utf8Measure<wchar_t> (bytes, in.length(), errorAt);
+        if (units == UTF8_INVALID) {
+            return false;
+        }
+#ifdef FIXED_STR_STATS
+        const bool wasOverflow = out.isOverflow();
+#endif
+        size_t allocated = out.place (0, units, out.overlaps (bytes, in.length()), Utf8Decoder (units, bytes, in.length()));
+        FIXED_STR_STATS_RECORD (ASSIGN, _AllocSizeT, sizeof (wchar_t), units,
+                                wasOverflow, out.isOverflow(), allocated);
+        (void) allocated;
+        return true;
+    }
+
+    // Replaces the content of 'out' with 'in' as UTF-8.  False if 'in'
+    // has a stray surrogate or a value past U+10FFFF, with 'out' left
+    // alone and the index of that wchar_t in 'errorAt'.
+    template<size_t _AllocSizeT>
+    static bool encode (BaseStr<_AllocSizeT, char>& out, WFixedStrView in, size_t* errorAt = NULL) {
+        const size_t bytes = utf8EncodedMeasure (in.data(), in.length(), errorAt);
+        if (bytes == UTF8_INVALID) {
+            return false;
+        }
+#ifdef FIXED_STR_STATS
+        const bool wasOverflow = out.isOverflow();
+#endif
+        size_t allocated = out.place (0, bytes, out.overlaps (in.data(), in.length() * sizeof (wchar_t)),
+                                      Utf8Encoder (bytes, in.data(), in.length()));
+        FIXED_STR_STATS_RECORD (ASSIGN, _AllocSizeT, sizeof (char), bytes,
+                                wasOverflow, out.isOverflow(), allocated);
+        (void) allocated;
+        return true;
+    }
+
+    // wchar_t's decode() would make of 'in', or npos (setting 'errorAt')
+    // if it isn't valid.
+    static size_t decodedLength (FixedStrView in, size_t* errorAt = NULL) {
+        const size_t units = utf8Measure<wchar_t> (reinterpret_cast<const unsigned char*> (in.data()),
+                                                   in.length(), errorAt);
+        return units == UTF8_INVALID ? FixedStrView::npos : units;
+    }
+
+    // Bytes encode() would make of 'in', or npos (setting 'errorAt').
+    static size_t encodedLength (WFixedStrView in, size_t* errorAt = NULL) {
+        const size_t bytes = utf8EncodedMeasure (in.data(), in.length(), errorAt);
+        return bytes == UTF8_INVALID ? WFixedStrView::npos : bytes;
+    }
+
+    // Whether decode() of 'in' fits the array of a WFixedStr<_AllocSizeT>,
+    // without decoding.  Each byte makes at most one wchar_t, so only a
+    // string longer than the array is looked at, and then only to count.
+    // Assumes 'in' is valid.
+    template<size_t _AllocSizeT>
+    static bool decodeFits (FixedStrView in) {
+        if (in.length() <= _AllocSizeT) {
+            return true;
+        }
+        // 4 bytes make at least one wchar_t.
+        if (in.length() > 4 * _AllocSizeT) {
+            return false;
+        }
+        return utf8Units<wchar_t> (reinterpret_cast<const unsigned char*> (in.data()), in.length()) <= _AllocSizeT;
+    }
+
+    // Whether encode() of 'in' fits the array of a FixedStr<_AllocSizeT>,
+    // without encoding.  A wchar_t makes 1 to 4 bytes (1 to 3 for each
+    // half of a surrogate pair), so only lengths in between are counted.
+    // Assumes 'in' is valid.
+    template<size_t _AllocSizeT>
+    static bool encodeFits (WFixedStrView in) {
+        if (in.length() * (sizeof (wchar_t) == 2 ? 3 : 4) <= _AllocSizeT) {
+            return true;
+        }
+        if (in.length() > _AllocSizeT) {
+            return false;
+        }
+        return utf8EncodedBytes (in.data(), in.length()) <= _AllocSizeT;
+    }
+};
+
+#endif
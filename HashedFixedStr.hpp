@@ -0,0 +1,236 @@
+#ifndef HASHED_FIXED_STR_H
+#define HASHED_FIXED_STR_H
+
+#include <cstdarg>
+#include <functional>
+
+#include "FixedStr.hpp"
+
+/*
+ *  HashedFixedStr
+ *  A FixedStr that remembers its hash, for keys that get looked up many
+ *  times.  The hash is worked out the first time it's asked for and
+ *  thrown away by anything that changes the content (assign, append,
+ *  format, fmt, =, +=, clear, to_lower, to_upper), so it's never stale.
+ *  It's the same value as the hash of a plain FixedStr or view with the
+ *  same content.
+ *
+ *      std::unordered_set<HashedFixedStr<24> > seen;
+ *
+ *  The string is held, not inherited, so there's no way to change it
+ *  behind the cache's back; str() gives read-only access to the FixedStr
+ *  for anything not repeated here.
+ */
+
+template<typename _StrT, typename _CharT>
+class BaseHashedStr {
+public:
+    typedef BaseStrView<_CharT> View;
+
+    BaseHashedStr()
+        :
+        m_hash (0)
+    {
+    }
+
+    explicit BaseHashedStr (const _CharT* newStr)
+        :
+        m_str  (newStr),
+        m_hash (0)
+    {
+    }
+
+    // Also takes any FixedStr/WFixedStr.
+    explicit BaseHashedStr (View newStr)
+        :
+        m_str  (newStr),
+        m_hash (0)
+    {
+    }
+
+    // Anything the string itself can be assigned from.
+    template<typename _ValueT>
+    BaseHashedStr<_StrT, _CharT>& operator= (const _ValueT& rhs) {
+        m_str = rhs;
+        m_hash = 0;
+        return *this;
+    }
+
+    const _StrT& str() const {
+        return m_str;
+    }
+
+    const _CharT* c_str() const {
+        return m_str.c_str();
+    }
+
+    size_t length() const {
+        return m_str.length();
+    }
+
+    bool empty() const {
+        return m_str.empty();
+    }
+
+    View view() const {
+        return m_str.view();
+    }
+
+    operator View() const {
+        return view();
+    }
+
+    // Worked out once per change.  (A content that really hashes to 0 is
+    // just worked out every time.)
+    size_t hash() const {
+        if (m_hash == 0) {
+            m_hash = m_str.hash();
+        }
+        return m_hash;
+    }
+
+    // Cached hashes that differ settle it without looking at the chars.
+    bool equals (const BaseHashedStr<_StrT, _CharT>& rhs) const {
+        if (m_hash != 0 && rhs.m_hash != 0 && m_hash != rhs.m_hash) {
+            return false;
+        }
+        return view() == rhs.view();
+    }
+
+    int compare (View rhs) const {
+        return view().compare (rhs);
+    }
+
+    // Changes; each one drops the cached hash.
+
+    template<typename... _ArgsT>
+    void assign (const _ArgsT&... args) {
+        m_str.assign (args...);
+        m_hash = 0;
+    }
+
+    template<typename... _ArgsT>
+    BaseHashedStr<_StrT, _CharT>& append (const _ArgsT&... args) {
+        m_str.append (args...);
+        m_hash = 0;
+        return *this;
+    }
+
+    template<typename _ValueT>
+    BaseHashedStr<_StrT, _CharT>& operator+= (const _ValueT& value) {
+        m_str += value;
+        m_hash = 0;
+        return *this;
+    }
+
+    template<typename... _ArgsT>
+    bool fmt (const _CharT* formatStr, const _ArgsT&... args) {
+        m_hash = 0;
+        return m_str.fmt (formatStr, args...);
+    }
+
+    bool format (const _CharT* formatStr, ...) {
+        va_list args;
+        va_start (args, formatStr);
+        m_hash = 0;
+        bool ok = m_str.vformat (formatStr, args);
+        va_end (args);
+        return ok;
+    }
+
+    void clear() {
+        m_str.clear();
+        m_hash = 0;
+    }
+
+    BaseHashedStr<_StrT, _CharT>& to_lower() {
+        m_str.to_lower();
+        m_hash = 0;
+        return *this;
+    }
+
+    BaseHashedStr<_StrT, _CharT>& to_upper() {
+        m_str.to_upper();
+        m_hash = 0;
+        return *this;
+    }
+
+    // Storage only; the content (and hash) stay.
+
+    size_t capacity() const {
+        return m_str.capacity();
+    }
+
+    void reserve (size_t n) {
+        m_str.reserve (n);
+    }
+
+    void shrink_to_fit() {
+        m_str.shrink_to_fit();
+    }
+
+private:
+    _StrT           m_str;
+    mutable size_t  m_hash;
+};
+
+template<size_t _AllocSizeT>
+using HashedFixedStr = BaseHashedStr<FixedStr<_AllocSizeT>, char>;
+
+template<size_t _AllocSizeT>
+using WHashedFixedStr = BaseHashedStr<WFixedStr<_AllocSizeT>, wchar_t>;
+
+template<typename _StrT, typename _CharT>
+bool operator==(const BaseHashedStr<_StrT, _CharT>& lhs, const BaseHashedStr<_StrT, _CharT>& rhs)
+{
+    return lhs.equals (rhs);
+}
+
+template<typename _StrT, typename _CharT>
+bool operator!=(const BaseHashedStr<_StrT, _CharT>& lhs, const BaseHashedStr<_StrT, _CharT>& rhs)
+{
+    return !lhs.equals (rhs);
+}
+
+template<typename _StrT, typename _CharT>
+bool operator<(const BaseHashedStr<_StrT, _CharT>& lhs, const BaseHashedStr<_StrT, _CharT>& rhs)
+{
+    return lhs.compare (rhs) < 0;
+}
+
+// With views (and so FixedStrs), for lookups with FixedStrHash.
+
+template<typename _StrT, typename _CharT>
+bool operator==(const BaseHashedStr<_StrT, _CharT>& lhs, typename BaseHashedStr<_StrT, _CharT>::View rhs)
+{
+    return lhs.view() == rhs;
+}
+
+template<typename _StrT, typename _CharT>
+bool operator==(typename BaseHashedStr<_StrT, _CharT>::View lhs, const BaseHashedStr<_StrT, _CharT>& rhs)
+{
+    return lhs == rhs.view();
+}
+
+template<typename _StrT, typename _CharT>
+bool operator!=(const BaseHashedStr<_StrT, _CharT>& lhs, typename BaseHashedStr<_StrT, _CharT>::View rhs)
+{
+    return !(lhs.view() == rhs);
+}
+
+template<typename _StrT, typename _CharT>
+bool operator!=(typename BaseHashedStr<_StrT, _CharT>::View lhs, const BaseHashedStr<_StrT, _CharT>& rhs)
+{
+    return !(lhs == rhs.view());
+}
+
+namespace std {
+    template<typename _StrT, typename _CharT>
+    struct hash<BaseHashedStr<_StrT, _CharT> > {
+        size_t operator() (const BaseHashedStr<_StrT, _CharT>& str) const {
+            return str.hash();
+        }
+    };
+}
+
+#endif
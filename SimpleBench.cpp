@@ -0,0 +1,233 @@
+
+/*
+ *  SimpleBench.cpp
+ *  FixedStr
+ *
+ */
+
+#include "SimpleBench.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define SIMPLE_BENCH_TSC 1
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define SIMPLE_BENCH_TSC 1
+#endif
+
+#if !defined(__GNUC__)
+volatile char* volatile SimpleBench::s_sink = NULL;
+#endif
+
+namespace {
+    // Nearest-rank percentile of sorted values.
+    double percentile (const std::vector<double>& sorted, double pct) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t idx = static_cast<size_t> (pct / 100.0 * (sorted.size() - 1) + 0.5);
+        return sorted[idx];
+    }
+
+    // Quotes for CSV/JSON.  Names are plain ASCII so this only needs
+    // to deal with quotes and backslashes.
+    std::string quoted (const std::string& str) {
+        std::string toRet = "\"";
+        for (size_t i = 0; i < str.size(); ++i) {
+            if (str[i] == '"' || str[i] == '\\') {
+                toRet += '\\';
+            }
+            toRet += str[i];
+        }
+        toRet += '"';
+        return toRet;
+    }
+
+    std::string csvQuoted (const std::string& str) {
+        std::string toRet = "\"";
+        for (size_t i = 0; i < str.size(); ++i) {
+            if (str[i] == '"') {
+                toRet += '"';
+            }
+            toRet += str[i];
+        }
+        toRet += '"';
+        return toRet;
+    }
+}
+
+SimpleBench::SimpleBench()
+    :
+    m_samples     (25),
+    m_minSampleNs (50000) {
+}
+
+bool SimpleBench::parseArgs (int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp (arg, "--csv") == 0 && hasValue) {
+            m_csvPath = argv[++i];
+        }
+        else if (strcmp (arg, "--json") == 0 && hasValue) {
+            m_jsonPath = argv[++i];
+        }
+        else if (strcmp (arg, "--label") == 0 && hasValue) {
+            m_label = argv[++i];
+        }
+        else if (strcmp (arg, "--samples") == 0 && hasValue) {
+            m_samples = strtoul (argv[++i], NULL, 10);
+            if (m_samples == 0) {
+                m_samples = 1;
+            }
+        }
+        else if (arg[0] == '-') {
+            fprintf (stderr, "usage: %s [--csv file] [--json file] [--label text] "
+                     "[--samples n] [filter]\n", argv[0]);
+            return false;
+        }
+        else {
+            m_filter = arg;
+        }
+    }
+    return true;
+}
+
+bool SimpleBench::selected (const char* group, const char* name) const {
+    if (m_filter.empty()) {
+        return true;
+    }
+    std::string full = group;
+    full += '/';
+    full += name;
+    return full.find (m_filter) != std::string::npos;
+}
+
+bool SimpleBench::groupSelected (const char* group) const {
+    if (m_filter.empty()) {
+        return true;
+    }
+    std::string prefix = group;
+    prefix += '/';
+    return prefix.find (m_filter) != std::string::npos ||
+           m_filter.compare (0, prefix.size(), prefix) == 0;
+}
+
+double SimpleBench::nowNs() {
+    return static_cast<double> (std::chrono::duration_cast<std::chrono::nanoseconds> (
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t SimpleBench::ticks() {
+#ifdef SIMPLE_BENCH_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t> (nowNs());
+#endif
+}
+
+double SimpleBench::nsPerTick() {
+#ifdef SIMPLE_BENCH_TSC
+    // Calibrated once against the steady clock.
+    struct Calibrate {
+        static double run() {
+            double startNs = nowNs();
+            uint64_t start = ticks();
+            while (nowNs() - startNs < 20e6) {
+            }
+            double elapsedNs = nowNs() - startNs;
+            return elapsedNs / (ticks() - start);
+        }
+    };
+    static const double ratio = Calibrate::run();
+    return ratio;
+#else
+    return 1.0;
+#endif
+}
+
+void SimpleBench::addResult (const char* group, const char* name, size_t opsPerSample,
+                             std::vector<double>& nsPerOp) {
+    std::sort (nsPerOp.begin(), nsPerOp.end());
+    Result res;
+    res.group =        group;
+    res.name =         name;
+    res.opsPerSample = opsPerSample;
+    res.samples =      nsPerOp.size();
+    res.minNs =        nsPerOp.empty() ? 0 : nsPerOp[0];
+    res.p50Ns =        percentile (nsPerOp, 50);
+    res.p90Ns =        percentile (nsPerOp, 90);
+    res.p99Ns =        percentile (nsPerOp, 99);
+    double total = 0;
+    for (size_t i = 0; i < nsPerOp.size(); ++i) {
+        total += nsPerOp[i];
+    }
+    res.meanNs = nsPerOp.empty() ? 0 : total / nsPerOp.size();
+    m_results.push_back (res);
+
+    printf ("%-12s %-44s %10.2f ns/op  (min %.2f  p90 %.2f  p99 %.2f)\n",
+            group, name, res.p50Ns, res.minNs, res.p90Ns, res.p99Ns);
+    fflush (stdout);
+}
+
+void SimpleBench::report (const char* group, const char* name, size_t ops, double elapsedNs) {
+    if (!selected (group, name)) {
+        return;
+    }
+    std::vector<double> nsPerOp (1, ops ? elapsedNs / ops : 0);
+    addResult (group, name, ops, nsPerOp);
+}
+
+bool SimpleBench::writeCsv (const char* path) const {
+    FILE* f = fopen (path, "w");
+    if (!f) {
+        return false;
+    }
+    fprintf (f, "label,group,name,ops_per_sample,samples,min_ns,p50_ns,p90_ns,p99_ns,mean_ns\n");
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const Result& res = m_results[i];
+        fprintf (f, "%s,%s,%s,%lu,%lu,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                 csvQuoted (m_label).c_str(), csvQuoted (res.group).c_str(),
+                 csvQuoted (res.name).c_str(),
+                 static_cast<unsigned long> (res.opsPerSample),
+                 static_cast<unsigned long> (res.samples),
+                 res.minNs, res.p50Ns, res.p90Ns, res.p99Ns, res.meanNs);
+    }
+    return fclose (f) == 0;
+}
+
+bool SimpleBench::writeJson (const char* path) const {
+    FILE* f = fopen (path, "w");
+    if (!f) {
+        return false;
+    }
+    fprintf (f, "{\n  \"label\": %s,\n  \"results\": [\n", quoted (m_label).c_str());
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const Result& res = m_results[i];
+        fprintf (f, "    {\"group\": %s, \"name\": %s, \"ops_per_sample\": %lu, \"samples\": %lu, "
+                 "\"min_ns\": %.3f, \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, "
+                 "\"mean_ns\": %.3f}%s\n",
+                 quoted (res.group).c_str(), quoted (res.name).c_str(),
+                 static_cast<unsigned long> (res.opsPerSample),
+                 static_cast<unsigned long> (res.samples),
+                 res.minNs, res.p50Ns, res.p90Ns, res.p99Ns, res.meanNs,
+                 i + 1 < m_results.size() ? "," : "");
+    }
+    fprintf (f, "  ]\n}\n");
+    return fclose (f) == 0;
+}
+
+bool SimpleBench::writeOutputs() const {
+    bool ok = true;
+    if (!m_csvPath.empty()) {
+        ok = writeCsv (m_csvPath.c_str()) && ok;
+    }
+    if (!m_jsonPath.empty()) {
+        ok = writeJson (m_jsonPath.c_str()) && ok;
+    }
+    return ok;
+}
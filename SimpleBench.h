@@ -0,0 +1,148 @@
+#ifndef SIMPLE_BENCH_H
+#define SIMPLE_BENCH_H
+
+/*
+ *  SimpleBench.h
+ *  FixedStr
+ *
+ *  Very simple benchmark 'framework', in the same spirit as SimpleTest.
+ *  Kept separate from the unit tests; see bench.cpp.
+ *
+ *  run() times a single operation:  it finds a batch size where one batch
+ *  takes long enough to time reliably, then times a number of batches
+ *  (samples) and reports ns/op percentiles across them.  Results can also
+ *  be written as CSV or JSON so runs can be compared between versions.
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+class SimpleBench {
+public:
+    struct Result {
+        std::string group;
+        std::string name;
+        size_t      opsPerSample;
+        size_t      samples;
+        double      minNs;
+        double      p50Ns;
+        double      p90Ns;
+        double      p99Ns;
+        double      meanNs;
+    };
+
+    SimpleBench();
+
+    // Understands [--csv file] [--json file] [--label text] [--samples n]
+    // [filter].  Only benchmarks whose "group/name" contains 'filter' run.
+    // Returns false (after printing usage) if the args are bad.
+    bool parseArgs (int argc, char** argv);
+
+    // Times fn(); 'fn' should do one operation and hand its result to
+    // doNotOptimize().
+    template<typename F>
+    void run (const char* group, const char* name, F fn) {
+        if (!selected (group, name)) {
+            return;
+        }
+        // double the batch until it's long enough to time.  This
+        // doubles as the warm up.
+        size_t batch = 1;
+        while (timeBatch (fn, batch) < m_minSampleNs && batch < (static_cast<size_t> (1) << 30)) {
+            batch *= 2;
+        }
+        std::vector<double> nsPerOp;
+        nsPerOp.reserve (m_samples);
+        for (size_t s = 0; s < m_samples; ++s) {
+            nsPerOp.push_back (timeBatch (fn, batch) / batch);
+        }
+        addResult (group, name, batch, nsPerOp);
+    }
+
+    // Records a single timed run of something too big for run(),
+    // e.g. sorting a million strings.
+    void report (const char* group, const char* name, size_t ops, double elapsedNs);
+
+    // Writes everything recorded so far.  Called by bench.cpp after
+    // the benchmarks if the args asked for it.
+    bool writeCsv  (const char* path) const;
+    bool writeJson (const char* path) const;
+    bool writeOutputs() const;
+
+    // Is "group/name" selected by the filter?
+    bool selected (const char* group, const char* name) const;
+
+    // Could anything in 'group' be selected?  Lets expensive setup
+    // be skipped.
+    bool groupSelected (const char* group) const;
+
+    // Monotonic clock in nanoseconds.
+    static double nowNs();
+
+    // Makes the compiler believe 'value' is used, so the work producing
+    // it can't be thrown away.
+    template<typename T>
+    static void doNotOptimize (const T& value) {
+#if defined(__GNUC__)
+        asm volatile ("" : : "r,m" (value) : "memory");
+#else
+        s_sink = const_cast<volatile char*> (reinterpret_cast<const volatile char*> (&value));
+        clobberMemory();
+#endif
+    }
+
+    // Makes the compiler believe all memory may have been read and written.
+    static void clobberMemory() {
+#if defined(__GNUC__)
+        asm volatile ("" : : : "memory");
+#else
+        _ReadWriteBarrier();
+#endif
+    }
+
+protected:
+    // Raw timestamp:  TSC ticks on x86, otherwise nanoseconds.
+    static uint64_t ticks();
+
+    // Converts ticks() differences to nanoseconds.
+    static double nsPerTick();
+
+private:
+    template<typename F>
+    double timeBatch (F& fn, size_t batch) {
+        clobberMemory();
+        uint64_t start = ticks();
+        for (size_t i = 0; i < batch; ++i) {
+            fn();
+        }
+        uint64_t end = ticks();
+        clobberMemory();
+        return (end - start) * nsPerTick();
+    }
+
+    void addResult (const char* group, const char* name, size_t opsPerSample,
+                    std::vector<double>& nsPerOp);
+
+    std::vector<Result> m_results;
+    std::string         m_filter;
+    std::string         m_label;
+    std::string         m_csvPath;
+    std::string         m_jsonPath;
+    size_t              m_samples;
+    double              m_minSampleNs;
+
+#if !defined(__GNUC__)
+    static volatile char* volatile s_sink;
+#endif
+
+    // disable these...
+    SimpleBench(const SimpleBench& other);
+    SimpleBench& operator=(const SimpleBench& other);
+};
+
+#endif
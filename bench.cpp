@@ -0,0 +1,33 @@
+#include <cstdio>
+#include <iostream>
+#include "FixedStr.hpp"
+#include "FixedStrBench.h"
+
+using std::cout;
+using std::endl;
+
+//
+// Driver app for running benchmarks.  Build optimized, e.g.
+//   g++ -O2 -pthread bench.cpp SimpleBench.cpp FixedStrBench.cpp
+//
+//   bench [--csv file] [--json file] [--label text] [--samples n] [filter]
+//
+int main(int argc, char** argv)
+{
+    try {
+        FixedStrBench bench;
+        if (!bench.parseArgs (argc, argv)) {
+            return 2;
+        }
+        bench.runBenchmarks();
+        if (!bench.writeOutputs()) {
+            cout << "Couldn't write results" << endl;
+            return 1;
+        }
+    }
+    catch (const std::exception& ex) {
+        cout << "Benchmarks failed:  " << ex.what() << endl;
+        return 1;
+    }
+    return 0;
+}